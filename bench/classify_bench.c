@@ -0,0 +1,151 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "text_classifier.h"
+
+#define BENCH_ROUNDS 3
+
+typedef struct {
+  const char *name;
+  double control_fraction;
+} Scenario;
+
+/* Byte-for-byte copy of the pre-SIMD classify_buffer loop, kept as the baseline. */
+static bool legacy_is_binary(const unsigned char *data, size_t len) {
+  size_t binary = 0;
+  for (size_t i = 0; i < len; ++i) {
+    unsigned char ch = data[i];
+    if (ch == '\n' || ch == '\r' || ch == '\t') {
+      continue;
+    }
+    if (ch < 0x09 || (ch > 0x0D && ch < 0x20) || ch == 0x7F) {
+      binary++;
+      if (binary * 5 > len) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+static uint64_t next_random(uint64_t *state) {
+  uint64_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  *state = x;
+  return x;
+}
+
+static void fill_buffer(unsigned char *buffer, size_t len, double control_fraction) {
+  static const char text[] = "the quick brown fox jumps over the lazy dog,0123456789;\n\t";
+  uint64_t state = 0x2545F4914F6CDD1DULL;
+  uint64_t threshold = (uint64_t) (control_fraction * 1000000.0);
+  for (size_t i = 0; i < len; ++i) {
+    uint64_t r = next_random(&state);
+    if (r % 1000000ULL < threshold) {
+      buffer[i] = (unsigned char) ((r >> 32) % 9);
+    } else {
+      buffer[i] = (unsigned char) text[(r >> 40) % (sizeof text - 1)];
+    }
+  }
+}
+
+typedef bool (*ClassifyFn)(const unsigned char *data, size_t len);
+
+static bool sampled_adapter(const unsigned char *data, size_t len) {
+  return text_classifier_is_binary_sampled(data, len, NULL);
+}
+
+static double best_of(ClassifyFn fn, const unsigned char *data, size_t len, bool *verdict) {
+  double best = -1.0;
+  for (int round = 0; round < BENCH_ROUNDS; ++round) {
+    double start = now_seconds();
+    *verdict = fn(data, len);
+    double elapsed = now_seconds() - start;
+    if (best < 0.0 || elapsed < best) {
+      best = elapsed;
+    }
+  }
+  return best;
+}
+
+static void report(const char *label, double seconds, size_t len, bool verdict, double baseline) {
+  double gbps = seconds > 0.0 ? (double) len / seconds / 1e9 : 0.0;
+  printf("  %-16s %10.3f ms  %8.2f GB/s effective  %-6s  x%.1f\n", label, seconds * 1e3, gbps,
+         verdict ? "binary" : "text", seconds > 0.0 ? baseline / seconds : 0.0);
+}
+
+int main(int argc, char **argv) {
+  size_t size_mb = 256;
+  if (argc > 1) {
+    char *end = NULL;
+    unsigned long long parsed = strtoull(argv[1], &end, 10);
+    if (!end || *end != '\0' || parsed == 0) {
+      fprintf(stderr, "usage: %s [size-in-MiB]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+    size_mb = (size_t) parsed;
+  }
+  size_t len = size_mb * 1024U * 1024U;
+  unsigned char *buffer = malloc(len);
+  if (!buffer) {
+    fprintf(stderr, "unable to allocate %zu MiB\n", size_mb);
+    return EXIT_FAILURE;
+  }
+
+  static const Scenario scenarios[] = {
+      {"text (0.1% control)", 0.001},
+      {"near threshold (19%)", 0.19},
+      {"near threshold (21%)", 0.21},
+      {"binary (40% control)", 0.40},
+  };
+
+  printf("classify_bench: %zu MiB buffer, backend=%s, best of %d rounds\n", size_mb, text_classifier_backend(),
+         BENCH_ROUNDS);
+  int mismatches = 0;
+  for (size_t i = 0; i < sizeof scenarios / sizeof scenarios[0]; ++i) {
+    fill_buffer(buffer, len, scenarios[i].control_fraction);
+    printf("%s\n", scenarios[i].name);
+
+    bool legacy = false;
+    bool exact = false;
+    bool sampled = false;
+    double legacy_s = best_of(legacy_is_binary, buffer, len, &legacy);
+    double exact_s = best_of(text_classifier_is_binary_exact, buffer, len, &exact);
+    double sampled_s = best_of(sampled_adapter, buffer, len, &sampled);
+    size_t sampled_bytes = 0;
+    text_classifier_is_binary_sampled(buffer, len, &sampled_bytes);
+
+    report("legacy scalar", legacy_s, len, legacy, legacy_s);
+    report("simd exact", exact_s, len, exact, legacy_s);
+    report("simd sampled", sampled_s, len, sampled, legacy_s);
+    printf("  sampled %zu of %zu bytes (%.3f%%)\n", sampled_bytes, len,
+           100.0 * (double) sampled_bytes / (double) len);
+    if (exact != legacy || sampled != legacy) {
+      printf("  MISMATCH against legacy verdict\n");
+      mismatches++;
+    }
+  }
+
+  double start = now_seconds();
+  size_t control = text_classifier_count_control(buffer, len);
+  double elapsed = now_seconds() - start;
+  printf("raw control-byte count: %zu in %.3f ms (%.2f GB/s)\n", control, elapsed * 1e3,
+         elapsed > 0.0 ? (double) len / elapsed / 1e9 : 0.0);
+
+  free(buffer);
+  return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
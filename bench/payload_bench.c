@@ -0,0 +1,206 @@
+#define _GNU_SOURCE
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+
+#include "large_buffer.h"
+#include "text_classifier.h"
+
+#define BENCH_ROUNDS 3
+
+/* Receive-buffer setups compared: the old malloc + memset path, the same on 4 KiB pages without the
+ * memset, and large_buffer_alloc. Each then scans the buffer the way a rank does: one sequential pass
+ * (control-byte count, as classify and escape do) and one chunk-indexing pass that jumps between
+ * chunk starts in random order. */
+typedef enum { SETUP_MEMSET, SETUP_SMALL_PAGES, SETUP_LARGE_BUFFER } Setup;
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+static uint64_t next_random(uint64_t *state) {
+  uint64_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  *state = x;
+  return x;
+}
+
+/* kB of this process's anonymous memory currently on transparent huge pages. */
+static long anon_huge_kb(void) {
+  FILE *fp = fopen("/proc/self/smaps_rollup", "r");
+  if (!fp) {
+    return -1;
+  }
+  char line[256];
+  long kb = -1;
+  while (fgets(line, sizeof line, fp)) {
+    if (sscanf(line, "AnonHugePages: %ld kB", &kb) == 1) {
+      break;
+    }
+  }
+  fclose(fp);
+  return kb;
+}
+
+static char *setup_buffer(Setup setup, size_t len, LargeBuffer *large, size_t *mapped) {
+  *mapped = 0;
+  if (setup == SETUP_LARGE_BUFFER) {
+    return large_buffer_alloc(large, len) == 0 ? large->data : NULL;
+  }
+  size_t span = (len + 4095) / 4096 * 4096;
+  char *data = mmap(NULL, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (data == MAP_FAILED) {
+    return NULL;
+  }
+#ifdef MADV_NOHUGEPAGE
+  madvise(data, span, MADV_NOHUGEPAGE);
+#endif
+  *mapped = span;
+  if (setup == SETUP_MEMSET) {
+    memset(data, 0, len);
+  }
+  return data;
+}
+
+static void release_buffer(Setup setup, char *data, LargeBuffer *large, size_t mapped) {
+  if (setup == SETUP_LARGE_BUFFER) {
+    large_buffer_free(large);
+  } else if (data) {
+    munmap(data, mapped);
+  }
+}
+
+/* Visits every chunk start once in a shuffled order and reads a cache line there. */
+static uint64_t index_chunks(const char *data, const size_t *order, size_t chunks, size_t chunk_size) {
+  uint64_t sum = 0;
+  for (size_t i = 0; i < chunks; ++i) {
+    const char *chunk = data + order[i] * chunk_size;
+    for (size_t b = 0; b < 64; b += 8) {
+      sum += (unsigned char) chunk[b];
+    }
+  }
+  return sum;
+}
+
+typedef struct {
+  double receive;
+  double scan;
+  double index;
+  long huge_kb;
+  const char *backing;
+} Result;
+
+static int run_setup(Setup setup, const char *source, size_t len, const size_t *order, size_t chunks,
+                     size_t chunk_size, Result *best) {
+  memset(best, 0, sizeof *best);
+  for (int round = 0; round < BENCH_ROUNDS; ++round) {
+    LargeBuffer large;
+    size_t mapped = 0;
+    double start = now_seconds();
+    char *data = setup_buffer(setup, len, &large, &mapped);
+    if (!data) {
+      return -1;
+    }
+    /* Stands in for broadcast_payload writing the received bytes. */
+    memcpy(data, source, len);
+    double receive = now_seconds() - start;
+
+    start = now_seconds();
+    size_t control = text_classifier_count_control((const unsigned char *) data, len);
+    double scan = now_seconds() - start;
+
+    start = now_seconds();
+    uint64_t sum = index_chunks(data, order, chunks, chunk_size);
+    double index = now_seconds() - start;
+    if (control == SIZE_MAX || sum == UINT64_MAX) {
+      printf("unreachable\n");
+    }
+
+    if (round == 0 || receive < best->receive) {
+      best->receive = receive;
+    }
+    if (round == 0 || scan < best->scan) {
+      best->scan = scan;
+    }
+    if (round == 0 || index < best->index) {
+      best->index = index;
+    }
+    best->huge_kb = anon_huge_kb();
+    best->backing = setup == SETUP_LARGE_BUFFER ? large_buffer_kind_name(large.kind) : "4k";
+    release_buffer(setup, data, &large, mapped);
+  }
+  return 0;
+}
+
+static void report(const char *label, const Result *r, size_t len, const Result *baseline) {
+  printf("  %-22s %-7s receive %8.1f ms  scan %6.2f GB/s  index %8.1f ms (x%.2f)  huge pages %ld MiB\n", label,
+         r->backing, r->receive * 1e3, r->scan > 0.0 ? (double) len / r->scan / 1e9 : 0.0, r->index * 1e3,
+         r->index > 0.0 ? baseline->index / r->index : 0.0, r->huge_kb > 0 ? r->huge_kb / 1024 : 0);
+}
+
+int main(int argc, char **argv) {
+  size_t size_mb = 256;
+  if (argc > 1) {
+    char *end = NULL;
+    unsigned long long parsed = strtoull(argv[1], &end, 10);
+    if (!end || *end != '\0' || parsed == 0) {
+      fprintf(stderr, "usage: %s [size-in-MiB]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+    size_mb = (size_t) parsed;
+  }
+  size_t len = size_mb * 1024U * 1024U;
+  const size_t chunk_size = 2048;
+  size_t chunks = len / chunk_size;
+  char *source = malloc(len);
+  size_t *order = malloc(chunks * sizeof *order);
+  if (!source || !order) {
+    fprintf(stderr, "unable to allocate %zu MiB\n", size_mb);
+    return EXIT_FAILURE;
+  }
+  static const char text[] = "the quick brown fox jumps over the lazy dog,0123456789;\n\t";
+  uint64_t state = 0x2545F4914F6CDD1DULL;
+  for (size_t i = 0; i < len; ++i) {
+    source[i] = text[next_random(&state) % (sizeof text - 1)];
+  }
+  for (size_t i = 0; i < chunks; ++i) {
+    order[i] = i;
+  }
+  for (size_t i = chunks; i > 1; --i) {
+    size_t j = (size_t) (next_random(&state) % i);
+    size_t tmp = order[i - 1];
+    order[i - 1] = order[j];
+    order[j] = tmp;
+  }
+
+  printf("payload_bench: %zu MiB payload, %zu chunks of %zu bytes, best of %d rounds\n", size_mb, chunks, chunk_size,
+         BENCH_ROUNDS);
+  static const struct {
+    Setup setup;
+    const char *label;
+  } setups[] = {
+      {SETUP_MEMSET, "malloc + memset"},
+      {SETUP_SMALL_PAGES, "4k pages, no memset"},
+      {SETUP_LARGE_BUFFER, "large_buffer_alloc"},
+  };
+  Result results[3];
+  for (size_t i = 0; i < 3; ++i) {
+    if (run_setup(setups[i].setup, source, len, order, chunks, chunk_size, &results[i]) != 0) {
+      fprintf(stderr, "unable to map %zu MiB\n", size_mb);
+      return EXIT_FAILURE;
+    }
+    report(setups[i].label, &results[i], len, &results[0]);
+  }
+  free(order);
+  free(source);
+  return EXIT_SUCCESS;
+}
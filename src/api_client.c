@@ -284,6 +284,17 @@ static char *build_payload_for_provider(const ProgramConfig *config, const char
   }
 }
 
+static int progress_callback(void *userp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal,
+                             curl_off_t ulnow) {
+  (void) dltotal;
+  (void) dlnow;
+  (void) ultotal;
+  (void) ulnow;
+  ApiClient *client = userp;
+  client->progress_hook(client->progress_data);
+  return 0;
+}
+
 static void sleep_millis(long millis) {
   if (millis <= 0) {
     return;
@@ -294,13 +305,7 @@ static void sleep_millis(long millis) {
   nanosleep(&ts, NULL);
 }
 
-int api_client_init(ApiClient *client, const ProgramConfig *config, char **error_out) {
-  if (!client || !config) {
-    assign_error(error_out, "internal: client/config missing");
-    return -1;
-  }
-  memset(client, 0, sizeof *client);
-  client->config = config;
+static int resolve_api_key(ApiClient *client, const ProgramConfig *config, char **error_out) {
   const char *key = config->explicit_api_key;
   if (!key && config->api_key_env) {
     key = getenv(config->api_key_env);
@@ -316,6 +321,19 @@ int api_client_init(ApiClient *client, const ProgramConfig *config, char **error
       return -1;
     }
   }
+  return 0;
+}
+
+int api_client_init(ApiClient *client, const ProgramConfig *config, char **error_out) {
+  if (!client || !config) {
+    assign_error(error_out, "internal: client/config missing");
+    return -1;
+  }
+  memset(client, 0, sizeof *client);
+  client->config = config;
+  if (resolve_api_key(client, config, error_out) != 0) {
+    return -1;
+  }
   CURLcode init = curl_global_init(CURL_GLOBAL_DEFAULT);
   if (init != CURLE_OK) {
     assign_error(error_out, "curl init failed: %s", curl_easy_strerror(init));
@@ -379,7 +397,13 @@ int api_client_send(ApiClient *client, const char *chunk, size_t chunk_len, size
     if (response) {
       sb_reset(response);
     }
-    CURL *curl = curl_easy_init();
+    CURL *curl = client->curl_handle;
+    if (curl) {
+      curl_easy_reset(curl);
+    } else {
+      curl = curl_easy_init();
+      client->curl_handle = curl;
+    }
     if (!curl) {
       assign_error(error_out, "curl handle allocation failed");
       free(payload);
@@ -394,7 +418,6 @@ int api_client_send(ApiClient *client, const char *chunk, size_t chunk_len, size
     if (client->config->provider == API_PROVIDER_ANTHROPIC) {
       if (!client->api_key) {
         curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
         free(payload);
         assign_error(error_out, "Anthropic-compatible endpoints require an API key");
         if (error_type) {
@@ -406,7 +429,6 @@ int api_client_send(ApiClient *client, const char *chunk, size_t chunk_len, size
       char *key_header = malloc(key_needed);
       if (!key_header) {
         curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
         free(payload);
         assign_error(error_out, "unable to allocate x-api-key header");
         if (error_type) {
@@ -424,7 +446,6 @@ int api_client_send(ApiClient *client, const char *chunk, size_t chunk_len, size
       char *version_header = malloc(version_len);
       if (!version_header) {
         curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
         free(payload);
         assign_error(error_out, "unable to allocate anthropic-version header");
         if (error_type) {
@@ -440,7 +461,6 @@ int api_client_send(ApiClient *client, const char *chunk, size_t chunk_len, size
       char *auth = malloc(needed);
       if (!auth) {
         curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
         free(payload);
         assign_error(error_out, "unable to build auth header");
         if (error_type) {
@@ -464,12 +484,16 @@ int api_client_send(ApiClient *client, const char *chunk, size_t chunk_len, size
     if (client->config->verbosity >= 2) {
       curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
     }
+    if (client->progress_hook) {
+      curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, progress_callback);
+      curl_easy_setopt(curl, CURLOPT_XFERINFODATA, client);
+      curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+    }
 
     CURLcode rc = curl_easy_perform(curl);
     long status_code = 0;
     curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status_code);
     curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
 
     if (rc == CURLE_OK && status_code >= 200 && status_code < 300) {
       free(payload);
@@ -491,6 +515,9 @@ int api_client_send(ApiClient *client, const char *chunk, size_t chunk_len, size
       break;
     }
 
+    if (client->progress_hook) {
+      client->progress_hook(client->progress_data);
+    }
     sleep_millis(delay);
     if (delay < max_delay) {
       long next = delay * 2;
@@ -505,10 +532,25 @@ int api_client_send(ApiClient *client, const char *chunk, size_t chunk_len, size
   return -1;
 }
 
+int api_client_rebind(ApiClient *client, const ProgramConfig *config, char **error_out) {
+  if (!client || !config) {
+    assign_error(error_out, "internal: client/config missing");
+    return -1;
+  }
+  free(client->api_key);
+  client->api_key = NULL;
+  client->config = config;
+  return resolve_api_key(client, config, error_out);
+}
+
 void api_client_cleanup(ApiClient *client) {
   if (!client) {
     return;
   }
+  if (client->curl_handle) {
+    curl_easy_cleanup(client->curl_handle);
+    client->curl_handle = NULL;
+  }
   free(client->api_key);
   client->api_key = NULL;
   curl_global_cleanup();
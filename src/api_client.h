@@ -6,9 +6,17 @@
 #include "app_config.h"
 #include "string_buffer.h"
 
+/**
+ * The curl easy handle is created on first send and kept until cleanup so its connection cache
+ * (TCP + TLS sessions) is reused across chunks. progress_hook, when set after init, is called
+ * roughly once a second while a request is in flight and before each retry back-off.
+ */
 typedef struct {
   const ProgramConfig *config;
   char *api_key;
+  void *curl_handle;
+  void (*progress_hook)(void *data);
+  void *progress_data;
 } ApiClient;
 
 typedef enum {
@@ -21,6 +29,7 @@ typedef enum {
 int api_client_init(ApiClient *client, const ProgramConfig *config, char **error_out);
 int api_client_send(ApiClient *client, const char *chunk, size_t chunk_len, size_t chunk_index,
                     StringBuffer *response, char **error_out, ApiClientError *error_type);
+int api_client_rebind(ApiClient *client, const ProgramConfig *config, char **error_out);
 void api_client_cleanup(ApiClient *client);
 
 #endif /* API_CLIENT_H */
@@ -9,6 +9,8 @@
 #include <string.h>
 #include <strings.h>
 
+#include "file_loader.h"
+
 static void config_apply_provider(ProgramConfig *config, ApiProvider provider, bool lock);
 
 static bool strcasestr_bool(const char *haystack, const char *needle) {
@@ -202,6 +204,20 @@ static int parse_long_value(const char *text, long *out) {
   return 0;
 }
 
+static int parse_double_value(const char *text, double *out) {
+  if (!text || !out) {
+    return -1;
+  }
+  errno = 0;
+  char *end = NULL;
+  double value = strtod(text, &end);
+  if (errno != 0 || end == text || *end != '\0') {
+    return -1;
+  }
+  *out = value;
+  return 0;
+}
+
 static int parse_bool_value(const char *text, bool *out) {
   if (!text || !out) {
     return -1;
@@ -229,6 +245,7 @@ ProgramConfig config_defaults(void) {
   cfg.input_text = NULL;
   cfg.config_file = NULL;
   cfg.response_dir = cfg_strdup(DEEPSEEK_DEFAULT_RESPONSE_DIR);
+  cfg.results_arrow = NULL;
   cfg.model = NULL;
   cfg.system_prompt = cfg_strdup(DEEPSEEK_DEFAULT_SYSTEM_PROMPT);
   cfg.anthropic_version = cfg_strdup(ANTHROPIC_DEFAULT_VERSION);
@@ -261,17 +278,81 @@ ProgramConfig config_defaults(void) {
   cfg.force_quiet = false;
   cfg.repl_mode = false;
   cfg.repl_history_limit = DEEPSEEK_DEFAULT_REPL_HISTORY;
+  cfg.normalize_input = false;
+  cfg.dedup_chunks = true;
+  cfg.near_dedup = false;
+  cfg.near_dedup_threshold = DEEPSEEK_DEFAULT_NEAR_DEDUP_PERCENT;
+  cfg.filter_keywords = NULL;
+  cfg.filter_regex = NULL;
+  cfg.filter_ignore_case = false;
+  cfg.daemon_mode = false;
+  cfg.daemon_socket = cfg_strdup(DEEPSEEK_DEFAULT_DAEMON_SOCKET);
+  cfg.job_groups = DEEPSEEK_DEFAULT_JOB_GROUPS;
+  cfg.stream_mode = false;
+  cfg.stream_window_ms = DEEPSEEK_DEFAULT_STREAM_WINDOW_MS;
+  cfg.stream_batch_bytes = DEEPSEEK_DEFAULT_STREAM_BATCH;
+  cfg.watch_dir = NULL;
+  cfg.watch_done_dir = NULL;
+  cfg.coordinator_mode = false;
+  cfg.resilient_mode = false;
+  cfg.retry_waves = DEEPSEEK_DEFAULT_RETRY_WAVES;
+  cfg.fault_timeout_seconds = DEEPSEEK_DEFAULT_FAULT_TIMEOUT;
+  cfg.cost_model = NULL;
+  cfg.max_inflight = 0;
+  cfg.autotune = false;
+  cfg.autotune_cache = NULL;
+  cfg.autotune_rpm = 0;
+  cfg.plan_mode = false;
+  cfg.plan_ranks = 0;
+  cfg.price_input = 0.0;
+  cfg.price_output = 0.0;
+  cfg.latency_overhead_ms = DEEPSEEK_DEFAULT_LATENCY_OVERHEAD_MS;
+  cfg.output_tokens_per_second = DEEPSEEK_DEFAULT_OUTPUT_TPS;
+  cfg.max_memory = 0;
+  cfg.numa_bind = false;
+  cfg.io_backend = ASYNC_IO_AUTO;
+  cfg.bcast_segment = DEEPSEEK_DEFAULT_BCAST_SEGMENT;
+  cfg.mpi_compress = TRANSFER_CODEC_AUTO;
+  cfg.response_fsync = false;
 
   cfg.rank = 0;
   cfg.world_size = 1;
+  cfg.results_arrow_started = false;
   cfg.provider = API_PROVIDER_DEEPSEEK;
   cfg.provider_locked = false;
   cfg.auto_scale_mode = AUTOSCALE_MODE_NONE;
   cfg.auto_scale_threshold_bytes = DEEPSEEK_AUTOSCALE_DEFAULT_THRESHOLD;
   cfg.auto_scale_factor = DEEPSEEK_AUTOSCALE_DEFAULT_FACTOR;
+  cfg.auto_scale_max_ranks = DEEPSEEK_AUTOSCALE_DEFAULT_MAX_RANKS;
   return cfg;
 }
 
+/* Deep copy used to derive per-job and per-batch configs from the startup config. */
+int config_clone(const ProgramConfig *source, ProgramConfig *out) {
+  if (!source || !out) {
+    return -1;
+  }
+  *out = *source;
+  char **fields[] = {&out->api_endpoint, &out->api_key_env, &out->explicit_api_key, &out->log_file,
+                     &out->input_file,   &out->input_text,  &out->config_file,      &out->response_dir,
+                     &out->model,        &out->system_prompt, &out->anthropic_version, &out->payload_file,
+                     &out->mpirun_cmd,   &out->filter_keywords, &out->filter_regex,  &out->daemon_socket,
+                     &out->watch_dir,    &out->watch_done_dir, &out->cost_model,
+                     &out->autotune_cache, &out->results_arrow};
+  bool ok = true;
+  for (size_t i = 0; i < sizeof fields / sizeof fields[0]; ++i) {
+    if (*fields[i]) {
+      *fields[i] = cfg_strdup(*fields[i]);
+      ok = ok && *fields[i] != NULL;
+    }
+  }
+  if (!ok) {
+    config_free(out);
+    return -1;
+  }
+  return 0;
+}
+
 void config_replace_string(char **target, const char *value) {
   if (!target) {
     return;
@@ -280,6 +361,42 @@ void config_replace_string(char **target, const char *value) {
   *target = value ? cfg_strdup(value) : NULL;
 }
 
+/* Appends each separator-delimited item of value to a newline-separated list. */
+void config_append_list(char **target, const char *value, char separator) {
+  if (!target || !value) {
+    return;
+  }
+  size_t existing = *target ? strlen(*target) : 0;
+  size_t add = strlen(value);
+  char *grown = realloc(*target, existing + add + 2);
+  if (!grown) {
+    return;
+  }
+  char *out = grown + existing;
+  if (existing > 0 && add > 0) {
+    *out++ = '\n';
+  }
+  for (const char *p = value; *p; ++p) {
+    *out++ = *p == separator ? '\n' : *p;
+  }
+  *out = '\0';
+  *target = grown;
+}
+
+int config_load_filter_keywords(ProgramConfig *config, const char *path, char **error_out) {
+  if (!config || !path) {
+    return -1;
+  }
+  char *contents = NULL;
+  size_t len = 0;
+  if (file_loader_read_all(path, &contents, &len, error_out) != 0) {
+    return -1;
+  }
+  config_append_list(&config->filter_keywords, contents, '\n');
+  free(contents);
+  return 0;
+}
+
 void config_record_rank(ProgramConfig *config, int rank, int world_size) {
   if (!config) {
     return;
@@ -301,11 +418,19 @@ void config_free(ProgramConfig *config) {
   free(config->input_text);
   free(config->config_file);
   free(config->response_dir);
+  free(config->results_arrow);
   free(config->model);
   free(config->system_prompt);
   free(config->anthropic_version);
   free(config->payload_file);
   free(config->mpirun_cmd);
+  free(config->filter_keywords);
+  free(config->filter_regex);
+  free(config->daemon_socket);
+  free(config->watch_dir);
+  free(config->watch_done_dir);
+  free(config->cost_model);
+  free(config->autotune_cache);
   config->api_endpoint = NULL;
   config->api_key_env = NULL;
   config->explicit_api_key = NULL;
@@ -314,6 +439,7 @@ void config_free(ProgramConfig *config) {
   config->input_text = NULL;
   config->config_file = NULL;
   config->response_dir = NULL;
+  config->results_arrow = NULL;
   config->response_files_enabled = true;
   config->model = NULL;
   config->system_prompt = NULL;
@@ -328,9 +454,46 @@ void config_free(ProgramConfig *config) {
   config->tui_log_view_explicit = false;
   config->repl_mode = false;
   config->repl_history_limit = DEEPSEEK_DEFAULT_REPL_HISTORY;
+  config->normalize_input = false;
+  config->dedup_chunks = true;
+  config->near_dedup = false;
+  config->near_dedup_threshold = DEEPSEEK_DEFAULT_NEAR_DEDUP_PERCENT;
+  config->filter_keywords = NULL;
+  config->filter_regex = NULL;
+  config->filter_ignore_case = false;
+  config->daemon_mode = false;
+  config->daemon_socket = NULL;
+  config->watch_dir = NULL;
+  config->watch_done_dir = NULL;
+  config->coordinator_mode = false;
+  config->resilient_mode = false;
+  config->retry_waves = DEEPSEEK_DEFAULT_RETRY_WAVES;
+  config->fault_timeout_seconds = DEEPSEEK_DEFAULT_FAULT_TIMEOUT;
+  config->cost_model = NULL;
+  config->max_inflight = 0;
+  config->autotune = false;
+  config->autotune_cache = NULL;
+  config->autotune_rpm = 0;
+  config->plan_mode = false;
+  config->plan_ranks = 0;
+  config->price_input = 0.0;
+  config->price_output = 0.0;
+  config->latency_overhead_ms = DEEPSEEK_DEFAULT_LATENCY_OVERHEAD_MS;
+  config->output_tokens_per_second = DEEPSEEK_DEFAULT_OUTPUT_TPS;
+  config->max_memory = 0;
+  config->numa_bind = false;
+  config->io_backend = ASYNC_IO_AUTO;
+  config->bcast_segment = DEEPSEEK_DEFAULT_BCAST_SEGMENT;
+  config->mpi_compress = TRANSFER_CODEC_AUTO;
+  config->response_fsync = false;
+  config->job_groups = DEEPSEEK_DEFAULT_JOB_GROUPS;
+  config->stream_mode = false;
+  config->stream_window_ms = DEEPSEEK_DEFAULT_STREAM_WINDOW_MS;
+  config->stream_batch_bytes = DEEPSEEK_DEFAULT_STREAM_BATCH;
   config->auto_scale_mode = AUTOSCALE_MODE_NONE;
   config->auto_scale_threshold_bytes = DEEPSEEK_AUTOSCALE_DEFAULT_THRESHOLD;
   config->auto_scale_factor = DEEPSEEK_AUTOSCALE_DEFAULT_FACTOR;
+  config->auto_scale_max_ranks = DEEPSEEK_AUTOSCALE_DEFAULT_MAX_RANKS;
   config->payload_file = NULL;
   config->mpirun_cmd = NULL;
   config->mpi_processes = 4;
@@ -496,6 +659,9 @@ int config_apply_kv(ProgramConfig *config, const char *key, const char *value, c
     config_replace_string(&config->input_text, val);
   } else if (strcmp(key, "response_dir") == 0) {
     config_replace_string(&config->response_dir, val);
+  } else if (strcmp(key, "results_arrow") == 0) {
+    config_replace_string(&config->results_arrow, val);
+    config->results_arrow_started = false;
   } else if (strcmp(key, "response_files") == 0) {
     bool enabled;
     if (parse_bool_value(val, &enabled) != 0) {
@@ -531,6 +697,52 @@ int config_apply_kv(ProgramConfig *config, const char *key, const char *value, c
       return -1;
     }
     config->max_request_bytes = tmp;
+  } else if (strcmp(key, "max_memory") == 0) {
+    size_t tmp;
+    if (parse_size_value(val, &tmp) != 0) {
+      cfg_assign_error(error_out, "invalid max_memory: %s", val);
+      return -1;
+    }
+    config->max_memory = tmp;
+  } else if (strcmp(key, "bcast_segment") == 0) {
+    size_t tmp;
+    if (parse_size_value(val, &tmp) != 0) {
+      cfg_assign_error(error_out, "invalid bcast_segment: %s", val);
+      return -1;
+    }
+    config->bcast_segment = tmp;
+  } else if (strcmp(key, "mpi_compress") == 0) {
+    TransferCodec codec;
+    if (transfer_codec_parse(val, &codec) != 0) {
+      cfg_assign_error(error_out, "unknown mpi_compress codec: %s", val);
+      return -1;
+    }
+    if (!transfer_codec_available(codec)) {
+      cfg_assign_error(error_out, "mpi_compress codec %s is not built in", val);
+      return -1;
+    }
+    config->mpi_compress = codec;
+  } else if (strcmp(key, "numa_bind") == 0) {
+    bool flag;
+    if (parse_bool_value(val, &flag) != 0) {
+      cfg_assign_error(error_out, "invalid numa_bind flag: %s", val);
+      return -1;
+    }
+    config->numa_bind = flag;
+  } else if (strcmp(key, "io_backend") == 0) {
+    AsyncIoBackend backend;
+    if (async_io_parse_backend(val, &backend) != 0) {
+      cfg_assign_error(error_out, "unknown io_backend: %s", val);
+      return -1;
+    }
+    config->io_backend = backend;
+  } else if (strcmp(key, "response_fsync") == 0) {
+    bool flag;
+    if (parse_bool_value(val, &flag) != 0) {
+      cfg_assign_error(error_out, "invalid response_fsync flag: %s", val);
+      return -1;
+    }
+    config->response_fsync = flag;
   } else if (strcmp(key, "tasks") == 0) {
     size_t tmp;
     if (parse_size_value(val, &tmp) != 0 || tmp == 0) {
@@ -553,6 +765,77 @@ int config_apply_kv(ProgramConfig *config, const char *key, const char *value, c
       return -1;
     }
     config->network_retry_limit = tmp;
+  } else if (strcmp(key, "retry_waves") == 0) {
+    int tmp;
+    if (parse_int_value(val, &tmp) != 0 || tmp < 0) {
+      cfg_assign_error(error_out, "invalid retry_waves: %s", val);
+      return -1;
+    }
+    config->retry_waves = tmp;
+  } else if (strcmp(key, "cost_model") == 0) {
+    config_replace_string(&config->cost_model, val);
+  } else if (strcmp(key, "max_inflight") == 0) {
+    int tmp;
+    if (parse_int_value(val, &tmp) != 0 || tmp < 0) {
+      cfg_assign_error(error_out, "invalid max_inflight: %s", val);
+      return -1;
+    }
+    config->max_inflight = tmp;
+  } else if (strcmp(key, "autotune") == 0) {
+    bool flag;
+    if (parse_bool_value(val, &flag) != 0) {
+      cfg_assign_error(error_out, "invalid autotune flag: %s", val);
+      return -1;
+    }
+    config->autotune = flag;
+  } else if (strcmp(key, "autotune_cache") == 0) {
+    config_replace_string(&config->autotune_cache, val);
+  } else if (strcmp(key, "autotune_rpm") == 0) {
+    int tmp;
+    if (parse_int_value(val, &tmp) != 0 || tmp < 0) {
+      cfg_assign_error(error_out, "invalid autotune_rpm: %s", val);
+      return -1;
+    }
+    config->autotune_rpm = tmp;
+  } else if (strcmp(key, "plan") == 0 || strcmp(key, "plan_mode") == 0) {
+    bool flag;
+    if (parse_bool_value(val, &flag) != 0) {
+      cfg_assign_error(error_out, "invalid plan flag: %s", val);
+      return -1;
+    }
+    config->plan_mode = flag;
+  } else if (strcmp(key, "plan_ranks") == 0) {
+    int tmp;
+    if (parse_int_value(val, &tmp) != 0 || tmp < 0) {
+      cfg_assign_error(error_out, "invalid plan_ranks: %s", val);
+      return -1;
+    }
+    config->plan_ranks = tmp;
+  } else if (strcmp(key, "price_input") == 0 || strcmp(key, "price_output") == 0) {
+    double tmp;
+    if (parse_double_value(val, &tmp) != 0 || tmp < 0.0) {
+      cfg_assign_error(error_out, "invalid %s: %s", key, val);
+      return -1;
+    }
+    if (strcmp(key, "price_input") == 0) {
+      config->price_input = tmp;
+    } else {
+      config->price_output = tmp;
+    }
+  } else if (strcmp(key, "latency_overhead_ms") == 0) {
+    long tmp;
+    if (parse_long_value(val, &tmp) != 0 || tmp < 0) {
+      cfg_assign_error(error_out, "invalid latency_overhead_ms: %s", val);
+      return -1;
+    }
+    config->latency_overhead_ms = tmp;
+  } else if (strcmp(key, "output_tokens_per_second") == 0) {
+    int tmp;
+    if (parse_int_value(val, &tmp) != 0 || tmp <= 0) {
+      cfg_assign_error(error_out, "invalid output_tokens_per_second: %s", val);
+      return -1;
+    }
+    config->output_tokens_per_second = tmp;
   } else if (strcmp(key, "progress_interval") == 0) {
     int tmp;
     if (parse_int_value(val, &tmp) != 0 || tmp <= 0) {
@@ -609,6 +892,108 @@ int config_apply_kv(ProgramConfig *config, const char *key, const char *value, c
       return -1;
     }
     config->repl_mode = flag;
+  } else if (strcmp(key, "normalize") == 0 || strcmp(key, "normalize_input") == 0) {
+    bool flag;
+    if (parse_bool_value(val, &flag) != 0) {
+      cfg_assign_error(error_out, "invalid normalize flag: %s", val);
+      return -1;
+    }
+    config->normalize_input = flag;
+  } else if (strcmp(key, "dedup") == 0 || strcmp(key, "dedup_chunks") == 0) {
+    bool flag;
+    if (parse_bool_value(val, &flag) != 0) {
+      cfg_assign_error(error_out, "invalid dedup flag: %s", val);
+      return -1;
+    }
+    config->dedup_chunks = flag;
+  } else if (strcmp(key, "near_dedup") == 0) {
+    bool flag;
+    if (parse_bool_value(val, &flag) != 0) {
+      cfg_assign_error(error_out, "invalid near_dedup flag: %s", val);
+      return -1;
+    }
+    config->near_dedup = flag;
+  } else if (strcmp(key, "near_dedup_threshold") == 0) {
+    int tmp;
+    if (parse_int_value(val, &tmp) != 0 || tmp < 1 || tmp > 100) {
+      cfg_assign_error(error_out, "invalid near_dedup_threshold (1-100): %s", val);
+      return -1;
+    }
+    config->near_dedup_threshold = tmp;
+  } else if (strcmp(key, "filter_keywords") == 0) {
+    config_append_list(&config->filter_keywords, val, ',');
+  } else if (strcmp(key, "filter_keyword_file") == 0) {
+    char *load_error = NULL;
+    if (config_load_filter_keywords(config, val, &load_error) != 0) {
+      cfg_assign_error(error_out, "unable to read filter_keyword_file %s: %s", val,
+                       load_error ? load_error : "unknown error");
+      free(load_error);
+      return -1;
+    }
+  } else if (strcmp(key, "filter_regex") == 0) {
+    config_append_list(&config->filter_regex, val, '\n');
+  } else if (strcmp(key, "filter_ignore_case") == 0) {
+    bool flag;
+    if (parse_bool_value(val, &flag) != 0) {
+      cfg_assign_error(error_out, "invalid filter_ignore_case flag: %s", val);
+      return -1;
+    }
+    config->filter_ignore_case = flag;
+  } else if (strcmp(key, "daemon_socket") == 0) {
+    config_replace_string(&config->daemon_socket, val);
+  } else if (strcmp(key, "job_groups") == 0) {
+    int tmp;
+    if (parse_int_value(val, &tmp) != 0 || tmp < 0) {
+      cfg_assign_error(error_out, "invalid job_groups: %s", val);
+      return -1;
+    }
+    config->job_groups = tmp;
+  } else if (strcmp(key, "stream") == 0 || strcmp(key, "stream_mode") == 0) {
+    bool flag;
+    if (parse_bool_value(val, &flag) != 0) {
+      cfg_assign_error(error_out, "invalid stream flag: %s", val);
+      return -1;
+    }
+    config->stream_mode = flag;
+  } else if (strcmp(key, "stream_window_ms") == 0) {
+    int tmp;
+    if (parse_int_value(val, &tmp) != 0 || tmp < 0) {
+      cfg_assign_error(error_out, "invalid stream_window_ms: %s", val);
+      return -1;
+    }
+    config->stream_window_ms = tmp;
+  } else if (strcmp(key, "stream_batch_bytes") == 0) {
+    size_t tmp;
+    if (parse_size_value(val, &tmp) != 0 || tmp == 0) {
+      cfg_assign_error(error_out, "invalid stream_batch_bytes: %s", val);
+      return -1;
+    }
+    config->stream_batch_bytes = tmp;
+  } else if (strcmp(key, "watch_dir") == 0) {
+    config_replace_string(&config->watch_dir, val);
+  } else if (strcmp(key, "watch_done_dir") == 0) {
+    config_replace_string(&config->watch_done_dir, val);
+  } else if (strcmp(key, "coordinator") == 0 || strcmp(key, "coordinator_mode") == 0) {
+    bool flag;
+    if (parse_bool_value(val, &flag) != 0) {
+      cfg_assign_error(error_out, "invalid coordinator flag: %s", val);
+      return -1;
+    }
+    config->coordinator_mode = flag;
+  } else if (strcmp(key, "resilient") == 0 || strcmp(key, "resilient_mode") == 0) {
+    bool flag;
+    if (parse_bool_value(val, &flag) != 0) {
+      cfg_assign_error(error_out, "invalid resilient flag: %s", val);
+      return -1;
+    }
+    config->resilient_mode = flag;
+  } else if (strcmp(key, "fault_timeout") == 0) {
+    long tmp;
+    if (parse_long_value(val, &tmp) != 0 || tmp <= 0) {
+      cfg_assign_error(error_out, "invalid fault_timeout: %s", val);
+      return -1;
+    }
+    config->fault_timeout_seconds = tmp;
   } else if (strcmp(key, "show_progress") == 0) {
     bool flag;
     if (parse_bool_value(val, &flag) != 0) {
@@ -682,6 +1067,13 @@ int config_apply_kv(ProgramConfig *config, const char *key, const char *value, c
       return -1;
     }
     config->auto_scale_factor = tmp;
+  } else if (strcmp(key, "auto_scale_max_ranks") == 0) {
+    int tmp;
+    if (parse_int_value(val, &tmp) != 0 || tmp < 0) {
+      cfg_assign_error(error_out, "invalid auto_scale_max_ranks: %s", val);
+      return -1;
+    }
+    config->auto_scale_max_ranks = tmp;
   } else {
     cfg_assign_error(error_out, "unknown config key: %s", key);
     return -1;
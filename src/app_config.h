@@ -4,7 +4,9 @@
 #include <stdbool.h>
 #include <stddef.h>
 
+#include "async_io.h"
 #include "deepseek.h"
+#include "transfer_codec.h"
 
 typedef enum {
   API_PROVIDER_DEEPSEEK = 0,
@@ -31,6 +33,7 @@ typedef struct {
   char *input_text;
   char *config_file;
   char *response_dir;
+  char *results_arrow;
   char *model;
   char *system_prompt;
   char *anthropic_version;
@@ -49,6 +52,7 @@ typedef struct {
   int progress_interval;
   int verbosity;
   int network_retry_limit;
+  int retry_waves;
   int max_output_tokens;
 
   bool show_progress;
@@ -63,19 +67,60 @@ typedef struct {
   bool force_quiet;
   bool repl_mode;
   size_t repl_history_limit;
+  bool normalize_input;
+  bool dedup_chunks;
+  bool near_dedup;
+  int near_dedup_threshold;
+  char *filter_keywords;
+  char *filter_regex;
+  bool filter_ignore_case;
+  bool daemon_mode;
+  char *daemon_socket;
+  int job_groups;
+  bool stream_mode;
+  int stream_window_ms;
+  size_t stream_batch_bytes;
+  char *watch_dir;
+  char *watch_done_dir;
+  bool coordinator_mode;
+  bool resilient_mode;
+  long fault_timeout_seconds;
+  char *cost_model;
+  int max_inflight;
+  bool autotune;
+  char *autotune_cache;
+  int autotune_rpm;
+  bool plan_mode;
+  int plan_ranks;
+  double price_input;
+  double price_output;
+  long latency_overhead_ms;
+  int output_tokens_per_second;
+  size_t max_memory;
+  bool numa_bind;
+  AsyncIoBackend io_backend;
+  size_t bcast_segment;
+  TransferCodec mpi_compress;
+  bool response_fsync;
 
   int rank;
   int world_size;
+  /* Set on rank 0 once results_arrow has been written in this run; later payloads append to it. */
+  bool results_arrow_started;
   ApiProvider provider;
   bool provider_locked;
   AutoScaleMode auto_scale_mode;
   size_t auto_scale_threshold_bytes;
   int auto_scale_factor;
+  int auto_scale_max_ranks;
 } ProgramConfig;
 
 ProgramConfig config_defaults(void);
 void config_free(ProgramConfig *config);
+int config_clone(const ProgramConfig *source, ProgramConfig *out);
 void config_replace_string(char **target, const char *value);
+void config_append_list(char **target, const char *value, char separator);
+int config_load_filter_keywords(ProgramConfig *config, const char *path, char **error_out);
 void config_record_rank(ProgramConfig *config, int rank, int world_size);
 void config_set_provider(ProgramConfig *config, ApiProvider provider);
 int config_apply_kv(ProgramConfig *config, const char *key, const char *value, char **error_out);
@@ -0,0 +1,775 @@
+#define _GNU_SOURCE
+#include "async_io.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef HAVE_LINUX_IO_URING_H
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#include "large_buffer.h"
+#include "memory_budget.h"
+
+/* Reads go out in readahead-sized segments, several at a time on io_uring. */
+#define ASYNC_IO_READ_SEGMENT (1U * 1024U * 1024U)
+#define ASYNC_IO_READ_DEPTH   8U
+/* Writer limits: io_uring jobs in flight, pool threads, and jobs queued for the pool before a
+ * submitter waits for one to finish. */
+#define ASYNC_IO_RING_ENTRIES 64U
+#define ASYNC_IO_POOL_THREADS 2
+#define ASYNC_IO_QUEUE_MAX    256U
+
+static void assign_error(char **error_out, const char *fmt, ...) {
+  if (!error_out) {
+    return;
+  }
+  va_list args;
+  va_start(args, fmt);
+  va_list copy;
+  va_copy(copy, args);
+  int needed = vsnprintf(NULL, 0, fmt, copy);
+  va_end(copy);
+  if (needed < 0) {
+    va_end(args);
+    return;
+  }
+  size_t size = (size_t) needed + 1;
+  char *msg = malloc(size);
+  if (!msg) {
+    va_end(args);
+    return;
+  }
+  vsnprintf(msg, size, fmt, args);
+  va_end(args);
+  *error_out = msg;
+}
+
+typedef struct WriteJob {
+  struct WriteJob *next;
+  char *path;
+  char *data;
+  size_t len;
+  size_t written;
+  int fd;
+  bool syncing;
+} WriteJob;
+
+#ifdef HAVE_LINUX_IO_URING_H
+/* The submission and completion rings shared with the kernel (no liburing, just the syscalls). */
+typedef struct {
+  int fd;
+  unsigned entries;
+  unsigned *sq_head;
+  unsigned *sq_tail;
+  unsigned *sq_mask;
+  unsigned *sq_array;
+  unsigned *cq_head;
+  unsigned *cq_tail;
+  unsigned *cq_mask;
+  struct io_uring_sqe *sqes;
+  struct io_uring_cqe *cqes;
+  void *sq_map;
+  size_t sq_map_size;
+  void *cq_map;
+  size_t cq_map_size;
+  size_t sqes_size;
+  unsigned unsubmitted;
+} Uring;
+
+static void uring_close(Uring *ring) {
+  if (ring->sqes) {
+    munmap(ring->sqes, ring->sqes_size);
+  }
+  if (ring->cq_map && ring->cq_map != ring->sq_map) {
+    munmap(ring->cq_map, ring->cq_map_size);
+  }
+  if (ring->sq_map) {
+    munmap(ring->sq_map, ring->sq_map_size);
+  }
+  if (ring->fd >= 0) {
+    close(ring->fd);
+  }
+  memset(ring, 0, sizeof *ring);
+  ring->fd = -1;
+}
+
+static int uring_open(Uring *ring, unsigned entries) {
+  memset(ring, 0, sizeof *ring);
+  ring->fd = -1;
+  struct io_uring_params params;
+  memset(&params, 0, sizeof params);
+  int fd = (int) syscall(__NR_io_uring_setup, entries, &params);
+  if (fd < 0) {
+    return -1;
+  }
+  ring->fd = fd;
+  /* IORING_OP_WRITE and IORING_OP_READ arrived with this feature (5.6); older rings cannot run our ops. */
+  if (!(params.features & IORING_FEAT_RW_CUR_POS)) {
+    uring_close(ring);
+    return -1;
+  }
+  ring->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  ring->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  bool single_map = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single_map && ring->cq_map_size > ring->sq_map_size) {
+    ring->sq_map_size = ring->cq_map_size;
+  }
+  ring->sq_map = mmap(NULL, ring->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                      IORING_OFF_SQ_RING);
+  if (ring->sq_map == MAP_FAILED) {
+    ring->sq_map = NULL;
+    uring_close(ring);
+    return -1;
+  }
+  if (single_map) {
+    ring->cq_map = ring->sq_map;
+  } else {
+    ring->cq_map = mmap(NULL, ring->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                        IORING_OFF_CQ_RING);
+    if (ring->cq_map == MAP_FAILED) {
+      ring->cq_map = NULL;
+      uring_close(ring);
+      return -1;
+    }
+  }
+  ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+  ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+  if (ring->sqes == MAP_FAILED) {
+    ring->sqes = NULL;
+    uring_close(ring);
+    return -1;
+  }
+  char *sq = ring->sq_map;
+  char *cq = ring->cq_map;
+  ring->sq_head = (unsigned *) (sq + params.sq_off.head);
+  ring->sq_tail = (unsigned *) (sq + params.sq_off.tail);
+  ring->sq_mask = (unsigned *) (sq + params.sq_off.ring_mask);
+  ring->sq_array = (unsigned *) (sq + params.sq_off.array);
+  ring->cq_head = (unsigned *) (cq + params.cq_off.head);
+  ring->cq_tail = (unsigned *) (cq + params.cq_off.tail);
+  ring->cq_mask = (unsigned *) (cq + params.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+  ring->entries = params.sq_entries;
+  return 0;
+}
+
+/* Submits everything queued and, when wait_for is non-zero, blocks until that many completions exist. */
+static int uring_enter(Uring *ring, unsigned wait_for) {
+  for (;;) {
+    long rc = syscall(__NR_io_uring_enter, ring->fd, ring->unsubmitted, wait_for,
+                      wait_for ? IORING_ENTER_GETEVENTS : 0U, NULL, 0);
+    if (rc >= 0) {
+      ring->unsubmitted = (unsigned long) rc >= ring->unsubmitted ? 0 : ring->unsubmitted - (unsigned) rc;
+      return 0;
+    }
+    if (errno != EINTR) {
+      return -1;
+    }
+  }
+}
+
+/* Hands out the next free submission slot, submitting what is queued first when the ring is full. */
+static struct io_uring_sqe *uring_next_sqe(Uring *ring) {
+  for (;;) {
+    unsigned tail = *ring->sq_tail;
+    unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    if (tail - head < ring->entries) {
+      unsigned index = tail & *ring->sq_mask;
+      struct io_uring_sqe *sqe = &ring->sqes[index];
+      memset(sqe, 0, sizeof *sqe);
+      ring->sq_array[index] = index;
+      return sqe;
+    }
+    if (uring_enter(ring, 0) != 0) {
+      return NULL;
+    }
+  }
+}
+
+static void uring_commit_sqe(Uring *ring) {
+  __atomic_store_n(ring->sq_tail, *ring->sq_tail + 1, __ATOMIC_RELEASE);
+  ring->unsubmitted++;
+}
+
+static int uring_queue_rw(Uring *ring, int opcode, int fd, void *data, size_t len, uint64_t offset,
+                          uint64_t user_data) {
+  struct io_uring_sqe *sqe = uring_next_sqe(ring);
+  if (!sqe) {
+    return -1;
+  }
+  sqe->opcode = (uint8_t) opcode;
+  sqe->fd = fd;
+  sqe->addr = (uint64_t) (uintptr_t) data;
+  sqe->len = (uint32_t) len;
+  sqe->off = offset;
+  sqe->user_data = user_data;
+  uring_commit_sqe(ring);
+  return 0;
+}
+
+static bool uring_reap(Uring *ring, struct io_uring_cqe *out) {
+  unsigned head = *ring->cq_head;
+  unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+  if (head == tail) {
+    return false;
+  }
+  *out = ring->cqes[head & *ring->cq_mask];
+  __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+  return true;
+}
+#endif
+
+/* Process-wide writer. The lock guards the pool queue and the failure record; memory-budget accounting
+ * only ever happens on the calling thread, so finished jobs leave their byte counts in finished_bytes. */
+static struct {
+  bool started;
+  AsyncIoBackend backend;
+  bool fsync_writes;
+  pthread_mutex_t lock;
+  pthread_cond_t work;
+  pthread_cond_t progress;
+  pthread_t threads[ASYNC_IO_POOL_THREADS];
+  int thread_count;
+  bool stopping;
+  WriteJob *queue_head;
+  WriteJob *queue_tail;
+  size_t outstanding;
+  size_t finished_bytes;
+  size_t failures;
+  char *first_error;
+#ifdef HAVE_LINUX_IO_URING_H
+  Uring ring;
+#endif
+} writer = {
+    .backend = ASYNC_IO_AUTO,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .work = PTHREAD_COND_INITIALIZER,
+    .progress = PTHREAD_COND_INITIALIZER,
+};
+
+int async_io_parse_backend(const char *text, AsyncIoBackend *out) {
+  if (!text || !out) {
+    return -1;
+  }
+  if (strcasecmp(text, "auto") == 0) {
+    *out = ASYNC_IO_AUTO;
+  } else if (strcasecmp(text, "uring") == 0 || strcasecmp(text, "io_uring") == 0) {
+    *out = ASYNC_IO_URING;
+  } else if (strcasecmp(text, "threads") == 0) {
+    *out = ASYNC_IO_THREADS;
+  } else if (strcasecmp(text, "sync") == 0 || strcasecmp(text, "none") == 0) {
+    *out = ASYNC_IO_SYNC;
+  } else {
+    return -1;
+  }
+  return 0;
+}
+
+const char *async_io_backend_name(AsyncIoBackend backend) {
+  switch (backend) {
+  case ASYNC_IO_URING:
+    return "uring";
+  case ASYNC_IO_THREADS:
+    return "threads";
+  case ASYNC_IO_SYNC:
+    return "sync";
+  default:
+    return "auto";
+  }
+}
+
+static void free_job(WriteJob *job) {
+  free(job->path);
+  free(job->data);
+  free(job);
+}
+
+/* Call with the lock held; takes ownership of message. */
+static void record_failure_locked(char *message) {
+  writer.failures++;
+  if (!writer.first_error) {
+    writer.first_error = message;
+  } else {
+    free(message);
+  }
+}
+
+static void finish_job(WriteJob *job, char *failure) {
+  pthread_mutex_lock(&writer.lock);
+  if (failure) {
+    record_failure_locked(failure);
+  }
+  writer.finished_bytes += job->len;
+  writer.outstanding--;
+  pthread_cond_broadcast(&writer.progress);
+  pthread_mutex_unlock(&writer.lock);
+  free_job(job);
+}
+
+static void release_finished_bytes(void) {
+  pthread_mutex_lock(&writer.lock);
+  size_t bytes = writer.finished_bytes;
+  writer.finished_bytes = 0;
+  pthread_mutex_unlock(&writer.lock);
+  memory_budget_release(bytes);
+}
+
+static int open_for_write(const char *path, char **error_out) {
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    assign_error(error_out, "cannot open %s: %s", path, strerror(errno));
+  }
+  return fd;
+}
+
+static int write_job_inline(WriteJob *job, bool fsync_file, char **error_out) {
+  int fd = open_for_write(job->path, error_out);
+  if (fd < 0) {
+    return -1;
+  }
+  while (job->written < job->len) {
+    ssize_t n = write(fd, job->data + job->written, job->len - job->written);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      assign_error(error_out, "cannot write %s: %s", job->path, n < 0 ? strerror(errno) : "no progress");
+      close(fd);
+      return -1;
+    }
+    job->written += (size_t) n;
+  }
+  if (fsync_file && fsync(fd) != 0) {
+    assign_error(error_out, "cannot fsync %s: %s", job->path, strerror(errno));
+    close(fd);
+    return -1;
+  }
+  if (close(fd) != 0) {
+    assign_error(error_out, "cannot close %s: %s", job->path, strerror(errno));
+    return -1;
+  }
+  return 0;
+}
+
+static void *writer_thread(void *arg) {
+  (void) arg;
+  pthread_mutex_lock(&writer.lock);
+  for (;;) {
+    while (!writer.queue_head && !writer.stopping) {
+      pthread_cond_wait(&writer.work, &writer.lock);
+    }
+    WriteJob *job = writer.queue_head;
+    if (!job) {
+      break;
+    }
+    writer.queue_head = job->next;
+    if (!writer.queue_head) {
+      writer.queue_tail = NULL;
+    }
+    bool fsync_file = writer.fsync_writes;
+    pthread_mutex_unlock(&writer.lock);
+    char *failure = NULL;
+    write_job_inline(job, fsync_file, &failure);
+    finish_job(job, failure);
+    pthread_mutex_lock(&writer.lock);
+  }
+  pthread_mutex_unlock(&writer.lock);
+  return NULL;
+}
+
+#ifdef HAVE_LINUX_IO_URING_H
+/* Each job has one operation in flight: a write (re-queued on short writes), then an fsync when asked
+ * for. The descriptor is closed on this thread once the last one completes. */
+static int uring_queue_job(WriteJob *job) {
+  if (job->syncing) {
+    struct io_uring_sqe *sqe = uring_next_sqe(&writer.ring);
+    if (!sqe) {
+      return -1;
+    }
+    sqe->opcode = IORING_OP_FSYNC;
+    sqe->fd = job->fd;
+    sqe->user_data = (uint64_t) (uintptr_t) job;
+    uring_commit_sqe(&writer.ring);
+    return 0;
+  }
+  return uring_queue_rw(&writer.ring, IORING_OP_WRITE, job->fd, job->data + job->written, job->len - job->written,
+                        job->written, (uint64_t) (uintptr_t) job);
+}
+
+static void uring_complete(const struct io_uring_cqe *cqe) {
+  WriteJob *job = (WriteJob *) (uintptr_t) cqe->user_data;
+  char *failure = NULL;
+  if (cqe->res < 0) {
+    assign_error(&failure, "cannot %s %s: %s", job->syncing ? "fsync" : "write", job->path, strerror(-cqe->res));
+  } else if (!job->syncing) {
+    if (cqe->res == 0) {
+      assign_error(&failure, "cannot write %s: no progress", job->path);
+    } else {
+      job->written += (size_t) cqe->res;
+      bool more = job->written < job->len;
+      if (!more && writer.fsync_writes) {
+        job->syncing = true;
+        more = true;
+      }
+      if (more) {
+        if (uring_queue_job(job) == 0) {
+          return;
+        }
+        assign_error(&failure, "cannot queue I/O for %s", job->path);
+      }
+    }
+  }
+  if (close(job->fd) != 0 && !failure) {
+    assign_error(&failure, "cannot close %s: %s", job->path, strerror(errno));
+  }
+  finish_job(job, failure);
+}
+
+static void uring_drain(bool wait) {
+  for (;;) {
+    struct io_uring_cqe cqe;
+    while (uring_reap(&writer.ring, &cqe)) {
+      uring_complete(&cqe);
+    }
+    pthread_mutex_lock(&writer.lock);
+    size_t outstanding = writer.outstanding;
+    pthread_mutex_unlock(&writer.lock);
+    if (writer.ring.unsubmitted > 0 || (wait && outstanding > 0)) {
+      if (uring_enter(&writer.ring, wait && outstanding > 0 ? 1U : 0U) != 0) {
+        return;
+      }
+      continue;
+    }
+    return;
+  }
+}
+#endif
+
+AsyncIoBackend async_io_start(AsyncIoBackend requested, bool fsync_writes) {
+  pthread_mutex_lock(&writer.lock);
+  writer.fsync_writes = fsync_writes;
+  pthread_mutex_unlock(&writer.lock);
+  if (writer.started) {
+    return writer.backend;
+  }
+  AsyncIoBackend backend = requested == ASYNC_IO_SYNC ? ASYNC_IO_SYNC : ASYNC_IO_THREADS;
+#ifdef HAVE_LINUX_IO_URING_H
+  if ((requested == ASYNC_IO_AUTO || requested == ASYNC_IO_URING) &&
+      uring_open(&writer.ring, ASYNC_IO_RING_ENTRIES) == 0) {
+    backend = ASYNC_IO_URING;
+  }
+#endif
+  if (backend == ASYNC_IO_THREADS) {
+    writer.stopping = false;
+    writer.thread_count = 0;
+    for (int i = 0; i < ASYNC_IO_POOL_THREADS; ++i) {
+      if (pthread_create(&writer.threads[writer.thread_count], NULL, writer_thread, NULL) == 0) {
+        writer.thread_count++;
+      }
+    }
+    if (writer.thread_count == 0) {
+      backend = ASYNC_IO_SYNC;
+    }
+  }
+  writer.backend = backend;
+  writer.started = true;
+  return backend;
+}
+
+int async_io_write_file(const char *path, const char *data, size_t len, bool add_newline, char **error_out) {
+  if (!path || (!data && len > 0)) {
+    assign_error(error_out, "internal: missing write target");
+    return -1;
+  }
+  WriteJob *job = calloc(1, sizeof *job);
+  size_t total = len + (add_newline ? 1 : 0);
+  if (job) {
+    job->path = strdup(path);
+    job->data = malloc(total > 0 ? total : 1);
+    job->fd = -1;
+  }
+  if (!job || !job->path || !job->data) {
+    if (job) {
+      free_job(job);
+    }
+    assign_error(error_out, "unable to allocate %zu bytes for %s", total, path);
+    return -1;
+  }
+  if (len > 0) {
+    memcpy(job->data, data, len);
+  }
+  if (add_newline) {
+    job->data[len] = '\n';
+  }
+  job->len = total;
+  release_finished_bytes();
+
+  AsyncIoBackend backend = writer.started ? writer.backend : ASYNC_IO_SYNC;
+  if (backend == ASYNC_IO_SYNC) {
+    int rc = write_job_inline(job, writer.fsync_writes, error_out);
+    free_job(job);
+    return rc;
+  }
+  memory_budget_charge(total);
+#ifdef HAVE_LINUX_IO_URING_H
+  if (backend == ASYNC_IO_URING) {
+    job->fd = open_for_write(job->path, error_out);
+    if (job->fd < 0) {
+      memory_budget_release(total);
+      free_job(job);
+      return -1;
+    }
+    /* Keep within the ring; each job holds at most one slot. */
+    for (;;) {
+      pthread_mutex_lock(&writer.lock);
+      bool room = writer.outstanding < writer.ring.entries;
+      if (room) {
+        writer.outstanding++;
+      }
+      pthread_mutex_unlock(&writer.lock);
+      if (room) {
+        break;
+      }
+      if (uring_enter(&writer.ring, 1) != 0) {
+        break;
+      }
+      uring_drain(false);
+    }
+    if (uring_queue_job(job) != 0) {
+      pthread_mutex_lock(&writer.lock);
+      writer.outstanding--;
+      pthread_mutex_unlock(&writer.lock);
+      close(job->fd);
+      memory_budget_release(total);
+      assign_error(error_out, "cannot queue I/O for %s", job->path);
+      free_job(job);
+      return -1;
+    }
+    uring_drain(false);
+    return 0;
+  }
+#endif
+  pthread_mutex_lock(&writer.lock);
+  while (writer.outstanding >= ASYNC_IO_QUEUE_MAX) {
+    pthread_cond_wait(&writer.progress, &writer.lock);
+  }
+  if (writer.queue_tail) {
+    writer.queue_tail->next = job;
+  } else {
+    writer.queue_head = job;
+  }
+  writer.queue_tail = job;
+  writer.outstanding++;
+  pthread_cond_signal(&writer.work);
+  pthread_mutex_unlock(&writer.lock);
+  return 0;
+}
+
+size_t async_io_flush(char **first_error) {
+  if (writer.started) {
+#ifdef HAVE_LINUX_IO_URING_H
+    if (writer.backend == ASYNC_IO_URING) {
+      uring_drain(true);
+    }
+#endif
+    if (writer.backend == ASYNC_IO_THREADS) {
+      pthread_mutex_lock(&writer.lock);
+      while (writer.outstanding > 0) {
+        pthread_cond_wait(&writer.progress, &writer.lock);
+      }
+      pthread_mutex_unlock(&writer.lock);
+    }
+  }
+  release_finished_bytes();
+  pthread_mutex_lock(&writer.lock);
+  size_t failures = writer.failures;
+  char *message = writer.first_error;
+  writer.failures = 0;
+  writer.first_error = NULL;
+  pthread_mutex_unlock(&writer.lock);
+  if (first_error) {
+    *first_error = message;
+  } else {
+    free(message);
+  }
+  return failures;
+}
+
+void async_io_stop(void) {
+  if (!writer.started) {
+    return;
+  }
+  async_io_flush(NULL);
+  if (writer.backend == ASYNC_IO_THREADS) {
+    pthread_mutex_lock(&writer.lock);
+    writer.stopping = true;
+    pthread_cond_broadcast(&writer.work);
+    pthread_mutex_unlock(&writer.lock);
+    for (int i = 0; i < writer.thread_count; ++i) {
+      pthread_join(writer.threads[i], NULL);
+    }
+    writer.thread_count = 0;
+  }
+#ifdef HAVE_LINUX_IO_URING_H
+  if (writer.backend == ASYNC_IO_URING) {
+    uring_close(&writer.ring);
+  }
+#endif
+  writer.started = false;
+  writer.backend = ASYNC_IO_AUTO;
+}
+
+static int pread_all(int fd, char *buffer, size_t size, const char *path, char **error_out) {
+  size_t done = 0;
+  while (done < size) {
+    size_t want = size - done < ASYNC_IO_READ_SEGMENT ? size - done : ASYNC_IO_READ_SEGMENT;
+    ssize_t n = pread(fd, buffer + done, want, (off_t) done);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      assign_error(error_out, "read failed for %s: %s", path, strerror(errno));
+      return -1;
+    }
+    if (n == 0) {
+      assign_error(error_out, "short read for %s", path);
+      return -1;
+    }
+    done += (size_t) n;
+  }
+  return 0;
+}
+
+#ifdef HAVE_LINUX_IO_URING_H
+/* Keeps ASYNC_IO_READ_DEPTH segments in flight on a private ring. Each read's user_data is its file
+ * offset; the segment it belongs to tells how much is still expected there. Returns 1 when no ring
+ * could be set up. */
+static int uring_read_all(int fd, char *buffer, size_t size, const char *path, char **error_out) {
+  Uring ring;
+  if (uring_open(&ring, ASYNC_IO_READ_DEPTH) != 0) {
+    return 1;
+  }
+  size_t next = 0;
+  unsigned in_flight = 0;
+  int rc = 0;
+  while ((rc == 0 && next < size) || in_flight > 0) {
+    while (rc == 0 && next < size && in_flight < ASYNC_IO_READ_DEPTH) {
+      size_t len = size - next < ASYNC_IO_READ_SEGMENT ? size - next : ASYNC_IO_READ_SEGMENT;
+      if (uring_queue_rw(&ring, IORING_OP_READ, fd, buffer + next, len, next, next) != 0) {
+        assign_error(error_out, "cannot queue read for %s", path);
+        rc = -1;
+        break;
+      }
+      in_flight++;
+      next += len;
+    }
+    if (in_flight == 0) {
+      break;
+    }
+    if (uring_enter(&ring, 1) != 0) {
+      /* Nothing more can be reaped; closing the ring cancels what is left. */
+      assign_error(error_out, "io_uring_enter failed for %s: %s", path, strerror(errno));
+      rc = -1;
+      break;
+    }
+    struct io_uring_cqe cqe;
+    while (uring_reap(&ring, &cqe)) {
+      in_flight--;
+      size_t offset = (size_t) cqe.user_data;
+      size_t segment_end = (offset / ASYNC_IO_READ_SEGMENT + 1) * ASYNC_IO_READ_SEGMENT;
+      if (segment_end > size) {
+        segment_end = size;
+      }
+      if (rc != 0) {
+        continue;
+      }
+      if (cqe.res < 0) {
+        assign_error(error_out, "read failed for %s: %s", path, strerror(-cqe.res));
+        rc = -1;
+      } else if (cqe.res == 0) {
+        assign_error(error_out, "short read for %s", path);
+        rc = -1;
+      } else if (offset + (size_t) cqe.res < segment_end) {
+        size_t resume = offset + (size_t) cqe.res;
+        if (uring_queue_rw(&ring, IORING_OP_READ, fd, buffer + resume, segment_end - resume, resume, resume) != 0) {
+          assign_error(error_out, "cannot queue read for %s", path);
+          rc = -1;
+        } else {
+          in_flight++;
+        }
+      }
+    }
+  }
+  uring_close(&ring);
+  return rc;
+}
+#endif
+
+int async_io_read_file(const char *path, char **out, size_t *len, char **error_out) {
+  if (!path || !out) {
+    assign_error(error_out, "input path missing");
+    return -1;
+  }
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    assign_error(error_out, "unable to open %s: %s", path, strerror(errno));
+    return -1;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    assign_error(error_out, "unable to stat %s: %s", path, strerror(errno));
+    close(fd);
+    return -1;
+  }
+  if (!S_ISREG(st.st_mode)) {
+    close(fd);
+    return 1;
+  }
+  size_t size = (size_t) st.st_size;
+  char *buffer = malloc(size + 1);
+  if (!buffer) {
+    assign_error(error_out, "unable to allocate %zu bytes for %s", size + 1, path);
+    close(fd);
+    return -1;
+  }
+  large_buffer_advise(buffer, size + 1);
+  posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+  int rc = 1;
+#ifdef HAVE_LINUX_IO_URING_H
+  AsyncIoBackend backend = writer.started ? writer.backend : ASYNC_IO_AUTO;
+  if ((backend == ASYNC_IO_AUTO || backend == ASYNC_IO_URING) && size > ASYNC_IO_READ_SEGMENT) {
+    rc = uring_read_all(fd, buffer, size, path, error_out);
+  }
+#endif
+  if (rc == 1) {
+    rc = pread_all(fd, buffer, size, path, error_out);
+  }
+  close(fd);
+  if (rc != 0) {
+    free(buffer);
+    return -1;
+  }
+  buffer[size] = '\0';
+  memory_budget_note(size + 1);
+  *out = buffer;
+  if (len) {
+    *len = size;
+  }
+  return 0;
+}
@@ -0,0 +1,44 @@
+#ifndef ASYNC_IO_H
+#define ASYNC_IO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Disk I/O that stays off the request loop. Response files are handed to a process-wide writer and
+ * written (and optionally fsynced) while the rank goes back to its HTTP requests; whole-file reads use
+ * large sequential reads instead of a 4 KiB stdio loop. Backends:
+ *   uring    io_uring through the raw syscalls: writes and fsyncs are queued to the kernel, and reads
+ *            keep several readahead-sized segments in flight
+ *   threads  a small pthread pool performing ordinary write/fsync calls (reads use large preads)
+ *   sync     everything inline, as before
+ * auto picks uring when the kernel allows it and threads otherwise.
+ */
+typedef enum {
+  ASYNC_IO_AUTO = 0,
+  ASYNC_IO_URING,
+  ASYNC_IO_THREADS,
+  ASYNC_IO_SYNC
+} AsyncIoBackend;
+
+int async_io_parse_backend(const char *text, AsyncIoBackend *out);
+const char *async_io_backend_name(AsyncIoBackend backend);
+
+/* Starts the writer for this process and returns the backend actually in use. Calling it again with
+ * the writer running only updates fsync_writes. Reads pick up the backend too. */
+AsyncIoBackend async_io_start(AsyncIoBackend requested, bool fsync_writes);
+/* Waits for queued writes and releases the writer; later writes run inline. */
+void async_io_stop(void);
+
+/* Copies data (and a trailing newline when add_newline) and queues it to replace path. Failures that
+ * surface only once the write runs are reported by async_io_flush. */
+int async_io_write_file(const char *path, const char *data, size_t len, bool add_newline, char **error_out);
+/* Waits until every queued write has finished. Returns how many failed since the previous flush and
+ * hands the first failure's message to *first_error (caller frees). */
+size_t async_io_flush(char **first_error);
+
+/* Reads a whole regular file into a NUL-terminated buffer the caller frees. Returns 1 without touching
+ * *out when path is not a regular file (a pipe, a terminal), so the caller can read it as a stream. */
+int async_io_read_file(const char *path, char **out, size_t *len, char **error_out);
+
+#endif /* ASYNC_IO_H */
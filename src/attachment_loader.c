@@ -1,7 +1,10 @@
 #define _GNU_SOURCE
 #include "attachment_loader.h"
 
+#include "async_io.h"
+#include "memory_budget.h"
 #include "string_buffer.h"
+#include "text_classifier.h"
 
 #include <ctype.h>
 #include <errno.h>
@@ -61,59 +64,21 @@ static void assign_error(char **error_out, const char *fmt, ...) {
 }
 
 static int read_all_bytes(const char *path, unsigned char **out, size_t *len, char **error_out) {
-  FILE *fp = fopen(path, "rb");
-  if (!fp) {
-    assign_error(error_out, "unable to open %s: %s", path, strerror(errno));
+  char *buffer = NULL;
+  int rc = async_io_read_file(path, &buffer, len, error_out);
+  if (rc == 1) {
+    assign_error(error_out, "%s is not a regular file", path);
     return -1;
   }
-  if (fseek(fp, 0, SEEK_END) != 0) {
-    assign_error(error_out, "fseek failed for %s", path);
-    fclose(fp);
+  if (rc != 0) {
     return -1;
   }
-  long size = ftell(fp);
-  if (size < 0) {
-    assign_error(error_out, "ftell failed for %s", path);
-    fclose(fp);
-    return -1;
-  }
-  rewind(fp);
-  unsigned char *buffer = malloc((size_t) size + 1);
-  if (!buffer) {
-    assign_error(error_out, "unable to allocate %ld bytes", size);
-    fclose(fp);
-    return -1;
-  }
-  size_t read_bytes = fread(buffer, 1, (size_t) size, fp);
-  fclose(fp);
-  if (read_bytes != (size_t) size) {
-    assign_error(error_out, "short read for %s", path);
-    free(buffer);
-    return -1;
-  }
-  buffer[read_bytes] = '\0';
-  *out = buffer;
-  if (len) {
-    *len = read_bytes;
-  }
+  *out = (unsigned char *) buffer;
   return 0;
 }
 
 static DataClass classify_buffer(const unsigned char *data, size_t len) {
-  size_t binary = 0;
-  for (size_t i = 0; i < len; ++i) {
-    unsigned char ch = data[i];
-    if (ch == '\n' || ch == '\r' || ch == '\t') {
-      continue;
-    }
-    if (ch < 0x09 || (ch > 0x0D && ch < 0x20) || ch == 0x7F) {
-      binary++;
-      if (binary * 5 > len) {
-        return DATA_CLASS_BINARY;
-      }
-    }
-  }
-  return DATA_CLASS_TEXT;
+  return text_classifier_is_binary(data, len) ? DATA_CLASS_BINARY : DATA_CLASS_TEXT;
 }
 
 static char *base64_encode(const unsigned char *data, size_t len) {
@@ -265,6 +230,7 @@ static int extract_member(const char *path, const char *member, unsigned char **
         return -1;
       }
       buffer[r] = '\0';
+      memory_budget_note(size + 1);
       *out = buffer;
       if (len) {
         *len = (size_t) r;
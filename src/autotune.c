@@ -0,0 +1,220 @@
+#include "autotune.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define AUTOTUNE_TOLERANCE 1.01
+#define AUTOTUNE_HEADER    "# deepseek_mpi autotune for "
+
+static void assign_error(char **error_out, const char *fmt, ...) {
+  if (!error_out) {
+    return;
+  }
+  va_list args;
+  va_start(args, fmt);
+  va_list copy;
+  va_copy(copy, args);
+  int needed = vsnprintf(NULL, 0, fmt, copy);
+  va_end(copy);
+  if (needed < 0) {
+    va_end(args);
+    return;
+  }
+  size_t size = (size_t) needed + 1;
+  char *msg = malloc(size);
+  if (!msg) {
+    va_end(args);
+    return;
+  }
+  vsnprintf(msg, size, fmt, args);
+  va_end(args);
+  *error_out = msg;
+}
+
+static void fit_window(const AutotuneSample *samples, size_t count, int window, LatencyModel *model) {
+  double n = 0.0;
+  double sum_x = 0.0;
+  double sum_y = 0.0;
+  double sum_xx = 0.0;
+  double sum_xy = 0.0;
+  for (size_t i = 0; i < count; ++i) {
+    if (samples[i].window != window || samples[i].seconds < 0.0) {
+      continue;
+    }
+    n += 1.0;
+    sum_x += samples[i].tokens;
+    sum_y += samples[i].seconds;
+    sum_xx += samples[i].tokens * samples[i].tokens;
+    sum_xy += samples[i].tokens * samples[i].seconds;
+  }
+  model->window = window;
+  model->samples = (size_t) n;
+  double mean_x = sum_x / n;
+  double mean_y = sum_y / n;
+  double spread = sum_xx - n * mean_x * mean_x;
+  double slope = spread > 1e-9 ? (sum_xy - n * mean_x * mean_y) / spread : 0.0;
+  /* Noise can tilt a near-flat fit below zero; neither term can really be negative. */
+  if (slope < 0.0) {
+    slope = 0.0;
+  }
+  double overhead = mean_y - slope * mean_x;
+  if (overhead < 0.0) {
+    overhead = 0.0;
+    slope = sum_xx > 0.0 ? sum_xy / sum_xx : 0.0;
+  }
+  model->overhead_seconds = overhead;
+  model->seconds_per_token = slope;
+}
+
+size_t autotune_fit(const AutotuneSample *samples, size_t count, LatencyModel *models, size_t max_models) {
+  if (!samples || !models) {
+    return 0;
+  }
+  size_t fitted = 0;
+  int previous = 0;
+  for (;;) {
+    /* Windows are visited in ascending order by taking the smallest one above the last fitted. */
+    int next = 0;
+    for (size_t i = 0; i < count; ++i) {
+      if (samples[i].seconds >= 0.0 && samples[i].window > previous && (next == 0 || samples[i].window < next)) {
+        next = samples[i].window;
+      }
+    }
+    if (next == 0 || fitted == max_models) {
+      return fitted;
+    }
+    fit_window(samples, count, next, &models[fitted++]);
+    previous = next;
+  }
+}
+
+double autotune_predict(const AutotuneJob *job, const LatencyModel *model, size_t chunk_size) {
+  if (!job || !model || chunk_size == 0 || model->window <= 0) {
+    return HUGE_VAL;
+  }
+  size_t chunks = (job->payload_bytes + chunk_size - 1) / chunk_size;
+  size_t rounds = (chunks + (size_t) model->window - 1) / (size_t) model->window;
+  double latency = model->overhead_seconds + model->seconds_per_token * job->tokens_per_byte * (double) chunk_size;
+  double seconds = (double) rounds * latency;
+  if (job->requests_per_minute > 0) {
+    double throttled = (double) chunks * 60.0 / (double) job->requests_per_minute;
+    if (throttled > seconds) {
+      seconds = throttled;
+    }
+  }
+  return seconds;
+}
+
+/* Ratio of the larger size to the smaller, so halving and doubling count as equally far. */
+static double size_distance(size_t a, size_t b) {
+  return a > b ? (double) a / (double) b : (double) b / (double) a;
+}
+
+int autotune_choose(const AutotuneJob *job, const LatencyModel *models, size_t model_count, AutotuneChoice *choice) {
+  if (!job || !models || model_count == 0 || !choice || job->min_chunk == 0 || job->max_chunk < job->min_chunk) {
+    return -1;
+  }
+  size_t configured = job->configured_chunk;
+  if (configured < job->min_chunk) {
+    configured = job->min_chunk;
+  } else if (configured > job->max_chunk) {
+    configured = job->max_chunk;
+  }
+  /* Candidate sizes halve down from the largest piloted size; the configured size is always included. */
+  size_t sizes[64];
+  size_t size_count = 0;
+  for (size_t s = job->max_chunk; s >= job->min_chunk && size_count < 63; s /= 2) {
+    sizes[size_count++] = s;
+  }
+  sizes[size_count++] = configured;
+
+  double best = HUGE_VAL;
+  for (size_t m = 0; m < model_count; ++m) {
+    for (size_t i = 0; i < size_count; ++i) {
+      double seconds = autotune_predict(job, &models[m], sizes[i]);
+      if (seconds < best) {
+        best = seconds;
+      }
+    }
+  }
+  if (!isfinite(best)) {
+    return -1;
+  }
+  bool chosen = false;
+  for (size_t m = 0; m < model_count && !chosen; ++m) {
+    for (size_t i = 0; i < size_count; ++i) {
+      double seconds = autotune_predict(job, &models[m], sizes[i]);
+      if (seconds > best * AUTOTUNE_TOLERANCE) {
+        continue;
+      }
+      if (!chosen || size_distance(sizes[i], configured) < size_distance(choice->chunk_size, configured)) {
+        choice->chunk_size = sizes[i];
+        choice->window = models[m].window;
+        choice->predicted_seconds = seconds;
+        chosen = true;
+      }
+    }
+  }
+  choice->baseline_seconds = autotune_predict(job, &models[model_count - 1], configured);
+  return 0;
+}
+
+int autotune_cache_load(const char *path, const char *key, AutotuneChoice *choice) {
+  if (!path || !key || !choice) {
+    return -1;
+  }
+  FILE *fp = fopen(path, "r");
+  if (!fp) {
+    return -1;
+  }
+  char line[1024];
+  bool matched = false;
+  bool have_size = false;
+  bool have_window = false;
+  memset(choice, 0, sizeof *choice);
+  while (fgets(line, sizeof line, fp)) {
+    line[strcspn(line, "\r\n")] = '\0';
+    if (strncmp(line, AUTOTUNE_HEADER, strlen(AUTOTUNE_HEADER)) == 0) {
+      matched = strcmp(line + strlen(AUTOTUNE_HEADER), key) == 0;
+    } else if (strncmp(line, "chunk_size=", 11) == 0) {
+      unsigned long long value = strtoull(line + 11, NULL, 10);
+      choice->chunk_size = (size_t) value;
+      have_size = value > 0;
+    } else if (strncmp(line, "max_inflight=", 13) == 0) {
+      long value = strtol(line + 13, NULL, 10);
+      choice->window = (int) value;
+      have_window = value > 0;
+    }
+  }
+  fclose(fp);
+  return matched && have_size && have_window ? 0 : -1;
+}
+
+int autotune_cache_store(const char *path, const char *key, const AutotuneChoice *choice, const LatencyModel *models,
+                         size_t model_count, char **error_out) {
+  if (!path || !key || !choice) {
+    return -1;
+  }
+  FILE *fp = fopen(path, "w");
+  if (!fp) {
+    assign_error(error_out, "cannot write %s: %s", path, strerror(errno));
+    return -1;
+  }
+  fprintf(fp, AUTOTUNE_HEADER "%s\n", key);
+  for (size_t m = 0; m < model_count; ++m) {
+    fprintf(fp, "# window %d: %.4f s + %.3g s/token (%zu samples)\n", models[m].window, models[m].overhead_seconds,
+            models[m].seconds_per_token, models[m].samples);
+  }
+  fprintf(fp, "# predicted %.1f s (configured chunk size: %.1f s)\n", choice->predicted_seconds,
+          choice->baseline_seconds);
+  fprintf(fp, "chunk_size=%zu\nmax_inflight=%d\n", choice->chunk_size, choice->window);
+  if (fclose(fp) != 0) {
+    assign_error(error_out, "cannot write %s: %s", path, strerror(errno));
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,57 @@
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Pilot-run tuning of chunk size and in-flight window. Pilot requests at a few chunk sizes and
+ * concurrency levels yield (window, prompt tokens, seconds) samples; each window gets a latency model
+ * seconds = overhead + per_token * tokens fitted by least squares. A job of payload_bytes split into
+ * chunks of size s and sent by w ranks at a time then takes ceil(ceil(bytes / s) / w) rounds of one
+ * latency each, or longer when requests_per_minute caps the request rate.
+ */
+typedef struct {
+  int window;
+  double tokens;
+  double seconds;
+} AutotuneSample;
+
+typedef struct {
+  int window;
+  double overhead_seconds;
+  double seconds_per_token;
+  size_t samples;
+} LatencyModel;
+
+typedef struct {
+  size_t payload_bytes;
+  double tokens_per_byte;
+  size_t configured_chunk;
+  size_t min_chunk;
+  size_t max_chunk;
+  int requests_per_minute;
+} AutotuneJob;
+
+typedef struct {
+  size_t chunk_size;
+  int window;
+  double predicted_seconds;
+  double baseline_seconds;
+} AutotuneChoice;
+
+/* One model per distinct window in samples (negative seconds mark failed pilots and are ignored), sorted
+ * by window. Returns the number of models written, at most max_models. */
+size_t autotune_fit(const AutotuneSample *samples, size_t count, LatencyModel *models, size_t max_models);
+double autotune_predict(const AutotuneJob *job, const LatencyModel *model, size_t chunk_size);
+/* Picks the fastest (chunk size, window) pair. Among pairs within 1% of the fastest it prefers the
+ * smallest window, then the size closest to the configured one, so a flat model changes nothing. */
+int autotune_choose(const AutotuneJob *job, const LatencyModel *models, size_t model_count, AutotuneChoice *choice);
+
+/* The cache is a config file (chunk_size, max_inflight) headed by a comment naming key; load returns -1
+ * when the file is missing or was tuned for another key. */
+int autotune_cache_load(const char *path, const char *key, AutotuneChoice *choice);
+int autotune_cache_store(const char *path, const char *key, const AutotuneChoice *choice, const LatencyModel *models,
+                         size_t model_count, char **error_out);
+
+#endif /* AUTOTUNE_H */
@@ -0,0 +1,279 @@
+#include "chunk_cost.h"
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "deepseek.h"
+
+/* Completion length is guessed as a fraction of the prompt, capped at max_output_tokens; decoding a
+ * token costs far more wall time than reading one, hence the weight. */
+#define COST_COMPLETION_RATIO 0.5
+#define COST_DECODE_WEIGHT    20.0
+#define COST_MAX_PREDICTORS   16
+
+static void assign_error(char **error_out, const char *fmt, ...) {
+  if (!error_out) {
+    return;
+  }
+  va_list args;
+  va_start(args, fmt);
+  va_list copy;
+  va_copy(copy, args);
+  int needed = vsnprintf(NULL, 0, fmt, copy);
+  va_end(copy);
+  if (needed < 0) {
+    va_end(args);
+    return;
+  }
+  size_t size = (size_t) needed + 1;
+  char *msg = malloc(size);
+  if (!msg) {
+    va_end(args);
+    return;
+  }
+  vsnprintf(msg, size, fmt, args);
+  va_end(args);
+  *error_out = msg;
+}
+
+static double predict_size(const ChunkCostModel *model, size_t chunk_index, const char *chunk, size_t len) {
+  (void) model;
+  (void) chunk_index;
+  (void) chunk;
+  return (double) len;
+}
+
+/* BPE-like estimate: ASCII letter/digit runs cost a token per four bytes, other visible ASCII bytes
+ * and every non-ASCII code point cost one token each, whitespace is free. */
+double chunk_cost_estimate_tokens(const char *chunk, size_t len) {
+  const unsigned char *bytes = (const unsigned char *) chunk;
+  size_t tokens = 0;
+  size_t run = 0;
+  for (size_t i = 0; i < len; ++i) {
+    unsigned char ch = bytes[i];
+    bool word = (ch >= '0' && ch <= '9') || (ch >= 'A' && ch <= 'Z') || (ch >= 'a' && ch <= 'z');
+    if (word) {
+      run++;
+      continue;
+    }
+    tokens += (run + 3) / 4;
+    run = 0;
+    if (ch >= 0x80) {
+      tokens += (ch & 0xC0) != 0x80 ? 1 : 0;
+    } else if (ch > ' ' && ch != 0x7F) {
+      tokens++;
+    }
+  }
+  tokens += (run + 3) / 4;
+  return (double) tokens;
+}
+
+double chunk_cost_expected_completion(double prompt_tokens, int max_output_tokens) {
+  double cap = max_output_tokens > 0 ? max_output_tokens : AI_DEFAULT_MAX_OUTPUT_TOKENS;
+  double completion = prompt_tokens * COST_COMPLETION_RATIO;
+  return completion > cap ? cap : completion;
+}
+
+static double predict_tokens(const ChunkCostModel *model, size_t chunk_index, const char *chunk, size_t len) {
+  (void) chunk_index;
+  double prompt = chunk_cost_estimate_tokens(chunk, len);
+  return prompt + COST_DECODE_WEIGHT * chunk_cost_expected_completion(prompt, model->max_output_tokens);
+}
+
+typedef struct {
+  size_t index;
+  size_t bytes;
+  double seconds;
+  size_t sequence;
+} ChunkTiming;
+
+typedef struct {
+  ChunkTiming *timings;
+  size_t count;
+  double seconds_per_byte;
+} CostHistory;
+
+static int compare_timings(const void *lhs, const void *rhs) {
+  const ChunkTiming *a = lhs;
+  const ChunkTiming *b = rhs;
+  if (a->index != b->index) {
+    return a->index < b->index ? -1 : 1;
+  }
+  return a->sequence < b->sequence ? -1 : (a->sequence > b->sequence ? 1 : 0);
+}
+
+/* Reads the "Chunk N (B bytes) succeeded in S s" lines a previous run logged. When a log holds several
+ * runs the latest timing for each chunk wins. */
+static int history_init(ChunkCostModel *model, const char *argument, char **error_out) {
+  if (!argument || !*argument) {
+    assign_error(error_out, "history cost model needs a log file (history:PATH)");
+    return -1;
+  }
+  FILE *fp = fopen(argument, "r");
+  if (!fp) {
+    assign_error(error_out, "cannot open %s: %s", argument, strerror(errno));
+    return -1;
+  }
+  CostHistory *history = calloc(1, sizeof *history);
+  if (!history) {
+    fclose(fp);
+    assign_error(error_out, "unable to allocate cost history");
+    return -1;
+  }
+  size_t capacity = 0;
+  double total_seconds = 0.0;
+  double total_bytes = 0.0;
+  char line[1024];
+  while (fgets(line, sizeof line, fp)) {
+    const char *entry = strstr(line, "| Chunk ");
+    ChunkTiming timing;
+    if (!entry || sscanf(entry, "| Chunk %zu (%zu bytes) succeeded in %lfs", &timing.index, &timing.bytes,
+                         &timing.seconds) != 3) {
+      continue;
+    }
+    if (history->count == capacity) {
+      size_t new_cap = capacity ? capacity * 2 : 256;
+      ChunkTiming *grown = realloc(history->timings, new_cap * sizeof *grown);
+      if (!grown) {
+        fclose(fp);
+        free(history->timings);
+        free(history);
+        assign_error(error_out, "unable to allocate cost history");
+        return -1;
+      }
+      history->timings = grown;
+      capacity = new_cap;
+    }
+    timing.sequence = history->count;
+    history->timings[history->count++] = timing;
+    total_seconds += timing.seconds;
+    total_bytes += (double) timing.bytes;
+  }
+  fclose(fp);
+  if (history->count == 0) {
+    free(history);
+    assign_error(error_out, "no chunk timings found in %s", argument);
+    return -1;
+  }
+  qsort(history->timings, history->count, sizeof *history->timings, compare_timings);
+  size_t kept = 0;
+  for (size_t i = 0; i < history->count; ++i) {
+    if (kept > 0 && history->timings[kept - 1].index == history->timings[i].index) {
+      history->timings[kept - 1] = history->timings[i];
+    } else {
+      history->timings[kept++] = history->timings[i];
+    }
+  }
+  history->count = kept;
+  history->seconds_per_byte = total_bytes > 0.0 ? total_seconds / total_bytes : 0.0;
+  model->state = history;
+  return 0;
+}
+
+static double history_predict(const ChunkCostModel *model, size_t chunk_index, const char *chunk, size_t len) {
+  (void) chunk;
+  const CostHistory *history = model->state;
+  size_t lo = 0;
+  size_t hi = history->count;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (history->timings[mid].index < chunk_index) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if (lo < history->count && history->timings[lo].index == chunk_index && history->timings[lo].bytes == len) {
+    return history->timings[lo].seconds;
+  }
+  return history->seconds_per_byte * (double) len;
+}
+
+static void history_release(ChunkCostModel *model) {
+  CostHistory *history = model->state;
+  if (history) {
+    free(history->timings);
+    free(history);
+  }
+  model->state = NULL;
+}
+
+static const ChunkCostPredictor builtin_predictors[] = {
+    {"size", NULL, predict_size, NULL},
+    {"tokens", NULL, predict_tokens, NULL},
+    {"history", history_init, history_predict, history_release},
+};
+
+static const ChunkCostPredictor *registered_predictors[COST_MAX_PREDICTORS];
+static size_t registered_count = 0;
+
+int chunk_cost_register(const ChunkCostPredictor *predictor) {
+  if (!predictor || !predictor->name || !predictor->predict || registered_count == COST_MAX_PREDICTORS) {
+    return -1;
+  }
+  registered_predictors[registered_count++] = predictor;
+  return 0;
+}
+
+static const ChunkCostPredictor *find_predictor(const char *name, size_t name_len) {
+  for (size_t i = registered_count; i-- > 0;) {
+    if (strlen(registered_predictors[i]->name) == name_len &&
+        strncmp(registered_predictors[i]->name, name, name_len) == 0) {
+      return registered_predictors[i];
+    }
+  }
+  for (size_t i = 0; i < sizeof builtin_predictors / sizeof builtin_predictors[0]; ++i) {
+    if (strlen(builtin_predictors[i].name) == name_len && strncmp(builtin_predictors[i].name, name, name_len) == 0) {
+      return &builtin_predictors[i];
+    }
+  }
+  return NULL;
+}
+
+int chunk_cost_init(ChunkCostModel *model, const char *spec, int max_output_tokens, char **error_out) {
+  if (!model) {
+    return -1;
+  }
+  memset(model, 0, sizeof *model);
+  model->max_output_tokens = max_output_tokens;
+  if (!spec || !*spec || strcmp(spec, "none") == 0) {
+    return 0;
+  }
+  const char *colon = strchr(spec, ':');
+  size_t name_len = colon ? (size_t) (colon - spec) : strlen(spec);
+  const ChunkCostPredictor *predictor = find_predictor(spec, name_len);
+  if (!predictor) {
+    assign_error(error_out, "unknown cost model: %.*s", (int) name_len, spec);
+    return -1;
+  }
+  if (predictor->init && predictor->init(model, colon ? colon + 1 : NULL, error_out) != 0) {
+    return -1;
+  }
+  model->predictor = predictor;
+  return 0;
+}
+
+bool chunk_cost_active(const ChunkCostModel *model) {
+  return model && model->predictor;
+}
+
+double chunk_cost_predict(const ChunkCostModel *model, size_t chunk_index, const char *chunk, size_t len) {
+  if (!chunk_cost_active(model)) {
+    return 0.0;
+  }
+  double cost = model->predictor->predict(model, chunk_index, chunk, len);
+  return cost > 0.0 ? cost : 0.0;
+}
+
+void chunk_cost_free(ChunkCostModel *model) {
+  if (!model) {
+    return;
+  }
+  if (model->predictor && model->predictor->release) {
+    model->predictor->release(model);
+  }
+  memset(model, 0, sizeof *model);
+}
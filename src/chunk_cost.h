@@ -0,0 +1,46 @@
+#ifndef CHUNK_COST_H
+#define CHUNK_COST_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Predicts how long a chunk will take so the scheduler can start the slowest chunks first (longest
+ * processing time first). Only the ordering matters, so predictors may return any non-negative scale.
+ * A model spec is "NAME" or "NAME:ARGUMENT"; built-in predictors are:
+ *   size          chunk length in bytes
+ *   tokens        estimated prompt tokens plus weighted expected completion tokens
+ *   history:LOG   per-chunk timings from a previous run's log file, with a fitted seconds-per-byte
+ *                 rate for chunks the log does not cover
+ */
+typedef struct ChunkCostModel ChunkCostModel;
+
+typedef struct {
+  const char *name;
+  /* Optional; parses ARGUMENT into model->state. */
+  int (*init)(ChunkCostModel *model, const char *argument, char **error_out);
+  double (*predict)(const ChunkCostModel *model, size_t chunk_index, const char *chunk, size_t len);
+  /* Optional; releases model->state. */
+  void (*release)(ChunkCostModel *model);
+} ChunkCostPredictor;
+
+struct ChunkCostModel {
+  const ChunkCostPredictor *predictor;
+  int max_output_tokens;
+  void *state;
+};
+
+/* Adds a predictor to the lookup table used by chunk_cost_init. Returns -1 when the table is full. */
+int chunk_cost_register(const ChunkCostPredictor *predictor);
+
+/* An empty or NULL spec (or "none") leaves the model inactive, which keeps index order. */
+int chunk_cost_init(ChunkCostModel *model, const char *spec, int max_output_tokens, char **error_out);
+bool chunk_cost_active(const ChunkCostModel *model);
+double chunk_cost_predict(const ChunkCostModel *model, size_t chunk_index, const char *chunk, size_t len);
+void chunk_cost_free(ChunkCostModel *model);
+/* Rough prompt-token count shared by the tokens predictor, the autotuner and --plan. */
+double chunk_cost_estimate_tokens(const char *chunk, size_t len);
+/* Expected completion length: half the prompt, capped at max_output_tokens (or the provider default). */
+double chunk_cost_expected_completion(double prompt_tokens, int max_output_tokens);
+
+#endif /* CHUNK_COST_H */
@@ -0,0 +1,1000 @@
+#include "chunk_dedup.h"
+
+#include <limits.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEDUP_RECORD_WORDS 4
+#define DEDUP_REPLY_WORDS 2
+
+typedef struct {
+  uint64_t hash;
+  size_t start;
+  size_t end;
+  size_t index;
+  int origin;
+} DedupRecord;
+
+typedef struct {
+  int dest;
+  size_t chunk;
+  size_t representative;
+} DedupReply;
+
+static void assign_error(char **error_out, const char *fmt, ...) {
+  if (!error_out) {
+    return;
+  }
+  va_list args;
+  va_start(args, fmt);
+  va_list copy;
+  va_copy(copy, args);
+  int needed = vsnprintf(NULL, 0, fmt, copy);
+  va_end(copy);
+  if (needed < 0) {
+    va_end(args);
+    return;
+  }
+  size_t size = (size_t) needed + 1;
+  char *msg = malloc(size);
+  if (!msg) {
+    va_end(args);
+    return;
+  }
+  vsnprintf(msg, size, fmt, args);
+  va_end(args);
+  *error_out = msg;
+}
+
+static uint64_t hash_chunk(const char *data, size_t len) {
+  uint64_t hash = 1469598103934665603ULL;
+  for (size_t i = 0; i < len; ++i) {
+    hash ^= (unsigned char) data[i];
+    hash *= 1099511628211ULL;
+  }
+  hash ^= (uint64_t) len;
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+static bool all_ranks_ok(bool ok, MPI_Comm comm) {
+  int local = ok ? 1 : 0;
+  int global = 0;
+  MPI_Allreduce(&local, &global, 1, MPI_INT, MPI_MIN, comm);
+  return global == 1;
+}
+
+static int compare_records(const void *lhs, const void *rhs) {
+  const DedupRecord *a = lhs;
+  const DedupRecord *b = rhs;
+  if (a->hash != b->hash) {
+    return a->hash < b->hash ? -1 : 1;
+  }
+  size_t alen = a->end - a->start;
+  size_t blen = b->end - b->start;
+  if (alen != blen) {
+    return alen < blen ? -1 : 1;
+  }
+  if (a->index != b->index) {
+    return a->index < b->index ? -1 : 1;
+  }
+  return 0;
+}
+
+/* Sends `words`-wide rows grouped by destination and returns the received rows in recv_out. */
+static int exchange_rows(const unsigned long long *send, const int *send_rows, int words, int world_size,
+                         MPI_Comm comm, unsigned long long **recv_out, int **recv_rows_out, size_t *recv_total) {
+  int *send_counts = calloc((size_t) world_size, sizeof(int));
+  int *send_displs = calloc((size_t) world_size, sizeof(int));
+  int *recv_counts = calloc((size_t) world_size, sizeof(int));
+  int *recv_displs = calloc((size_t) world_size, sizeof(int));
+  bool ok = send_counts && send_displs && recv_counts && recv_displs;
+  long long offset = 0;
+  for (int i = 0; ok && i < world_size; ++i) {
+    send_counts[i] = send_rows[i] * words;
+    send_displs[i] = (int) offset;
+    offset += send_counts[i];
+    if (offset > INT_MAX) {
+      ok = false;
+    }
+  }
+  if (!all_ranks_ok(ok, comm)) {
+    free(send_counts);
+    free(send_displs);
+    free(recv_counts);
+    free(recv_displs);
+    return -1;
+  }
+
+  MPI_Alltoall(send_counts, 1, MPI_INT, recv_counts, 1, MPI_INT, comm);
+  offset = 0;
+  for (int i = 0; i < world_size; ++i) {
+    recv_displs[i] = (int) offset;
+    offset += recv_counts[i];
+  }
+  unsigned long long *recv = NULL;
+  int *recv_rows = calloc((size_t) world_size, sizeof(int));
+  ok = recv_rows != NULL && offset <= INT_MAX;
+  if (ok) {
+    recv = malloc(((size_t) offset + 1) * sizeof(unsigned long long));
+    ok = recv != NULL;
+  }
+  if (!all_ranks_ok(ok, comm)) {
+    free(recv);
+    free(recv_rows);
+    free(send_counts);
+    free(send_displs);
+    free(recv_counts);
+    free(recv_displs);
+    return -1;
+  }
+
+  MPI_Alltoallv(send, send_counts, send_displs, MPI_UNSIGNED_LONG_LONG, recv, recv_counts, recv_displs,
+                MPI_UNSIGNED_LONG_LONG, comm);
+  for (int i = 0; i < world_size; ++i) {
+    recv_rows[i] = recv_counts[i] / words;
+  }
+  *recv_out = recv;
+  *recv_rows_out = recv_rows;
+  *recv_total = (size_t) offset / (size_t) words;
+  free(send_counts);
+  free(send_displs);
+  free(recv_counts);
+  free(recv_displs);
+  return 0;
+}
+
+static int push_reply(DedupReply **replies, size_t *count, size_t *capacity, int dest, size_t chunk,
+                      size_t representative) {
+  if (*count == *capacity) {
+    size_t new_cap = *capacity ? *capacity * 2 : 64;
+    DedupReply *next = realloc(*replies, new_cap * sizeof(DedupReply));
+    if (!next) {
+      return -1;
+    }
+    *replies = next;
+    *capacity = new_cap;
+  }
+  (*replies)[*count].dest = dest;
+  (*replies)[*count].chunk = chunk;
+  (*replies)[*count].representative = representative;
+  (*count)++;
+  return 0;
+}
+
+/* Groups identical chunks among the records this rank owns and emits (chunk, representative) pairs
+ * to the rank holding the duplicate and, when different, the rank holding the representative. */
+static int elect_representatives(DedupRecord *records, size_t count, const char *data, DedupReply **replies_out,
+                                 size_t *reply_count, size_t *duplicates) {
+  qsort(records, count, sizeof(DedupRecord), compare_records);
+  bool *assigned = calloc(count ? count : 1, sizeof(bool));
+  if (!assigned) {
+    return -1;
+  }
+  DedupReply *replies = NULL;
+  size_t capacity = 0;
+  *reply_count = 0;
+  *duplicates = 0;
+  size_t group_start = 0;
+  while (group_start < count) {
+    size_t group_end = group_start + 1;
+    size_t len = records[group_start].end - records[group_start].start;
+    while (group_end < count && records[group_end].hash == records[group_start].hash &&
+           records[group_end].end - records[group_end].start == len) {
+      group_end++;
+    }
+    for (size_t rep = group_start; rep < group_end; ++rep) {
+      if (assigned[rep]) {
+        continue;
+      }
+      assigned[rep] = true;
+      const DedupRecord *leader = &records[rep];
+      for (size_t other = rep + 1; other < group_end; ++other) {
+        if (assigned[other] || memcmp(data + leader->start, data + records[other].start, len) != 0) {
+          continue;
+        }
+        assigned[other] = true;
+        (*duplicates)++;
+        if (push_reply(&replies, reply_count, &capacity, records[other].origin, records[other].index,
+                       leader->index) != 0 ||
+            (leader->origin != records[other].origin &&
+             push_reply(&replies, reply_count, &capacity, leader->origin, records[other].index,
+                        leader->index) != 0)) {
+          free(replies);
+          free(assigned);
+          return -1;
+        }
+      }
+    }
+    group_start = group_end;
+  }
+  free(assigned);
+  *replies_out = replies;
+  return 0;
+}
+
+/* Rows name an alias in word 0 and its leader in word 1 (held by the rank in holder_word, when that is not
+ * -1). Leaders record their aliases before any duplicate is skipped, so a rank that cannot record one makes
+ * every rank back out and keep its duplicates rather than lose a chunk. Taking back the aliases of rows
+ * [0, applied) restores the local leaders; aliases are appended, so the last ones added are the ones
+ * dropped. */
+static void drop_added_aliases(ChunkPlan *plan, const unsigned long long *rows, size_t applied, size_t width,
+                               int holder_word, int rank) {
+  for (size_t i = 0; i < applied; ++i) {
+    const unsigned long long *row = rows + i * width;
+    if (holder_word >= 0 && (int) row[holder_word] != rank) {
+      continue;
+    }
+    ChunkTask *leader = chunk_plan_find(plan, (size_t) row[1]);
+    if (leader && leader->alias_count > 0) {
+      leader->alias_count--;
+    }
+  }
+}
+
+int chunk_dedup_exchange(ChunkPlan *plan, const char *data, MPI_Comm comm, size_t *duplicates_out,
+                         char **error_out) {
+  if (duplicates_out) {
+    *duplicates_out = 0;
+  }
+  int rank = 0;
+  int world_size = 1;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &world_size);
+
+  size_t local_count = plan ? plan->count : 0;
+  int *send_rows = calloc((size_t) world_size, sizeof(int));
+  int *fill = calloc((size_t) world_size, sizeof(int));
+  uint64_t *hashes = malloc((local_count ? local_count : 1) * sizeof(uint64_t));
+  unsigned long long *send = malloc((local_count ? local_count : 1) * DEDUP_RECORD_WORDS *
+                                    sizeof(unsigned long long));
+  bool ok = send_rows && fill && hashes && send && (plan || local_count == 0) && (data || local_count == 0);
+  if (ok) {
+    for (size_t i = 0; i < local_count; ++i) {
+      const ChunkTask *task = &plan->tasks[i];
+      if (task->skip) {
+        continue;
+      }
+      hashes[i] = hash_chunk(data + task->start, task->end - task->start);
+      send_rows[hashes[i] % (uint64_t) world_size]++;
+    }
+    int offset = 0;
+    for (int i = 0; i < world_size; ++i) {
+      fill[i] = offset;
+      offset += send_rows[i];
+    }
+    for (size_t i = 0; i < local_count; ++i) {
+      const ChunkTask *task = &plan->tasks[i];
+      if (task->skip) {
+        continue;
+      }
+      int dest = (int) (hashes[i] % (uint64_t) world_size);
+      unsigned long long *row = send + (size_t) fill[dest]++ * DEDUP_RECORD_WORDS;
+      row[0] = (unsigned long long) hashes[i];
+      row[1] = (unsigned long long) task->start;
+      row[2] = (unsigned long long) task->end;
+      row[3] = (unsigned long long) task->index;
+    }
+  }
+  free(hashes);
+  free(fill);
+  if (!all_ranks_ok(ok, comm)) {
+    free(send_rows);
+    free(send);
+    assign_error(error_out, "rank %d could not allocate dedup hash table", rank);
+    return -1;
+  }
+
+  unsigned long long *recv = NULL;
+  int *recv_rows = NULL;
+  size_t recv_total = 0;
+  int rc = exchange_rows(send, send_rows, DEDUP_RECORD_WORDS, world_size, comm, &recv, &recv_rows, &recv_total);
+  free(send);
+  free(send_rows);
+  if (rc != 0) {
+    assign_error(error_out, "unable to exchange chunk hashes");
+    return -1;
+  }
+
+  DedupRecord *records = malloc((recv_total ? recv_total : 1) * sizeof(DedupRecord));
+  DedupReply *replies = NULL;
+  size_t reply_count = 0;
+  size_t owned_duplicates = 0;
+  ok = records != NULL;
+  if (ok) {
+    size_t row = 0;
+    for (int source = 0; source < world_size; ++source) {
+      for (int i = 0; i < recv_rows[source]; ++i, ++row) {
+        const unsigned long long *words = recv + row * DEDUP_RECORD_WORDS;
+        records[row].hash = (uint64_t) words[0];
+        records[row].start = (size_t) words[1];
+        records[row].end = (size_t) words[2];
+        records[row].index = (size_t) words[3];
+        records[row].origin = source;
+      }
+    }
+    ok = elect_representatives(records, recv_total, data, &replies, &reply_count, &owned_duplicates) == 0;
+  }
+  free(records);
+  free(recv);
+  free(recv_rows);
+
+  int *reply_rows = calloc((size_t) world_size, sizeof(int));
+  int *fill_rows = calloc((size_t) world_size, sizeof(int));
+  unsigned long long *reply_words = malloc((reply_count ? reply_count : 1) * DEDUP_REPLY_WORDS *
+                                           sizeof(unsigned long long));
+  ok = ok && reply_rows && fill_rows && reply_words;
+  if (ok) {
+    for (size_t i = 0; i < reply_count; ++i) {
+      reply_rows[replies[i].dest]++;
+    }
+    int offset = 0;
+    for (int i = 0; i < world_size; ++i) {
+      fill_rows[i] = offset;
+      offset += reply_rows[i];
+    }
+    for (size_t i = 0; i < reply_count; ++i) {
+      unsigned long long *row = reply_words + (size_t) fill_rows[replies[i].dest]++ * DEDUP_REPLY_WORDS;
+      row[0] = (unsigned long long) replies[i].chunk;
+      row[1] = (unsigned long long) replies[i].representative;
+    }
+  }
+  free(replies);
+  free(fill_rows);
+  if (!all_ranks_ok(ok, comm)) {
+    free(reply_rows);
+    free(reply_words);
+    assign_error(error_out, "rank %d could not allocate dedup replies", rank);
+    return -1;
+  }
+
+  rc = exchange_rows(reply_words, reply_rows, DEDUP_REPLY_WORDS, world_size, comm, &recv, &recv_rows,
+                     &recv_total);
+  free(reply_words);
+  free(reply_rows);
+  if (rc != 0) {
+    assign_error(error_out, "unable to exchange dedup decisions");
+    return -1;
+  }
+  size_t applied = 0;
+  ok = true;
+  for (; applied < recv_total; ++applied) {
+    const unsigned long long *row = recv + applied * DEDUP_REPLY_WORDS;
+    ChunkTask *leader = chunk_plan_find(plan, (size_t) row[1]);
+    if (leader && chunk_task_add_alias(leader, (size_t) row[0], 1.0) != 0) {
+      ok = false;
+      break;
+    }
+  }
+  if (!all_ranks_ok(ok, comm)) {
+    drop_added_aliases(plan, recv, applied, DEDUP_REPLY_WORDS, -1, rank);
+    free(recv);
+    free(recv_rows);
+    assign_error(error_out, "unable to record duplicate aliases; duplicates are sent as usual");
+    return -1;
+  }
+  for (size_t i = 0; i < recv_total; ++i) {
+    ChunkTask *duplicate = chunk_plan_find(plan, (size_t) recv[i * DEDUP_REPLY_WORDS]);
+    if (duplicate) {
+      duplicate->skip = true;
+      duplicate->duplicate_of = (size_t) recv[i * DEDUP_REPLY_WORDS + 1];
+    }
+  }
+  free(recv);
+  free(recv_rows);
+
+  unsigned long long local_dups = (unsigned long long) owned_duplicates;
+  unsigned long long global_dups = 0;
+  MPI_Allreduce(&local_dups, &global_dups, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, comm);
+  if (duplicates_out) {
+    *duplicates_out = (size_t) global_dups;
+  }
+  return 0;
+}
+
+#define MINHASH_PERMUTATIONS 64
+#define MINHASH_BANDS 16
+#define MINHASH_ROWS (MINHASH_PERMUTATIONS / MINHASH_BANDS)
+#define MINHASH_BUCKET_LEADERS 32
+#define NEAR_RECORD_WORDS 4
+#define NEAR_EDGE_WORDS 4
+#define NEAR_DECISION_WORDS 4
+#define NEAR_TRANSFER_WORDS 3
+#define SIMILARITY_SCALE 1000000ULL
+
+typedef struct {
+  uint64_t key;
+  size_t start;
+  size_t end;
+  size_t index;
+  int origin;
+} BandRecord;
+
+typedef struct {
+  size_t index;
+  bool valid;
+  uint32_t signature[MINHASH_PERMUTATIONS];
+} SignatureSlot;
+
+typedef struct {
+  unsigned long long *words;
+  size_t rows;
+  size_t capacity;
+  int width;
+} RowList;
+
+static uint64_t mix64(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+static bool token_byte(unsigned char ch) {
+  return (ch >= '0' && ch <= '9') || (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch >= 0x80;
+}
+
+static void minhash_update(uint32_t *signature, uint64_t shingle) {
+  for (unsigned i = 0; i < MINHASH_PERMUTATIONS; ++i) {
+    uint64_t a = mix64(0x9e3779b97f4a7c15ULL * (i + 1)) | 1ULL;
+    uint64_t b = mix64(0xd1b54a32d192ed03ULL * (i + 1));
+    uint32_t value = (uint32_t) ((a * shingle + b) >> 32);
+    if (value < signature[i]) {
+      signature[i] = value;
+    }
+  }
+}
+
+/* Signature over word 3-shingles (lower-cased alphanumeric tokens); short chunks fall back to single
+ * tokens. Returns false when the chunk has no tokens at all. */
+static bool minhash_signature(const char *data, size_t len, uint32_t *signature) {
+  for (unsigned i = 0; i < MINHASH_PERMUTATIONS; ++i) {
+    signature[i] = UINT32_MAX;
+  }
+  uint64_t window[3] = {0, 0, 0};
+  size_t tokens = 0;
+  size_t i = 0;
+  while (i < len) {
+    while (i < len && !token_byte((unsigned char) data[i])) {
+      i++;
+    }
+    if (i >= len) {
+      break;
+    }
+    uint64_t token = 1469598103934665603ULL;
+    while (i < len && token_byte((unsigned char) data[i])) {
+      unsigned char ch = (unsigned char) data[i++];
+      if (ch >= 'A' && ch <= 'Z') {
+        ch = (unsigned char) (ch - 'A' + 'a');
+      }
+      token ^= ch;
+      token *= 1099511628211ULL;
+    }
+    window[0] = window[1];
+    window[1] = window[2];
+    window[2] = token;
+    tokens++;
+    if (tokens >= 3) {
+      minhash_update(signature, mix64(window[0] ^ mix64(window[1] ^ mix64(window[2]))));
+    }
+  }
+  if (tokens == 0) {
+    return false;
+  }
+  if (tokens < 3) {
+    for (size_t t = 3 - tokens; t < 3; ++t) {
+      minhash_update(signature, mix64(window[t]));
+    }
+  }
+  return true;
+}
+
+static uint64_t band_key(const uint32_t *signature, unsigned band) {
+  uint64_t key = mix64(0x51afd7ed558ccd00ULL + band);
+  for (unsigned r = 0; r < MINHASH_ROWS; ++r) {
+    key = mix64(key ^ signature[band * MINHASH_ROWS + r]);
+  }
+  return key;
+}
+
+static uint64_t signature_similarity_ppm(const uint32_t *a, const uint32_t *b) {
+  unsigned matches = 0;
+  for (unsigned i = 0; i < MINHASH_PERMUTATIONS; ++i) {
+    matches += a[i] == b[i];
+  }
+  return (uint64_t) matches * SIMILARITY_SCALE / MINHASH_PERMUTATIONS;
+}
+
+static int row_list_push(RowList *list, const unsigned long long *row) {
+  if (list->rows == list->capacity) {
+    size_t new_cap = list->capacity ? list->capacity * 2 : 64;
+    unsigned long long *next = realloc(list->words, new_cap * (size_t) list->width * sizeof(unsigned long long));
+    if (!next) {
+      return -1;
+    }
+    list->words = next;
+    list->capacity = new_cap;
+  }
+  memcpy(list->words + list->rows * (size_t) list->width, row, (size_t) list->width * sizeof(unsigned long long));
+  list->rows++;
+  return 0;
+}
+
+static int compare_band_records(const void *lhs, const void *rhs) {
+  const BandRecord *a = lhs;
+  const BandRecord *b = rhs;
+  if (a->key != b->key) {
+    return a->key < b->key ? -1 : 1;
+  }
+  if (a->index != b->index) {
+    return a->index < b->index ? -1 : 1;
+  }
+  return 0;
+}
+
+static int compare_edges(const void *lhs, const void *rhs) {
+  const unsigned long long *a = lhs;
+  const unsigned long long *b = rhs;
+  /* (low, low origin, high, similarity): order by high, best similarity first, then low. */
+  if (a[2] != b[2]) {
+    return a[2] < b[2] ? -1 : 1;
+  }
+  if (a[3] != b[3]) {
+    return a[3] > b[3] ? -1 : 1;
+  }
+  if (a[0] != b[0]) {
+    return a[0] < b[0] ? -1 : 1;
+  }
+  return 0;
+}
+
+static int compare_size(const void *lhs, const void *rhs) {
+  size_t a = *(const size_t *) lhs;
+  size_t b = *(const size_t *) rhs;
+  return a < b ? -1 : (a > b ? 1 : 0);
+}
+
+static const uint32_t *cached_signature(SignatureSlot *cache, size_t cache_size, const BandRecord *record,
+                                        const char *data) {
+  SignatureSlot *slot = &cache[mix64(record->index) % cache_size];
+  if (slot->index != record->index || !slot->valid) {
+    slot->index = record->index;
+    slot->valid = minhash_signature(data + record->start, record->end - record->start, slot->signature);
+  }
+  return slot->valid ? slot->signature : NULL;
+}
+
+/* Within each LSH bucket, members are compared against up to MINHASH_BUCKET_LEADERS earlier members and
+ * an edge (leader, member) is emitted for pairs at or above the threshold. */
+static int collect_bucket_edges(BandRecord *records, size_t count, const char *data, uint64_t threshold_ppm,
+                                RowList *edges) {
+  qsort(records, count, sizeof(BandRecord), compare_band_records);
+  size_t cache_size = count < 1024 ? 1024 : (count > 65536 ? 65536 : count);
+  SignatureSlot *cache = calloc(cache_size, sizeof(SignatureSlot));
+  uint32_t(*leader_sigs)[MINHASH_PERMUTATIONS] = malloc(MINHASH_BUCKET_LEADERS * sizeof *leader_sigs);
+  size_t leader_index[MINHASH_BUCKET_LEADERS];
+  int leader_origin[MINHASH_BUCKET_LEADERS];
+  if (!cache || !leader_sigs) {
+    free(cache);
+    free(leader_sigs);
+    return -1;
+  }
+  size_t group_start = 0;
+  while (group_start < count) {
+    size_t group_end = group_start + 1;
+    while (group_end < count && records[group_end].key == records[group_start].key) {
+      group_end++;
+    }
+    size_t leaders = 0;
+    for (size_t m = group_start; group_end - group_start > 1 && m < group_end; ++m) {
+      if (m > group_start && records[m].index == records[m - 1].index) {
+        continue;
+      }
+      const uint32_t *signature = cached_signature(cache, cache_size, &records[m], data);
+      if (!signature) {
+        continue;
+      }
+      bool matched = false;
+      for (size_t l = 0; l < leaders; ++l) {
+        uint64_t similarity = signature_similarity_ppm(leader_sigs[l], signature);
+        if (similarity >= threshold_ppm) {
+          unsigned long long row[NEAR_EDGE_WORDS] = {leader_index[l], (unsigned long long) leader_origin[l],
+                                                      records[m].index, similarity};
+          if (row_list_push(edges, row) != 0) {
+            free(cache);
+            free(leader_sigs);
+            return -1;
+          }
+          matched = true;
+          break;
+        }
+      }
+      if (!matched && leaders < MINHASH_BUCKET_LEADERS) {
+        memcpy(leader_sigs[leaders], signature, sizeof leader_sigs[leaders]);
+        leader_index[leaders] = records[m].index;
+        leader_origin[leaders] = records[m].origin;
+        leaders++;
+      }
+    }
+    group_start = group_end;
+  }
+  free(cache);
+  free(leader_sigs);
+  return 0;
+}
+
+/* Rank 0: each chunk joins the most similar lower-indexed chunk that is still a representative. */
+static int choose_near_duplicates(unsigned long long *edges, size_t edge_count, RowList *decisions) {
+  qsort(edges, edge_count, NEAR_EDGE_WORDS * sizeof(unsigned long long), compare_edges);
+  size_t *aliased = malloc((edge_count ? edge_count : 1) * sizeof(size_t));
+  if (!aliased) {
+    return -1;
+  }
+  size_t aliased_count = 0;
+  for (size_t e = 0; e < edge_count; ++e) {
+    const unsigned long long *edge = edges + e * NEAR_EDGE_WORDS;
+    size_t low = (size_t) edge[0];
+    size_t high = (size_t) edge[2];
+    if (aliased_count > 0 && aliased[aliased_count - 1] == high) {
+      continue;
+    }
+    if (bsearch(&low, aliased, aliased_count, sizeof(size_t), compare_size)) {
+      continue;
+    }
+    unsigned long long row[NEAR_DECISION_WORDS] = {high, low, edge[1], edge[3]};
+    if (row_list_push(decisions, row) != 0) {
+      free(aliased);
+      return -1;
+    }
+    aliased[aliased_count++] = high;
+  }
+  free(aliased);
+  return 0;
+}
+
+int chunk_dedup_near_exchange(ChunkPlan *plan, const char *data, int threshold_percent, MPI_Comm comm,
+                              size_t *clustered_out, char **error_out) {
+  if (clustered_out) {
+    *clustered_out = 0;
+  }
+  int rank = 0;
+  int world_size = 1;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &world_size);
+  uint64_t threshold_ppm = (uint64_t) (threshold_percent < 1 ? 1 : threshold_percent) * SIMILARITY_SCALE / 100;
+
+  /* 1. LSH band keys for every chunk this rank still has to send. */
+  size_t local_count = plan ? plan->count : 0;
+  int *send_rows = calloc((size_t) world_size, sizeof(int));
+  RowList *outgoing = calloc((size_t) world_size, sizeof(RowList));
+  uint32_t signature[MINHASH_PERMUTATIONS];
+  bool ok = send_rows && outgoing && (data || local_count == 0);
+  for (int i = 0; ok && i < world_size; ++i) {
+    outgoing[i].width = NEAR_RECORD_WORDS;
+  }
+  for (size_t t = 0; ok && t < local_count; ++t) {
+    const ChunkTask *task = &plan->tasks[t];
+    if (task->skip || !minhash_signature(data + task->start, task->end - task->start, signature)) {
+      continue;
+    }
+    for (unsigned band = 0; ok && band < MINHASH_BANDS; ++band) {
+      uint64_t key = band_key(signature, band);
+      int dest = (int) (key % (uint64_t) world_size);
+      unsigned long long row[NEAR_RECORD_WORDS] = {key, task->start, task->end, task->index};
+      ok = row_list_push(&outgoing[dest], row) == 0;
+      send_rows[dest]++;
+    }
+  }
+  unsigned long long *send = NULL;
+  size_t total_rows = 0;
+  for (int i = 0; ok && i < world_size; ++i) {
+    total_rows += outgoing[i].rows;
+  }
+  if (ok) {
+    send = malloc((total_rows ? total_rows : 1) * NEAR_RECORD_WORDS * sizeof(unsigned long long));
+    ok = send != NULL;
+  }
+  if (ok) {
+    size_t offset = 0;
+    for (int i = 0; i < world_size; ++i) {
+      memcpy(send + offset, outgoing[i].words, outgoing[i].rows * NEAR_RECORD_WORDS * sizeof(unsigned long long));
+      offset += outgoing[i].rows * NEAR_RECORD_WORDS;
+    }
+  }
+  for (int i = 0; outgoing && i < world_size; ++i) {
+    free(outgoing[i].words);
+  }
+  free(outgoing);
+  if (!all_ranks_ok(ok, comm)) {
+    free(send);
+    free(send_rows);
+    assign_error(error_out, "rank %d could not allocate MinHash band records", rank);
+    return -1;
+  }
+
+  unsigned long long *recv = NULL;
+  int *recv_rows = NULL;
+  size_t recv_total = 0;
+  int rc = exchange_rows(send, send_rows, NEAR_RECORD_WORDS, world_size, comm, &recv, &recv_rows, &recv_total);
+  free(send);
+  free(send_rows);
+  if (rc != 0) {
+    assign_error(error_out, "unable to exchange MinHash band keys");
+    return -1;
+  }
+
+  /* 2. Bucket owners verify candidates against the similarity threshold. */
+  RowList edges = {.width = NEAR_EDGE_WORDS};
+  BandRecord *records = malloc((recv_total ? recv_total : 1) * sizeof(BandRecord));
+  ok = records != NULL;
+  if (ok) {
+    size_t row = 0;
+    for (int source = 0; source < world_size; ++source) {
+      for (int i = 0; i < recv_rows[source]; ++i, ++row) {
+        const unsigned long long *words = recv + row * NEAR_RECORD_WORDS;
+        records[row].key = (uint64_t) words[0];
+        records[row].start = (size_t) words[1];
+        records[row].end = (size_t) words[2];
+        records[row].index = (size_t) words[3];
+        records[row].origin = source;
+      }
+    }
+    ok = collect_bucket_edges(records, recv_total, data, threshold_ppm, &edges) == 0;
+  }
+  free(records);
+  free(recv);
+  free(recv_rows);
+
+  /* 3. Rank 0 gathers the edges, forms clusters and broadcasts (alias, representative, holder, similarity). */
+  int edge_words = ok && edges.rows * NEAR_EDGE_WORDS <= INT_MAX ? (int) (edges.rows * NEAR_EDGE_WORDS) : 0;
+  if (!all_ranks_ok(ok && (size_t) edge_words == edges.rows * NEAR_EDGE_WORDS, comm)) {
+    free(edges.words);
+    assign_error(error_out, "rank %d could not collect similarity edges", rank);
+    return -1;
+  }
+  int *edge_counts = rank == 0 ? calloc((size_t) world_size, sizeof(int)) : NULL;
+  int *edge_displs = rank == 0 ? calloc((size_t) world_size, sizeof(int)) : NULL;
+  MPI_Gather(&edge_words, 1, MPI_INT, edge_counts, 1, MPI_INT, 0, comm);
+  unsigned long long *all_edges = NULL;
+  long long all_words = 0;
+  ok = true;
+  if (rank == 0) {
+    ok = edge_counts && edge_displs;
+    for (int i = 0; ok && i < world_size; ++i) {
+      edge_displs[i] = (int) all_words;
+      all_words += edge_counts[i];
+      ok = all_words <= INT_MAX;
+    }
+    if (ok) {
+      all_edges = malloc(((size_t) all_words + 1) * sizeof(unsigned long long));
+      ok = all_edges != NULL;
+    }
+  }
+  if (!all_ranks_ok(ok, comm)) {
+    free(edges.words);
+    free(edge_counts);
+    free(edge_displs);
+    free(all_edges);
+    assign_error(error_out, "unable to gather similarity edges");
+    return -1;
+  }
+  MPI_Gatherv(edges.words, edge_words, MPI_UNSIGNED_LONG_LONG, all_edges, edge_counts, edge_displs,
+              MPI_UNSIGNED_LONG_LONG, 0, comm);
+  free(edges.words);
+  free(edge_counts);
+  free(edge_displs);
+
+  RowList decisions = {.width = NEAR_DECISION_WORDS};
+  ok = true;
+  if (rank == 0) {
+    ok = choose_near_duplicates(all_edges, (size_t) all_words / NEAR_EDGE_WORDS, &decisions) == 0;
+  }
+  free(all_edges);
+  unsigned long long decision_rows = ok ? (unsigned long long) decisions.rows : 0ULL;
+  MPI_Bcast(&decision_rows, 1, MPI_UNSIGNED_LONG_LONG, 0, comm);
+  ok = decision_rows * NEAR_DECISION_WORDS <= INT_MAX;
+  if (ok && rank != 0) {
+    decisions.words = malloc(((size_t) decision_rows + 1) * NEAR_DECISION_WORDS * sizeof(unsigned long long));
+    decisions.rows = (size_t) decision_rows;
+    ok = decisions.words != NULL;
+  }
+  if (!all_ranks_ok(ok, comm)) {
+    free(decisions.words);
+    assign_error(error_out, "unable to distribute near-duplicate clusters");
+    return -1;
+  }
+  if (decision_rows > 0) {
+    MPI_Bcast(decisions.words, (int) (decision_rows * NEAR_DECISION_WORDS), MPI_UNSIGNED_LONG_LONG, 0, comm);
+  }
+
+  /* 4. Apply. Representatives record their new aliases, and aliases that already carried exact duplicates
+   * hand those over to the new representative's rank. Duplicates are only skipped once every rank has
+   * managed both, so a failed allocation leaves the plan as it was. */
+  int *transfer_rows = calloc((size_t) world_size, sizeof(int));
+  RowList *transfers = calloc((size_t) world_size, sizeof(RowList));
+  ok = transfer_rows && transfers;
+  for (int i = 0; ok && i < world_size; ++i) {
+    transfers[i].width = NEAR_TRANSFER_WORDS;
+  }
+  size_t applied = 0;
+  for (; ok && applied < decisions.rows; ++applied) {
+    const unsigned long long *row = decisions.words + applied * NEAR_DECISION_WORDS;
+    ChunkTask *leader = rank == (int) row[2] ? chunk_plan_find(plan, (size_t) row[1]) : NULL;
+    if (leader && chunk_task_add_alias(leader, (size_t) row[0], (double) row[3] / (double) SIMILARITY_SCALE) != 0) {
+      ok = false;
+      break;
+    }
+  }
+  for (size_t d = 0; ok && d < decisions.rows; ++d) {
+    const unsigned long long *row = decisions.words + d * NEAR_DECISION_WORDS;
+    int holder = (int) row[2];
+    const ChunkTask *duplicate = chunk_plan_find(plan, (size_t) row[0]);
+    for (size_t a = 0; ok && duplicate && a < duplicate->alias_count; ++a) {
+      unsigned long long move[NEAR_TRANSFER_WORDS] = {duplicate->aliases[a], row[1], row[3]};
+      ok = holder >= 0 && holder < world_size && row_list_push(&transfers[holder], move) == 0;
+      if (ok) {
+        transfer_rows[holder]++;
+      }
+    }
+  }
+  unsigned long long *transfer_words = NULL;
+  total_rows = 0;
+  for (int i = 0; ok && i < world_size; ++i) {
+    total_rows += transfers[i].rows;
+  }
+  if (ok) {
+    transfer_words = malloc((total_rows ? total_rows : 1) * NEAR_TRANSFER_WORDS * sizeof(unsigned long long));
+    ok = transfer_words != NULL;
+  }
+  if (ok) {
+    size_t offset = 0;
+    for (int i = 0; i < world_size; ++i) {
+      memcpy(transfer_words + offset, transfers[i].words,
+             transfers[i].rows * NEAR_TRANSFER_WORDS * sizeof(unsigned long long));
+      offset += transfers[i].rows * NEAR_TRANSFER_WORDS;
+    }
+  }
+  for (int i = 0; transfers && i < world_size; ++i) {
+    free(transfers[i].words);
+  }
+  free(transfers);
+  if (!all_ranks_ok(ok, comm)) {
+    drop_added_aliases(plan, decisions.words, applied, NEAR_DECISION_WORDS, 2, rank);
+    free(decisions.words);
+    free(transfer_rows);
+    free(transfer_words);
+    assign_error(error_out, "unable to record near-duplicate aliases; duplicates are sent as usual");
+    return -1;
+  }
+  rc = exchange_rows(transfer_words, transfer_rows, NEAR_TRANSFER_WORDS, world_size, comm, &recv, &recv_rows,
+                     &recv_total);
+  free(transfer_words);
+  free(transfer_rows);
+  if (rc != 0) {
+    drop_added_aliases(plan, decisions.words, applied, NEAR_DECISION_WORDS, 2, rank);
+    free(decisions.words);
+    assign_error(error_out, "unable to hand over duplicate aliases");
+    return -1;
+  }
+  size_t moved = 0;
+  ok = true;
+  for (; moved < recv_total; ++moved) {
+    const unsigned long long *row = recv + moved * NEAR_TRANSFER_WORDS;
+    ChunkTask *leader = chunk_plan_find(plan, (size_t) row[1]);
+    if (leader && chunk_task_add_alias(leader, (size_t) row[0], (double) row[2] / (double) SIMILARITY_SCALE) != 0) {
+      ok = false;
+      break;
+    }
+  }
+  if (!all_ranks_ok(ok, comm)) {
+    drop_added_aliases(plan, recv, moved, NEAR_TRANSFER_WORDS, -1, rank);
+    drop_added_aliases(plan, decisions.words, applied, NEAR_DECISION_WORDS, 2, rank);
+    free(decisions.words);
+    free(recv);
+    free(recv_rows);
+    assign_error(error_out, "unable to hand over duplicate aliases; duplicates are sent as usual");
+    return -1;
+  }
+  free(recv);
+  free(recv_rows);
+  for (size_t d = 0; d < decisions.rows; ++d) {
+    const unsigned long long *row = decisions.words + d * NEAR_DECISION_WORDS;
+    ChunkTask *duplicate = chunk_plan_find(plan, (size_t) row[0]);
+    if (duplicate) {
+      duplicate->skip = true;
+      duplicate->duplicate_of = (size_t) row[1];
+      duplicate->alias_count = 0;
+    }
+  }
+  free(decisions.words);
+
+  if (clustered_out) {
+    *clustered_out = (size_t) decision_rows;
+  }
+  return 0;
+}
+
+int chunk_dedup_share_verdicts(ChunkPlan *plan, const ChunkPlan *root_plan, MPI_Comm comm, size_t *folded_out,
+                               char **error_out) {
+  if (folded_out) {
+    *folded_out = 0;
+  }
+  int rank = 0;
+  MPI_Comm_rank(comm, &rank);
+  unsigned long long rows = 0;
+  for (size_t i = 0; rank == 0 && root_plan && i < root_plan->count; ++i) {
+    rows += root_plan->tasks[i].alias_count;
+  }
+  bool ok = rows <= INT_MAX / NEAR_TRANSFER_WORDS;
+  unsigned long long *verdicts = ok ? malloc((rows ? rows : 1) * NEAR_TRANSFER_WORDS * sizeof *verdicts) : NULL;
+  ok = verdicts != NULL;
+  if (ok && rank == 0 && root_plan) {
+    size_t offset = 0;
+    for (size_t i = 0; i < root_plan->count; ++i) {
+      const ChunkTask *leader = &root_plan->tasks[i];
+      for (size_t a = 0; a < leader->alias_count; ++a) {
+        verdicts[offset++] = leader->aliases[a];
+        verdicts[offset++] = leader->index;
+        verdicts[offset++] = (unsigned long long) (leader->alias_similarity[a] * (double) SIMILARITY_SCALE + 0.5);
+      }
+    }
+  }
+  /* rows is only known on rank 0 until the broadcast, so the outcome travels with it. */
+  unsigned long long header[2] = {rows, ok ? 1ULL : 0ULL};
+  MPI_Bcast(header, 2, MPI_UNSIGNED_LONG_LONG, 0, comm);
+  if (header[1] == 0) {
+    free(verdicts);
+    assign_error(error_out, "rank 0 could not collect its dedup verdicts");
+    return -1;
+  }
+  rows = header[0];
+  if (rank != 0) {
+    free(verdicts);
+    verdicts = malloc((rows ? rows : 1) * NEAR_TRANSFER_WORDS * sizeof *verdicts);
+    ok = verdicts != NULL;
+  }
+  if (!all_ranks_ok(ok, comm)) {
+    free(verdicts);
+    assign_error(error_out, "unable to allocate %llu dedup verdicts", rows);
+    return -1;
+  }
+  if (rows > 0) {
+    MPI_Bcast(verdicts, (int) (rows * NEAR_TRANSFER_WORDS), MPI_UNSIGNED_LONG_LONG, 0, comm);
+  }
+  size_t applied = 0;
+  for (; applied < (size_t) rows; ++applied) {
+    const unsigned long long *row = verdicts + applied * NEAR_TRANSFER_WORDS;
+    ChunkTask *leader = chunk_plan_find(plan, (size_t) row[1]);
+    if (leader && chunk_task_add_alias(leader, (size_t) row[0], (double) row[2] / (double) SIMILARITY_SCALE) != 0) {
+      ok = false;
+      break;
+    }
+  }
+  if (!all_ranks_ok(ok, comm)) {
+    drop_added_aliases(plan, verdicts, applied, NEAR_TRANSFER_WORDS, -1, rank);
+    free(verdicts);
+    assign_error(error_out, "unable to record shared dedup verdicts; duplicates are sent as usual");
+    return -1;
+  }
+  for (unsigned long long i = 0; i < rows; ++i) {
+    const unsigned long long *row = verdicts + i * NEAR_TRANSFER_WORDS;
+    ChunkTask *duplicate = chunk_plan_find(plan, (size_t) row[0]);
+    if (duplicate) {
+      duplicate->skip = true;
+      duplicate->duplicate_of = (size_t) row[1];
+    }
+  }
+  free(verdicts);
+  if (folded_out) {
+    *folded_out = (size_t) rows;
+  }
+  return 0;
+}
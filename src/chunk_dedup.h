@@ -0,0 +1,37 @@
+#ifndef CHUNK_DEDUP_H
+#define CHUNK_DEDUP_H
+
+#include <mpi.h>
+#include <stddef.h>
+
+#include "input_chunker.h"
+
+/**
+ * Collective over comm. Every rank hashes the chunks in its plan that are not already skipped, hashes are partitioned to owner
+ * ranks with MPI_Alltoallv, and owners confirm byte equality before electing the lowest chunk index
+ * as representative. On return duplicates are marked skip and representatives carry their aliases,
+ * even when the alias lives on another rank. duplicates_out receives the cluster-wide count.
+ */
+int chunk_dedup_exchange(ChunkPlan *plan, const char *data, MPI_Comm comm, size_t *duplicates_out,
+                         char **error_out);
+
+/**
+ * Collective over comm, run after chunk_dedup_exchange. Chunks still to be sent get a 64-permutation
+ * MinHash signature over word 3-shingles; LSH band keys (16 bands of 4 rows) are partitioned to owner
+ * ranks, owners verify bucket candidates against threshold_percent, and rank 0 clusters the resulting
+ * edges so each chunk joins its most similar lower-indexed representative. clustered_out receives the
+ * number of chunks folded into another chunk's request.
+ */
+int chunk_dedup_near_exchange(ChunkPlan *plan, const char *data, int threshold_percent, MPI_Comm comm,
+                              size_t *clustered_out, char **error_out);
+
+/**
+ * Collective over comm, for payloads only rank 0 holds in full (a pipelined broadcast still in flight).
+ * Rank 0 passes root_plan, a plan of every chunk it has already run through the dedup passes with
+ * MPI_COMM_SELF; the other ranks pass NULL. Rank 0 broadcasts each alias with its representative and
+ * similarity, and every rank applies them to its own plan. folded_out receives the alias count.
+ */
+int chunk_dedup_share_verdicts(ChunkPlan *plan, const ChunkPlan *root_plan, MPI_Comm comm, size_t *folded_out,
+                               char **error_out);
+
+#endif /* CHUNK_DEDUP_H */
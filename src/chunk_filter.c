@@ -0,0 +1,254 @@
+#include "chunk_filter.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void assign_error(char **error_out, const char *fmt, ...) {
+  if (!error_out) {
+    return;
+  }
+  va_list args;
+  va_start(args, fmt);
+  va_list copy;
+  va_copy(copy, args);
+  int needed = vsnprintf(NULL, 0, fmt, copy);
+  va_end(copy);
+  if (needed < 0) {
+    va_end(args);
+    return;
+  }
+  size_t size = (size_t) needed + 1;
+  char *msg = malloc(size);
+  if (!msg) {
+    va_end(args);
+    return;
+  }
+  vsnprintf(msg, size, fmt, args);
+  va_end(args);
+  *error_out = msg;
+}
+
+static unsigned char fold_byte(const ChunkFilter *filter, unsigned char ch) {
+  if (filter->ignore_case && ch >= 'A' && ch <= 'Z') {
+    return (unsigned char) (ch - 'A' + 'a');
+  }
+  return ch;
+}
+
+/* Calls fn for every non-empty line of a newline-separated list. */
+static int for_each_line(const char *list, int (*fn)(ChunkFilter *, const char *, size_t, char **),
+                         ChunkFilter *filter, char **error_out) {
+  const char *cursor = list;
+  while (cursor && *cursor) {
+    const char *end = strchr(cursor, '\n');
+    size_t len = end ? (size_t) (end - cursor) : strlen(cursor);
+    size_t trimmed = len;
+    while (trimmed > 0 && cursor[trimmed - 1] == '\r') {
+      trimmed--;
+    }
+    if (trimmed > 0 && fn(filter, cursor, trimmed, error_out) != 0) {
+      return -1;
+    }
+    cursor = end ? end + 1 : NULL;
+  }
+  return 0;
+}
+
+static int register_classes(ChunkFilter *filter, const char *keyword, size_t len, char **error_out) {
+  (void) error_out;
+  for (size_t i = 0; i < len; ++i) {
+    unsigned char ch = fold_byte(filter, (unsigned char) keyword[i]);
+    if (filter->byte_class[ch] == 0) {
+      filter->byte_class[ch] = (unsigned short) filter->class_count++;
+    }
+  }
+  filter->keyword_count++;
+  return 0;
+}
+
+static int add_state(ChunkFilter *filter) {
+  if (filter->state_count == filter->state_capacity) {
+    size_t new_cap = filter->state_capacity ? filter->state_capacity * 2 : 64;
+    int *delta = realloc(filter->delta, new_cap * filter->class_count * sizeof(int));
+    if (!delta) {
+      return -1;
+    }
+    filter->delta = delta;
+    bool *terminal = realloc(filter->terminal, new_cap * sizeof(bool));
+    if (!terminal) {
+      return -1;
+    }
+    filter->terminal = terminal;
+    filter->state_capacity = new_cap;
+  }
+  size_t state = filter->state_count++;
+  for (size_t c = 0; c < filter->class_count; ++c) {
+    filter->delta[state * filter->class_count + c] = -1;
+  }
+  filter->terminal[state] = false;
+  return (int) state;
+}
+
+static int insert_keyword(ChunkFilter *filter, const char *keyword, size_t len, char **error_out) {
+  int state = 0;
+  for (size_t i = 0; i < len; ++i) {
+    size_t cls = filter->byte_class[fold_byte(filter, (unsigned char) keyword[i])];
+    int *slot = &filter->delta[(size_t) state * filter->class_count + cls];
+    if (*slot < 0) {
+      int next = add_state(filter);
+      if (next < 0) {
+        assign_error(error_out, "unable to allocate keyword automaton");
+        return -1;
+      }
+      slot = &filter->delta[(size_t) state * filter->class_count + cls];
+      *slot = next;
+    }
+    state = *slot;
+  }
+  filter->terminal[state] = true;
+  return 0;
+}
+
+/* Breadth-first pass that turns the trie into a complete DFA: missing transitions follow the failure
+ * link, and states whose failure chain ends a keyword become terminal too. */
+static int link_failures(ChunkFilter *filter, char **error_out) {
+  size_t classes = filter->class_count;
+  int *fail = calloc(filter->state_count, sizeof(int));
+  int *queue = malloc(filter->state_count * sizeof(int));
+  if (!fail || !queue) {
+    free(fail);
+    free(queue);
+    assign_error(error_out, "unable to allocate keyword automaton");
+    return -1;
+  }
+  size_t head = 0;
+  size_t tail = 0;
+  for (size_t c = 0; c < classes; ++c) {
+    int next = filter->delta[c];
+    if (next < 0) {
+      filter->delta[c] = 0;
+    } else {
+      fail[next] = 0;
+      queue[tail++] = next;
+    }
+  }
+  while (head < tail) {
+    int state = queue[head++];
+    filter->terminal[state] = filter->terminal[state] || filter->terminal[fail[state]];
+    for (size_t c = 0; c < classes; ++c) {
+      int *slot = &filter->delta[(size_t) state * classes + c];
+      int fallback = filter->delta[(size_t) fail[state] * classes + c];
+      if (*slot < 0) {
+        *slot = fallback;
+      } else {
+        fail[*slot] = fallback;
+        queue[tail++] = *slot;
+      }
+    }
+  }
+  free(fail);
+  free(queue);
+  return 0;
+}
+
+static int compile_regex(ChunkFilter *filter, const char *pattern, size_t len, char **error_out) {
+  char *copy = malloc(len + 1);
+  regex_t *grown = realloc(filter->regexes, (filter->regex_count + 1) * sizeof(regex_t));
+  if (!copy || !grown) {
+    free(copy);
+    if (grown) {
+      filter->regexes = grown;
+    }
+    assign_error(error_out, "unable to allocate regex filter");
+    return -1;
+  }
+  filter->regexes = grown;
+  memcpy(copy, pattern, len);
+  copy[len] = '\0';
+  int flags = REG_EXTENDED | REG_NOSUB | (filter->ignore_case ? REG_ICASE : 0);
+  int rc = regcomp(&filter->regexes[filter->regex_count], copy, flags);
+  if (rc != 0) {
+    char reason[256];
+    regerror(rc, &filter->regexes[filter->regex_count], reason, sizeof reason);
+    assign_error(error_out, "invalid filter regex '%s': %s", copy, reason);
+    free(copy);
+    return -1;
+  }
+  filter->regex_count++;
+  free(copy);
+  return 0;
+}
+
+int chunk_filter_init(ChunkFilter *filter, const char *keywords, const char *patterns, bool ignore_case,
+                      char **error_out) {
+  if (!filter) {
+    return -1;
+  }
+  memset(filter, 0, sizeof *filter);
+  filter->ignore_case = ignore_case;
+  filter->class_count = 1;
+
+  for_each_line(keywords, register_classes, filter, error_out);
+  if (ignore_case) {
+    for (unsigned ch = 'A'; ch <= 'Z'; ++ch) {
+      filter->byte_class[ch] = filter->byte_class[ch - 'A' + 'a'];
+    }
+  }
+  if (filter->keyword_count > 0) {
+    if (add_state(filter) != 0 ||
+        for_each_line(keywords, insert_keyword, filter, error_out) != 0 ||
+        link_failures(filter, error_out) != 0) {
+      chunk_filter_free(filter);
+      return -1;
+    }
+  }
+  if (for_each_line(patterns, compile_regex, filter, error_out) != 0) {
+    chunk_filter_free(filter);
+    return -1;
+  }
+  filter->active = filter->keyword_count > 0 || filter->regex_count > 0;
+  return 0;
+}
+
+bool chunk_filter_matches(const ChunkFilter *filter, const char *data, size_t len) {
+  if (!filter || !filter->active) {
+    return true;
+  }
+  if (filter->keyword_count > 0) {
+    const unsigned char *bytes = (const unsigned char *) data;
+    const unsigned short *classes = filter->byte_class;
+    const int *delta = filter->delta;
+    size_t width = filter->class_count;
+    int state = 0;
+    for (size_t i = 0; i < len; ++i) {
+      state = delta[(size_t) state * width + classes[bytes[i]]];
+      if (filter->terminal[state]) {
+        return true;
+      }
+    }
+  }
+  for (size_t i = 0; i < filter->regex_count; ++i) {
+    regmatch_t range[1];
+    range[0].rm_so = 0;
+    range[0].rm_eo = (regoff_t) len;
+    if (regexec(&filter->regexes[i], data, 1, range, REG_STARTEND) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void chunk_filter_free(ChunkFilter *filter) {
+  if (!filter) {
+    return;
+  }
+  free(filter->delta);
+  free(filter->terminal);
+  for (size_t i = 0; i < filter->regex_count; ++i) {
+    regfree(&filter->regexes[i]);
+  }
+  free(filter->regexes);
+  memset(filter, 0, sizeof *filter);
+}
@@ -0,0 +1,36 @@
+#ifndef CHUNK_FILTER_H
+#define CHUNK_FILTER_H
+
+#include <regex.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Local predicate evaluated before a chunk is sent: the chunk passes when it contains any keyword or
+ * matches any POSIX extended regex. Keywords compile into one Aho-Corasick automaton whose transitions
+ * are a dense table over the byte classes that actually occur in the keywords, so the scan costs one
+ * table lookup per payload byte. An inactive filter passes everything.
+ */
+typedef struct {
+  unsigned short byte_class[256];
+  size_t class_count;
+  int *delta;
+  bool *terminal;
+  size_t state_count;
+  size_t state_capacity;
+  size_t keyword_count;
+  regex_t *regexes;
+  size_t regex_count;
+  bool ignore_case;
+  bool active;
+} ChunkFilter;
+
+/**
+ * keywords and patterns are newline-separated lists (either may be NULL).
+ */
+int chunk_filter_init(ChunkFilter *filter, const char *keywords, const char *patterns, bool ignore_case,
+                      char **error_out);
+bool chunk_filter_matches(const ChunkFilter *filter, const char *data, size_t len);
+void chunk_filter_free(ChunkFilter *filter);
+
+#endif /* CHUNK_FILTER_H */
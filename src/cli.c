@@ -36,11 +36,58 @@ enum {
   OPT_AUTOSCALE_MODE,
   OPT_AUTOSCALE_THRESHOLD,
   OPT_AUTOSCALE_FACTOR,
+  OPT_AUTOSCALE_MAX_RANKS,
   OPT_TUI_LOG_VIEW_ON,
   OPT_TUI_LOG_VIEW_OFF,
   OPT_REPL,
   OPT_NONINTERACTIVE,
-  OPT_REPL_HISTORY_LIMIT
+  OPT_REPL_HISTORY_LIMIT,
+  OPT_NORMALIZE_ON,
+  OPT_NORMALIZE_OFF,
+  OPT_DEDUP_ON,
+  OPT_DEDUP_OFF,
+  OPT_NEAR_DEDUP_ON,
+  OPT_NEAR_DEDUP_OFF,
+  OPT_NEAR_DEDUP_THRESHOLD,
+  OPT_FILTER_KEYWORDS,
+  OPT_FILTER_KEYWORD_FILE,
+  OPT_FILTER_REGEX,
+  OPT_FILTER_IGNORE_CASE,
+  OPT_DAEMON,
+  OPT_DAEMON_SOCKET,
+  OPT_JOB_GROUPS,
+  OPT_STREAM,
+  OPT_STREAM_WINDOW,
+  OPT_STREAM_BATCH,
+  OPT_WATCH_DIR,
+  OPT_WATCH_DONE_DIR,
+  OPT_COORDINATOR_ON,
+  OPT_COORDINATOR_OFF,
+  OPT_RESILIENT_ON,
+  OPT_RESILIENT_OFF,
+  OPT_FAULT_TIMEOUT,
+  OPT_RETRY_WAVES,
+  OPT_COST_MODEL,
+  OPT_MAX_INFLIGHT,
+  OPT_AUTOTUNE_ON,
+  OPT_AUTOTUNE_OFF,
+  OPT_AUTOTUNE_CACHE,
+  OPT_AUTOTUNE_RPM,
+  OPT_PLAN,
+  OPT_PLAN_RANKS,
+  OPT_PRICE_INPUT,
+  OPT_PRICE_OUTPUT,
+  OPT_LATENCY_OVERHEAD,
+  OPT_OUTPUT_TPS,
+  OPT_MAX_MEMORY,
+  OPT_NUMA_BIND_ON,
+  OPT_NUMA_BIND_OFF,
+  OPT_IO_BACKEND,
+  OPT_RESPONSE_FSYNC_ON,
+  OPT_RESPONSE_FSYNC_OFF,
+  OPT_BCAST_SEGMENT,
+  OPT_MPI_COMPRESS,
+  OPT_RESULTS_ARROW
 };
 
 static void print_version(void) {
@@ -49,36 +96,74 @@ static void print_version(void) {
 
 static void print_help(const char *prog) {
   printf("Usage: %s [options]\n\n", prog);
-  puts("Key options:\n"
-       "  --api-endpoint URL         Override DeepSeek API endpoint\n"
-       "  --api-key-env NAME         Environment variable containing API key\n"
-       "  --api-key VALUE            Provide API key directly (overrides env)\n"
-       "  --chunk-size BYTES         Chunk size per MPI slice\n"
-       "  --max-request-bytes BYTES  Upper bound for encoded payload\n"
-       "  --input-file PATH          Read payload from file (use '-' for stdin)\n"
-       "  --stdin                    Force stdin for payload\n"
-       "  --inline-text STRING       Provide inline text without TUI\n"
-       "  --system-prompt FILE       Read a system prompt from FILE (sent with every request)\n"
-       "  --config FILE              Load key=value defaults from file\n"
-       "  --log-file PATH            Redirect log output\n"
-       "  --response-dir DIR         Persist each chunk response as JSON\n"
-       "  --response-files / --no-response-files  Toggle per-rank response file emission (default on)\n"
-       "  --tasks N / --mp N / --np N  Desired task count (auto chunking across MPI ranks)\n"
-       "  --auto-scale-threshold BYTES  Trigger size for automatic scaling (default 100MB)\n"
-       "  --auto-scale-mode MODE      Autoscale strategy: none, threads, chunks\n"
-       "  --auto-scale-factor N       Multiplier applied when autoscale fires\n"
-       "  --api-provider NAME        Target API provider: deepseek, openai, anthropic, zai\n"
-       "  --model MODEL              Override model for OpenAI/Anthropic/Zai-compatible APIs\n"
-       "  --max-output-tokens N      Cap response tokens for OpenAI/Anthropic/Zai providers\n"
-       "  --anthropic-version DATE   Override the x-anthropic-version header\n"
-       "  --timeout SECONDS          HTTP timeout\n"
-       "  --max-retries N            Retry count per chunk\n"
-       "  --retry-delay-ms MS        Delay between retries in milliseconds\n"
-       "  --network-retries N        MPI-level client resets after network failures\n"
-       "  --readline / --no-readline  Toggle GNU Readline prompt when TUI is disabled\n"
+  fputs("Key options:\n"
+        "  --api-endpoint URL         Override DeepSeek API endpoint\n"
+        "  --api-key-env NAME         Environment variable containing API key\n"
+        "  --api-key VALUE            Provide API key directly (overrides env)\n"
+        "  --chunk-size BYTES         Chunk size per MPI slice\n"
+        "  --max-request-bytes BYTES  Upper bound for encoded payload\n"
+        "  --max-memory BYTES         Per-rank memory budget; responses past it spool to disk (default 0 = none)\n"
+        "  --bcast-segment BYTES      Broadcast the payload in segments of BYTES so ranks start early (0 = one piece)\n"
+        "  --mpi-compress CODEC       Compress payload and response transfers: auto, off, lz4, zstd or zlib\n"
+        "  --numa-bind / --no-numa-bind  Spread the ranks on each host over its NUMA domains (default off)\n"
+        "  --input-file PATH          Read payload from file (use '-' for stdin)\n"
+        "  --stdin                    Force stdin for payload\n"
+        "  --inline-text STRING       Provide inline text without TUI\n"
+        "  --normalize / --no-normalize  Compact whitespace, boilerplate, empty CSV columns and base64 before chunking\n"
+        "  --dedup / --no-dedup       Send byte-identical chunks once and reuse the response (default on)\n"
+        "  --near-dedup / --no-near-dedup  Reuse one response for MinHash near-duplicate chunks (default off)\n"
+        "  --near-dedup-threshold PCT  Minimum estimated similarity for --near-dedup (default 90)\n"
+        "  --filter-keywords LIST     Only send chunks containing one of these comma-separated keywords\n"
+        "  --filter-keyword-file FILE  Read filter keywords from FILE, one per line\n"
+        "  --filter-regex PATTERN     Only send chunks matching this extended regex (repeatable)\n"
+        "  --filter-ignore-case       Match filter keywords and regexes case-insensitively\n"
+        "  --system-prompt FILE       Read a system prompt from FILE (sent with every request)\n"
+        "  --config FILE              Load key=value defaults from file\n"
+        "  --log-file PATH            Redirect log output\n"
+        "  --response-dir DIR         Persist each chunk response as JSON\n"
+        "  --response-files / --no-response-files  Toggle per-rank response file emission (default on)\n"
+        "  --response-fsync / --no-response-fsync  fsync each response file once written (default off)\n"
+        "  --results-arrow PATH       Also write every chunk result as one row of an Arrow IPC stream at PATH\n"
+        "  --io-backend NAME          Disk I/O engine: auto, uring, threads or sync (default auto)\n"
+        "  --tasks N / --mp N / --np N  Desired task count (auto chunking across MPI ranks)\n"
+        "  --auto-scale-threshold BYTES  Trigger size for automatic scaling (default 100MB)\n"
+        "  --auto-scale-mode MODE      Autoscale strategy: none, threads, chunks\n"
+        "  --auto-scale-factor N       Multiplier applied when autoscale fires\n"
+        "  --auto-scale-max-ranks N    Total rank cap for threads-mode spawning (default: MPI universe size)\n"
+        "  --api-provider NAME        Target API provider: deepseek, openai, anthropic, zai\n"
+        "  --model MODEL              Override model for OpenAI/Anthropic/Zai-compatible APIs\n"
+        "  --max-output-tokens N      Cap response tokens for OpenAI/Anthropic/Zai providers\n"
+        "  --anthropic-version DATE   Override the x-anthropic-version header\n"
+        "  --timeout SECONDS          HTTP timeout\n"
+        "  --max-retries N            Retry count per chunk\n"
+        "  --retry-delay-ms MS        Delay between retries in milliseconds\n"
+        "  --network-retries N        MPI-level client resets after network failures\n"
+        "  --retry-waves N            Redistribute chunks that still failed over all ranks this many times (default 1)\n"
+        "  --cost-model MODEL         Start the costliest chunks first: size, tokens, history:LOG (default: index order)\n",
+        stdout);
+  puts("  --readline / --no-readline  Toggle GNU Readline prompt when TUI is disabled\n"
        "  --repl                    Keep an interactive REPL session inside deepseek_mpi\n"
        "  --noninteractive          Disable TUI/readline and require --input-file plus inline text\n"
        "  --tui-log-view / --no-tui-log-view  Control the post-prompt curses log pane (auto-on with --tui)\n"
+       "  --daemon                   Keep ranks running and accept jobs from deepseek_mpi_submit\n"
+       "  --daemon-socket PATH       Unix socket rank 0 listens on in --daemon mode\n"
+       "  --job-groups N             Max daemon jobs run side by side on rank sub-groups (0 = world size)\n"
+       "  --stream                   Process stdin (or a FIFO via --input-file) continuously in micro-batches\n"
+       "  --stream-window MS         Close a stream batch this long after its first byte (default 2000)\n"
+       "  --stream-batch-bytes N     Close a stream batch once it holds N bytes (default 262144)\n"
+       "  --watch-dir DIR            Process every file written or moved into DIR until SIGINT/SIGTERM\n"
+       "  --watch-done-dir DIR       Where finished watch files are moved (default DIR/done; failures go to DIR/failed)\n"
+       "  --coordinator / --no-coordinator  Keep rank 0 out of API work; it only schedules, records and prints results\n"
+       "  --resilient / --no-resilient  Rank 0 hands out chunks one at a time and requeues work from failed ranks\n"
+       "  --fault-timeout SECONDS    Declare a --resilient worker lost after this long without a heartbeat (default 120)\n"
+       "  --max-inflight N           Let at most N ranks send requests at once (default 0 = every rank)\n"
+       "  --autotune / --no-autotune  Pick chunk size and --max-inflight from a short pilot run before the job\n"
+       "  --autotune-cache FILE      Reuse (or save) the tuned settings in FILE instead of piloting every run\n"
+       "  --autotune-rpm N           Provider request-per-minute limit the autotuner plans around (default 0 = none)\n"
+       "  --plan                     Forecast requests, tokens, cost and wall time without sending anything\n"
+       "  --plan-ranks N             Rank count the --plan forecast assumes (default: this run's -np)\n"
+       "  --price-input / --price-output USD  Price per million input / output tokens for --plan\n"
+       "  --latency-overhead-ms MS / --output-tokens-per-second N  Latency model for --plan (default 800 / 40)\n"
        "  --tui / --no-tui           Toggle ncurses interface\n"
        "  --dry-run                  Skip HTTP calls (for smoke tests)\n"
        "  --verbose / --quiet        Adjust console verbosity\n"
@@ -130,6 +215,20 @@ static int parse_long_value(const char *text, long *out) {
   return 0;
 }
 
+static int parse_price(const char *text, double *out) {
+  if (!text || !out) {
+    return -1;
+  }
+  errno = 0;
+  char *end = NULL;
+  double value = strtod(text, &end);
+  if (errno != 0 || end == text || *end != '\0' || value < 0.0) {
+    return -1;
+  }
+  *out = value;
+  return 0;
+}
+
 static int load_config_file(ProgramConfig *cfg, const char *path) {
   if (!cfg || !path) {
     return -1;
@@ -211,17 +310,63 @@ CliResult cli_parse_args(int argc, char **argv, ProgramConfig *config) {
       {"max-retries", required_argument, NULL, 'r'},
       {"retry-delay-ms", required_argument, NULL, 'd'},
       {"network-retries", required_argument, NULL, OPT_NETWORK_RETRIES},
+      {"retry-waves", required_argument, NULL, OPT_RETRY_WAVES},
+      {"cost-model", required_argument, NULL, OPT_COST_MODEL},
+      {"max-inflight", required_argument, NULL, OPT_MAX_INFLIGHT},
+      {"autotune", no_argument, NULL, OPT_AUTOTUNE_ON},
+      {"no-autotune", no_argument, NULL, OPT_AUTOTUNE_OFF},
+      {"autotune-cache", required_argument, NULL, OPT_AUTOTUNE_CACHE},
+      {"autotune-rpm", required_argument, NULL, OPT_AUTOTUNE_RPM},
+      {"plan", no_argument, NULL, OPT_PLAN},
+      {"plan-ranks", required_argument, NULL, OPT_PLAN_RANKS},
+      {"price-input", required_argument, NULL, OPT_PRICE_INPUT},
+      {"price-output", required_argument, NULL, OPT_PRICE_OUTPUT},
+      {"latency-overhead-ms", required_argument, NULL, OPT_LATENCY_OVERHEAD},
+      {"output-tokens-per-second", required_argument, NULL, OPT_OUTPUT_TPS},
       {"progress-interval", required_argument, NULL, 'p'},
       {"max-request-bytes", required_argument, NULL, OPT_MAX_REQUEST},
+      {"max-memory", required_argument, NULL, OPT_MAX_MEMORY},
+      {"bcast-segment", required_argument, NULL, OPT_BCAST_SEGMENT},
+      {"mpi-compress", required_argument, NULL, OPT_MPI_COMPRESS},
+      {"numa-bind", no_argument, NULL, OPT_NUMA_BIND_ON},
+      {"no-numa-bind", no_argument, NULL, OPT_NUMA_BIND_OFF},
+      {"io-backend", required_argument, NULL, OPT_IO_BACKEND},
+      {"response-fsync", no_argument, NULL, OPT_RESPONSE_FSYNC_ON},
+      {"no-response-fsync", no_argument, NULL, OPT_RESPONSE_FSYNC_OFF},
       {"config", required_argument, NULL, OPT_CONFIG_FILE},
       {"inline-text", required_argument, NULL, 'T'},
       {"model", required_argument, NULL, 'm'},
       {"max-output-tokens", required_argument, NULL, OPT_MAX_OUTPUT_TOKENS},
       {"anthropic-version", required_argument, NULL, OPT_ANTHROPIC_VERSION},
       {"response-dir", required_argument, NULL, OPT_RESPONSE_DIR},
+      {"results-arrow", required_argument, NULL, OPT_RESULTS_ARROW},
       {"response-files", no_argument, NULL, OPT_RESPONSE_FILES_ON},
       {"no-response-files", no_argument, NULL, OPT_RESPONSE_FILES_OFF},
       {"system-prompt", required_argument, NULL, OPT_SYSTEM_PROMPT},
+      {"normalize", no_argument, NULL, OPT_NORMALIZE_ON},
+      {"no-normalize", no_argument, NULL, OPT_NORMALIZE_OFF},
+      {"dedup", no_argument, NULL, OPT_DEDUP_ON},
+      {"no-dedup", no_argument, NULL, OPT_DEDUP_OFF},
+      {"near-dedup", no_argument, NULL, OPT_NEAR_DEDUP_ON},
+      {"no-near-dedup", no_argument, NULL, OPT_NEAR_DEDUP_OFF},
+      {"near-dedup-threshold", required_argument, NULL, OPT_NEAR_DEDUP_THRESHOLD},
+      {"filter-keywords", required_argument, NULL, OPT_FILTER_KEYWORDS},
+      {"filter-keyword-file", required_argument, NULL, OPT_FILTER_KEYWORD_FILE},
+      {"filter-regex", required_argument, NULL, OPT_FILTER_REGEX},
+      {"filter-ignore-case", no_argument, NULL, OPT_FILTER_IGNORE_CASE},
+      {"daemon", no_argument, NULL, OPT_DAEMON},
+      {"daemon-socket", required_argument, NULL, OPT_DAEMON_SOCKET},
+      {"job-groups", required_argument, NULL, OPT_JOB_GROUPS},
+      {"stream", no_argument, NULL, OPT_STREAM},
+      {"stream-window", required_argument, NULL, OPT_STREAM_WINDOW},
+      {"stream-batch-bytes", required_argument, NULL, OPT_STREAM_BATCH},
+      {"watch-dir", required_argument, NULL, OPT_WATCH_DIR},
+      {"watch-done-dir", required_argument, NULL, OPT_WATCH_DONE_DIR},
+      {"coordinator", no_argument, NULL, OPT_COORDINATOR_ON},
+      {"no-coordinator", no_argument, NULL, OPT_COORDINATOR_OFF},
+      {"resilient", no_argument, NULL, OPT_RESILIENT_ON},
+      {"no-resilient", no_argument, NULL, OPT_RESILIENT_OFF},
+      {"fault-timeout", required_argument, NULL, OPT_FAULT_TIMEOUT},
       {"tui-log-view", no_argument, NULL, OPT_TUI_LOG_VIEW_ON},
       {"no-tui-log-view", no_argument, NULL, OPT_TUI_LOG_VIEW_OFF},
       {"tasks", required_argument, NULL, OPT_TASKS},
@@ -230,6 +375,7 @@ CliResult cli_parse_args(int argc, char **argv, ProgramConfig *config) {
       {"auto-scale-mode", required_argument, NULL, OPT_AUTOSCALE_MODE},
       {"auto-scale-threshold", required_argument, NULL, OPT_AUTOSCALE_THRESHOLD},
       {"auto-scale-factor", required_argument, NULL, OPT_AUTOSCALE_FACTOR},
+      {"auto-scale-max-ranks", required_argument, NULL, OPT_AUTOSCALE_MAX_RANKS},
       {"stdin", no_argument, NULL, 'S'},
       {"readline", no_argument, NULL, OPT_READLINE_ON},
       {"no-readline", no_argument, NULL, OPT_READLINE_OFF},
@@ -307,6 +453,112 @@ CliResult cli_parse_args(int argc, char **argv, ProgramConfig *config) {
       config->network_retry_limit = value;
       break;
     }
+    case OPT_RETRY_WAVES: {
+      int value;
+      if (parse_int(optarg, &value) != 0 || value < 0) {
+        fprintf(stderr, "Invalid retry waves: %s\n", optarg);
+        return CLI_ERROR;
+      }
+      config->retry_waves = value;
+      break;
+    }
+    case OPT_COST_MODEL:
+      config_replace_string(&config->cost_model, optarg);
+      break;
+    case OPT_MAX_INFLIGHT: {
+      int value;
+      if (parse_int(optarg, &value) != 0 || value < 0) {
+        fprintf(stderr, "Invalid in-flight window: %s\n", optarg);
+        return CLI_ERROR;
+      }
+      config->max_inflight = value;
+      break;
+    }
+    case OPT_NUMA_BIND_ON:
+      config->numa_bind = true;
+      break;
+    case OPT_NUMA_BIND_OFF:
+      config->numa_bind = false;
+      break;
+    case OPT_IO_BACKEND: {
+      AsyncIoBackend backend;
+      if (async_io_parse_backend(optarg, &backend) != 0) {
+        fprintf(stderr, "Invalid I/O backend: %s\n", optarg);
+        return CLI_ERROR;
+      }
+      config->io_backend = backend;
+      break;
+    }
+    case OPT_RESPONSE_FSYNC_ON:
+      config->response_fsync = true;
+      break;
+    case OPT_RESPONSE_FSYNC_OFF:
+      config->response_fsync = false;
+      break;
+    case OPT_AUTOTUNE_ON:
+      config->autotune = true;
+      break;
+    case OPT_AUTOTUNE_OFF:
+      config->autotune = false;
+      break;
+    case OPT_AUTOTUNE_CACHE:
+      config_replace_string(&config->autotune_cache, optarg);
+      break;
+    case OPT_AUTOTUNE_RPM: {
+      int value;
+      if (parse_int(optarg, &value) != 0 || value < 0) {
+        fprintf(stderr, "Invalid autotune request rate: %s\n", optarg);
+        return CLI_ERROR;
+      }
+      config->autotune_rpm = value;
+      break;
+    }
+    case OPT_PLAN:
+      config->plan_mode = true;
+      config->use_tui = false;
+      config->use_readline_prompt = false;
+      break;
+    case OPT_PLAN_RANKS: {
+      int value;
+      if (parse_int(optarg, &value) != 0 || value < 0) {
+        fprintf(stderr, "Invalid plan rank count: %s\n", optarg);
+        return CLI_ERROR;
+      }
+      config->plan_ranks = value;
+      break;
+    }
+    case OPT_PRICE_INPUT:
+    case OPT_PRICE_OUTPUT: {
+      double value;
+      if (parse_price(optarg, &value) != 0) {
+        fprintf(stderr, "Invalid price: %s\n", optarg);
+        return CLI_ERROR;
+      }
+      if (opt == OPT_PRICE_INPUT) {
+        config->price_input = value;
+      } else {
+        config->price_output = value;
+      }
+      break;
+    }
+    case OPT_LATENCY_OVERHEAD: {
+      long value;
+      if (parse_long_value(optarg, &value) != 0 || value < 0) {
+        fprintf(stderr, "Invalid latency overhead: %s\n", optarg);
+        return CLI_ERROR;
+      }
+      config->latency_overhead_ms = value;
+      break;
+    }
+    case OPT_OUTPUT_TPS: {
+      int value;
+      if (parse_int(optarg, &value) != 0 || value <= 0) {
+        fprintf(stderr, "Invalid output tokens per second: %s\n", optarg);
+        return CLI_ERROR;
+      }
+      config->output_tokens_per_second = value;
+      break;
+    }
     case 'p': {
       int value;
       if (parse_int(optarg, &value) != 0 || value <= 0) {
@@ -326,6 +578,9 @@ CliResult cli_parse_args(int argc, char **argv, ProgramConfig *config) {
     case OPT_RESPONSE_DIR:
       config_replace_string(&config->response_dir, optarg);
       break;
+    case OPT_RESULTS_ARROW:
+      config_replace_string(&config->results_arrow, optarg);
+      break;
     case OPT_SYSTEM_PROMPT: {
       char *contents = NULL;
       size_t len = 0;
@@ -342,6 +597,120 @@ CliResult cli_parse_args(int argc, char **argv, ProgramConfig *config) {
       free(contents);
       break;
     }
+    case OPT_NORMALIZE_ON:
+      config->normalize_input = true;
+      break;
+    case OPT_NORMALIZE_OFF:
+      config->normalize_input = false;
+      break;
+    case OPT_DEDUP_ON:
+      config->dedup_chunks = true;
+      break;
+    case OPT_DEDUP_OFF:
+      config->dedup_chunks = false;
+      break;
+    case OPT_NEAR_DEDUP_ON:
+      config->near_dedup = true;
+      break;
+    case OPT_NEAR_DEDUP_OFF:
+      config->near_dedup = false;
+      break;
+    case OPT_NEAR_DEDUP_THRESHOLD: {
+      int value;
+      if (parse_int(optarg, &value) != 0 || value < 1 || value > 100) {
+        fprintf(stderr, "Invalid near-dedup threshold (1-100): %s\n", optarg);
+        return CLI_ERROR;
+      }
+      config->near_dedup_threshold = value;
+      break;
+    }
+    case OPT_FILTER_KEYWORDS:
+      config_append_list(&config->filter_keywords, optarg, ',');
+      break;
+    case OPT_FILTER_KEYWORD_FILE: {
+      char *error = NULL;
+      if (config_load_filter_keywords(config, optarg, &error) != 0) {
+        fprintf(stderr, "Failed to read filter keywords %s: %s\n", optarg, error ? error : "unknown error");
+        free(error);
+        return CLI_ERROR;
+      }
+      break;
+    }
+    case OPT_FILTER_REGEX:
+      config_append_list(&config->filter_regex, optarg, '\n');
+      break;
+    case OPT_FILTER_IGNORE_CASE:
+      config->filter_ignore_case = true;
+      break;
+    case OPT_DAEMON:
+      config->daemon_mode = true;
+      config->use_tui = false;
+      config->use_readline_prompt = false;
+      break;
+    case OPT_DAEMON_SOCKET:
+      config_replace_string(&config->daemon_socket, optarg);
+      break;
+    case OPT_JOB_GROUPS: {
+      int value;
+      if (parse_int(optarg, &value) != 0 || value < 0) {
+        fprintf(stderr, "Invalid job group count: %s\n", optarg);
+        return CLI_ERROR;
+      }
+      config->job_groups = value;
+      break;
+    }
+    case OPT_STREAM:
+      config->stream_mode = true;
+      config->use_tui = false;
+      config->use_readline_prompt = false;
+      break;
+    case OPT_STREAM_WINDOW: {
+      int value;
+      if (parse_int(optarg, &value) != 0 || value < 0) {
+        fprintf(stderr, "Invalid stream window (ms): %s\n", optarg);
+        return CLI_ERROR;
+      }
+      config->stream_window_ms = value;
+      break;
+    }
+    case OPT_STREAM_BATCH: {
+      size_t value;
+      if (parse_size(optarg, &value) != 0 || value == 0) {
+        fprintf(stderr, "Invalid stream batch bytes: %s\n", optarg);
+        return CLI_ERROR;
+      }
+      config->stream_batch_bytes = value;
+      break;
+    }
+    case OPT_WATCH_DIR:
+      config_replace_string(&config->watch_dir, optarg);
+      config->use_tui = false;
+      config->use_readline_prompt = false;
+      break;
+    case OPT_WATCH_DONE_DIR:
+      config_replace_string(&config->watch_done_dir, optarg);
+      break;
+    case OPT_COORDINATOR_ON:
+      config->coordinator_mode = true;
+      break;
+    case OPT_COORDINATOR_OFF:
+      config->coordinator_mode = false;
+      break;
+    case OPT_RESILIENT_ON:
+      config->resilient_mode = true;
+      break;
+    case OPT_RESILIENT_OFF:
+      config->resilient_mode = false;
+      break;
+    case OPT_FAULT_TIMEOUT: {
+      long value;
+      if (parse_long_value(optarg, &value) != 0 || value <= 0) {
+        fprintf(stderr, "Invalid fault timeout: %s\n", optarg);
+        return CLI_ERROR;
+      }
+      config->fault_timeout_seconds = value;
+      break;
+    }
     case OPT_RESPONSE_FILES_ON:
       config->response_files_enabled = true;
       break;
@@ -422,6 +791,15 @@ CliResult cli_parse_args(int argc, char **argv, ProgramConfig *config) {
       config->auto_scale_factor = value;
       break;
     }
+    case OPT_AUTOSCALE_MAX_RANKS: {
+      int value;
+      if (parse_int(optarg, &value) != 0 || value < 0) {
+        fprintf(stderr, "Invalid auto-scale max ranks: %s\n", optarg);
+        return CLI_ERROR;
+      }
+      config->auto_scale_max_ranks = value;
+      break;
+    }
     case 'q':
       config->force_quiet = true;
       config->verbosity = 0;
@@ -444,6 +822,37 @@ CliResult cli_parse_args(int argc, char **argv, ProgramConfig *config) {
       config->max_request_bytes = value;
       break;
     }
+    case OPT_MAX_MEMORY: {
+      size_t value;
+      if (parse_size(optarg, &value) != 0) {
+        fprintf(stderr, "Invalid memory budget: %s\n", optarg);
+        return CLI_ERROR;
+      }
+      config->max_memory = value;
+      break;
+    }
+    case OPT_BCAST_SEGMENT: {
+      size_t value;
+      if (parse_size(optarg, &value) != 0) {
+        fprintf(stderr, "Invalid broadcast segment size: %s\n", optarg);
+        return CLI_ERROR;
+      }
+      config->bcast_segment = value;
+      break;
+    }
+    case OPT_MPI_COMPRESS: {
+      TransferCodec codec;
+      if (transfer_codec_parse(optarg, &codec) != 0) {
+        fprintf(stderr, "Invalid MPI compression codec: %s\n", optarg);
+        return CLI_ERROR;
+      }
+      if (!transfer_codec_available(codec)) {
+        fprintf(stderr, "MPI compression codec %s is not built in\n", optarg);
+        return CLI_ERROR;
+      }
+      config->mpi_compress = codec;
+      break;
+    }
     case OPT_MAX_OUTPUT_TOKENS: {
       int value;
       if (parse_int(optarg, &value) != 0 || value <= 0) {
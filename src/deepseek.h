@@ -20,6 +20,16 @@
 #define DEEPSEEK_DEFAULT_MODEL           "deepseek-chat"
 #define DEEPSEEK_DEFAULT_SYSTEM_PROMPT   "You are a helpful assistant."
 #define DEEPSEEK_DEFAULT_REPL_HISTORY     4ULL
+#define DEEPSEEK_DEFAULT_NEAR_DEDUP_PERCENT 90
+#define DEEPSEEK_DEFAULT_DAEMON_SOCKET   "/tmp/deepseek_mpi.sock"
+#define DEEPSEEK_DEFAULT_JOB_GROUPS      0
+#define DEEPSEEK_DEFAULT_STREAM_WINDOW_MS 2000
+#define DEEPSEEK_DEFAULT_STREAM_BATCH    (256U * 1024U)
+#define DEEPSEEK_DEFAULT_FAULT_TIMEOUT   120L
+#define DEEPSEEK_DEFAULT_RETRY_WAVES     1
+#define DEEPSEEK_DEFAULT_LATENCY_OVERHEAD_MS 800L
+#define DEEPSEEK_DEFAULT_OUTPUT_TPS      40
+#define DEEPSEEK_DEFAULT_BCAST_SEGMENT   (16U * 1024U * 1024U)
 
 #define OPENAI_DEFAULT_ENDPOINT          "https://api.openai.com/v1/chat/completions"
 #define OPENAI_DEFAULT_MODEL             "gpt-4o-mini"
@@ -37,6 +47,7 @@
 #define AI_DEFAULT_MAX_OUTPUT_TOKENS     1024
 #define DEEPSEEK_AUTOSCALE_DEFAULT_THRESHOLD (100ULL * 1024ULL * 1024ULL)
 #define DEEPSEEK_AUTOSCALE_DEFAULT_FACTOR    2
+#define DEEPSEEK_AUTOSCALE_DEFAULT_MAX_RANKS 0
 
 /**
  * @return build-time version string advertised to users.
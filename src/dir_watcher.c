@@ -0,0 +1,213 @@
+#define _GNU_SOURCE
+#include "dir_watcher.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static void assign_error(char **error_out, const char *fmt, ...) {
+  if (!error_out) {
+    return;
+  }
+  va_list args;
+  va_start(args, fmt);
+  va_list copy;
+  va_copy(copy, args);
+  int needed = vsnprintf(NULL, 0, fmt, copy);
+  va_end(copy);
+  if (needed < 0) {
+    va_end(args);
+    return;
+  }
+  size_t size = (size_t) needed + 1;
+  char *msg = malloc(size);
+  if (!msg) {
+    va_end(args);
+    return;
+  }
+  vsnprintf(msg, size, fmt, args);
+  va_end(args);
+  *error_out = msg;
+}
+
+/* A writer that closes a file several times raises IN_CLOSE_WRITE each time; a name already waiting is
+ * queued once. */
+static int enqueue(DirWatcher *watcher, const char *name) {
+  if (!name || name[0] == '\0' || name[0] == '.') {
+    return 0;
+  }
+  for (size_t i = 0; i < watcher->count; ++i) {
+    if (strcmp(watcher->queue[watcher->head + i], name) == 0) {
+      return 0;
+    }
+  }
+  if (watcher->head + watcher->count == watcher->capacity) {
+    if (watcher->head > 0) {
+      memmove(watcher->queue, watcher->queue + watcher->head, watcher->count * sizeof(char *));
+      watcher->head = 0;
+    } else {
+      size_t new_cap = watcher->capacity ? watcher->capacity * 2 : 16;
+      char **grown = realloc(watcher->queue, new_cap * sizeof(char *));
+      if (!grown) {
+        return -1;
+      }
+      watcher->queue = grown;
+      watcher->capacity = new_cap;
+    }
+  }
+  char *copy = strdup(name);
+  if (!copy) {
+    return -1;
+  }
+  watcher->queue[watcher->head + watcher->count++] = copy;
+  return 0;
+}
+
+static int compare_names(const void *lhs, const void *rhs) {
+  return strcmp(*(char *const *) lhs, *(char *const *) rhs);
+}
+
+static int scan_existing(DirWatcher *watcher, char **error_out) {
+  DIR *dir = opendir(watcher->directory);
+  if (!dir) {
+    assign_error(error_out, "cannot open %s: %s", watcher->directory, strerror(errno));
+    return -1;
+  }
+  struct dirent *entry;
+  while ((entry = readdir(dir)) != NULL) {
+    if (enqueue(watcher, entry->d_name) != 0) {
+      closedir(dir);
+      assign_error(error_out, "unable to allocate watch queue");
+      return -1;
+    }
+  }
+  closedir(dir);
+  qsort(watcher->queue + watcher->head, watcher->count, sizeof(char *), compare_names);
+  return 0;
+}
+
+int dir_watcher_open(DirWatcher *watcher, const char *directory, char **error_out) {
+  if (!watcher || !directory || !*directory) {
+    assign_error(error_out, "no watch directory configured");
+    return -1;
+  }
+  memset(watcher, 0, sizeof *watcher);
+  watcher->inotify_fd = -1;
+  watcher->directory = strdup(directory);
+  if (!watcher->directory) {
+    assign_error(error_out, "unable to allocate watch directory");
+    return -1;
+  }
+  watcher->inotify_fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+  if (watcher->inotify_fd < 0) {
+    assign_error(error_out, "inotify_init1: %s", strerror(errno));
+    dir_watcher_close(watcher);
+    return -1;
+  }
+  /* Watch before scanning so a file landing in between is not missed. */
+  if (inotify_add_watch(watcher->inotify_fd, directory, IN_CLOSE_WRITE | IN_MOVED_TO | IN_ONLYDIR) < 0) {
+    assign_error(error_out, "cannot watch %s: %s", directory, strerror(errno));
+    dir_watcher_close(watcher);
+    return -1;
+  }
+  if (scan_existing(watcher, error_out) != 0) {
+    dir_watcher_close(watcher);
+    return -1;
+  }
+  return 0;
+}
+
+static int drain_events(DirWatcher *watcher, char **error_out) {
+  union {
+    struct inotify_event event;
+    char bytes[4096];
+  } block;
+  char *buffer = block.bytes;
+  for (;;) {
+    ssize_t n = read(watcher->inotify_fd, buffer, sizeof block);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN) {
+        return 0;
+      }
+      assign_error(error_out, "inotify read: %s", strerror(errno));
+      return -1;
+    }
+    for (char *cursor = buffer; cursor < buffer + n;) {
+      const struct inotify_event *event = (const struct inotify_event *) cursor;
+      if (event->len > 0 && !(event->mask & IN_ISDIR) && enqueue(watcher, event->name) != 0) {
+        assign_error(error_out, "unable to allocate watch queue");
+        return -1;
+      }
+      cursor += sizeof(struct inotify_event) + event->len;
+    }
+  }
+}
+
+int dir_watcher_next(DirWatcher *watcher, int timeout_ms, char **path_out, char **error_out) {
+  if (!watcher || !path_out) {
+    return -1;
+  }
+  bool waited = false;
+  for (;;) {
+    if (drain_events(watcher, error_out) != 0) {
+      return -1;
+    }
+    while (watcher->count > 0) {
+      char *name = watcher->queue[watcher->head++];
+      watcher->count--;
+      size_t needed = strlen(watcher->directory) + strlen(name) + 2;
+      char *path = malloc(needed);
+      if (!path) {
+        free(name);
+        assign_error(error_out, "unable to allocate watch path");
+        return -1;
+      }
+      snprintf(path, needed, "%s/%s", watcher->directory, name);
+      free(name);
+      /* Entries can be stale: moved away, or already processed, before we got to them. */
+      struct stat st;
+      if (stat(path, &st) == 0 && S_ISREG(st.st_mode)) {
+        *path_out = path;
+        return 1;
+      }
+      free(path);
+    }
+    if (waited) {
+      return 0;
+    }
+    struct pollfd entry = {.fd = watcher->inotify_fd, .events = POLLIN, .revents = 0};
+    int ready = poll(&entry, 1, timeout_ms);
+    if (ready < 0 && errno != EINTR) {
+      assign_error(error_out, "poll: %s", strerror(errno));
+      return -1;
+    }
+    waited = true;
+  }
+}
+
+void dir_watcher_close(DirWatcher *watcher) {
+  if (!watcher) {
+    return;
+  }
+  if (watcher->inotify_fd >= 0) {
+    close(watcher->inotify_fd);
+  }
+  for (size_t i = 0; i < watcher->count; ++i) {
+    free(watcher->queue[watcher->head + i]);
+  }
+  free(watcher->queue);
+  free(watcher->directory);
+  memset(watcher, 0, sizeof *watcher);
+  watcher->inotify_fd = -1;
+}
@@ -0,0 +1,29 @@
+#ifndef DIR_WATCHER_H
+#define DIR_WATCHER_H
+
+#include <stddef.h>
+
+/**
+ * Spool-directory watcher backed by inotify. Files already present when the watcher opens are queued
+ * first (in name order); after that a file is queued when it is closed after writing or renamed into
+ * the directory. Hidden files are ignored, so producers can write `.name.tmp` and rename when done.
+ */
+typedef struct {
+  int inotify_fd;
+  char *directory;
+  char **queue;
+  size_t head;
+  size_t count;
+  size_t capacity;
+} DirWatcher;
+
+int dir_watcher_open(DirWatcher *watcher, const char *directory, char **error_out);
+
+/**
+ * Waits up to timeout_ms for the next regular file. Returns 1 with a malloc'd full path in path_out,
+ * 0 on timeout, or -1 on error.
+ */
+int dir_watcher_next(DirWatcher *watcher, int timeout_ms, char **path_out, char **error_out);
+void dir_watcher_close(DirWatcher *watcher);
+
+#endif /* DIR_WATCHER_H */
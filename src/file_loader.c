@@ -6,7 +6,11 @@
 #include <stdlib.h>
 #include <string.h>
 
-#define FILE_LOADER_CHUNK 4096
+#include "async_io.h"
+#include "large_buffer.h"
+#include "memory_budget.h"
+
+#define FILE_LOADER_CHUNK (64U * 1024U)
 
 static void assign_error(char **error_out, const char *fmt, ...) {
   if (!error_out) {
@@ -40,45 +44,41 @@ static int read_stream_internal(FILE *stream, char **out, size_t *len, char **er
   char *buffer = NULL;
   size_t capacity = 0;
   size_t used = 0;
-  char chunk[FILE_LOADER_CHUNK];
+  /* Reads land straight in the growing buffer, FILE_LOADER_CHUNK at a time. */
   while (1) {
-    size_t read_bytes = fread(chunk, 1, sizeof chunk, stream);
-    if (read_bytes > 0) {
-      size_t required = used + read_bytes + 1;
-      if (required > capacity) {
-        size_t new_capacity = capacity ? capacity : required;
-        while (new_capacity < required) {
-          new_capacity *= 2;
-        }
-        char *next = realloc(buffer, new_capacity);
-        if (!next) {
-          free(buffer);
-          assign_error(error_out, "Out of memory while reading stream");
-          return -1;
-        }
-        buffer = next;
-        capacity = new_capacity;
+    size_t required = used + FILE_LOADER_CHUNK + 1;
+    if (required > capacity) {
+      size_t new_capacity = capacity ? capacity : required;
+      while (new_capacity < required) {
+        new_capacity *= 2;
+      }
+      char *next = realloc(buffer, new_capacity);
+      if (!next) {
+        free(buffer);
+        memory_budget_release(capacity);
+        assign_error(error_out, "Out of memory while reading stream");
+        return -1;
       }
-      memcpy(buffer + used, chunk, read_bytes);
-      used += read_bytes;
+      memory_budget_charge(new_capacity - capacity);
+      large_buffer_advise(next, new_capacity);
+      buffer = next;
+      capacity = new_capacity;
     }
-    if (read_bytes < sizeof chunk) {
+    size_t read_bytes = fread(buffer + used, 1, FILE_LOADER_CHUNK, stream);
+    used += read_bytes;
+    if (read_bytes < FILE_LOADER_CHUNK) {
       if (ferror(stream)) {
         free(buffer);
+        memory_budget_release(capacity);
         assign_error(error_out, "Error while reading stream: %s", strerror(errno));
         return -1;
       }
       break;
     }
   }
-  if (!buffer) {
-    buffer = malloc(1);
-    if (!buffer) {
-      assign_error(error_out, "Unable to allocate buffer");
-      return -1;
-    }
-  }
   buffer[used] = '\0';
+  /* The caller owns the buffer from here; execute_payload charges it again as the payload. */
+  memory_budget_release(capacity);
   *out = buffer;
   *len = used;
   return 0;
@@ -96,12 +96,17 @@ int file_loader_read_all(const char *path, char **out, size_t *len, char **error
   if (strcmp(path, "-") == 0) {
     return file_loader_read_stream(stdin, out, len, error_out);
   }
+  /* Regular files are read whole at their known size; pipes and devices fall through to the stream. */
+  int rc = async_io_read_file(path, out, len, error_out);
+  if (rc != 1) {
+    return rc;
+  }
   FILE *fp = fopen(path, "rb");
   if (!fp) {
     assign_error(error_out, "Unable to open %s: %s", path, strerror(errno));
     return -1;
   }
-  int rc = read_stream_internal(fp, out, len, error_out);
+  rc = read_stream_internal(fp, out, len, error_out);
   fclose(fp);
   return rc;
 }
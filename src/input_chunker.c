@@ -1,5 +1,8 @@
 #include "input_chunker.h"
 
+#include <stdlib.h>
+#include <string.h>
+
 void chunk_cursor_init(ChunkCursor *cursor, size_t chunk_size, size_t total_length, int rank, int world_size) {
   if (!cursor) {
     return;
@@ -36,3 +39,266 @@ int chunk_cursor_next(ChunkCursor *cursor, size_t *start, size_t *end, size_t *c
   cursor->cursor += 1;
   return 1;
 }
+
+void chunk_plan_init(ChunkPlan *plan) {
+  if (!plan) {
+    return;
+  }
+  plan->tasks = NULL;
+  plan->count = 0;
+  plan->capacity = 0;
+}
+
+int chunk_plan_build(ChunkPlan *plan, size_t chunk_size, size_t total_length, int rank, int world_size) {
+  if (!plan) {
+    return -1;
+  }
+  ChunkCursor cursor;
+  chunk_cursor_init(&cursor, chunk_size, total_length, rank, world_size);
+  size_t start = 0;
+  size_t end = 0;
+  size_t index = 0;
+  while (chunk_cursor_next(&cursor, &start, &end, &index)) {
+    if (!chunk_plan_append(plan, index, start, end)) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+typedef struct {
+  double cost;
+  size_t index;
+} CostedChunk;
+
+static int compare_costed_chunks(const void *lhs, const void *rhs) {
+  const CostedChunk *a = lhs;
+  const CostedChunk *b = rhs;
+  if (a->cost != b->cost) {
+    return a->cost > b->cost ? -1 : 1;
+  }
+  return a->index < b->index ? -1 : (a->index > b->index ? 1 : 0);
+}
+
+int chunk_order_by_cost(const double *costs, size_t count, size_t *order) {
+  if ((!costs || !order) && count > 0) {
+    return -1;
+  }
+  CostedChunk *entries = malloc((count + 1) * sizeof *entries);
+  if (!entries) {
+    return -1;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    entries[i].cost = costs[i];
+    entries[i].index = i;
+  }
+  qsort(entries, count, sizeof *entries, compare_costed_chunks);
+  for (size_t i = 0; i < count; ++i) {
+    order[i] = entries[i].index;
+  }
+  free(entries);
+  return 0;
+}
+
+typedef struct {
+  double load;
+  int rank;
+} RankLoad;
+
+static bool rank_load_less(const RankLoad *a, const RankLoad *b) {
+  return a->load < b->load || (a->load == b->load && a->rank < b->rank);
+}
+
+static void rank_heap_sift_down(RankLoad *heap, size_t count, size_t pos) {
+  for (;;) {
+    size_t smallest = pos;
+    size_t left = 2 * pos + 1;
+    size_t right = left + 1;
+    if (left < count && rank_load_less(&heap[left], &heap[smallest])) {
+      smallest = left;
+    }
+    if (right < count && rank_load_less(&heap[right], &heap[smallest])) {
+      smallest = right;
+    }
+    if (smallest == pos) {
+      return;
+    }
+    RankLoad tmp = heap[pos];
+    heap[pos] = heap[smallest];
+    heap[smallest] = tmp;
+    pos = smallest;
+  }
+}
+
+int chunk_assign_least_loaded(const size_t *order, size_t count, const double *weights, int world_size,
+                              int *owner_out, double *loads_out) {
+  if ((!order || !weights || !owner_out) && count > 0) {
+    return -1;
+  }
+  if (world_size <= 0) {
+    world_size = 1;
+  }
+  RankLoad *heap = malloc((size_t) world_size * sizeof *heap);
+  if (!heap) {
+    return -1;
+  }
+  /* Ranks start equally loaded and in rank order, which is already a valid heap. */
+  for (int r = 0; r < world_size; ++r) {
+    heap[r].load = 0.0;
+    heap[r].rank = r;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    owner_out[order[i]] = heap[0].rank;
+    heap[0].load += weights[order[i]];
+    rank_heap_sift_down(heap, (size_t) world_size, 0);
+  }
+  if (loads_out) {
+    for (int r = 0; r < world_size; ++r) {
+      loads_out[heap[r].rank] = heap[r].load;
+    }
+  }
+  free(heap);
+  return 0;
+}
+
+int chunk_plan_build_balanced(ChunkPlan *plan, size_t chunk_size, size_t total_length, int rank, int world_size,
+                              const double *costs) {
+  if (!plan || !costs) {
+    return -1;
+  }
+  if (chunk_size == 0 || total_length == 0) {
+    return 0;
+  }
+  size_t chunk_count = (total_length + chunk_size - 1) / chunk_size;
+  size_t *order = malloc(chunk_count * sizeof *order);
+  int *owners = malloc(chunk_count * sizeof *owners);
+  int rc = order && owners ? 0 : -1;
+  if (rc == 0) {
+    rc = chunk_order_by_cost(costs, chunk_count, order);
+  }
+  if (rc == 0) {
+    rc = chunk_assign_least_loaded(order, chunk_count, costs, world_size, owners, NULL);
+  }
+  for (size_t i = 0; i < chunk_count && rc == 0; ++i) {
+    if (owners[i] != rank) {
+      continue;
+    }
+    size_t start = i * chunk_size;
+    size_t end = start + chunk_size < total_length ? start + chunk_size : total_length;
+    ChunkTask *task = chunk_plan_append(plan, i, start, end);
+    if (!task) {
+      rc = -1;
+    } else {
+      task->cost = costs[i];
+    }
+  }
+  free(order);
+  free(owners);
+  return rc;
+}
+
+int chunk_plan_cost_order(const ChunkPlan *plan, size_t **order_out) {
+  if (!plan || !order_out) {
+    return -1;
+  }
+  *order_out = NULL;
+  double *costs = malloc((plan->count + 1) * sizeof *costs);
+  size_t *order = malloc((plan->count + 1) * sizeof *order);
+  if (!costs || !order) {
+    free(costs);
+    free(order);
+    return -1;
+  }
+  /* Sorting by (cost, position) gives the same order as (cost, index) because the plan is index-sorted. */
+  for (size_t i = 0; i < plan->count; ++i) {
+    costs[i] = plan->tasks[i].cost;
+  }
+  int rc = chunk_order_by_cost(costs, plan->count, order);
+  free(costs);
+  if (rc != 0) {
+    free(order);
+    return -1;
+  }
+  *order_out = order;
+  return 0;
+}
+
+ChunkTask *chunk_plan_append(ChunkPlan *plan, size_t chunk_index, size_t start, size_t end) {
+  if (!plan) {
+    return NULL;
+  }
+  if (plan->count == plan->capacity) {
+    size_t new_cap = plan->capacity ? plan->capacity * 2 : 16;
+    ChunkTask *next = realloc(plan->tasks, new_cap * sizeof(ChunkTask));
+    if (!next) {
+      return NULL;
+    }
+    plan->tasks = next;
+    plan->capacity = new_cap;
+  }
+  ChunkTask *task = &plan->tasks[plan->count++];
+  memset(task, 0, sizeof *task);
+  task->index = chunk_index;
+  task->start = start;
+  task->end = end;
+  task->duplicate_of = chunk_index;
+  return task;
+}
+
+ChunkTask *chunk_plan_find(ChunkPlan *plan, size_t chunk_index) {
+  if (!plan || plan->count == 0) {
+    return NULL;
+  }
+  size_t lo = 0;
+  size_t hi = plan->count;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (plan->tasks[mid].index < chunk_index) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if (lo < plan->count && plan->tasks[lo].index == chunk_index) {
+    return &plan->tasks[lo];
+  }
+  return NULL;
+}
+
+int chunk_task_add_alias(ChunkTask *task, size_t chunk_index, double similarity) {
+  if (!task) {
+    return -1;
+  }
+  if (task->alias_count == task->alias_capacity) {
+    size_t new_cap = task->alias_capacity ? task->alias_capacity * 2 : 4;
+    size_t *next = realloc(task->aliases, new_cap * sizeof(size_t));
+    if (!next) {
+      return -1;
+    }
+    task->aliases = next;
+    double *next_similarity = realloc(task->alias_similarity, new_cap * sizeof(double));
+    if (!next_similarity) {
+      return -1;
+    }
+    task->alias_similarity = next_similarity;
+    task->alias_capacity = new_cap;
+  }
+  task->aliases[task->alias_count] = chunk_index;
+  task->alias_similarity[task->alias_count] = similarity;
+  task->alias_count++;
+  return 0;
+}
+
+void chunk_plan_free(ChunkPlan *plan) {
+  if (!plan) {
+    return;
+  }
+  for (size_t i = 0; i < plan->count; ++i) {
+    free(plan->tasks[i].aliases);
+    free(plan->tasks[i].alias_similarity);
+  }
+  free(plan->tasks);
+  plan->tasks = NULL;
+  plan->count = 0;
+  plan->capacity = 0;
+}
@@ -1,6 +1,7 @@
 #ifndef INPUT_CHUNKER_H
 #define INPUT_CHUNKER_H
 
+#include <stdbool.h>
 #include <stddef.h>
 
 typedef struct {
@@ -11,7 +12,56 @@ typedef struct {
   size_t cursor;
 } ChunkCursor;
 
+/**
+ * One chunk assigned to this rank. Duplicates of another chunk are marked skip and point at their
+ * representative; representatives list the chunk indices that reuse their response together with the
+ * estimated similarity (1.0 for byte-identical chunks). cost is the predicted processing cost when a
+ * cost model is active and 0 otherwise.
+ */
+typedef struct {
+  size_t index;
+  size_t start;
+  size_t end;
+  bool skip;
+  size_t duplicate_of;
+  size_t *aliases;
+  double *alias_similarity;
+  size_t alias_count;
+  size_t alias_capacity;
+  double cost;
+} ChunkTask;
+
+typedef struct {
+  ChunkTask *tasks;
+  size_t count;
+  size_t capacity;
+} ChunkPlan;
+
 void chunk_cursor_init(ChunkCursor *cursor, size_t chunk_size, size_t total_length, int rank, int world_size);
 int chunk_cursor_next(ChunkCursor *cursor, size_t *start, size_t *end, size_t *chunk_index);
 
+void chunk_plan_init(ChunkPlan *plan);
+int chunk_plan_build(ChunkPlan *plan, size_t chunk_size, size_t total_length, int rank, int world_size);
+/**
+ * Longest-processing-time-first partition: chunks are taken in descending cost order (ties by index) and
+ * each goes to the rank with the least predicted load so far (ties to the lower rank). costs holds one
+ * entry per chunk of total_length; every rank passing the same costs gets a disjoint share. The plan
+ * stays sorted by index and each task keeps its cost.
+ */
+int chunk_plan_build_balanced(ChunkPlan *plan, size_t chunk_size, size_t total_length, int rank, int world_size,
+                              const double *costs);
+/* Writes the chunk indices 0..count-1 into order, highest cost first (ties by index). */
+int chunk_order_by_cost(const double *costs, size_t count, size_t *order);
+/* Deals the chunks in order, each to the rank whose weights add up to the least so far (ties to the
+ * lower rank). owner_out is indexed by chunk; loads_out, when given, receives world_size totals. */
+int chunk_assign_least_loaded(const size_t *order, size_t count, const double *weights, int world_size,
+                              int *owner_out, double *loads_out);
+/* Fills order_out with a malloc'd list of task positions, highest cost first (ties by index). */
+int chunk_plan_cost_order(const ChunkPlan *plan, size_t **order_out);
+/* Appends one task; callers keep the plan sorted by index so chunk_plan_find keeps working. */
+ChunkTask *chunk_plan_append(ChunkPlan *plan, size_t chunk_index, size_t start, size_t end);
+ChunkTask *chunk_plan_find(ChunkPlan *plan, size_t chunk_index);
+int chunk_task_add_alias(ChunkTask *task, size_t chunk_index, double similarity);
+void chunk_plan_free(ChunkPlan *plan);
+
 #endif /* INPUT_CHUNKER_H */
@@ -0,0 +1,342 @@
+#define _GNU_SOURCE
+#include "job_server.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "memory_budget.h"
+#include "string_buffer.h"
+
+static void assign_error(char **error_out, const char *fmt, ...) {
+  if (!error_out) {
+    return;
+  }
+  va_list args;
+  va_start(args, fmt);
+  va_list copy;
+  va_copy(copy, args);
+  int needed = vsnprintf(NULL, 0, fmt, copy);
+  va_end(copy);
+  if (needed < 0) {
+    va_end(args);
+    return;
+  }
+  size_t size = (size_t) needed + 1;
+  char *msg = malloc(size);
+  if (!msg) {
+    va_end(args);
+    return;
+  }
+  vsnprintf(msg, size, fmt, args);
+  va_end(args);
+  *error_out = msg;
+}
+
+static int fill_address(struct sockaddr_un *addr, const char *path, char **error_out) {
+  if (!path || !*path) {
+    assign_error(error_out, "no daemon socket path configured");
+    return -1;
+  }
+  memset(addr, 0, sizeof *addr);
+  addr->sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof addr->sun_path) {
+    assign_error(error_out, "socket path too long: %s", path);
+    return -1;
+  }
+  strcpy(addr->sun_path, path);
+  return 0;
+}
+
+int job_server_connect(const char *path, char **error_out) {
+  struct sockaddr_un addr;
+  if (fill_address(&addr, path, error_out) != 0) {
+    return -1;
+  }
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    assign_error(error_out, "socket: %s", strerror(errno));
+    return -1;
+  }
+  if (connect(fd, (struct sockaddr *) &addr, sizeof addr) != 0) {
+    assign_error(error_out, "connect %s: %s", path, strerror(errno));
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+int job_server_listen(const char *path, char **error_out) {
+  struct sockaddr_un addr;
+  if (fill_address(&addr, path, error_out) != 0) {
+    return -1;
+  }
+  int probe = job_server_connect(path, NULL);
+  if (probe >= 0) {
+    close(probe);
+    assign_error(error_out, "another daemon is already listening on %s", path);
+    return -1;
+  }
+  unlink(path);
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    assign_error(error_out, "socket: %s", strerror(errno));
+    return -1;
+  }
+  mode_t previous = umask(0077);
+  int rc = bind(fd, (struct sockaddr *) &addr, sizeof addr);
+  umask(previous);
+  if (rc != 0 || listen(fd, 16) != 0) {
+    assign_error(error_out, "bind/listen %s: %s", path, strerror(errno));
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+static int read_exact(int fd, char *buffer, size_t len) {
+  size_t got = 0;
+  while (got < len) {
+    ssize_t n = read(fd, buffer + got, len - got);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n == 0) {
+      errno = ECONNRESET;
+    }
+    if (n <= 0) {
+      return -1;
+    }
+    got += (size_t) n;
+  }
+  return 0;
+}
+
+/* Splits the header into control keys and the config options forwarded to every rank. */
+static int parse_header(JobRequest *request, const char *header, size_t len, size_t *payload_bytes,
+                        char **error_out) {
+  StringBuffer options;
+  sb_init(&options);
+  const char *cursor = header;
+  const char *end = header + len;
+  while (cursor < end) {
+    const char *line_end = memchr(cursor, '\n', (size_t) (end - cursor));
+    size_t line_len = line_end ? (size_t) (line_end - cursor) : (size_t) (end - cursor);
+    while (line_len > 0 && cursor[line_len - 1] == '\r') {
+      line_len--;
+    }
+    size_t command_len = strlen(JOB_COMMAND_KEY "=");
+    size_t bytes_len = strlen(JOB_PAYLOAD_BYTES_KEY "=");
+    if (line_len > command_len && strncmp(cursor, JOB_COMMAND_KEY "=", command_len) == 0) {
+      if (line_len - command_len == 8 && strncmp(cursor + command_len, "shutdown", 8) == 0) {
+        request->command = JOB_COMMAND_SHUTDOWN;
+      } else if (!(line_len - command_len == 6 && strncmp(cursor + command_len, "submit", 6) == 0)) {
+        assign_error(error_out, "unknown command: %.*s", (int) (line_len - command_len), cursor + command_len);
+        sb_clean(&options);
+        return -1;
+      }
+    } else if (line_len > bytes_len && strncmp(cursor, JOB_PAYLOAD_BYTES_KEY "=", bytes_len) == 0) {
+      char digits[32];
+      size_t n = line_len - bytes_len < sizeof digits - 1 ? line_len - bytes_len : sizeof digits - 1;
+      memcpy(digits, cursor + bytes_len, n);
+      digits[n] = '\0';
+      char *digits_end = NULL;
+      errno = 0;
+      unsigned long long value = strtoull(digits, &digits_end, 10);
+      if (digits[0] < '0' || digits[0] > '9' || !digits_end || *digits_end != '\0' || errno == ERANGE) {
+        assign_error(error_out, "invalid payload_bytes: %s", digits);
+        sb_clean(&options);
+        return -1;
+      }
+      /* Checked before anything is allocated: payload_bytes + 1 must not wrap. */
+      if (value > JOB_PAYLOAD_LIMIT || value > SIZE_MAX - 1) {
+        assign_error(error_out, "payload_bytes %llu exceeds the %llu-byte limit; submit input_file= instead", value,
+                     JOB_PAYLOAD_LIMIT);
+        sb_clean(&options);
+        return -1;
+      }
+      *payload_bytes = (size_t) value;
+    } else if (line_len > 0 && cursor[0] != '#') {
+      sb_append(&options, cursor, line_len);
+      sb_append_char(&options, '\n');
+    }
+    cursor = line_end ? line_end + 1 : end;
+  }
+  request->options_length = options.length;
+  request->options = sb_detach(&options);
+  sb_clean(&options);
+  return 0;
+}
+
+int job_server_accept(int listen_fd, JobRequest *request, char **error_out) {
+  if (!request) {
+    return -1;
+  }
+  memset(request, 0, sizeof *request);
+  request->client_fd = -1;
+  int fd = -1;
+  do {
+    fd = accept(listen_fd, NULL, NULL);
+  } while (fd < 0 && errno == EINTR);
+  if (fd < 0) {
+    assign_error(error_out, "accept: %s", strerror(errno));
+    return -1;
+  }
+  request->client_fd = fd;
+  /* Every read and write on the client gives up after the timeout instead of blocking rank 0, and the
+   * whole header has to arrive within it too. */
+  struct timeval timeout = {JOB_CLIENT_TIMEOUT_SECONDS, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof timeout);
+  struct timespec started;
+  clock_gettime(CLOCK_MONOTONIC, &started);
+
+  StringBuffer header;
+  sb_init(&header);
+  size_t header_len = 0;
+  bool complete = false;
+  char block[4096];
+  while (!complete) {
+    ssize_t n = read(fd, block, sizeof block);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      assign_error(error_out, "reading job header: %s",
+                   errno == EAGAIN || errno == EWOULDBLOCK ? "client timed out" : strerror(errno));
+      sb_clean(&header);
+      return -1;
+    }
+    if (n == 0) {
+      complete = true;
+      header_len = header.length;
+      break;
+    }
+    size_t scan_from = header.length > 0 ? header.length - 1 : 0;
+    sb_append(&header, block, (size_t) n);
+    for (size_t i = scan_from; i < header.length; ++i) {
+      if (header.data[i] == '\n' && (i == 0 || header.data[i - 1] == '\n')) {
+        header_len = i + 1;
+        complete = true;
+        break;
+      }
+    }
+    if (!complete && header.length > JOB_HEADER_LIMIT) {
+      assign_error(error_out, "job header exceeds %u bytes", JOB_HEADER_LIMIT);
+      sb_clean(&header);
+      return -1;
+    }
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (!complete && now.tv_sec - started.tv_sec >= JOB_CLIENT_TIMEOUT_SECONDS) {
+      assign_error(error_out, "job header not complete after %d s", JOB_CLIENT_TIMEOUT_SECONDS);
+      sb_clean(&header);
+      return -1;
+    }
+  }
+
+  size_t payload_bytes = 0;
+  if (parse_header(request, header.data ? header.data : "", header_len, &payload_bytes, error_out) != 0) {
+    sb_clean(&header);
+    return -1;
+  }
+  /* Refused before the buffer exists; execute_payload only sees the payload once it has been read. */
+  if (payload_bytes > 0 && !memory_budget_fits(payload_bytes + 1)) {
+    assign_error(error_out, "payload of %zu bytes does not fit the %zu-byte memory budget (%zu bytes in use)",
+                 payload_bytes, memory_budget_limit(), memory_budget_used());
+    sb_clean(&header);
+    return -1;
+  }
+  if (payload_bytes > 0) {
+    request->payload = malloc(payload_bytes + 1);
+    if (!request->payload) {
+      assign_error(error_out, "unable to allocate %zu-byte payload", payload_bytes);
+      sb_clean(&header);
+      return -1;
+    }
+    size_t buffered = header.length - header_len;
+    if (buffered > payload_bytes) {
+      buffered = payload_bytes;
+    }
+    memcpy(request->payload, header.data + header_len, buffered);
+    if (read_exact(fd, request->payload + buffered, payload_bytes - buffered) != 0) {
+      assign_error(error_out, "client %s before sending %zu payload bytes",
+                   errno == EAGAIN || errno == EWOULDBLOCK ? "timed out" : "closed", payload_bytes);
+      sb_clean(&header);
+      return -1;
+    }
+    request->payload[payload_bytes] = '\0';
+    request->payload_length = payload_bytes;
+  }
+  sb_clean(&header);
+  return 0;
+}
+
+bool job_server_pending(int listen_fd) {
+  struct pollfd entry = {.fd = listen_fd, .events = POLLIN, .revents = 0};
+  return poll(&entry, 1, 0) > 0 && (entry.revents & POLLIN);
+}
+
+int job_server_write(int fd, const char *data, size_t len) {
+  size_t sent = 0;
+  while (sent < len) {
+    ssize_t n = send(fd, data + sent, len - sent, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return -1;
+    }
+    sent += (size_t) n;
+  }
+  return 0;
+}
+
+void job_server_finish(JobRequest *request, bool ok, const char *message) {
+  if (!request || request->client_fd < 0) {
+    return;
+  }
+  StringBuffer status;
+  sb_init(&status);
+  if (ok) {
+    sb_append_str(&status, "\n" JOB_STATUS_PREFIX "ok\n");
+  } else {
+    sb_append_printf(&status, "\n" JOB_STATUS_PREFIX "error: %s\n", message ? message : "unknown error");
+  }
+  job_server_write(request->client_fd, status.data, status.length);
+  sb_clean(&status);
+  close(request->client_fd);
+  request->client_fd = -1;
+}
+
+void job_server_close(int listen_fd, const char *path) {
+  if (listen_fd >= 0) {
+    close(listen_fd);
+  }
+  if (path) {
+    unlink(path);
+  }
+}
+
+void job_request_clean(JobRequest *request) {
+  if (!request) {
+    return;
+  }
+  if (request->client_fd >= 0) {
+    close(request->client_fd);
+  }
+  free(request->options);
+  free(request->payload);
+  memset(request, 0, sizeof *request);
+  request->client_fd = -1;
+}
@@ -0,0 +1,45 @@
+#ifndef JOB_SERVER_H
+#define JOB_SERVER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Wire format on the daemon socket. A client sends config-style `key=value` lines, an empty line, and
+ * then `payload_bytes` raw payload bytes when that key is present. `command=shutdown` stops the
+ * daemon. The server streams text back and finishes with a `status=ok` or `status=error: ...` line.
+ */
+#define JOB_COMMAND_KEY       "command"
+#define JOB_PAYLOAD_BYTES_KEY "payload_bytes"
+#define JOB_STATUS_PREFIX     "status="
+#define JOB_HEADER_LIMIT      (1024U * 1024U)
+/* Larger inputs should be submitted as input_file= paths instead of inline payload bytes. */
+#define JOB_PAYLOAD_LIMIT     (4ULL * 1024ULL * 1024ULL * 1024ULL)
+/* A client that sends or reads nothing for this long is dropped, so it cannot stall rank 0. */
+#define JOB_CLIENT_TIMEOUT_SECONDS 30
+
+typedef enum {
+  JOB_COMMAND_SUBMIT = 0,
+  JOB_COMMAND_SHUTDOWN
+} JobCommand;
+
+typedef struct {
+  int client_fd;
+  JobCommand command;
+  char *options;
+  size_t options_length;
+  char *payload;
+  size_t payload_length;
+} JobRequest;
+
+int job_server_listen(const char *path, char **error_out);
+int job_server_accept(int listen_fd, JobRequest *request, char **error_out);
+/* True when another client is already waiting to be accepted. */
+bool job_server_pending(int listen_fd);
+int job_server_write(int fd, const char *data, size_t len);
+void job_server_finish(JobRequest *request, bool ok, const char *message);
+void job_server_close(int listen_fd, const char *path);
+int job_server_connect(const char *path, char **error_out);
+void job_request_clean(JobRequest *request);
+
+#endif /* JOB_SERVER_H */
@@ -0,0 +1,98 @@
+#define _GNU_SOURCE
+#include "large_buffer.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#define LARGE_BUFFER_HUGE_PAGE (2U * 1024U * 1024U)
+
+static size_t round_up(size_t size, size_t unit) {
+  return (size + unit - 1) / unit * unit;
+}
+
+int large_buffer_alloc(LargeBuffer *buffer, size_t size) {
+  if (!buffer) {
+    return -1;
+  }
+  memset(buffer, 0, sizeof *buffer);
+  buffer->size = size;
+  if (size >= LARGE_BUFFER_THRESHOLD) {
+    size_t mapped = round_up(size, LARGE_BUFFER_HUGE_PAGE);
+#ifdef MAP_HUGETLB
+    void *data = mmap(NULL, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (data != MAP_FAILED) {
+      buffer->data = data;
+      buffer->mapped = mapped;
+      buffer->kind = LARGE_BUFFER_HUGETLB;
+      return 0;
+    }
+#endif
+    /* Over-map by one huge page so the buffer can start on a 2 MiB boundary. */
+    size_t span = mapped + LARGE_BUFFER_HUGE_PAGE;
+    char *raw = mmap(NULL, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw != MAP_FAILED) {
+      uintptr_t aligned = ((uintptr_t) raw + LARGE_BUFFER_HUGE_PAGE - 1) & ~((uintptr_t) LARGE_BUFFER_HUGE_PAGE - 1);
+      size_t head = (size_t) (aligned - (uintptr_t) raw);
+      if (head > 0) {
+        munmap(raw, head);
+      }
+      if (span - head > mapped) {
+        munmap((char *) aligned + mapped, span - head - mapped);
+      }
+      buffer->data = (char *) aligned;
+      buffer->mapped = mapped;
+      buffer->kind = LARGE_BUFFER_THP;
+#ifdef MADV_HUGEPAGE
+      madvise(buffer->data, mapped, MADV_HUGEPAGE);
+#endif
+      return 0;
+    }
+  }
+  buffer->data = malloc(size > 0 ? size : 1);
+  if (!buffer->data) {
+    return -1;
+  }
+  buffer->kind = LARGE_BUFFER_HEAP;
+  return 0;
+}
+
+void large_buffer_free(LargeBuffer *buffer) {
+  if (!buffer || !buffer->data) {
+    return;
+  }
+  if (buffer->kind == LARGE_BUFFER_HEAP) {
+    free(buffer->data);
+  } else {
+    munmap(buffer->data, buffer->mapped);
+  }
+  memset(buffer, 0, sizeof *buffer);
+}
+
+const char *large_buffer_kind_name(LargeBufferKind kind) {
+  switch (kind) {
+  case LARGE_BUFFER_HUGETLB:
+    return "hugetlb";
+  case LARGE_BUFFER_THP:
+    return "thp";
+  default:
+    return "heap";
+  }
+}
+
+void large_buffer_advise(void *data, size_t size) {
+#ifdef MADV_HUGEPAGE
+  if (!data || size < LARGE_BUFFER_THRESHOLD) {
+    return;
+  }
+  uintptr_t start = ((uintptr_t) data + LARGE_BUFFER_HUGE_PAGE - 1) & ~((uintptr_t) LARGE_BUFFER_HUGE_PAGE - 1);
+  uintptr_t end = ((uintptr_t) data + size) & ~((uintptr_t) LARGE_BUFFER_HUGE_PAGE - 1);
+  if (end > start) {
+    madvise((void *) start, (size_t) (end - start), MADV_HUGEPAGE);
+  }
+#else
+  (void) data;
+  (void) size;
+#endif
+}
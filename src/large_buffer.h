@@ -0,0 +1,37 @@
+#ifndef LARGE_BUFFER_H
+#define LARGE_BUFFER_H
+
+#include <stddef.h>
+
+/**
+ * Huge-page backing for buffers big enough that TLB reach matters (multi-MB payloads, response
+ * accumulation). Scans over such buffers touch a new 4 KiB page every 4096 bytes; 2 MiB pages cut the
+ * TLB misses 512-fold. Buffers below LARGE_BUFFER_THRESHOLD are left alone.
+ */
+#define LARGE_BUFFER_THRESHOLD (4U * 1024U * 1024U)
+
+typedef enum {
+  LARGE_BUFFER_HEAP = 0, /* plain malloc: small buffers, or every mmap attempt failed */
+  LARGE_BUFFER_HUGETLB,  /* mmap(MAP_HUGETLB) from the reserved hugetlbfs pool */
+  LARGE_BUFFER_THP       /* anonymous mmap with madvise(MADV_HUGEPAGE) */
+} LargeBufferKind;
+
+typedef struct {
+  char *data;
+  size_t size;
+  size_t mapped;
+  LargeBufferKind kind;
+} LargeBuffer;
+
+/* Tries the hugetlbfs pool, then transparent huge pages, then malloc. Mapped memory arrives zeroed and
+ * unfaulted: whoever writes a page first (the rank receiving a broadcast, say) places it, so callers
+ * should not clear it. Returns -1 only when every path failed. */
+int large_buffer_alloc(LargeBuffer *buffer, size_t size);
+void large_buffer_free(LargeBuffer *buffer);
+const char *large_buffer_kind_name(LargeBufferKind kind);
+
+/* Asks for transparent huge pages on the 2 MiB-aligned interior of a buffer from malloc/realloc, which
+ * stays with the caller and is released with free(). A no-op for small buffers or where THP is off. */
+void large_buffer_advise(void *data, size_t size);
+
+#endif /* LARGE_BUFFER_H */
@@ -2,7 +2,9 @@
 
 #include <errno.h>
 #include <ctype.h>
+#include <fcntl.h>
 #include <limits.h>
+#include <signal.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -11,27 +13,56 @@
 #include <stdarg.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <time.h>
 #include <unistd.h>
 
 #ifndef PATH_MAX
 #define PATH_MAX 4096
 #endif
 
+#if defined(OPEN_MPI) && OPEN_MPI
+#include <mpi-ext.h>
+#endif
+#if defined(MPIX_ERR_PROC_FAILED)
+#define DEEPSEEK_HAVE_ULFM 1
+#endif
+
 #include "api_client.h"
+#include "autotune.h"
 #include "app_config.h"
+#include "async_io.h"
 #include "attachment_loader.h"
+#include "chunk_cost.h"
+#include "chunk_dedup.h"
+#include "chunk_filter.h"
 #include "cli.h"
 #include "deepseek.h"
+#include "dir_watcher.h"
 #include "file_loader.h"
 #include "input_chunker.h"
+#include "job_server.h"
+#include "large_buffer.h"
 #include "logger.h"
+#include "memory_budget.h"
+#include "memory_profile.h"
+#include "numa_topology.h"
+#include "response_spool.h"
+#include "result_arrow.h"
+#include "segmented_bcast.h"
 #include "string_buffer.h"
 #include "readline_prompt.h"
+#include "stream_batcher.h"
+#include "text_normalizer.h"
+#include "transfer_codec.h"
 #include "tui.h"
 
+/* arrival is set while a pipelined broadcast is still filling data (see payload_wait); codec is what
+ * this payload's bulk MPI transfers are compressed with. */
 typedef struct {
   char *data;
   size_t length;
+  SegmentedBcast *arrival;
+  TransferCodec codec;
 } Payload;
 
 typedef struct {
@@ -160,40 +191,37 @@ static void sb_append_unescaped_json(StringBuffer *out, const char *encoded, siz
   }
 }
 
-static void append_json_content_block(StringBuffer *out, const char *json, size_t len) {
-  if (!out || !json || len == 0) {
-    return;
-  }
+/* Decodes the assistant message of one JSON response into out. Returns false when there is none. */
+static bool decode_assistant_content(const char *json, size_t len, StringBuffer *out) {
   char *copy = dup_substring(json, len);
   if (!copy) {
-    sb_append(out, json, len);
-    sb_append_str(out, "\n\n");
-    return;
+    return false;
   }
   const char *needle = "\"content\":\"";
   char *content = strstr(copy, needle);
-  if (!content) {
-    sb_append(out, json, len);
-    sb_append_str(out, "\n\n");
-    free(copy);
+  if (content) {
+    sb_append_unescaped_json(out, content + strlen(needle), NULL);
+  }
+  free(copy);
+  return out->length > 0;
+}
+
+static void append_json_content_block(StringBuffer *out, const char *json, size_t len) {
+  if (!out || !json || len == 0) {
     return;
   }
-  content += strlen(needle);
   StringBuffer decoded;
   sb_init(&decoded);
-  sb_append_unescaped_json(&decoded, content, NULL);
-  if (decoded.length == 0) {
+  if (!decode_assistant_content(json, len, &decoded)) {
     sb_append(out, json, len);
     sb_append_str(out, "\n\n");
     sb_clean(&decoded);
-    free(copy);
     return;
   }
   sb_append_str(out, "[Assistant]\n");
   sb_append(out, decoded.data, decoded.length);
   sb_append_str(out, "\n\n");
   sb_clean(&decoded);
-  free(copy);
 }
 
 static const char *find_double_newline(const char *cursor, const char *end) {
@@ -246,21 +274,19 @@ static void render_pretty_response_stream(const StringBuffer *raw, StringBuffer
   }
 }
 
-static void log_pretty_responses(Logger *logger, const char *prefix, const char *raw, size_t len,
-                                 StringBuffer *capture) {
-  if (!logger || !raw || len == 0) {
+/* Records arrive already rendered by the rank that produced them (see record_chunk_response), so rank 0
+ * only copies them out. */
+static void log_rendered_responses(Logger *logger, const char *prefix, const char *rendered, size_t len,
+                                   StringBuffer *capture) {
+  if (!logger || !rendered || len == 0) {
     return;
   }
-  StringBuffer raw_buf = {.data = (char *) raw, .length = len, .capacity = len};
   StringBuffer pretty;
   sb_init(&pretty);
   if (prefix) {
     sb_append_str(&pretty, prefix);
   }
-  render_pretty_response_stream(&raw_buf, &pretty);
-  if (pretty.length == 0) {
-    sb_append_str(&pretty, "(no response data)");
-  }
+  sb_append(&pretty, rendered, len);
   logger_log(logger, LOG_LEVEL_INFO, "%s", pretty.data ? pretty.data : "(no response data)");
   if (capture && pretty.data) {
     sb_append(capture, pretty.data, pretty.length);
@@ -268,6 +294,30 @@ static void log_pretty_responses(Logger *logger, const char *prefix, const char
   sb_clean(&pretty);
 }
 
+static void send_blob(const char *data, size_t length, int dest, int tag, MPI_Comm comm) {
+  size_t sent = 0;
+  while (sent < length) {
+    int chunk = (length - sent) > INT_MAX ? INT_MAX : (int) (length - sent);
+    MPI_Send(data + sent, chunk, MPI_CHAR, dest, tag, comm);
+    sent += (size_t) chunk;
+  }
+}
+
+static char *recv_blob(size_t length, int source, int tag, MPI_Comm comm) {
+  char *data = malloc(length + 1);
+  if (!data) {
+    MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+  }
+  size_t received = 0;
+  while (received < length) {
+    int chunk = (length - received) > INT_MAX ? INT_MAX : (int) (length - received);
+    MPI_Recv(data + received, chunk, MPI_CHAR, source, tag, comm, MPI_STATUS_IGNORE);
+    received += (size_t) chunk;
+  }
+  data[length] = '\0';
+  return data;
+}
+
 static void maybe_adjust_chunk_from_tasks(ProgramConfig *config, const Payload *payload, Logger *logger);
 static void maybe_autoscale_payload(ProgramConfig *config, const Payload *payload, Logger *logger);
 static int ensure_input_file_available(ProgramConfig *config, Logger *logger);
@@ -402,6 +452,39 @@ static int ensure_input_file_available(ProgramConfig *config, Logger *logger) {
   return 0;
 }
 
+static void normalize_payload_text(const ProgramConfig *config, Logger *logger, Payload *payload,
+                                   const char *label, const char *mime) {
+  if (!config || !config->normalize_input || !payload || !payload->data || payload->length == 0) {
+    return;
+  }
+  TextNormalizeStats stats;
+  if (text_normalize(payload->data, &payload->length, text_normalize_mime_is_tabular(mime), &stats) != 0) {
+    logger_log(logger, LOG_LEVEL_WARN, "Normalization skipped for %s", label);
+    return;
+  }
+  logger_log(logger, LOG_LEVEL_INFO,
+             "Normalized %s: %zu -> %zu bytes (whitespace %zu, boilerplate %zu in %zu lines, "
+             "empty CSV columns %zu in %zu, base64 %zu in %zu runs)",
+             label, stats.input_bytes, stats.output_bytes, stats.whitespace_bytes, stats.boilerplate_bytes,
+             stats.boilerplate_lines, stats.csv_column_bytes, stats.csv_columns_dropped, stats.base64_bytes,
+             stats.base64_runs);
+}
+
+/* Refuses input larger than the memory budget before any of it is read. Only regular files have a size to
+ * check (path, or stdin when path is NULL); execute_payload checks the final payload once more. */
+static bool input_fits_budget(const ProgramConfig *config, Logger *logger, const char *path) {
+  struct stat st;
+  memory_budget_set_limit(config->max_memory);
+  if ((path ? stat(path, &st) : fstat(STDIN_FILENO, &st)) != 0 || !S_ISREG(st.st_mode) ||
+      memory_budget_fits((size_t) st.st_size + 1)) {
+    return true;
+  }
+  logger_log(logger, LOG_LEVEL_ERROR,
+             "Input %s of %lld bytes does not fit the %zu-byte memory budget (%zu bytes already in use)",
+             path ? path : "stdin", (long long) st.st_size, memory_budget_limit(), memory_budget_used());
+  return false;
+}
+
 static int gather_payload_root(ProgramConfig *config, Logger *logger, Payload *payload) {
   if (!config || !payload) {
     return -1;
@@ -411,10 +494,19 @@ static int gather_payload_root(ProgramConfig *config, Logger *logger, Payload *p
 
   if (config->input_file) {
     if (strcmp(config->input_file, "-") == 0) {
+      if (!input_fits_budget(config, logger, NULL)) {
+        return -1;
+      }
       logger_log(logger, LOG_LEVEL_INFO, "Reading payload from stdin (-)");
       rc = load_from_stream(stdin, payload, &error);
+      if (rc == 0) {
+        normalize_payload_text(config, logger, payload, "stdin", NULL);
+      }
     } else {
       rc = ensure_input_file_available(config, logger);
+      if (rc == 0 && !input_fits_budget(config, logger, config->input_file)) {
+        return -1;
+      }
       if (rc == 0) {
         logger_log(logger, LOG_LEVEL_INFO, "Reading payload from file %s", config->input_file);
         AttachmentTextPayload text_payload = {0};
@@ -437,13 +529,22 @@ static int gather_payload_root(ProgramConfig *config, Logger *logger, Payload *p
           payload->data = text_payload.data;
           payload->length = text_payload.length;
           text_payload.data = NULL;
+          if (!text_payload.encoded_binary) {
+            normalize_payload_text(config, logger, payload, config->input_file, text_payload.mime_label);
+          }
         }
         attachment_text_payload_clean(&text_payload);
       }
     }
   } else if (config->use_stdin) {
+    if (!input_fits_budget(config, logger, NULL)) {
+      return -1;
+    }
     logger_log(logger, LOG_LEVEL_INFO, "Reading payload from stdin (flag)");
     rc = load_from_stream(stdin, payload, &error);
+    if (rc == 0) {
+      normalize_payload_text(config, logger, payload, "stdin", NULL);
+    }
   } else if (config->input_text) {
     logger_log(logger, LOG_LEVEL_INFO, "Using inline text payload");
     rc = duplicate_text(config->input_text, payload, &error);
@@ -476,13 +577,10 @@ static int gather_payload_root(ProgramConfig *config, Logger *logger, Payload *p
   }
 
   logger_log(logger, LOG_LEVEL_INFO, "Captured %zu bytes of payload", payload->length);
-  if (!config->repl_mode) {
-    adjust_chunking_for_payload(config, payload, logger);
-  }
   return 0;
 }
 
-static int broadcast_payload(char *buffer, size_t length) {
+static int broadcast_payload(char *buffer, size_t length, MPI_Comm comm) {
   if (!buffer && length > 0) {
     return -1;
   }
@@ -490,12 +588,81 @@ static int broadcast_payload(char *buffer, size_t length) {
   while (offset < length) {
     size_t remaining = length - offset;
     int chunk = remaining > (size_t) INT_MAX ? INT_MAX : (int) remaining;
-    MPI_Bcast(buffer + offset, chunk, MPI_CHAR, 0, MPI_COMM_WORLD);
+    MPI_Bcast(buffer + offset, chunk, MPI_CHAR, 0, comm);
     offset += (size_t) chunk;
   }
   return 0;
 }
 
+/* Payloads below TRANSFER_PROBE_MIN are never worth profiling; the link probe and the codec sample are
+ * at most TRANSFER_PROBE_BYTES. */
+#define TRANSFER_PROBE_MIN   (1U * 1024U * 1024U)
+#define TRANSFER_PROBE_BYTES (4U * 1024U * 1024U)
+
+/* Collective. Times two broadcasts of probe bytes and returns the faster rate, in bytes per second, as
+ * seen by the slowest rank. */
+static double measure_link_rate(size_t bytes, MPI_Comm comm) {
+  char *probe = calloc(bytes, 1);
+  if (!probe) {
+    MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+  }
+  double best = 0.0;
+  for (int round = 0; round < 2; ++round) {
+    MPI_Barrier(comm);
+    double started = MPI_Wtime();
+    MPI_Bcast(probe, (int) bytes, MPI_CHAR, 0, comm);
+    double elapsed = MPI_Wtime() - started;
+    MPI_Allreduce(MPI_IN_PLACE, &elapsed, 1, MPI_DOUBLE, MPI_MAX, comm);
+    double rate = (double) bytes / (elapsed > 1e-6 ? elapsed : 1e-6);
+    best = rate > best ? rate : best;
+  }
+  free(probe);
+  return best;
+}
+
+/* Collective. Rank 0 settles the codec for this payload's bulk transfers (--mpi-compress) and every rank
+ * adopts it; with auto the link is probed and the codecs are profiled on the head of the payload. */
+static TransferCodec choose_transfer_codec(const ProgramConfig *config, Logger *logger, const char *data,
+                                           size_t length, MPI_Comm comm) {
+  int comm_size = 1;
+  MPI_Comm_size(comm, &comm_size);
+  int probe = config->rank == 0 && comm_size > 1 && config->mpi_compress == TRANSFER_CODEC_AUTO &&
+              length >= TRANSFER_PROBE_MIN;
+  MPI_Bcast(&probe, 1, MPI_INT, 0, comm);
+  size_t sample = length < TRANSFER_PROBE_BYTES ? length : TRANSFER_PROBE_BYTES;
+  double link_rate = probe ? measure_link_rate(sample, comm) : 0.0;
+  int chosen = TRANSFER_CODEC_OFF;
+  if (config->rank == 0 && comm_size > 1 && length > 0) {
+    TransferCodecProfile profile;
+    chosen = (int) transfer_codec_choose(config->mpi_compress, data, sample, link_rate, &profile);
+    if (chosen != TRANSFER_CODEC_OFF && probe) {
+      logger_log(logger, LOG_LEVEL_INFO, "Compressing MPI transfers with %s (%.1fx at %.0f MB/s; link %.0f MB/s)",
+                 transfer_codec_name((TransferCodec) chosen), profile.ratio, profile.compress_rate / 1e6,
+                 link_rate / 1e6);
+    } else if (chosen != TRANSFER_CODEC_OFF) {
+      logger_log(logger, LOG_LEVEL_INFO, "Compressing MPI transfers with %s as requested (%.1fx at %.0f MB/s)",
+                 transfer_codec_name((TransferCodec) chosen), profile.ratio, profile.compress_rate / 1e6);
+    } else if (probe) {
+      logger_log(logger, LOG_LEVEL_DEBUG, "MPI transfers stay raw: link %.0f MB/s beats every codec",
+                 link_rate / 1e6);
+    }
+  }
+  MPI_Bcast(&chosen, 1, MPI_INT, 0, comm);
+  return (TransferCodec) chosen;
+}
+
+/* Blocks until payload bytes [0, end) are in place; a no-op once the broadcast is complete. */
+static void payload_wait(const Payload *payload, size_t end) {
+  if (payload->arrival) {
+    segmented_bcast_wait(payload->arrival, end);
+  }
+}
+
+/* Installed as the API client's progress hook so the broadcast keeps moving during requests. */
+static void progress_payload_broadcast(void *data) {
+  segmented_bcast_progress(data);
+}
+
 static void maybe_adjust_chunk_from_tasks(ProgramConfig *config, const Payload *payload, Logger *logger) {
   if (!config || !payload || !logger) {
     return;
@@ -550,11 +717,11 @@ static void maybe_autoscale_payload(ProgramConfig *config, const Payload *payloa
     logger_log(logger, LOG_LEVEL_INFO,
                "Autoscale (chunks) triggered: payload %zu bytes >= %zu bytes -> %zu tasks (factor %d)",
                payload->length, config->auto_scale_threshold_bytes, scaled, config->auto_scale_factor);
-  } else if (config->auto_scale_mode == AUTOSCALE_MODE_THREADS) {
+  } else if (config->auto_scale_mode == AUTOSCALE_MODE_THREADS &&
+             (config->daemon_mode || config->stream_mode || config->watch_dir || config->repl_mode)) {
     logger_log(logger, LOG_LEVEL_INFO,
-               "Autoscale (threads) requested for %zu-byte payload but MPI world size is fixed at %d. "
-               "Rerun with a higher -np or enable wrapper autoscale for rank scaling.",
-               payload->length, config->world_size);
+               "Autoscale (threads) spawns ranks only for one-shot runs; continuing with %d ranks for this "
+               "%zu-byte payload", config->world_size, payload->length);
   }
 }
 
@@ -657,7 +824,7 @@ static int ensure_directory(const char *path) {
   return 0;
 }
 
-static void persist_response_to_disk(const ProgramConfig *config, Logger *logger, size_t chunk_index,
+static void persist_response_to_disk(const ProgramConfig *config, Logger *logger, size_t chunk_index, int rank,
                                      const StringBuffer *response) {
   if (!config || !logger || !config->response_files_enabled || !config->response_dir || !response ||
       response->length == 0) {
@@ -677,25 +844,45 @@ static void persist_response_to_disk(const ProgramConfig *config, Logger *logger
     return;
   }
   int written = snprintf(path, needed, "%s%schunk-%06zu-r%d.json", config->response_dir, suffix, chunk_index,
-                         config->rank);
+                         rank);
   if (written < 0 || (size_t) written >= needed) {
     logger_log(logger, LOG_LEVEL_WARN, "Rank %d response path truncated", config->rank);
     free(path);
     return;
   }
-  FILE *fp = fopen(path, "w");
-  if (!fp) {
-    logger_log(logger, LOG_LEVEL_WARN, "Rank %d cannot open %s: %s", config->rank, path, strerror(errno));
+  /* The write (and fsync) finishes in the background; execute_payload reports late failures. */
+  char *write_error = NULL;
+  if (async_io_write_file(path, response->data, response->length, true, &write_error) != 0) {
+    logger_log(logger, LOG_LEVEL_WARN, "Rank %d %s", config->rank, write_error ? write_error : "cannot write response");
+    free(write_error);
     free(path);
     return;
   }
-  fwrite(response->data, 1, response->length, fp);
-  fputc('\n', fp);
-  fclose(fp);
   logger_log(logger, LOG_LEVEL_DEBUG, "Persisted response for chunk %zu to %s", chunk_index, path);
   free(path);
 }
 
+/* Exact duplicates get the representative's response verbatim; near-duplicates get it wrapped with
+ * the representative index and estimated similarity so consumers can tell the answer was reused. */
+static void persist_alias_response(const ProgramConfig *config, Logger *logger, size_t alias_index, int rank,
+                                   size_t representative, double similarity, const StringBuffer *response) {
+  if (!response || response->length == 0) {
+    return;
+  }
+  if (similarity >= 1.0) {
+    persist_response_to_disk(config, logger, alias_index, rank, response);
+    return;
+  }
+  StringBuffer envelope;
+  sb_init(&envelope);
+  sb_append_printf(&envelope, "{\"chunk\":%zu,\"duplicate_of\":%zu,\"similarity\":%.4f,\"response\":", alias_index,
+                   representative, similarity);
+  sb_append(&envelope, response->data, response->length);
+  sb_append_char(&envelope, '}');
+  persist_response_to_disk(config, logger, alias_index, rank, &envelope);
+  sb_clean(&envelope);
+}
+
 static void log_response_preview(const ProgramConfig *config, Logger *logger, size_t chunk_index,
                                  const StringBuffer *response) {
   (void) config;
@@ -760,394 +947,3397 @@ static void build_repl_payload(const StringBuffer *history, const Payload *promp
   sb_clean(&builder);
 }
 
+/* With a memory budget each rank renders (and rank 0 receives) at most a quarter of it at a time. */
+static size_t response_batch_bytes(void) {
+  size_t limit = memory_budget_limit();
+  return limit > 0 ? limit / 4 : SIZE_MAX;
+}
+
+static void log_spooled_responses(Logger *logger, const char *prefix, ResponseSpool *spool, StringBuffer *capture) {
+  size_t cursor = 0;
+  StringBuffer batch;
+  sb_init(&batch);
+  for (;;) {
+    char *error = NULL;
+    sb_reset(&batch);
+    int rc = response_spool_read(spool, &cursor, response_batch_bytes(), &batch, &error);
+    if (rc < 0) {
+      logger_log(logger, LOG_LEVEL_ERROR, "Unable to read back responses: %s", error ? error : "unknown error");
+      free(error);
+    }
+    if (rc <= 0) {
+      break;
+    }
+    log_rendered_responses(logger, prefix, batch.data, batch.length, capture);
+    prefix = NULL;
+  }
+  sb_clean(&batch);
+}
+
 static void stream_responses_after_completion(const ProgramConfig *config, Logger *logger,
-                                              StringBuffer *response_stream, StringBuffer *global_out,
-                                              bool stream_enabled) {
+                                              ResponseSpool *response_stream, StringBuffer *global_out,
+                                              bool stream_enabled, TransferCodec codec, MPI_Comm comm) {
   if (!stream_enabled || !config || !logger || !response_stream) {
     return;
   }
   const int TAG_LEN = 0x5a1;
   const int TAG_DATA = 0x5a2;
-  unsigned long long local_len = (unsigned long long) response_stream->length;
 
   if (config->world_size == 1) {
-    if (local_len > 0 && response_stream->data) {
-      log_pretty_responses(logger, "\n===== Responses =====\n",
-                           response_stream->data, response_stream->length, global_out);
-    }
+    log_spooled_responses(logger, "\n===== Responses =====\n", response_stream, global_out);
     return;
   }
 
+  /* Workers ship their records in batches ended by a zero length, so rank 0 never holds more than one
+   * batch from one rank, and a worker blocks in MPI_Send until rank 0 has printed the previous batch.
+   * Each batch is announced as {length, wire length, codec}; a batch that did not shrink goes raw. */
   if (config->rank == 0) {
-    if (local_len > 0 && response_stream->data) {
-      log_pretty_responses(logger, "\n===== Responses from rank 0 =====\n",
-                           response_stream->data, response_stream->length, global_out);
-    }
+    log_spooled_responses(logger, "\n===== Responses from rank 0 =====\n", response_stream, global_out);
+    StringBuffer batch;
+    sb_init(&batch);
     for (int source = 1; source < config->world_size; ++source) {
-      unsigned long long incoming = 0;
-      MPI_Recv(&incoming, 1, MPI_UNSIGNED_LONG_LONG, source, TAG_LEN, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-      if (incoming == 0) {
-        continue;
+      char header[128];
+      snprintf(header, sizeof header, "\n===== Responses from rank %d =====\n", source);
+      bool first = true;
+      for (;;) {
+        unsigned long long frame[3] = {0, 0, 0};
+        MPI_Recv(frame, 3, MPI_UNSIGNED_LONG_LONG, source, TAG_LEN, comm, MPI_STATUS_IGNORE);
+        unsigned long long incoming = frame[0];
+        if (incoming == 0) {
+          break;
+        }
+        bool compressed = frame[1] < incoming;
+        char *wire = compressed ? malloc((size_t) frame[1] + 1) : NULL;
+        sb_reset(&batch);
+        if ((compressed && !wire) || sb_reserve(&batch, (size_t) incoming) != 0) {
+          logger_log(logger, LOG_LEVEL_WARN, "Rank 0 cannot allocate %llu bytes to stream responses from rank %d",
+                     incoming, source);
+          size_t remaining = (size_t) frame[1];
+          char discard[4096];
+          while (remaining > 0) {
+            int chunk = remaining > (size_t) sizeof discard ? (int) sizeof discard : (int) remaining;
+            MPI_Recv(discard, chunk, MPI_CHAR, source, TAG_DATA, comm, MPI_STATUS_IGNORE);
+            remaining -= (size_t) chunk;
+          }
+          free(wire);
+          continue;
+        }
+        char *target = compressed ? wire : batch.data;
+        size_t received = 0;
+        while (received < frame[1]) {
+          int chunk = (frame[1] - received) > INT_MAX ? INT_MAX : (int) (frame[1] - received);
+          MPI_Recv(target + received, chunk, MPI_CHAR, source, TAG_DATA, comm, MPI_STATUS_IGNORE);
+          received += (size_t) chunk;
+        }
+        if (compressed && transfer_codec_decompress((TransferCodec) frame[2], wire, (size_t) frame[1], batch.data,
+                                                    (size_t) incoming) != 0) {
+          logger_log(logger, LOG_LEVEL_WARN, "Dropped a corrupt %s response batch from rank %d",
+                     transfer_codec_name((TransferCodec) frame[2]), source);
+          free(wire);
+          continue;
+        }
+        free(wire);
+        batch.length = (size_t) incoming;
+        batch.data[batch.length] = '\0';
+        log_rendered_responses(logger, first ? header : NULL, batch.data, batch.length, global_out);
+        first = false;
       }
-      char *buffer = malloc((size_t) incoming + 1);
-      if (!buffer) {
-        logger_log(logger, LOG_LEVEL_WARN, "Rank 0 cannot allocate %llu bytes to stream responses from rank %d",
-                   incoming, source);
-        size_t remaining = (size_t) incoming;
-        char discard[4096];
-        while (remaining > 0) {
-          int chunk = remaining > (size_t) sizeof discard ? (int) sizeof discard : (int) remaining;
-          MPI_Recv(discard, chunk, MPI_CHAR, source, TAG_DATA, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-          remaining -= (size_t) chunk;
+    }
+    sb_clean(&batch);
+  } else {
+    size_t cursor = 0;
+    StringBuffer batch;
+    sb_init(&batch);
+    bool compress = codec != TRANSFER_CODEC_AUTO && codec != TRANSFER_CODEC_OFF;
+    char *wire = NULL;
+    size_t wire_capacity = 0;
+    for (;;) {
+      char *error = NULL;
+      sb_reset(&batch);
+      int rc = response_spool_read(response_stream, &cursor, response_batch_bytes(), &batch, &error);
+      if (rc < 0) {
+        logger_log(logger, LOG_LEVEL_ERROR, "Unable to read back responses: %s", error ? error : "unknown error");
+        free(error);
+      }
+      unsigned long long frame[3] = {rc > 0 ? (unsigned long long) batch.length : 0ULL, 0, (unsigned long long) codec};
+      frame[1] = frame[0];
+      size_t bound = compress && frame[0] > 0 ? transfer_codec_bound(codec, batch.length) : 0;
+      if (bound > wire_capacity) {
+        char *grown = realloc(wire, bound);
+        if (grown) {
+          wire = grown;
+          wire_capacity = bound;
         }
-        continue;
       }
-      size_t received = 0;
-      while (received < incoming) {
-        int chunk = (incoming - received) > INT_MAX ? INT_MAX : (int) (incoming - received);
-        MPI_Recv(buffer + received, chunk, MPI_CHAR, source, TAG_DATA, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-        received += (size_t) chunk;
+      size_t wire_len = 0;
+      if (bound > 0 && bound <= wire_capacity &&
+          transfer_codec_compress(codec, batch.data, batch.length, wire, wire_capacity, &wire_len) == 0 &&
+          wire_len < batch.length) {
+        frame[1] = wire_len;
       }
-      buffer[incoming] = '\0';
-      char header[128];
-      snprintf(header, sizeof header, "\n===== Responses from rank %d =====\n", source);
-      log_pretty_responses(logger, header, buffer, (size_t) incoming, global_out);
-      free(buffer);
+      MPI_Send(frame, 3, MPI_UNSIGNED_LONG_LONG, 0, TAG_LEN, comm);
+      if (frame[0] == 0) {
+        break;
+      }
+      send_blob(frame[1] < frame[0] ? wire : batch.data, (size_t) frame[1], 0, TAG_DATA, comm);
     }
-  } else {
-    MPI_Send(&local_len, 1, MPI_UNSIGNED_LONG_LONG, 0, TAG_LEN, MPI_COMM_WORLD);
-    size_t sent = 0;
-    while (sent < response_stream->length) {
-      int chunk = (response_stream->length - sent) > INT_MAX ? INT_MAX : (int) (response_stream->length - sent);
-      MPI_Send(response_stream->data + sent, chunk, MPI_CHAR, 0, TAG_DATA, MPI_COMM_WORLD);
-      sent += (size_t) chunk;
+    free(wire);
+    sb_clean(&batch);
+  }
+}
+
+/* --results-arrow part this rank writes for the current payload (see open_results_part). */
+static ResultArrowWriter g_results_part;
+static bool g_results_part_open = false;
+/* How long the last successful request took, for the latency column. */
+static double g_last_chunk_seconds = -1.0;
+
+/* A token count from the usage block of an OpenAI-style (key) or Anthropic (alt_key) response, -1 when
+ * the response has none. */
+static long long response_token_count(const StringBuffer *response, const char *key, const char *alt_key) {
+  const char *keys[] = {key, alt_key};
+  for (size_t i = 0; i < 2 && response->data; ++i) {
+    char needle[64];
+    snprintf(needle, sizeof needle, "\"%s\":", keys[i]);
+    const char *found = strstr(response->data, needle);
+    if (found) {
+      found += strlen(needle);
+      while (*found == ' ') {
+        found++;
+      }
+      char *end = NULL;
+      long long count = strtoll(found, &end, 10);
+      if (end != found && count >= 0) {
+        return count;
+      }
     }
   }
+  return -1;
 }
 
-static void process_chunks(const ProgramConfig *config, Logger *logger, const Payload *payload,
-                           StringBuffer *repl_capture) {
-  if (!config || !payload) {
+/* Adds the rows for task and its duplicates to this rank's --results-arrow part. response is NULL when
+ * the chunk failed; a negative latency is unknown. */
+static void export_chunk_rows(const ProgramConfig *config, Logger *logger, const ChunkTask *task, int rank,
+                              double latency, const StringBuffer *response) {
+  if (!g_results_part_open) {
     return;
   }
-  ChunkCursor cursor;
-  chunk_cursor_init(&cursor, config->chunk_size, payload->length, config->rank, config->world_size);
-
-  ApiClient client;
-  char *client_error = NULL;
-  bool client_ready = (api_client_init(&client, config, &client_error) == 0);
-  if (!client_ready) {
-    logger_log(logger, LOG_LEVEL_ERROR, "API client init failed: %s", client_error ? client_error : "unknown");
-    free(client_error);
+  StringBuffer text;
+  sb_init(&text);
+  bool has_text = false;
+  if (response && response->data && response->length > 0) {
+    /* Without an assistant message (dry runs, other providers) the raw response is kept instead. */
+    if (!decode_assistant_content(response->data, response->length, &text)) {
+      sb_reset(&text);
+      sb_append(&text, response->data, response->length);
+    }
+    has_text = true;
   }
-
-  StringBuffer response;
-  bool response_ready = false;
-  if (client_ready) {
-    sb_init(&response);
-    response_ready = true;
+  ResultArrowRow row;
+  memset(&row, 0, sizeof row);
+  row.chunk_index = task->index;
+  row.rank = rank;
+  row.status = !response ? "failed" : (config->dry_run ? "dry-run" : "ok");
+  row.latency = response ? latency : -1.0;
+  row.prompt_tokens = response ? response_token_count(response, "prompt_tokens", "input_tokens") : -1;
+  row.completion_tokens = response ? response_token_count(response, "completion_tokens", "output_tokens") : -1;
+  row.text = has_text ? text.data : NULL;
+  row.text_len = text.length;
+  char *error = NULL;
+  int rc = result_arrow_add(&g_results_part, &row, &error);
+  /* Duplicates sent no request of their own, so they carry no latency or token counts. */
+  row.latency = -1.0;
+  row.prompt_tokens = -1;
+  row.completion_tokens = -1;
+  row.duplicate = true;
+  row.duplicate_of = task->index;
+  for (size_t a = 0; rc == 0 && a < task->alias_count; ++a) {
+    row.chunk_index = task->aliases[a];
+    if (response) {
+      row.status = task->alias_similarity[a] < 1.0 ? "near-duplicate" : "duplicate";
+    }
+    rc = result_arrow_add(&g_results_part, &row, &error);
   }
-
-  bool stream_enabled = response_ready && config && config->repl_mode;
-  StringBuffer response_stream;
-  if (stream_enabled) {
-    sb_init(&response_stream);
+  if (rc != 0) {
+    logger_log(logger, LOG_LEVEL_WARN, "Rank %d stops exporting results: %s", config->rank,
+               error ? error : "unknown error");
+    result_arrow_close(&g_results_part, NULL);
+    g_results_part_open = false;
   }
+  free(error);
+  sb_clean(&text);
+}
 
-  size_t processed = 0;
-  size_t failures = 0;
-  size_t network_failures = 0;
-  size_t chunk_index = 0;
-  size_t start = 0;
-  size_t end = 0;
-  bool aborted = false;
-
-  while (client_ready && !aborted && chunk_cursor_next(&cursor, &start, &end, &chunk_index)) {
-    const char *chunk_ptr = payload->data + start;
-    size_t chunk_len = end - start;
-    int remaining_resets = config->network_retry_limit;
-    if (remaining_resets < 0) {
-      remaining_resets = 0;
-    }
-    bool chunk_done = false;
-    while (client_ready && !chunk_done) {
-      char *error = NULL;
-      ApiClientError api_error = API_CLIENT_ERROR_NONE;
-      int api_rc = api_client_send(&client, chunk_ptr, chunk_len, chunk_index, response_ready ? &response : NULL,
-                                   &error, &api_error);
-      if (api_rc == 0) {
-        logger_log(logger, LOG_LEVEL_INFO, "Chunk %zu (%zu bytes) succeeded", chunk_index, chunk_len);
-        if (response_ready) {
-          persist_response_to_disk(config, logger, chunk_index, &response);
-          log_response_preview(config, logger, chunk_index, &response);
-          if (stream_enabled) {
-            sb_append_printf(&response_stream, "----- chunk %zu (rank %d) -----\n", chunk_index, config->rank);
-            if (response.length > 0 && response.data) {
-              sb_append(&response_stream, response.data, response.length);
-            }
-            sb_append_str(&response_stream, "\n\n");
-          }
-        }
-        chunk_done = true;
-        free(error);
-        error = NULL;
-      } else if (api_error == API_CLIENT_ERROR_NETWORK && remaining_resets > 0) {
-        logger_log(logger, LOG_LEVEL_WARN,
-                   "Chunk %zu network error: %s (resetting client, %d retries left)", chunk_index,
-                   error ? error : "unknown error", remaining_resets);
-        free(error);
-        error = NULL;
-        remaining_resets--;
-        api_client_cleanup(&client);
-        client_ready = false;
-        char *reset_error = NULL;
-        if (api_client_init(&client, config, &reset_error) != 0) {
-          logger_log(logger, LOG_LEVEL_ERROR, "Unable to reinitialize API client: %s",
-                     reset_error ? reset_error : "unknown error");
-          free(reset_error);
-          aborted = true;
-          break;
-        }
-        client_ready = true;
-        continue;
-      } else {
-        logger_log(logger, LOG_LEVEL_ERROR, "Chunk %zu failed: %s", chunk_index,
-                   error ? error : "unknown error");
-        if (api_error == API_CLIENT_ERROR_NETWORK) {
-          network_failures++;
-        }
-        failures++;
-        chunk_done = true;
-        free(error);
-        error = NULL;
-      }
+enum { TAG_JOB_PAYLOAD = 0x6b1, TAG_JOB_RESULT = 0x6b2, TAG_JOB_RECORD = 0x6b3 };
 
-      if (!client_ready || aborted) {
-        break;
-      }
-    }
+/* Daemon jobs stream every chunk record to their client as soon as it is rendered. World rank 0 writes the
+ * records of the group it leads straight to client_fd; every other rank posts them to rank 0 with
+ * TAG_JOB_RECORD, and rank 0 relays them from relay (see daemon_relay_pending) between its own chunks. */
+typedef struct {
+  bool active;
+  int client_fd;
+  unsigned long long posted;
+  MPI_Request *requests;
+  char **buffers;
+  size_t count;
+  size_t capacity;
+  void (*relay)(void *data);
+  void *relay_data;
+} JobStream;
 
-    if (!client_ready || aborted) {
-      break;
-    }
+static JobStream g_job_stream = {.client_fd = -1};
 
-    processed++;
-    if (config->show_progress && config->progress_interval > 0 &&
-        (processed % (size_t) config->progress_interval == 0)) {
-      logger_log(logger, LOG_LEVEL_INFO, "Progress: %zu chunks processed on rank %d", processed, config->rank);
+/* Frees the records rank 0 has taken delivery of; with wait, blocks until every one has been. */
+static void job_stream_reap(bool wait) {
+  size_t kept = 0;
+  for (size_t i = 0; i < g_job_stream.count; ++i) {
+    int done = 0;
+    if (wait) {
+      MPI_Wait(&g_job_stream.requests[i], MPI_STATUS_IGNORE);
+      done = 1;
+    } else {
+      MPI_Test(&g_job_stream.requests[i], &done, MPI_STATUS_IGNORE);
+    }
+    if (done) {
+      free(g_job_stream.buffers[i]);
+    } else {
+      g_job_stream.requests[kept] = g_job_stream.requests[i];
+      g_job_stream.buffers[kept] = g_job_stream.buffers[i];
+      kept++;
     }
   }
-
-  unsigned long long stats[3] = {processed, failures, network_failures};
-  unsigned long long global_stats[3] = {0, 0, 0};
-  MPI_Reduce(stats, global_stats, 3, MPI_UNSIGNED_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
-
-  if (config->rank == 0) {
-    logger_log(logger, LOG_LEVEL_INFO,
-               "Cluster summary: processed=%llu, failures=%llu, network_failures=%llu",
-               global_stats[0], global_stats[1], global_stats[2]);
+  g_job_stream.count = kept;
+  if (wait) {
+    free(g_job_stream.requests);
+    free(g_job_stream.buffers);
+    g_job_stream.requests = NULL;
+    g_job_stream.buffers = NULL;
+    g_job_stream.capacity = 0;
   }
+}
 
-  if (response_ready) {
-    sb_clean(&response);
+/* Hands one rendered record to the daemon client. Returns false outside daemon jobs, and for a record
+ * that cannot be posted, which then goes to the response spool as usual. */
+static bool job_stream_record(Logger *logger, const char *record, size_t len) {
+  if (!g_job_stream.active) {
+    return false;
   }
-  if (stream_enabled) {
-    stream_responses_after_completion(config, logger, &response_stream, repl_capture, stream_enabled);
-    sb_clean(&response_stream);
-  } else if (repl_capture && config && config->rank == 0) {
-    sb_reset(repl_capture);
+  if (g_job_stream.client_fd >= 0) {
+    if (job_server_write(g_job_stream.client_fd, record, len) != 0) {
+      logger_log(logger, LOG_LEVEL_WARN, "Daemon client stopped reading results: %s", strerror(errno));
+      g_job_stream.client_fd = -1;
+    }
+  } else if (!g_job_stream.relay) {
+    job_stream_reap(false);
+    if (len > INT_MAX) {
+      return false;
+    }
+    if (g_job_stream.count == g_job_stream.capacity) {
+      size_t capacity = g_job_stream.capacity ? g_job_stream.capacity * 2 : 16;
+      MPI_Request *requests = realloc(g_job_stream.requests, capacity * sizeof *requests);
+      if (requests) {
+        g_job_stream.requests = requests;
+      }
+      char **buffers = realloc(g_job_stream.buffers, capacity * sizeof *buffers);
+      if (buffers) {
+        g_job_stream.buffers = buffers;
+      }
+      if (!requests || !buffers) {
+        return false;
+      }
+      g_job_stream.capacity = capacity;
+    }
+    char *copy = dup_substring(record, len);
+    if (!copy) {
+      return false;
+    }
+    MPI_Isend(copy, (int) len, MPI_CHAR, 0, TAG_JOB_RECORD, MPI_COMM_WORLD, &g_job_stream.requests[g_job_stream.count]);
+    g_job_stream.buffers[g_job_stream.count++] = copy;
+    g_job_stream.posted++;
   }
-  if (client_ready) {
-    api_client_cleanup(&client);
+  if (g_job_stream.relay) {
+    g_job_stream.relay(g_job_stream.relay_data);
   }
+  return true;
 }
 
-static int execute_payload(ProgramConfig *config, Logger *logger, Payload *payload,
-                           StringBuffer *repl_capture) {
-  if (!config || !logger || !payload) {
-    return -1;
+/* Persists, previews, exports and (optionally) streams one successful chunk together with the duplicates
+ * that reuse its response. rank is the rank that produced the response, latency how long it took. */
+static void record_chunk_response(const ProgramConfig *config, Logger *logger, const ChunkTask *task, int rank,
+                                  double latency, const StringBuffer *response, ResponseSpool *response_stream) {
+  size_t chunk_index = task->index;
+  persist_response_to_disk(config, logger, chunk_index, rank, response);
+  log_response_preview(config, logger, chunk_index, response);
+  export_chunk_rows(config, logger, task, rank, latency, response);
+  for (size_t a = 0; a < task->alias_count; ++a) {
+    persist_alias_response(config, logger, task->aliases[a], rank, chunk_index, task->alias_similarity[a],
+                           response);
   }
-  int ready = 0;
-  if (config->rank == 0 && payload->data && payload->length > 0) {
-    ready = 1;
+  if (task->alias_count > 0) {
+    logger_log(logger, LOG_LEVEL_INFO, "Chunk %zu response reused for %zu duplicate chunk(s)", chunk_index,
+               task->alias_count);
   }
-  MPI_Bcast(&ready, 1, MPI_INT, 0, MPI_COMM_WORLD);
-  if (!ready) {
-    if (config->rank == 0 && payload->data) {
-      free(payload->data);
-      payload->data = NULL;
-      payload->length = 0;
+  if (!response_stream) {
+    return;
+  }
+  /* The assistant text is decoded here, once for the chunk and its duplicates, so the record shipped to
+   * rank 0 is the compact rendered form rather than the raw JSON. */
+  StringBuffer rendered;
+  sb_init(&rendered);
+  if (response->length > 0 && response->data) {
+    render_pretty_response_stream(response, &rendered);
+  }
+  StringBuffer record;
+  sb_init(&record);
+  sb_append_printf(&record, "----- chunk %zu (rank %d) -----\n", chunk_index, rank);
+  sb_append(&record, rendered.data ? rendered.data : "", rendered.length);
+  for (size_t a = 0; a < task->alias_count; ++a) {
+    if (task->alias_similarity[a] < 1.0) {
+      sb_append_printf(&record, "----- chunk %zu (rank %d, near-duplicate of chunk %zu, similarity %.2f) -----\n",
+                       task->aliases[a], rank, chunk_index, task->alias_similarity[a]);
+    } else {
+      sb_append_printf(&record, "----- chunk %zu (rank %d, duplicate of chunk %zu) -----\n", task->aliases[a], rank,
+                       chunk_index);
     }
-    return -1;
+    sb_append(&record, rendered.data ? rendered.data : "", rendered.length);
   }
+  sb_clean(&rendered);
+  if (job_stream_record(logger, record.data, record.length)) {
+    sb_clean(&record);
+    return;
+  }
+  bool was_spilled = response_spool_spilled(response_stream);
+  size_t queued = response_spool_length(response_stream);
+  char *error = NULL;
+  if (response_spool_add(response_stream, record.data, record.length, &error) != 0) {
+    if (response_spool_length(response_stream) > queued) {
+      logger_log(logger, LOG_LEVEL_WARN, "Rank %d cannot spool responses to disk (%s); keeping them in memory",
+                 config->rank, error ? error : "unknown error");
+    } else {
+      logger_log(logger, LOG_LEVEL_WARN, "Chunk %zu response not queued for printing: %s", chunk_index,
+                 error ? error : "unknown error");
+    }
+    free(error);
+  } else if (!was_spilled && response_spool_spilled(response_stream)) {
+    logger_log(logger, LOG_LEVEL_INFO, "Rank %d reached its %zu-byte memory budget; spooling responses to disk",
+               config->rank, memory_budget_limit());
+  }
+  sb_clean(&record);
+}
 
-  unsigned long long chunk_size64 = (unsigned long long) config->chunk_size;
-  MPI_Bcast(&chunk_size64, 1, MPI_UNSIGNED_LONG_LONG, 0, MPI_COMM_WORLD);
-  config->chunk_size = (size_t) chunk_size64;
-
-  unsigned long long max_req64 = (unsigned long long) config->max_request_bytes;
-  MPI_Bcast(&max_req64, 1, MPI_UNSIGNED_LONG_LONG, 0, MPI_COMM_WORLD);
-  config->max_request_bytes = (size_t) max_req64;
-
-  unsigned long long payload_len64 = config->rank == 0 ? (unsigned long long) payload->length : 0ULL;
-  MPI_Bcast(&payload_len64, 1, MPI_UNSIGNED_LONG_LONG, 0, MPI_COMM_WORLD);
-  size_t payload_len = (size_t) payload_len64;
+enum { TAG_RESULT_HEADER = 0x7c1, TAG_RESULT_ALIASES = 0x7c2, TAG_RESULT_BODY = 0x7c3 };
+#define RESULT_DONE ULLONG_MAX
 
-  char *shared_buffer = NULL;
-  if (config->rank == 0) {
-    shared_buffer = payload->data;
-  } else {
-    shared_buffer = malloc(payload_len + 1);
-    if (!shared_buffer) {
-      logger_log(logger, LOG_LEVEL_ERROR, "Rank %d cannot allocate %zu bytes for payload", config->rank,
-                 payload_len);
-      return -1;
+/* Worker side of --coordinator: ships one finished chunk (and its alias list) to rank 0. */
+static void forward_chunk_response(const ChunkTask *task, const StringBuffer *response, MPI_Comm comm) {
+  unsigned long long header[4] = {(unsigned long long) task->index, (unsigned long long) task->alias_count,
+                                  (unsigned long long) response->length, 0};
+  memcpy(&header[3], &g_last_chunk_seconds, sizeof(double));
+  MPI_Send(header, 4, MPI_UNSIGNED_LONG_LONG, 0, TAG_RESULT_HEADER, comm);
+  if (task->alias_count > 0) {
+    unsigned long long *aliases = malloc(task->alias_count * sizeof *aliases);
+    if (!aliases) {
+      MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
     }
+    for (size_t a = 0; a < task->alias_count; ++a) {
+      aliases[a] = (unsigned long long) task->aliases[a];
+    }
+    MPI_Send(aliases, (int) task->alias_count, MPI_UNSIGNED_LONG_LONG, 0, TAG_RESULT_ALIASES, comm);
+    MPI_Send(task->alias_similarity, (int) task->alias_count, MPI_DOUBLE, 0, TAG_RESULT_ALIASES, comm);
+    free(aliases);
   }
+  send_blob(response->data, response->length, 0, TAG_RESULT_BODY, comm);
+}
 
-  if (payload_len > 0) {
-    if (config->rank != 0) {
-      memset(shared_buffer, 0, payload_len + 1);
+/* Rank 0 side of --coordinator: records results in arrival order until every worker reports done. */
+static void coordinate_chunk_responses(const ProgramConfig *config, Logger *logger, MPI_Comm comm,
+                                       ResponseSpool *response_stream) {
+  int workers_left = config->world_size - 1;
+  while (workers_left > 0) {
+    unsigned long long header[4];
+    MPI_Status status;
+    MPI_Recv(header, 4, MPI_UNSIGNED_LONG_LONG, MPI_ANY_SOURCE, TAG_RESULT_HEADER, comm, &status);
+    if (header[0] == RESULT_DONE) {
+      workers_left--;
+      continue;
     }
-    broadcast_payload(shared_buffer, payload_len);
-    shared_buffer[payload_len] = '\0';
+    int source = status.MPI_SOURCE;
+    ChunkTask task;
+    memset(&task, 0, sizeof task);
+    task.index = (size_t) header[0];
+    task.alias_count = (size_t) header[1];
+    unsigned long long *aliases = NULL;
+    if (task.alias_count > 0) {
+      aliases = malloc(task.alias_count * sizeof *aliases);
+      task.aliases = malloc(task.alias_count * sizeof *task.aliases);
+      task.alias_similarity = malloc(task.alias_count * sizeof *task.alias_similarity);
+      if (!aliases || !task.aliases || !task.alias_similarity) {
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+      }
+      MPI_Recv(aliases, (int) task.alias_count, MPI_UNSIGNED_LONG_LONG, source, TAG_RESULT_ALIASES, comm,
+               MPI_STATUS_IGNORE);
+      MPI_Recv(task.alias_similarity, (int) task.alias_count, MPI_DOUBLE, source, TAG_RESULT_ALIASES, comm,
+               MPI_STATUS_IGNORE);
+      for (size_t a = 0; a < task.alias_count; ++a) {
+        task.aliases[a] = (size_t) aliases[a];
+      }
+    }
+    StringBuffer response;
+    response.length = (size_t) header[2];
+    response.data = recv_blob(response.length, source, TAG_RESULT_BODY, comm);
+    response.capacity = response.length + 1;
+    double latency;
+    memcpy(&latency, &header[3], sizeof latency);
+    record_chunk_response(config, logger, &task, source, latency, &response, response_stream);
+    free(response.data);
+    free(aliases);
+    free(task.aliases);
+    free(task.alias_similarity);
   }
+}
 
-  Payload shared_payload = {shared_buffer, payload_len};
-  process_chunks(config, logger, &shared_payload, repl_capture);
+static ChunkFilter g_chunk_filter;
+static ChunkCostModel g_cost_model;
+static MemoryProfile g_memory_profile;
+static unsigned long long g_payload_sequence = 0;
+static ApiClient g_warm_client;
+static bool g_warm_client_ready = false;
+static size_t g_lost_ranks = 0;
 
-  if (config->rank == 0) {
-    free(payload->data);
-    payload->data = NULL;
-    payload->length = 0;
-  } else {
-    free(shared_buffer);
+/* Sends one chunk, rebuilding the client after network errors up to network_retry_limit times. Returns 0
+ * on success, 1 when the chunk failed (network_failure tells whether the network was to blame) and -1
+ * when the client could not be rebuilt, leaving *client_ready false. */
+static int send_chunk_with_resets(const ProgramConfig *config, Logger *logger, ApiClient *client, bool *client_ready,
+                                  const ChunkTask *task, const char *data, StringBuffer *response,
+                                  bool *network_failure) {
+  size_t chunk_index = task->index;
+  const char *chunk_ptr = data + task->start;
+  size_t chunk_len = task->end - task->start;
+  int remaining_resets = config->network_retry_limit;
+  if (remaining_resets < 0) {
+    remaining_resets = 0;
+  }
+  *network_failure = false;
+  double started = MPI_Wtime();
+  for (;;) {
+    char *error = NULL;
+    ApiClientError api_error = API_CLIENT_ERROR_NONE;
+    int api_rc = api_client_send(client, chunk_ptr, chunk_len, chunk_index, response, &error, &api_error);
+    if (api_rc == 0) {
+      /* The timing feeds --cost-model history:LOG on later runs. */
+      g_last_chunk_seconds = MPI_Wtime() - started;
+      logger_log(logger, LOG_LEVEL_INFO, "Chunk %zu (%zu bytes) succeeded in %.3fs", chunk_index, chunk_len,
+                 g_last_chunk_seconds);
+      free(error);
+      return 0;
+    }
+    if (api_error == API_CLIENT_ERROR_NETWORK && remaining_resets > 0) {
+      logger_log(logger, LOG_LEVEL_WARN, "Chunk %zu network error: %s (resetting client, %d retries left)",
+                 chunk_index, error ? error : "unknown error", remaining_resets);
+      free(error);
+      remaining_resets--;
+      void (*hook)(void *) = client->progress_hook;
+      void *hook_data = client->progress_data;
+      api_client_cleanup(client);
+      char *reset_error = NULL;
+      int reset_rc = api_client_init(client, config, &reset_error);
+      if (client == &g_warm_client) {
+        g_warm_client_ready = (reset_rc == 0);
+      }
+      if (reset_rc != 0) {
+        logger_log(logger, LOG_LEVEL_ERROR, "Unable to reinitialize API client: %s",
+                   reset_error ? reset_error : "unknown error");
+        free(reset_error);
+        *client_ready = false;
+        return -1;
+      }
+      client->progress_hook = hook;
+      client->progress_data = hook_data;
+      continue;
+    }
+    logger_log(logger, LOG_LEVEL_ERROR, "Chunk %zu failed: %s", chunk_index, error ? error : "unknown error");
+    *network_failure = (api_error == API_CLIENT_ERROR_NETWORK);
+    free(error);
+    return 1;
   }
-  return 0;
 }
 
-static bool g_tui_log_from_repl = false;
-
-static bool start_tui_log_view_if_needed(ProgramConfig *config, Logger *logger, bool *tui_log_active) {
-  if (!config || !logger || !tui_log_active) {
-    return false;
+/* Retry wave N runs on a fresh client with twice the per-request retries per wave and four times the
+ * back-off delay per wave, so a provider incident has time to clear. */
+static ProgramConfig retry_wave_config(const ProgramConfig *config, int wave) {
+  ProgramConfig wave_config = *config;
+  long delay = config->retry_delay_ms > 0 ? config->retry_delay_ms : 100;
+  int retries = config->max_retries > 0 ? config->max_retries : 1;
+  for (int i = 0; i < wave; ++i) {
+    delay *= 4;
+    retries *= 2;
   }
-  if (*tui_log_active) {
-    return true;
+  wave_config.retry_delay_ms = delay;
+  wave_config.max_retries = retries;
+  return wave_config;
+}
+
+/* Copies a task together with its alias list into plan. */
+static void plan_copy_task(ChunkPlan *plan, const ChunkTask *task) {
+  ChunkTask *copy = chunk_plan_append(plan, task->index, task->start, task->end);
+  if (!copy) {
+    MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
   }
-  if (config->use_tui && config->repl_mode) {
-    if (tui_repl_attach_logger(logger)) {
-      tui_log_set_quiet(!config->tui_log_view_explicit);
-      *tui_log_active = true;
-      g_tui_log_from_repl = true;
-      return true;
+  for (size_t a = 0; a < task->alias_count; ++a) {
+    if (chunk_task_add_alias(copy, task->aliases[a], task->alias_similarity[a]) != 0) {
+      MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+  }
+}
+
+/* Failed chunks travel as [index, start, end, alias_count, (alias, similarity bits) * alias_count]. */
+static unsigned long long *encode_retry_tasks(const ChunkPlan *pending, int *length_out) {
+  size_t length = 0;
+  for (size_t i = 0; i < pending->count; ++i) {
+    length += 4 + 2 * pending->tasks[i].alias_count;
+  }
+  unsigned long long *records = malloc((length + 1) * sizeof *records);
+  if (!records || length > INT_MAX) {
+    MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+  }
+  size_t pos = 0;
+  for (size_t i = 0; i < pending->count; ++i) {
+    const ChunkTask *task = &pending->tasks[i];
+    records[pos++] = task->index;
+    records[pos++] = task->start;
+    records[pos++] = task->end;
+    records[pos++] = task->alias_count;
+    for (size_t a = 0; a < task->alias_count; ++a) {
+      records[pos++] = task->aliases[a];
+      memcpy(&records[pos++], &task->alias_similarity[a], sizeof(double));
+    }
+  }
+  *length_out = (int) length;
+  return records;
+}
+
+/* Takes every size-th record starting at rank, so the failed chunks spread evenly. Returns the total. */
+static size_t decode_retry_share(const unsigned long long *records, size_t length, int rank, int size,
+                                 ChunkPlan *share) {
+  size_t pos = 0;
+  size_t entry = 0;
+  while (pos + 4 <= length) {
+    size_t alias_count = (size_t) records[pos + 3];
+    if (entry % (size_t) size == (size_t) rank) {
+      ChunkTask *task = chunk_plan_append(share, (size_t) records[pos], (size_t) records[pos + 1],
+                                          (size_t) records[pos + 2]);
+      if (!task) {
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+      }
+      for (size_t a = 0; a < alias_count; ++a) {
+        double similarity;
+        memcpy(&similarity, &records[pos + 5 + 2 * a], sizeof similarity);
+        if (chunk_task_add_alias(task, (size_t) records[pos + 4 + 2 * a], similarity) != 0) {
+          MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+      }
+    }
+    pos += 4 + 2 * alias_count;
+    entry++;
+  }
+  return entry;
+}
+
+/* Collective over wave_comm. Chunks that failed with a transient error are gathered after the main pass
+ * and dealt round-robin over every rank of wave_comm, up to retry_waves times. Results are recorded
+ * locally or, when forward is set, sent to the coordinator over result_comm. recovered counts the
+ * chunk and alias failures that a wave turned into successes, recovered_chunks the chunks themselves. */
+static void run_retry_waves(const ProgramConfig *config, Logger *logger, const Payload *payload, ChunkPlan *pending,
+                            MPI_Comm wave_comm, MPI_Comm result_comm, bool forward, ResponseSpool *response_stream,
+                            size_t *recovered, size_t *recovered_chunks) {
+  int rank = 0;
+  int size = 1;
+  MPI_Comm_rank(wave_comm, &rank);
+  MPI_Comm_size(wave_comm, &size);
+  int *lengths = malloc((size_t) size * sizeof *lengths);
+  int *displs = malloc((size_t) size * sizeof *displs);
+  if (!lengths || !displs) {
+    MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+  }
+  for (int wave = 1; wave <= config->retry_waves; ++wave) {
+    int local_length = 0;
+    unsigned long long *records = encode_retry_tasks(pending, &local_length);
+    MPI_Allgather(&local_length, 1, MPI_INT, lengths, 1, MPI_INT, wave_comm);
+    size_t total = 0;
+    for (int r = 0; r < size; ++r) {
+      displs[r] = (int) total;
+      total += (size_t) lengths[r];
+    }
+    if (total == 0) {
+      free(records);
+      break;
+    }
+    unsigned long long *all = malloc(total * sizeof *all);
+    if (!all || total > INT_MAX) {
+      MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    MPI_Allgatherv(records, local_length, MPI_UNSIGNED_LONG_LONG, all, lengths, displs, MPI_UNSIGNED_LONG_LONG,
+                   wave_comm);
+    free(records);
+    chunk_plan_free(pending);
+    ChunkPlan share;
+    chunk_plan_init(&share);
+    size_t entries = decode_retry_share(all, total, rank, size, &share);
+    free(all);
+    if (rank == 0) {
+      logger_log(logger, LOG_LEVEL_WARN, "Retry wave %d: redistributing %zu failed chunk(s) across %d rank(s)", wave,
+                 entries, size);
+    }
+
+    ProgramConfig wave_config = retry_wave_config(config, wave);
+    ApiClient client;
+    bool client_ready = false;
+    if (share.count > 0) {
+      char *client_error = NULL;
+      client_ready = (api_client_init(&client, &wave_config, &client_error) == 0);
+      if (!client_ready) {
+        logger_log(logger, LOG_LEVEL_ERROR, "Retry wave %d client init failed: %s", wave,
+                   client_error ? client_error : "unknown");
+        free(client_error);
+      }
+    }
+    StringBuffer response;
+    sb_init(&response);
+    for (size_t i = 0; i < share.count; ++i) {
+      const ChunkTask *task = &share.tasks[i];
+      bool network_failure = true;
+      int rc = client_ready ? send_chunk_with_resets(&wave_config, logger, &client, &client_ready, task,
+                                                     payload->data, &response, &network_failure)
+                            : -1;
+      if (rc == 0) {
+        *recovered += 1 + task->alias_count;
+        (*recovered_chunks)++;
+        if (forward) {
+          forward_chunk_response(task, &response, result_comm);
+        } else {
+          record_chunk_response(config, logger, task, config->rank, g_last_chunk_seconds, &response, response_stream);
+        }
+      } else if ((rc < 0 || network_failure) && wave < config->retry_waves) {
+        plan_copy_task(pending, task);
+      } else {
+        export_chunk_rows(config, logger, task, config->rank, -1.0, NULL);
+      }
+    }
+    sb_clean(&response);
+    if (client_ready) {
+      api_client_cleanup(&client);
+    }
+    chunk_plan_free(&share);
+  }
+  free(lengths);
+  free(displs);
+}
+
+enum {
+  TAG_WORK_REQUEST = 0x7d1,
+  TAG_WORK_ASSIGN = 0x7d2,
+  TAG_WORK_RESULT = 0x7d3,
+  TAG_WORK_BODY = 0x7d4,
+  TAG_HEARTBEAT = 0x7d5
+};
+enum { WORK_OK = 0, WORK_FAILED, WORK_FAILED_NETWORK, WORK_ABANDONED };
+
+typedef struct {
+  MPI_Comm comm;
+  double interval;
+  double last_sent;
+} Heartbeat;
+
+static void send_heartbeat(void *data) {
+  Heartbeat *beat = data;
+  double now = MPI_Wtime();
+  if (now - beat->last_sent < beat->interval) {
+    return;
+  }
+  beat->last_sent = now;
+  int alive = 1;
+  MPI_Send(&alive, 1, MPI_INT, 0, TAG_HEARTBEAT, beat->comm);
+}
+
+/* Worker side of --resilient: takes one chunk at a time from rank 0 and reports each result (which also
+ * asks for the next chunk) until rank 0 answers RESULT_DONE. A heartbeat goes out from curl's progress
+ * callback while a request is in flight so rank 0 can tell a slow chunk from a dead rank. */
+static void serve_resilient_chunks(const ProgramConfig *config, Logger *logger, ApiClient *client, bool *client_ready,
+                                   const Payload *payload, StringBuffer *response, MPI_Comm comm) {
+  Heartbeat beat = {comm, (double) config->fault_timeout_seconds / 4.0, MPI_Wtime()};
+  int ready = *client_ready ? 1 : 0;
+  MPI_Send(&ready, 1, MPI_INT, 0, TAG_WORK_REQUEST, comm);
+  if (!ready) {
+    return;
+  }
+  client->progress_hook = send_heartbeat;
+  client->progress_data = &beat;
+  ProgramConfig wave_config;
+  ApiClient wave_client;
+  bool wave_ready = false;
+  int wave_level = 0;
+  for (;;) {
+    unsigned long long assignment[4];
+    MPI_Recv(assignment, 4, MPI_UNSIGNED_LONG_LONG, 0, TAG_WORK_ASSIGN, comm, MPI_STATUS_IGNORE);
+    if (assignment[0] == RESULT_DONE) {
+      break;
+    }
+    int wave = (int) assignment[3];
+    if (wave > 0 && wave != wave_level) {
+      if (wave_ready) {
+        api_client_cleanup(&wave_client);
+      }
+      wave_config = retry_wave_config(config, wave);
+      char *wave_error = NULL;
+      wave_ready = (api_client_init(&wave_client, &wave_config, &wave_error) == 0);
+      if (wave_ready) {
+        wave_client.progress_hook = send_heartbeat;
+        wave_client.progress_data = &beat;
+      } else {
+        logger_log(logger, LOG_LEVEL_WARN, "Retry wave %d client init failed (%s); reusing the main client", wave,
+                   wave_error ? wave_error : "unknown");
+        free(wave_error);
+      }
+      wave_level = wave;
+    }
+    bool use_wave = wave > 0 && wave_ready;
+    ChunkTask task;
+    memset(&task, 0, sizeof task);
+    task.index = (size_t) assignment[0];
+    task.start = (size_t) assignment[1];
+    task.end = (size_t) assignment[2];
+    bool network_failure = false;
+    int rc = send_chunk_with_resets(use_wave ? &wave_config : config, logger, use_wave ? &wave_client : client,
+                                    use_wave ? &wave_ready : client_ready, &task, payload->data, response,
+                                    &network_failure);
+    unsigned long long status = WORK_OK;
+    if (rc < 0) {
+      status = use_wave ? WORK_FAILED_NETWORK : WORK_ABANDONED;
+    } else if (rc > 0) {
+      status = network_failure ? WORK_FAILED_NETWORK : WORK_FAILED;
+    }
+    unsigned long long header[4] = {assignment[0], status, rc == 0 ? (unsigned long long) response->length : 0, 0};
+    memcpy(&header[3], &g_last_chunk_seconds, sizeof(double));
+    MPI_Send(header, 4, MPI_UNSIGNED_LONG_LONG, 0, TAG_WORK_RESULT, comm);
+    if (rc == 0) {
+      send_blob(response->data, response->length, 0, TAG_WORK_BODY, comm);
+    }
+    if (status == WORK_ABANDONED) {
+      break;
+    }
+  }
+  if (wave_ready) {
+    api_client_cleanup(&wave_client);
+  }
+  if (*client_ready) {
+    client->progress_hook = NULL;
+    client->progress_data = NULL;
+  }
+}
+
+typedef enum { WORKER_STARTING = 0, WORKER_WAITING, WORKER_BUSY, WORKER_LOST, WORKER_RETIRED } WorkerState;
+
+typedef struct {
+  WorkerState state;
+  size_t task_pos;
+  double last_seen;
+  /* Reported failed by ULFM, as opposed to lost to the fault timeout. */
+  bool failed;
+} WorkerSlot;
+
+typedef struct {
+  size_t *items;
+  size_t length;
+  size_t capacity;
+} TaskQueue;
+
+typedef struct {
+  ChunkPlan *plan;
+  WorkerSlot *slots;
+  bool *completed;
+  int *waves;
+  TaskQueue queue;
+  TaskQueue deferred;
+  int live;
+  size_t lost;
+} Dispatcher;
+
+static void task_queue_push(TaskQueue *queue, size_t task_pos) {
+  if (queue->length == queue->capacity) {
+    size_t new_cap = queue->capacity ? queue->capacity * 2 : 16;
+    size_t *grown = realloc(queue->items, new_cap * sizeof *grown);
+    if (!grown) {
+      MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    queue->items = grown;
+    queue->capacity = new_cap;
+  }
+  queue->items[queue->length++] = task_pos;
+}
+
+static void dispatcher_requeue(Dispatcher *dispatcher, size_t task_pos) {
+  if (!dispatcher->completed[task_pos]) {
+    task_queue_push(&dispatcher->queue, task_pos);
+  }
+}
+
+static void dispatcher_mark_lost(Dispatcher *dispatcher, Logger *logger, int rank, const char *reason) {
+  WorkerSlot *slot = &dispatcher->slots[rank];
+  if (slot->state == WORKER_LOST || slot->state == WORKER_RETIRED) {
+    return;
+  }
+  if (slot->state == WORKER_BUSY && !dispatcher->completed[slot->task_pos]) {
+    logger_log(logger, LOG_LEVEL_WARN, "Rank %d lost (%s); requeueing chunk %zu", rank, reason,
+               dispatcher->plan->tasks[slot->task_pos].index);
+    dispatcher_requeue(dispatcher, slot->task_pos);
+  } else {
+    logger_log(logger, LOG_LEVEL_WARN, "Rank %d lost (%s)", rank, reason);
+  }
+  slot->state = WORKER_LOST;
+  dispatcher->live--;
+  dispatcher->lost++;
+}
+
+#ifdef DEEPSEEK_HAVE_ULFM
+/* Acknowledges the process failures ULFM reported on comm and retires the matching workers. */
+static void dispatcher_collect_failures(Dispatcher *dispatcher, Logger *logger, MPI_Comm comm) {
+  MPI_Group failed = MPI_GROUP_NULL;
+  MPI_Group everyone = MPI_GROUP_NULL;
+  MPIX_Comm_failure_ack(comm);
+  MPIX_Comm_failure_get_acked(comm, &failed);
+  MPI_Comm_group(comm, &everyone);
+  int count = 0;
+  MPI_Group_size(failed, &count);
+  for (int i = 0; i < count; ++i) {
+    int rank = MPI_UNDEFINED;
+    MPI_Group_translate_ranks(failed, 1, &i, everyone, &rank);
+    if (rank != MPI_UNDEFINED && rank > 0) {
+      dispatcher_mark_lost(dispatcher, logger, rank, "process failure reported by MPI");
+      dispatcher->slots[rank].failed = true;
+    }
+  }
+  MPI_Group_free(&failed);
+  MPI_Group_free(&everyone);
+}
+#endif
+
+/* A rank lost to the fault timeout may only have been slow. It still owes the result of the chunk it held
+ * and then waits for another assignment, so its late result (and any heartbeats before it) is drained and
+ * dropped and it is sent RESULT_DONE; it then leaves serve_resilient_chunks and finalizes like the rest.
+ * A rank that stays silent for another fault timeout is given up on and stays counted as lost. */
+static void dispatcher_release_stragglers(Dispatcher *dispatcher, Logger *logger, MPI_Comm comm, int size,
+                                          double timeout) {
+  int owed = 0;
+  for (int r = 1; r < size; ++r) {
+    if (dispatcher->slots[r].state == WORKER_LOST && !dispatcher->slots[r].failed) {
+      dispatcher->slots[r].last_seen = MPI_Wtime();
+      owed++;
+    }
+  }
+  if (owed > 0) {
+    logger_log(logger, LOG_LEVEL_INFO, "Waiting up to %.0f s for %d timed-out rank(s) to report back", timeout,
+               owed);
+  }
+  while (owed > 0) {
+    int flag = 0;
+    MPI_Status status;
+    int probe_rc = MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, comm, &flag, &status);
+#ifdef DEEPSEEK_HAVE_ULFM
+    if (probe_rc != MPI_SUCCESS) {
+      dispatcher_collect_failures(dispatcher, logger, comm);
+      owed = 0;
+      for (int r = 1; r < size; ++r) {
+        owed += dispatcher->slots[r].state == WORKER_LOST && !dispatcher->slots[r].failed;
+      }
+      continue;
+    }
+#else
+    (void) probe_rc;
+#endif
+    if (!flag) {
+      double now = MPI_Wtime();
+      for (int r = 1; r < size; ++r) {
+        WorkerSlot *slot = &dispatcher->slots[r];
+        if (slot->state == WORKER_LOST && !slot->failed && now - slot->last_seen > timeout) {
+          logger_log(logger, LOG_LEVEL_WARN, "Rank %d never reported back; giving up on it", r);
+          slot->failed = true;
+          owed--;
+        }
+      }
+      struct timespec pause = {0, 1000000L};
+      nanosleep(&pause, NULL);
+      continue;
+    }
+    int source = status.MPI_SOURCE;
+    WorkerSlot *slot = &dispatcher->slots[source];
+    slot->last_seen = MPI_Wtime();
+    if (status.MPI_TAG == TAG_HEARTBEAT || status.MPI_TAG == TAG_WORK_REQUEST) {
+      int ignored = 0;
+      MPI_Recv(&ignored, 1, MPI_INT, source, status.MPI_TAG, comm, MPI_STATUS_IGNORE);
+      continue;
+    }
+    unsigned long long header[4];
+    MPI_Recv(header, 4, MPI_UNSIGNED_LONG_LONG, source, status.MPI_TAG, comm, MPI_STATUS_IGNORE);
+    if (status.MPI_TAG != TAG_WORK_RESULT) {
+      continue;
+    }
+    if (header[1] == WORK_OK) {
+      free(recv_blob((size_t) header[2], source, TAG_WORK_BODY, comm));
+    }
+    logger_log(logger, LOG_LEVEL_INFO, "Rank %d reported back after its chunk %llu was reassigned; releasing it",
+               source, header[0]);
+    /* An abandoned worker has already left its loop and expects nothing more. */
+    if (header[1] != WORK_ABANDONED) {
+      unsigned long long done[4] = {RESULT_DONE, 0, 0, 0};
+      MPI_Send(done, 4, MPI_UNSIGNED_LONG_LONG, source, TAG_WORK_ASSIGN, comm);
+    }
+    if (slot->state == WORKER_LOST && !slot->failed) {
+      slot->state = WORKER_RETIRED;
+      dispatcher->lost--;
+      owed--;
+    }
+  }
+}
+
+/* Rank 0 side of --resilient. Chunks are handed out one at a time, so a lost rank only ever holds one
+ * unfinished chunk, which goes back to the queue. A rank counts as lost when ULFM reports it failed or
+ * when it stays silent for fault_timeout_seconds while holding a chunk; a rank that speaks again after
+ * that is taken back and whichever copy of its chunk finishes first wins. Chunks that fail with a
+ * transient error are set aside and handed out again, on the retry-wave back-off, once the queue drains. */
+static void dispatch_resilient_chunks(const ProgramConfig *config, Logger *logger, ChunkPlan *plan,
+                                      const size_t *order, MPI_Comm comm, ResponseSpool *response_stream,
+                                      size_t *processed, size_t *failures, size_t *network_failures,
+                                      size_t *recovered_chunks) {
+  Dispatcher dispatcher;
+  memset(&dispatcher, 0, sizeof dispatcher);
+  dispatcher.plan = plan;
+  dispatcher.slots = calloc((size_t) config->world_size, sizeof *dispatcher.slots);
+  dispatcher.completed = calloc(plan->count + 1, sizeof *dispatcher.completed);
+  dispatcher.waves = calloc(plan->count + 1, sizeof *dispatcher.waves);
+  if (!dispatcher.slots || !dispatcher.completed || !dispatcher.waves) {
+    MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+  }
+  /* The queue pops from the back, so it is filled in reverse of the order chunks should go out in. */
+  size_t remaining = 0;
+  for (size_t k = plan->count; k-- > 0;) {
+    size_t i = order ? order[k] : k;
+    if (!plan->tasks[i].skip) {
+      task_queue_push(&dispatcher.queue, i);
+      remaining++;
+    }
+  }
+  dispatcher.slots[0].state = WORKER_RETIRED;
+  dispatcher.live = config->world_size - 1;
+  double timeout = (double) config->fault_timeout_seconds;
+#ifdef DEEPSEEK_HAVE_ULFM
+  MPI_Errhandler previous_handler;
+  MPI_Comm_get_errhandler(comm, &previous_handler);
+  MPI_Comm_set_errhandler(comm, MPI_ERRORS_RETURN);
+#endif
+
+  while (dispatcher.live > 0) {
+    int busy = 0;
+    for (int r = 1; r < config->world_size; ++r) {
+      busy += dispatcher.slots[r].state == WORKER_BUSY;
+    }
+    for (int r = 1; r < config->world_size; ++r) {
+      WorkerSlot *slot = &dispatcher.slots[r];
+      if (slot->state != WORKER_WAITING) {
+        continue;
+      }
+      TaskQueue *queue = &dispatcher.queue;
+      while (queue->length > 0 && dispatcher.completed[queue->items[queue->length - 1]]) {
+        queue->length--;
+      }
+      if (queue->length == 0 && dispatcher.deferred.length > 0) {
+        logger_log(logger, LOG_LEVEL_WARN, "Retry wave: handing out %zu failed chunk(s) again",
+                   dispatcher.deferred.length);
+        for (size_t d = dispatcher.deferred.length; d-- > 0;) {
+          dispatcher.waves[dispatcher.deferred.items[d]]++;
+          dispatcher_requeue(&dispatcher, dispatcher.deferred.items[d]);
+        }
+        dispatcher.deferred.length = 0;
+      }
+      /* Waiting workers past the --max-inflight window stay parked until a busy one reports back. */
+      bool window_full = config->max_inflight > 0 && busy >= config->max_inflight;
+      if (queue->length > 0 && !window_full) {
+        size_t pos = queue->items[--queue->length];
+        const ChunkTask *task = &plan->tasks[pos];
+        unsigned long long assignment[4] = {(unsigned long long) task->index, (unsigned long long) task->start,
+                                            (unsigned long long) task->end, (unsigned long long) dispatcher.waves[pos]};
+        MPI_Send(assignment, 4, MPI_UNSIGNED_LONG_LONG, r, TAG_WORK_ASSIGN, comm);
+        slot->state = WORKER_BUSY;
+        slot->task_pos = pos;
+        slot->last_seen = MPI_Wtime();
+        busy++;
+      } else if (remaining == 0) {
+        unsigned long long done[4] = {RESULT_DONE, 0, 0, 0};
+        MPI_Send(done, 4, MPI_UNSIGNED_LONG_LONG, r, TAG_WORK_ASSIGN, comm);
+        slot->state = WORKER_RETIRED;
+        dispatcher.live--;
+      }
+    }
+    if (dispatcher.live == 0) {
+      break;
+    }
+
+    int flag = 0;
+    MPI_Status status;
+    int probe_rc = MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, comm, &flag, &status);
+#ifdef DEEPSEEK_HAVE_ULFM
+    if (probe_rc != MPI_SUCCESS) {
+      dispatcher_collect_failures(&dispatcher, logger, comm);
+      continue;
+    }
+#else
+    (void) probe_rc;
+#endif
+    if (!flag) {
+      double now = MPI_Wtime();
+      for (int r = 1; r < config->world_size; ++r) {
+        if (dispatcher.slots[r].state == WORKER_BUSY && now - dispatcher.slots[r].last_seen > timeout) {
+          dispatcher_mark_lost(&dispatcher, logger, r, "no heartbeat within fault timeout");
+        }
+      }
+      struct timespec pause = {0, 1000000L};
+      nanosleep(&pause, NULL);
+      continue;
+    }
+
+    int source = status.MPI_SOURCE;
+    WorkerSlot *slot = &dispatcher.slots[source];
+    if (slot->state == WORKER_LOST) {
+      logger_log(logger, LOG_LEVEL_WARN, "Rank %d answered again after being declared lost; taking it back",
+                 source);
+      slot->state = WORKER_BUSY;
+      dispatcher.live++;
+      dispatcher.lost--;
+    }
+    slot->last_seen = MPI_Wtime();
+
+    if (status.MPI_TAG == TAG_HEARTBEAT) {
+      int alive = 0;
+      MPI_Recv(&alive, 1, MPI_INT, source, TAG_HEARTBEAT, comm, MPI_STATUS_IGNORE);
+    } else if (status.MPI_TAG == TAG_WORK_REQUEST) {
+      int ready = 0;
+      MPI_Recv(&ready, 1, MPI_INT, source, TAG_WORK_REQUEST, comm, MPI_STATUS_IGNORE);
+      if (ready) {
+        slot->state = WORKER_WAITING;
+      } else {
+        logger_log(logger, LOG_LEVEL_WARN, "Rank %d has no API client and takes no chunks", source);
+        slot->state = WORKER_RETIRED;
+        dispatcher.live--;
+      }
+    } else if (status.MPI_TAG == TAG_WORK_RESULT) {
+      unsigned long long header[4];
+      MPI_Recv(header, 4, MPI_UNSIGNED_LONG_LONG, source, TAG_WORK_RESULT, comm, MPI_STATUS_IGNORE);
+      StringBuffer response = {NULL, 0, 0};
+      if (header[1] == WORK_OK) {
+        response.length = (size_t) header[2];
+        response.data = recv_blob(response.length, source, TAG_WORK_BODY, comm);
+        response.capacity = response.length + 1;
+      }
+      ChunkTask *task = chunk_plan_find(plan, (size_t) header[0]);
+      size_t pos = task ? (size_t) (task - plan->tasks) : 0;
+      if (header[1] == WORK_ABANDONED) {
+        if (task) {
+          dispatcher_requeue(&dispatcher, pos);
+        }
+        slot->state = WORKER_RETIRED;
+        dispatcher.live--;
+      } else {
+        slot->state = WORKER_WAITING;
+      }
+      if (!task || header[1] == WORK_ABANDONED) {
+        free(response.data);
+        continue;
+      }
+      if (dispatcher.completed[pos]) {
+        logger_log(logger, LOG_LEVEL_DEBUG, "Dropping late duplicate result for chunk %zu from rank %d",
+                   task->index, source);
+        free(response.data);
+        continue;
+      }
+      if (header[1] == WORK_FAILED_NETWORK && dispatcher.waves[pos] < config->retry_waves) {
+        task_queue_push(&dispatcher.deferred, pos);
+        free(response.data);
+        continue;
+      }
+      dispatcher.completed[pos] = true;
+      remaining--;
+      (*processed)++;
+      if (header[1] == WORK_OK) {
+        double latency;
+        memcpy(&latency, &header[3], sizeof latency);
+        record_chunk_response(config, logger, task, source, latency, &response, response_stream);
+        if (dispatcher.waves[pos] > 0) {
+          (*recovered_chunks)++;
+        }
+      } else {
+        export_chunk_rows(config, logger, task, source, -1.0, NULL);
+        *failures += 1 + task->alias_count;
+        if (header[1] == WORK_FAILED_NETWORK) {
+          (*network_failures)++;
+        }
+      }
+      free(response.data);
+      if (config->show_progress && config->progress_interval > 0 &&
+          (*processed % (size_t) config->progress_interval == 0)) {
+        logger_log(logger, LOG_LEVEL_INFO, "Progress: %zu chunks processed, %zu remaining", *processed,
+                   remaining);
+      }
+    }
+  }
+
+  if (remaining > 0) {
+    logger_log(logger, LOG_LEVEL_ERROR, "No workers left; %zu chunk(s) were not processed", remaining);
+    for (size_t i = 0; i < plan->count; ++i) {
+      if (!plan->tasks[i].skip && !dispatcher.completed[i]) {
+        *failures += 1 + plan->tasks[i].alias_count;
+      }
+    }
+  }
+  dispatcher_release_stragglers(&dispatcher, logger, comm, config->world_size, timeout);
+  if (dispatcher.lost > 0) {
+    logger_log(logger, LOG_LEVEL_WARN, "Finished after losing %zu rank(s); their unfinished chunks were reassigned",
+               dispatcher.lost);
+  }
+  g_lost_ranks += dispatcher.lost;
+#ifdef DEEPSEEK_HAVE_ULFM
+  MPI_Comm_set_errhandler(comm, previous_handler);
+  MPI_Errhandler_free(&previous_handler);
+#endif
+  free(dispatcher.slots);
+  free(dispatcher.completed);
+  free(dispatcher.waves);
+  free(dispatcher.queue.items);
+  free(dispatcher.deferred.items);
+}
+
+/* Rank 0 predicts the cost of every chunk and, when broadcast is set, shares the list so each rank derives
+ * the same longest-first partition. Returns NULL on every rank when no cost model is active. */
+static double *share_chunk_costs(const ProgramConfig *config, const Payload *payload, bool broadcast,
+                                 MPI_Comm comm) {
+  int active = config->rank == 0 && chunk_cost_active(&g_cost_model) && config->chunk_size > 0;
+  if (broadcast) {
+    MPI_Bcast(&active, 1, MPI_INT, 0, comm);
+  }
+  if (!active) {
+    return NULL;
+  }
+  size_t chunk_count = (payload->length + config->chunk_size - 1) / config->chunk_size;
+  double *costs = malloc((chunk_count + 1) * sizeof *costs);
+  if (!costs || chunk_count > INT_MAX) {
+    MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+  }
+  if (config->rank == 0) {
+    for (size_t i = 0; i < chunk_count; ++i) {
+      size_t start = i * config->chunk_size;
+      size_t end = start + config->chunk_size < payload->length ? start + config->chunk_size : payload->length;
+      costs[i] = chunk_cost_predict(&g_cost_model, i, payload->data + start, end - start);
+    }
+  }
+  if (broadcast) {
+    MPI_Bcast(costs, (int) chunk_count, MPI_DOUBLE, 0, comm);
+  }
+  return costs;
+}
+
+static void process_chunks(const ProgramConfig *config, Logger *logger, const Payload *payload,
+                           StringBuffer *repl_capture, MPI_Comm comm) {
+  if (!config || !payload) {
+    return;
+  }
+  /* With a dedicated coordinator the chunks are dealt over ranks 1..N-1 and rank 0 keeps an empty plan.
+   * In resilient mode rank 0 holds the whole plan instead and hands chunks out on request. */
+  bool resilient = config->resilient_mode && config->world_size > 1;
+  bool coordinated = (config->coordinator_mode || resilient) && config->world_size > 1;
+  bool coordinator = coordinated && config->rank == 0;
+  int plan_rank = coordinated ? config->rank - 1 : config->rank;
+  int plan_size = coordinated ? config->world_size - 1 : config->world_size;
+  if (resilient) {
+    plan_rank = 0;
+    plan_size = 1;
+  } else if (config->max_inflight > 0 && config->max_inflight < plan_size) {
+    /* Workers past the in-flight window get no chunks, so at most max_inflight requests run at once. */
+    plan_size = config->max_inflight;
+  }
+  bool owns_plan = resilient ? coordinator : (!coordinator && plan_rank < plan_size);
+  double *costs = share_chunk_costs(config, payload, !resilient, comm);
+  ChunkPlan plan;
+  chunk_plan_init(&plan);
+  int plan_rc = 0;
+  if (owns_plan && costs) {
+    plan_rc = chunk_plan_build_balanced(&plan, config->chunk_size, payload->length, plan_rank, plan_size, costs);
+  } else if (owns_plan) {
+    plan_rc = chunk_plan_build(&plan, config->chunk_size, payload->length, plan_rank, plan_size);
+  }
+  bool cost_ordered = costs != NULL;
+  free(costs);
+  if (plan_rc != 0) {
+    logger_log(logger, LOG_LEVEL_ERROR, "Rank %d cannot allocate its chunk plan", config->rank);
+    chunk_plan_free(&plan);
+  }
+  MPI_Comm dedup_comm = resilient ? MPI_COMM_SELF : comm;
+  size_t filtered = 0;
+  /* While the payload is still arriving, chunks are filtered as the loop reaches them. */
+  bool filter_in_loop = g_chunk_filter.active && payload->arrival;
+  if (g_chunk_filter.active && !filter_in_loop) {
+    for (size_t i = 0; i < plan.count; ++i) {
+      ChunkTask *task = &plan.tasks[i];
+      if (!chunk_filter_matches(&g_chunk_filter, payload->data + task->start, task->end - task->start)) {
+        task->skip = true;
+        filtered++;
+      }
+    }
+  }
+  /* A pipelined broadcast has only reached rank 0 in full, so rank 0 runs the dedup passes over every
+   * chunk on its own and shares the verdicts afterwards. */
+  bool dedup_on_root = payload->arrival && (config->dedup_chunks || config->near_dedup);
+  ChunkPlan root_plan;
+  chunk_plan_init(&root_plan);
+  ChunkPlan *dedup_plan = &plan;
+  if (dedup_on_root) {
+    dedup_comm = MPI_COMM_SELF;
+    dedup_plan = config->rank == 0 ? &root_plan : NULL;
+    if (dedup_plan && chunk_plan_build(dedup_plan, config->chunk_size, payload->length, 0, 1) != 0) {
+      MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    for (size_t i = 0; dedup_plan && g_chunk_filter.active && i < dedup_plan->count; ++i) {
+      ChunkTask *task = &dedup_plan->tasks[i];
+      task->skip = !chunk_filter_matches(&g_chunk_filter, payload->data + task->start, task->end - task->start);
+    }
+  }
+  size_t deduplicated = 0;
+  if (config->dedup_chunks && dedup_plan) {
+    char *dedup_error = NULL;
+    if (chunk_dedup_exchange(dedup_plan, payload->data, dedup_comm, &deduplicated, &dedup_error) != 0) {
+      logger_log(logger, LOG_LEVEL_WARN, "Chunk dedup skipped: %s", dedup_error ? dedup_error : "unknown error");
+    } else if (config->rank == 0 && deduplicated > 0) {
+      logger_log(logger, LOG_LEVEL_INFO, "Deduplicated %zu identical chunks; their responses will be reused",
+                 deduplicated);
+    }
+    free(dedup_error);
+  }
+  if (config->near_dedup && dedup_plan) {
+    size_t clustered = 0;
+    char *near_error = NULL;
+    if (chunk_dedup_near_exchange(dedup_plan, payload->data, config->near_dedup_threshold, dedup_comm, &clustered,
+                                  &near_error) != 0) {
+      logger_log(logger, LOG_LEVEL_WARN, "Near-duplicate detection skipped: %s",
+                 near_error ? near_error : "unknown error");
+    } else if (config->rank == 0) {
+      logger_log(logger, LOG_LEVEL_INFO, "Near-duplicate detection folded %zu chunks (similarity >= %d%%)",
+                 clustered, config->near_dedup_threshold);
+    }
+    deduplicated += clustered;
+    free(near_error);
+  }
+  if (dedup_on_root) {
+    char *share_error = NULL;
+    if (chunk_dedup_share_verdicts(&plan, dedup_plan, comm, NULL, &share_error) != 0) {
+      logger_log(logger, LOG_LEVEL_WARN, "Rank %d kept its duplicates: %s", config->rank,
+                 share_error ? share_error : "unknown error");
+      deduplicated = 0;
+    }
+    free(share_error);
+    chunk_plan_free(&root_plan);
+  }
+  /* Balanced plans carry costs; start with the costliest chunks so no rank finishes on a long one. */
+  size_t *order = NULL;
+  if (cost_ordered && chunk_plan_cost_order(&plan, &order) != 0) {
+    MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+  }
+
+  ApiClient local_client;
+  ApiClient *client = config->daemon_mode ? &g_warm_client : &local_client;
+  char *client_error = NULL;
+  bool client_ready = false;
+  if (coordinator) {
+    client_ready = false;
+  } else if (config->daemon_mode && g_warm_client_ready) {
+    client_ready = (api_client_rebind(client, config, &client_error) == 0);
+  } else {
+    client_ready = (api_client_init(client, config, &client_error) == 0);
+    if (config->daemon_mode) {
+      g_warm_client_ready = client_ready;
+    }
+  }
+  if (!client_ready && !coordinator) {
+    logger_log(logger, LOG_LEVEL_ERROR, "API client init failed: %s", client_error ? client_error : "unknown");
+    free(client_error);
+  }
+
+  StringBuffer response;
+  bool response_ready = false;
+  if (client_ready) {
+    sb_init(&response);
+    response_ready = true;
+  }
+
+  bool stream_enabled = config->repl_mode || config->daemon_mode || config->stream_mode;
+  ResponseSpool response_stream;
+  if (stream_enabled) {
+    response_spool_init(&response_stream);
+  }
+
+  size_t processed = 0;
+  size_t failures = 0;
+  size_t network_failures = 0;
+  ChunkPlan pending;
+  chunk_plan_init(&pending);
+
+  bool hooked_broadcast = payload->arrival && client_ready && !client->progress_hook;
+  if (hooked_broadcast) {
+    client->progress_hook = progress_payload_broadcast;
+    client->progress_data = payload->arrival;
+  }
+  bool first_chunk = true;
+  for (size_t task_pos = 0; client_ready && !resilient && task_pos < plan.count; ++task_pos) {
+    ChunkTask *task = &plan.tasks[order ? order[task_pos] : task_pos];
+    if (task->skip) {
+      continue;
+    }
+    payload_wait(payload, task->end);
+    if (first_chunk && payload->arrival) {
+      logger_log(logger, LOG_LEVEL_DEBUG, "Rank %d starts chunk %zu %.3f s into the broadcast (%zu of %zu bytes in)",
+                 config->rank, task->index, MPI_Wtime() - payload->arrival->started_at,
+                 segmented_bcast_arrived(payload->arrival), payload->length);
+    }
+    first_chunk = false;
+    if (filter_in_loop &&
+        !chunk_filter_matches(&g_chunk_filter, payload->data + task->start, task->end - task->start)) {
+      task->skip = true;
+      filtered++;
+      continue;
+    }
+    bool network_failure = false;
+    int rc = send_chunk_with_resets(config, logger, client, &client_ready, task, payload->data,
+                                    response_ready ? &response : NULL, &network_failure);
+    if (rc < 0) {
+      break;
+    }
+    if (rc > 0) {
+      if (network_failure) {
+        network_failures++;
+        if (config->retry_waves > 0) {
+          plan_copy_task(&pending, task);
+        }
+      }
+      if (!network_failure || config->retry_waves == 0) {
+        export_chunk_rows(config, logger, task, config->rank, -1.0, NULL);
+      }
+      failures += 1 + task->alias_count;
+    } else if (response_ready && coordinated) {
+      forward_chunk_response(task, &response, comm);
+    } else if (response_ready) {
+      record_chunk_response(config, logger, task, config->rank, g_last_chunk_seconds, &response,
+                            stream_enabled ? &response_stream : NULL);
+    }
+
+    processed++;
+    if (config->show_progress && config->progress_interval > 0 &&
+        (processed % (size_t) config->progress_interval == 0)) {
+      logger_log(logger, LOG_LEVEL_INFO, "Progress: %zu chunks processed on rank %d", processed, config->rank);
+    }
+  }
+
+  if (hooked_broadcast) {
+    client->progress_hook = NULL;
+    client->progress_data = NULL;
+  }
+  /* Retry waves may hand any chunk to any rank, so the whole payload has to be in place from here on. */
+  if (payload->arrival) {
+    segmented_bcast_finish(payload->arrival);
+  }
+
+  size_t recovered = 0;
+  size_t recovered_chunks = 0;
+  if (config->retry_waves > 0 && !resilient) {
+    /* The coordinator keeps collecting results while the workers run the waves among themselves. */
+    MPI_Comm wave_comm = comm;
+    if (coordinated) {
+      MPI_Comm_split(comm, coordinator ? MPI_UNDEFINED : 0, config->rank, &wave_comm);
+    }
+    if (wave_comm != MPI_COMM_NULL) {
+      run_retry_waves(config, logger, payload, &pending, wave_comm, comm, coordinated,
+                      stream_enabled ? &response_stream : NULL, &recovered, &recovered_chunks);
+      if (wave_comm != comm) {
+        MPI_Comm_free(&wave_comm);
+      }
+    }
+  }
+  chunk_plan_free(&pending);
+
+  if (resilient && coordinator) {
+    dispatch_resilient_chunks(config, logger, &plan, order, comm, stream_enabled ? &response_stream : NULL,
+                              &processed, &failures, &network_failures, &recovered_chunks);
+  } else if (resilient) {
+    serve_resilient_chunks(config, logger, client, &client_ready, payload, response_ready ? &response : NULL, comm);
+  } else if (coordinator) {
+    coordinate_chunk_responses(config, logger, comm, stream_enabled ? &response_stream : NULL);
+  } else if (coordinated) {
+    unsigned long long done[4] = {RESULT_DONE, 0, 0, 0};
+    MPI_Send(done, 4, MPI_UNSIGNED_LONG_LONG, 0, TAG_RESULT_HEADER, comm);
+  }
+  memory_profile_mark(&g_memory_profile, MEMORY_PHASE_CHUNKS);
+
+  /* Resilient runs already count everything on rank 0 and must not wait on a rank that may be gone. */
+  unsigned long long stats[6] = {processed, failures, network_failures, filtered, recovered, recovered_chunks};
+  unsigned long long global_stats[6] = {processed, failures, network_failures, filtered, recovered, recovered_chunks};
+  if (!resilient) {
+    MPI_Reduce(stats, global_stats, 6, MPI_UNSIGNED_LONG_LONG, MPI_SUM, 0, comm);
+  }
+
+  if (config->rank == 0) {
+    logger_log(logger, LOG_LEVEL_INFO,
+               "Cluster summary: processed=%llu, filtered=%llu, deduplicated=%zu, failures=%llu, network_failures=%llu, "
+               "recovered=%llu",
+               global_stats[0], global_stats[3], deduplicated, global_stats[1] - global_stats[4],
+               resilient ? global_stats[2] : global_stats[2] - global_stats[5], global_stats[5]);
+  }
+
+  if (response_ready) {
+    sb_clean(&response);
+  }
+  if (stream_enabled && coordinated) {
+    if (coordinator) {
+      log_spooled_responses(logger, "\n===== Responses =====\n", &response_stream, repl_capture);
+    }
+    response_spool_free(&response_stream);
+  } else if (stream_enabled) {
+    stream_responses_after_completion(config, logger, &response_stream, repl_capture, stream_enabled,
+                                      payload->codec, comm);
+    response_spool_free(&response_stream);
+  } else if (repl_capture && config && config->rank == 0) {
+    sb_reset(repl_capture);
+  }
+  if (client_ready && !config->daemon_mode) {
+    api_client_cleanup(client);
+  }
+  chunk_plan_free(&plan);
+  free(order);
+  if (g_lost_ranks > 0 && (config->daemon_mode || config->stream_mode || config->watch_dir || config->repl_mode)) {
+    /* Later payloads start with collectives over every rank, which a lost rank would never join. */
+    logger_log(logger, LOG_LEVEL_ERROR, "Stopping the session after losing %zu rank(s); finished results are saved",
+               g_lost_ranks);
+    MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+  }
+}
+
+#define AUTOTUNE_PILOT_SIZES  3
+#define AUTOTUNE_PILOT_LEVELS 3
+
+typedef struct {
+  bool ready;
+  size_t chunk_size;
+  int window;
+} AutotuneState;
+
+static AutotuneState g_autotune;
+
+/* Tuned settings only carry over to the same endpoint, model and worker count. */
+static void autotune_cache_key(const ProgramConfig *config, int workers, char *key, size_t key_size) {
+  snprintf(key, key_size, "%s %s %d", config->api_endpoint ? config->api_endpoint : "",
+           config->model ? config->model : "", workers);
+}
+
+/* Sends the pilot requests: at each window level the first `window` workers send together, cycling
+ * through the pilot sizes, so every level sees every size. Rank 0 fits the latency models from the
+ * gathered samples and broadcasts its choice; returns -1 on every rank when no usable model came out. */
+static int run_autotune_pilot(const ProgramConfig *config, Logger *logger, const Payload *payload, MPI_Comm comm,
+                              int first_worker, const char *cache_key, const size_t *sizes, const int *windows,
+                              size_t window_count, AutotuneChoice *choice) {
+  int worker = config->rank - first_worker;
+  ProgramConfig pilot_config = *config;
+  pilot_config.max_retries = 0;
+  if (pilot_config.max_request_bytes < sizes[AUTOTUNE_PILOT_SIZES - 1]) {
+    pilot_config.max_request_bytes = sizes[AUTOTUNE_PILOT_SIZES - 1];
+  }
+  ApiClient client;
+  bool client_ready = worker >= 0 && api_client_init(&client, &pilot_config, NULL) == 0;
+  StringBuffer response;
+  sb_init(&response);
+
+  size_t slots = window_count * AUTOTUNE_PILOT_SIZES;
+  double mine[3 * AUTOTUNE_PILOT_LEVELS * AUTOTUNE_PILOT_SIZES] = {0};
+  size_t used = 0;
+  for (size_t level = 0; level < window_count; ++level) {
+    int window = windows[level];
+    size_t steps = window >= AUTOTUNE_PILOT_SIZES ? 1 : AUTOTUNE_PILOT_SIZES;
+    for (size_t step = 0; step < steps; ++step) {
+      MPI_Barrier(comm);
+      if (!client_ready || worker < 0 || worker >= window) {
+        continue;
+      }
+      size_t len = sizes[((size_t) worker + step) % AUTOTUNE_PILOT_SIZES];
+      size_t offset = ((size_t) worker * sizes[AUTOTUNE_PILOT_SIZES - 1]) % payload->length;
+      if (offset + len > payload->length) {
+        offset = payload->length - len;
+      }
+      char *error = NULL;
+      ApiClientError api_error = API_CLIENT_ERROR_NONE;
+      double started = MPI_Wtime();
+      int rc = api_client_send(&client, payload->data + offset, len, offset / config->chunk_size, &response, &error,
+                               &api_error);
+      double elapsed = MPI_Wtime() - started;
+      if (rc != 0) {
+        logger_log(logger, LOG_LEVEL_WARN, "Autotune pilot request (%zu bytes) failed: %s", len,
+                   error ? error : "unknown error");
+      }
+      free(error);
+      mine[3 * used] = (double) window;
+      mine[3 * used + 1] = chunk_cost_estimate_tokens(payload->data + offset, len);
+      mine[3 * used + 2] = rc == 0 ? elapsed : -1.0;
+      used++;
+    }
+  }
+  sb_clean(&response);
+  if (client_ready) {
+    api_client_cleanup(&client);
+  }
+
+  double *all = NULL;
+  if (config->rank == 0) {
+    all = malloc((size_t) config->world_size * 3 * slots * sizeof *all);
+    if (!all) {
+      MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+  }
+  MPI_Gather(mine, (int) (3 * slots), MPI_DOUBLE, all, (int) (3 * slots), MPI_DOUBLE, 0, comm);
+  unsigned long long result[3] = {0, 0, 0};
+  LatencyModel models[AUTOTUNE_PILOT_LEVELS];
+  if (config->rank == 0) {
+    size_t sample_count = (size_t) config->world_size * slots;
+    AutotuneSample *samples = malloc(sample_count * sizeof *samples);
+    if (!samples) {
+      MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < sample_count; ++i) {
+      samples[i].window = (int) all[3 * i];
+      samples[i].tokens = all[3 * i + 1];
+      samples[i].seconds = all[3 * i + 2];
+    }
+    size_t model_count = autotune_fit(samples, sample_count, models, AUTOTUNE_PILOT_LEVELS);
+    free(samples);
+    for (size_t m = 0; m < model_count; ++m) {
+      logger_log(logger, LOG_LEVEL_INFO, "Autotune: %d in flight -> %.3fs + %.3gs/token (%zu samples)",
+                 models[m].window, models[m].overhead_seconds, models[m].seconds_per_token, models[m].samples);
+    }
+    AutotuneJob job = {payload->length,
+                       chunk_cost_estimate_tokens(payload->data, payload->length) / (double) payload->length,
+                       config->chunk_size,
+                       DEEPSEEK_MIN_CHUNK_SIZE < sizes[0] ? DEEPSEEK_MIN_CHUNK_SIZE : sizes[0],
+                       sizes[AUTOTUNE_PILOT_SIZES - 1],
+                       config->autotune_rpm};
+    if (model_count > 0 && autotune_choose(&job, models, model_count, choice) == 0) {
+      result[0] = 1;
+      result[1] = choice->chunk_size;
+      result[2] = (unsigned long long) choice->window;
+      char *cache_error = NULL;
+      if (config->autotune_cache &&
+          autotune_cache_store(config->autotune_cache, cache_key, choice, models, model_count, &cache_error) != 0) {
+        logger_log(logger, LOG_LEVEL_WARN, "Autotune cache not saved: %s", cache_error ? cache_error : "unknown");
+      }
+      free(cache_error);
+    } else {
+      logger_log(logger, LOG_LEVEL_WARN, "Autotune: no pilot request succeeded; keeping configured settings");
+    }
+    free(all);
+  }
+  MPI_Bcast(result, 3, MPI_UNSIGNED_LONG_LONG, 0, comm);
+  choice->chunk_size = (size_t) result[1];
+  choice->window = (int) result[2];
+  return result[0] ? 0 : -1;
+}
+
+/* --autotune: pick chunk_size and max_inflight for this payload. The first payload runs the pilot (or
+ * loads --autotune-cache) and later payloads in the same session reuse the result. */
+static void autotune_payload(ProgramConfig *config, Logger *logger, const Payload *payload, MPI_Comm comm) {
+  bool coordinated = (config->coordinator_mode || config->resilient_mode) && config->world_size > 1;
+  int first_worker = coordinated ? 1 : 0;
+  int workers = config->world_size - first_worker;
+  size_t base = config->chunk_size;
+  size_t sizes[AUTOTUNE_PILOT_SIZES] = {base / 2, base, base * 2};
+  for (size_t i = 0; i < AUTOTUNE_PILOT_SIZES; ++i) {
+    if (sizes[i] < DEEPSEEK_MIN_CHUNK_SIZE) {
+      sizes[i] = DEEPSEEK_MIN_CHUNK_SIZE;
+    }
+    if (sizes[i] > payload->length) {
+      sizes[i] = payload->length;
+    }
+  }
+  int windows[AUTOTUNE_PILOT_LEVELS];
+  size_t window_count = 0;
+  int levels[AUTOTUNE_PILOT_LEVELS] = {1, (workers + 1) / 2, workers};
+  size_t pilot_requests = 0;
+  for (size_t i = 0; i < AUTOTUNE_PILOT_LEVELS; ++i) {
+    if (levels[i] > 0 && (window_count == 0 || levels[i] > windows[window_count - 1])) {
+      windows[window_count++] = levels[i];
+      pilot_requests += (size_t) levels[i] * (levels[i] >= AUTOTUNE_PILOT_SIZES ? 1 : AUTOTUNE_PILOT_SIZES);
+    }
+  }
+
+  char key[1024];
+  autotune_cache_key(config, workers, key, sizeof key);
+
+  /* decision[0]: 0 keeps the configured settings, 1 applies decision[1..2], 2 runs the pilot. */
+  unsigned long long decision[3] = {0, 0, 0};
+  if (config->rank == 0) {
+    AutotuneChoice cached;
+    size_t chunks = base > 0 ? (payload->length + base - 1) / base : 0;
+    if (g_autotune.ready) {
+      decision[0] = 1;
+      decision[1] = g_autotune.chunk_size;
+      decision[2] = (unsigned long long) g_autotune.window;
+    } else if (config->autotune_cache && autotune_cache_load(config->autotune_cache, key, &cached) == 0) {
+      logger_log(logger, LOG_LEVEL_INFO, "Autotune: reusing chunk size %zu and %d in flight from %s",
+                 cached.chunk_size, cached.window, config->autotune_cache);
+      decision[0] = 1;
+      decision[1] = cached.chunk_size;
+      decision[2] = (unsigned long long) cached.window;
+    } else if (config->dry_run) {
+      logger_log(logger, LOG_LEVEL_INFO, "Autotune skipped: a dry run has no latency to measure");
+    } else if (workers < 1 || chunks < 4 * pilot_requests) {
+      logger_log(logger, LOG_LEVEL_INFO, "Autotune skipped: %zu chunks do not justify a %zu-request pilot", chunks,
+                 pilot_requests);
+    } else {
+      logger_log(logger, LOG_LEVEL_INFO, "Autotune pilot: %zu requests at %zu/%zu/%zu bytes, up to %d in flight",
+                 pilot_requests, sizes[0], sizes[1], sizes[2], workers);
+      decision[0] = 2;
+    }
+  }
+  MPI_Bcast(decision, 3, MPI_UNSIGNED_LONG_LONG, 0, comm);
+  if (decision[0] == 2) {
+    AutotuneChoice choice;
+    memset(&choice, 0, sizeof choice);
+    if (run_autotune_pilot(config, logger, payload, comm, first_worker, key, sizes, windows, window_count,
+                           &choice) != 0) {
+      return;
+    }
+    if (config->rank == 0) {
+      logger_log(logger, LOG_LEVEL_INFO,
+                 "Autotune: chunk size %zu with %d in flight, predicted %.1fs (%.1fs at chunk size %zu)",
+                 choice.chunk_size, choice.window, choice.predicted_seconds, choice.baseline_seconds, base);
+    }
+    decision[1] = choice.chunk_size;
+    decision[2] = (unsigned long long) choice.window;
+  } else if (decision[0] == 0) {
+    return;
+  }
+  if (config->rank == 0) {
+    g_autotune.ready = true;
+    g_autotune.chunk_size = (size_t) decision[1];
+    g_autotune.window = (int) decision[2];
+  }
+  config->chunk_size = (size_t) decision[1];
+  if (config->max_request_bytes < config->chunk_size) {
+    config->max_request_bytes = config->chunk_size;
+  }
+  config->max_inflight = (int) decision[2] >= workers ? 0 : (int) decision[2];
+}
+
+static double kib_to_mib(unsigned long long kib) {
+  return (double) kib / 1024.0;
+}
+
+/* Collects every rank's phase profile on rank 0 for the memory summary and, when
+ * DEEPSEEK_MPI_MEMORY_PROFILE names a file, appends the per-phase rows there. Resilient runs must not
+ * wait on a rank that may be gone, so they report rank 0 alone. */
+static void report_memory_profile(const ProgramConfig *config, Logger *logger, MPI_Comm comm) {
+  int rank = 0;
+  int size = 1;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &size);
+  if (config->resilient_mode) {
+    size = 1;
+    if (rank != 0) {
+      return;
+    }
+  }
+  MemoryProfile *profiles = NULL;
+  if (rank == 0) {
+    profiles = calloc((size_t) size, sizeof *profiles);
+    if (!profiles) {
+      MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+  }
+  const int fields = MEMORY_PHASE_COUNT * MEMORY_FIELD_COUNT;
+  if (config->resilient_mode) {
+    profiles[0] = g_memory_profile;
+  } else {
+    MPI_Gather(g_memory_profile.values, fields, MPI_UNSIGNED_LONG_LONG, profiles, fields, MPI_UNSIGNED_LONG_LONG, 0,
+               comm);
+  }
+  if (rank != 0) {
+    return;
+  }
+
+  int high = 0;
+  int low = 0;
+  int tracked_rank = 0;
+  int tracked_phase = 0;
+  unsigned long long allocations = 0;
+  unsigned long long allocated = 0;
+  const int last = MEMORY_PHASE_COUNT - 1;
+  for (int r = 0; r < size; ++r) {
+    unsigned long long peak = profiles[r].values[last][MEMORY_FIELD_PEAK_RSS_KB];
+    if (peak > profiles[high].values[last][MEMORY_FIELD_PEAK_RSS_KB]) {
+      high = r;
+    }
+    if (peak < profiles[low].values[last][MEMORY_FIELD_PEAK_RSS_KB]) {
+      low = r;
+    }
+    for (int p = 0; p < MEMORY_PHASE_COUNT; ++p) {
+      const unsigned long long *row = profiles[r].values[p];
+      if (row[MEMORY_FIELD_TRACKED_PEAK] > profiles[tracked_rank].values[tracked_phase][MEMORY_FIELD_TRACKED_PEAK]) {
+        tracked_rank = r;
+        tracked_phase = p;
+      }
+      allocations += row[MEMORY_FIELD_ALLOCATIONS];
+      allocated += row[MEMORY_FIELD_ALLOCATED_BYTES];
+    }
+  }
+  logger_log(logger, LOG_LEVEL_INFO,
+             "Memory summary: peak_rss max=%.1fMiB (rank %d), min=%.1fMiB (rank %d); buffers peak=%.1fMiB "
+             "(rank %d, %s phase); allocations=%llu (%.1fMiB)",
+             kib_to_mib(profiles[high].values[last][MEMORY_FIELD_PEAK_RSS_KB]), high,
+             kib_to_mib(profiles[low].values[last][MEMORY_FIELD_PEAK_RSS_KB]), low,
+             (double) profiles[tracked_rank].values[tracked_phase][MEMORY_FIELD_TRACKED_PEAK] / (1024.0 * 1024.0),
+             tracked_rank, memory_profile_phase_name((MemoryPhase) tracked_phase), allocations,
+             (double) allocated / (1024.0 * 1024.0));
+
+  const char *path = getenv("DEEPSEEK_MPI_MEMORY_PROFILE");
+  if (path && *path) {
+    char *error = NULL;
+    if (memory_profile_write_csv(path, g_payload_sequence, profiles, size, &error) != 0) {
+      logger_log(logger, LOG_LEVEL_WARN, "Unable to write memory profile: %s", error ? error : "unknown error");
+      free(error);
+    }
+  }
+  free(profiles);
+}
+
+enum { TAG_RESULTS_LENGTH = 0x7e1, TAG_RESULTS_MESSAGE = 0x7e2 };
+
+/* Each rank writes its --results-arrow rows to PATH.part-<rank>-<host>-<pid> before rank 0 merges them.
+ * The rank is the one in comm, so host and pid keep names apart: ranks spawned by --auto-scale-mode threads
+ * start their own MPI_COMM_WORLD at 0, and concurrent daemon groups each have a rank 0 of their own. */
+static char *results_part_path(const char *path, MPI_Comm comm) {
+  int rank = 0;
+  MPI_Comm_rank(comm, &rank);
+  char host[256];
+  if (gethostname(host, sizeof host) != 0) {
+    snprintf(host, sizeof host, "host");
+  }
+  host[sizeof host - 1] = '\0';
+  StringBuffer part;
+  sb_init(&part);
+  sb_append_printf(&part, "%s.part-%d-%s-%ld", path, rank, host, (long) getpid());
+  return sb_detach(&part);
+}
+
+/* Collective over comm. Rows are tagged with the payload sequence number, which tells REPL turns, stream
+ * batches and watched files apart, and with the source path from rank 0, the only rank that knows the
+ * input path of a watched file. */
+static void open_results_part(const ProgramConfig *config, Logger *logger, size_t payload_len, MPI_Comm comm) {
+  const char *input = config->input_file && strcmp(config->input_file, "-") != 0 ? config->input_file : NULL;
+  int source_len = config->rank == 0 && input ? (int) strlen(input) : -1;
+  MPI_Bcast(&source_len, 1, MPI_INT, 0, comm);
+  char *source = source_len >= 0 ? calloc((size_t) source_len + 1, 1) : NULL;
+  if (source_len >= 0 && !source) {
+    MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+  }
+  if (source && config->rank == 0) {
+    memcpy(source, input, (size_t) source_len);
+  }
+  if (source) {
+    MPI_Bcast(source, source_len, MPI_CHAR, 0, comm);
+  }
+  char *part = results_part_path(config->results_arrow, comm);
+  char *error = NULL;
+  g_results_part_open = part && result_arrow_open(&g_results_part, part, g_payload_sequence, source,
+                                                  config->chunk_size, payload_len, &error) == 0;
+  if (!g_results_part_open) {
+    logger_log(logger, LOG_LEVEL_WARN, "Rank %d cannot export results to %s: %s", config->rank,
+               part ? part : config->results_arrow, error ? error : "out of memory");
+  }
+  free(error);
+  free(part);
+  free(source);
+}
+
+/* Copies the record batches of an open part to out (or drops them when out is NULL), or ships them to
+ * rank 0 when dest is set. */
+static int forward_results_part(FILE *in, FILE *out, bool dest, MPI_Comm comm, char **error_out) {
+  StringBuffer message;
+  sb_init(&message);
+  bool schema = false;
+  int rc = 0;
+  while (in && (rc = result_arrow_read_message(in, &message, &schema, error_out)) == 1) {
+    if (schema) {
+      continue;
+    }
+    if (dest) {
+      unsigned long long length = (unsigned long long) message.length;
+      MPI_Send(&length, 1, MPI_UNSIGNED_LONG_LONG, 0, TAG_RESULTS_LENGTH, comm);
+      send_blob(message.data, message.length, 0, TAG_RESULTS_MESSAGE, comm);
+    } else if (out && fwrite(message.data, 1, message.length, out) != message.length) {
+      rc = -1;
+      break;
+    }
+  }
+  sb_clean(&message);
+  return rc;
+}
+
+/* Takes the record batches source ships with forward_results_part and appends them to out (drops them
+ * when out is NULL). Returns false when a write failed. */
+static bool receive_results_part(FILE *out, int source, MPI_Comm comm) {
+  bool ok = true;
+  for (;;) {
+    unsigned long long length = 0;
+    MPI_Recv(&length, 1, MPI_UNSIGNED_LONG_LONG, source, TAG_RESULTS_LENGTH, comm, MPI_STATUS_IGNORE);
+    if (length == 0) {
+      return ok;
+    }
+    char *message = recv_blob((size_t) length, source, TAG_RESULTS_MESSAGE, comm);
+    if (out && fwrite(message, 1, (size_t) length, out) != (size_t) length) {
+      ok = false;
+    }
+    free(message);
+  }
+}
+
+/* Collective over comm (except in --resilient runs, where workers may be gone and only rank 0 recorded
+ * results). Every rank closes its part and rank 0 appends the record batches to --results-arrow in rank
+ * order. Parts travel over MPI, so they may sit on node-local disks. The first payload of a run replaces
+ * the file; later ones (REPL turns, stream batches, watched files) append to it. */
+static void merge_results_parts(ProgramConfig *config, Logger *logger, MPI_Comm comm) {
+  char *error = NULL;
+  if (g_results_part_open && result_arrow_close(&g_results_part, &error) != 0) {
+    logger_log(logger, LOG_LEVEL_WARN, "Rank %d results part is incomplete: %s", config->rank,
+               error ? error : "unknown error");
+  }
+  g_results_part_open = false;
+  free(error);
+  error = NULL;
+  int rank = 0;
+  int size = 1;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &size);
+  int senders = config->resilient_mode ? 1 : size;
+  char *part = results_part_path(config->results_arrow, comm);
+  FILE *in = part ? fopen(part, "rb") : NULL;
+  if (rank != 0) {
+    if (senders > 1) {
+      if (forward_results_part(in, NULL, true, comm, &error) != 0) {
+        logger_log(logger, LOG_LEVEL_WARN, "Rank %d results part is unreadable: %s", config->rank,
+                   error ? error : "unknown error");
+      }
+      unsigned long long done = 0;
+      MPI_Send(&done, 1, MPI_UNSIGNED_LONG_LONG, 0, TAG_RESULTS_LENGTH, comm);
+    }
+  } else {
+    bool append = config->results_arrow_started;
+    FILE *out = result_arrow_begin(config->results_arrow, append, &error);
+    if (!out) {
+      logger_log(logger, LOG_LEVEL_ERROR, "Cannot export results: %s", error ? error : "unknown error");
+      free(error);
+      error = NULL;
+    }
+    bool ok = out != NULL && forward_results_part(in, out, false, comm, &error) == 0;
+    for (int source = 1; source < senders; ++source) {
+      if (!receive_results_part(out, source, comm)) {
+        ok = false;
+      }
+    }
+    if (out && result_arrow_end(out, ok ? &error : NULL) != 0) {
+      ok = false;
+    }
+    if (out && !ok) {
+      logger_log(logger, LOG_LEVEL_ERROR, "Results export to %s is incomplete: %s", config->results_arrow,
+                 error ? error : strerror(errno));
+    } else if (out) {
+      logger_log(logger, LOG_LEVEL_INFO, "Chunk results %s %s", append ? "appended to" : "written to",
+                 config->results_arrow);
+      config->results_arrow_started = true;
+    }
+  }
+  free(error);
+  if (in) {
+    fclose(in);
+  }
+  if (part) {
+    unlink(part);
+  }
+  free(part);
+}
+
+static int execute_payload(ProgramConfig *config, Logger *logger, Payload *payload,
+                           StringBuffer *repl_capture, MPI_Comm comm) {
+  if (!config || !logger || !payload) {
+    return -1;
+  }
+  memory_budget_set_limit(config->max_memory);
+  /* Already running by now; this only picks up a job's own response_fsync setting. */
+  async_io_start(config->io_backend, config->response_fsync);
+  int ready = 0;
+  if (config->rank == 0 && payload->data && payload->length > 0) {
+    ready = 1;
+    /* Every rank holds the whole payload, so one that does not fit is refused up front rather than
+     * getting ranks OOM-killed halfway through it. */
+    if (!memory_budget_fits(payload->length)) {
+      logger_log(logger, LOG_LEVEL_ERROR,
+                 "Payload of %zu bytes does not fit the %zu-byte memory budget (%zu bytes already in use)",
+                 payload->length, memory_budget_limit(), memory_budget_used());
+      ready = 0;
+    }
+  }
+  MPI_Bcast(&ready, 1, MPI_INT, 0, comm);
+  if (!ready) {
+    if (config->rank == 0 && payload->data) {
+      free(payload->data);
+      payload->data = NULL;
+      payload->length = 0;
+    }
+    return -1;
+  }
+  g_payload_sequence++;
+  memset(&g_memory_profile, 0, sizeof g_memory_profile);
+  memory_profile_mark(&g_memory_profile, MEMORY_PHASE_CAPTURE);
+
+  unsigned long long chunk_size64 = (unsigned long long) config->chunk_size;
+  MPI_Bcast(&chunk_size64, 1, MPI_UNSIGNED_LONG_LONG, 0, comm);
+  config->chunk_size = (size_t) chunk_size64;
+
+  unsigned long long max_req64 = (unsigned long long) config->max_request_bytes;
+  MPI_Bcast(&max_req64, 1, MPI_UNSIGNED_LONG_LONG, 0, comm);
+  config->max_request_bytes = (size_t) max_req64;
+
+  unsigned long long payload_len64 = config->rank == 0 ? (unsigned long long) payload->length : 0ULL;
+  MPI_Bcast(&payload_len64, 1, MPI_UNSIGNED_LONG_LONG, 0, comm);
+  size_t payload_len = (size_t) payload_len64;
+
+  unsigned long long segment64 = (unsigned long long) config->bcast_segment;
+  MPI_Bcast(&segment64, 1, MPI_UNSIGNED_LONG_LONG, 0, comm);
+  config->bcast_segment = (size_t) segment64;
+  /* Autotune and resilient hand-out read chunks anywhere in the payload before (or instead of) the plain
+   * chunk loop, so they keep the one-shot broadcast. Dedup runs on rank 0 alone (see process_chunks). */
+  int comm_size = 1;
+  MPI_Comm_size(comm, &comm_size);
+  bool pipelined = comm_size > 1 && config->bcast_segment > 0 && payload_len > config->bcast_segment &&
+                   !config->autotune && !config->resilient_mode;
+  /* Compressed payloads always travel in framed segments; without pipelining they are awaited at once. */
+  TransferCodec codec = choose_transfer_codec(config, logger, payload->data, payload_len, comm);
+  bool segmented = pipelined || codec != TRANSFER_CODEC_OFF;
+
+  /* Large receive buffers come from huge pages where the host has them. They are not cleared: the
+   * broadcast writes every byte, and that first write is what places the pages. */
+  char *shared_buffer = NULL;
+  LargeBuffer receive_buffer = {0};
+  if (config->rank == 0) {
+    shared_buffer = payload->data;
+  } else {
+    if (large_buffer_alloc(&receive_buffer, payload_len + 1) != 0) {
+      logger_log(logger, LOG_LEVEL_ERROR, "Rank %d cannot allocate %zu bytes for payload", config->rank,
+                 payload_len);
+      return -1;
+    }
+    shared_buffer = receive_buffer.data;
+    logger_log(logger, LOG_LEVEL_DEBUG, "Rank %d payload buffer: %zu bytes on %s pages", config->rank, payload_len,
+               large_buffer_kind_name(receive_buffer.kind));
+  }
+
+  SegmentedBcast arrival;
+  if (segmented) {
+    size_t segment = config->bcast_segment > 0 ? config->bcast_segment : DEEPSEEK_DEFAULT_BCAST_SEGMENT;
+    segmented_bcast_start(&arrival, shared_buffer, payload_len, segment, codec, comm);
+    if (!pipelined) {
+      segmented_bcast_finish(&arrival);
+    }
+    shared_buffer[payload_len] = '\0';
+  } else if (payload_len > 0) {
+    broadcast_payload(shared_buffer, payload_len, comm);
+    shared_buffer[payload_len] = '\0';
+  }
+
+  Payload shared_payload = {shared_buffer, payload_len, pipelined ? &arrival : NULL, codec};
+  memory_budget_charge(payload_len + 1);
+  memory_profile_mark(&g_memory_profile, MEMORY_PHASE_BROADCAST);
+  if (config->autotune && payload_len > 0) {
+    autotune_payload(config, logger, &shared_payload, comm);
+  }
+  if (config->results_arrow) {
+    open_results_part(config, logger, payload_len, comm);
+  }
+  process_chunks(config, logger, &shared_payload, repl_capture, comm);
+  if (segmented) {
+    segmented_bcast_finish(&arrival);
+    if (config->rank == 0 && codec != TRANSFER_CODEC_OFF) {
+      logger_log(logger, LOG_LEVEL_DEBUG, "Payload broadcast sent %zu bytes as %zu with %s", payload_len,
+                 arrival.wire_bytes, transfer_codec_name(codec));
+    }
+  }
+  char *write_error = NULL;
+  size_t write_failures = async_io_flush(&write_error);
+  if (write_failures > 0) {
+    logger_log(logger, LOG_LEVEL_WARN, "Rank %d failed to write %zu response file(s): %s", config->rank,
+               write_failures, write_error ? write_error : "unknown error");
+  }
+  free(write_error);
+  if (config->results_arrow) {
+    merge_results_parts(config, logger, comm);
+  }
+  memory_profile_mark(&g_memory_profile, MEMORY_PHASE_GATHER);
+  report_memory_profile(config, logger, comm);
+  memory_budget_release(payload_len + 1);
+
+  if (config->rank == 0) {
+    free(payload->data);
+    payload->data = NULL;
+    payload->length = 0;
+  } else {
+    large_buffer_free(&receive_buffer);
+  }
+  return 0;
+}
+
+static bool g_tui_log_from_repl = false;
+
+static bool start_tui_log_view_if_needed(ProgramConfig *config, Logger *logger, bool *tui_log_active) {
+  if (!config || !logger || !tui_log_active) {
+    return false;
+  }
+  if (*tui_log_active) {
+    return true;
+  }
+  if (config->use_tui && config->repl_mode) {
+    if (tui_repl_attach_logger(logger)) {
+      tui_log_set_quiet(!config->tui_log_view_explicit);
+      *tui_log_active = true;
+      g_tui_log_from_repl = true;
+      return true;
     }
   }
   if (config->rank != 0 || !config->use_tui || !config->use_tui_log_view) {
     return false;
   }
-  if (tui_log_view_start() == 0) {
-    tui_log_set_quiet(!config->tui_log_view_explicit);
-    logger_set_sink(logger, tui_logger_sink, NULL);
-    logger->mirror_stdout = false;
-    *tui_log_active = true;
-    g_tui_log_from_repl = false;
-  } else {
-    logger_log(logger, LOG_LEVEL_WARN, "Unable to initialize TUI log view; falling back to stdout logs");
+  if (tui_log_view_start() == 0) {
+    tui_log_set_quiet(!config->tui_log_view_explicit);
+    logger_set_sink(logger, tui_logger_sink, NULL);
+    logger->mirror_stdout = false;
+    *tui_log_active = true;
+    g_tui_log_from_repl = false;
+  } else {
+    logger_log(logger, LOG_LEVEL_WARN, "Unable to initialize TUI log view; falling back to stdout logs");
+  }
+  return *tui_log_active;
+}
+
+static int run_repl_session(ProgramConfig *config, Logger *logger, bool *tui_log_active) {
+  if (!config || !logger) {
+    return -1;
+  }
+  StringBuffer history;
+  sb_init(&history);
+  ReplTurnLedger turn_ledger;
+  repl_turn_ledger_init(&turn_ledger);
+  size_t turn = 1;
+  int running = 1;
+  while (running) {
+    Payload prompt = {0};
+    int ready = 0;
+    if (config->rank == 0) {
+      if (gather_payload_root(config, logger, &prompt) == 0) {
+        ready = 1;
+        if (repl_should_exit(prompt.data, prompt.length)) {
+          running = 0;
+        }
+      } else {
+        ready = 0;
+      }
+    }
+
+    MPI_Bcast(&running, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (!running) {
+      if (prompt.data) {
+        free(prompt.data);
+      }
+      break;
+    }
+
+    int ready_flag = ready;
+    MPI_Bcast(&ready_flag, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (!ready_flag) {
+      if (prompt.data) {
+        free(prompt.data);
+      }
+      continue;
+    }
+
+    Payload composite = {0};
+    if (config->rank == 0) {
+      build_repl_payload(&history, &prompt, turn, &composite);
+      adjust_chunking_for_payload(config, &composite, logger);
+    }
+
+    StringBuffer repl_response;
+    if (config->rank == 0) {
+      sb_init(&repl_response);
+    }
+    if (config->rank == 0) {
+      start_tui_log_view_if_needed(config, logger, tui_log_active);
+    }
+    int exec_rc = execute_payload(config, logger, &composite, config->rank == 0 ? &repl_response : NULL,
+                                  MPI_COMM_WORLD);
+
+    if (config->rank == 0) {
+      size_t turn_start = history.length;
+      sb_append_printf(&history, "User #%zu:\n%.*s\n", turn,
+                       (int) (prompt.length), prompt.data ? prompt.data : "");
+      if (exec_rc == 0 && repl_response.length > 0 && repl_response.data) {
+        sb_append_printf(&history, "Assistant #%zu:\n%.*s\n\n", turn,
+                         (int) repl_response.length, repl_response.data);
+        tui_repl_append_assistant(turn, repl_response.data, repl_response.length);
+      } else {
+        const char *fallback = "(no response available)";
+        sb_append_printf(&history, "Assistant #%zu:\n%s\n\n", turn, fallback);
+        tui_repl_append_assistant(turn, fallback, strlen(fallback));
+      }
+      size_t turn_chunk = history.length - turn_start;
+      repl_turn_ledger_append(&turn_ledger, turn_chunk);
+      repl_turn_ledger_trim(&turn_ledger, config->repl_history_limit, &history);
+      sb_clean(&repl_response);
+    }
+
+    if (prompt.data) {
+      free(prompt.data);
+    }
+    turn++;
+  }
+  sb_clean(&history);
+  repl_turn_ledger_free(&turn_ledger);
+  if (config->rank == 0 && config->use_tui && config->repl_mode) {
+    tui_repl_shutdown();
+  }
+  return 0;
+}
+
+/* Non-root ranks idle here between daemon jobs or stream batches; polling an Ibcast keeps them from
+ * spinning a core. */
+static void broadcast_int_idle(int *value) {
+  MPI_Request request;
+  MPI_Ibcast(value, 1, MPI_INT, 0, MPI_COMM_WORLD, &request);
+  int done = 0;
+  while (!done) {
+    MPI_Test(&request, &done, MPI_STATUS_IGNORE);
+    if (!done) {
+      struct timespec pause = {0, 5000000L};
+      nanosleep(&pause, NULL);
+    }
+  }
+}
+
+/* Layers a job's key=value lines over the daemon's startup config; rank/size describe the job's group. */
+static int build_job_config(const ProgramConfig *base, const char *options, int rank, int size,
+                            ProgramConfig *job, char **error_out) {
+  if (config_clone(base, job) != 0) {
+    assign_error(error_out, "unable to allocate job config");
+    return -1;
+  }
+  char *copy = strdup(options ? options : "");
+  if (!copy) {
+    config_free(job);
+    assign_error(error_out, "unable to allocate job options");
+    return -1;
+  }
+  int rc = 0;
+  char *line = copy;
+  while (rc == 0 && line && *line) {
+    char *next = strchr(line, '\n');
+    if (next) {
+      *next = '\0';
+    }
+    char *eq = strchr(line, '=');
+    if (eq) {
+      *eq = '\0';
+      rc = config_apply_kv(job, line, eq + 1, error_out);
+    }
+    line = next ? next + 1 : NULL;
+  }
+  free(copy);
+  if (rc != 0) {
+    config_free(job);
+    return -1;
+  }
+  job->use_tui = false;
+  job->use_readline_prompt = false;
+  job->repl_mode = false;
+  job->daemon_mode = true;
+  config_finalize(job);
+  config_record_rank(job, rank, size);
+  return 0;
+}
+
+static int prepare_chunk_policies(const ProgramConfig *config, Logger *logger, char **error_out) {
+  chunk_filter_free(&g_chunk_filter);
+  if (chunk_filter_init(&g_chunk_filter, config->filter_keywords, config->filter_regex, config->filter_ignore_case,
+                        error_out) != 0) {
+    return -1;
+  }
+  if (g_chunk_filter.active) {
+    logger_log(logger, LOG_LEVEL_INFO, "Chunk filter active: %zu keywords, %zu regexes%s",
+               g_chunk_filter.keyword_count, g_chunk_filter.regex_count,
+               g_chunk_filter.ignore_case ? " (case-insensitive)" : "");
+  }
+  /* Only the rank that plans predicts costs; the others receive them with the plan. A model that cannot be
+   * loaded (say, a missing history log) leaves chunks in index order rather than failing the run. */
+  chunk_cost_free(&g_cost_model);
+  if (config->rank == 0 && config->cost_model) {
+    char *cost_error = NULL;
+    if (chunk_cost_init(&g_cost_model, config->cost_model, config->max_output_tokens, &cost_error) != 0) {
+      logger_log(logger, LOG_LEVEL_WARN, "Cost model %s disabled: %s", config->cost_model,
+                 cost_error ? cost_error : "unknown error");
+      chunk_cost_free(&g_cost_model);
+    } else if (chunk_cost_active(&g_cost_model)) {
+      logger_log(logger, LOG_LEVEL_INFO, "Chunk cost model: %s (costliest chunks first)", config->cost_model);
+    }
+    free(cost_error);
+  }
+  return 0;
+}
+
+enum { DAEMON_STOP = 0, DAEMON_RUN_BATCH = 1, DAEMON_SKIP = 2 };
+typedef struct {
+  JobRequest request;
+  Payload payload;
+  size_t chunks;
+  int first_rank;
+  int ranks;
+  /* Set when the group leader reports: its status and how many records the group posted to rank 0. */
+  bool reported;
+  int rc;
+  unsigned long long records;
+  unsigned long long relayed;
+} DaemonJob;
+
+/* Rank 0: blocks for one job, then drains whatever is already queued on the socket (up to limit) so
+ * the batch can share the world. Payloads are captured here; groups are sized from their lengths. */
+static size_t daemon_collect_batch(int listen_fd, const ProgramConfig *config, Logger *logger, DaemonJob *jobs,
+                                   size_t limit, bool *shutdown_out) {
+  size_t count = 0;
+  bool first = true;
+  /* The previous batch left its jobs' limits behind; submitted payloads are checked against the daemon's. */
+  memory_budget_set_limit(config->max_memory);
+  while (count < limit && !*shutdown_out && (first || job_server_pending(listen_fd))) {
+    first = false;
+    DaemonJob *job = &jobs[count];
+    memset(job, 0, sizeof *job);
+    char *error = NULL;
+    if (job_server_accept(listen_fd, &job->request, &error) != 0) {
+      logger_log(logger, LOG_LEVEL_WARN, "Rejected daemon job: %s", error ? error : "unknown error");
+      job_server_finish(&job->request, false, error);
+      job_request_clean(&job->request);
+      free(error);
+      continue;
+    }
+    if (job->request.command == JOB_COMMAND_SHUTDOWN) {
+      logger_log(logger, LOG_LEVEL_INFO, "Daemon shutdown requested");
+      job_server_finish(&job->request, true, NULL);
+      job_request_clean(&job->request);
+      *shutdown_out = true;
+      continue;
+    }
+    ProgramConfig job_config;
+    int rc = build_job_config(config, job->request.options, 0, 1, &job_config, &error);
+    bool config_built = rc == 0;
+    if (rc == 0) {
+      ChunkFilter probe;
+      rc = chunk_filter_init(&probe, job_config.filter_keywords, job_config.filter_regex,
+                             job_config.filter_ignore_case, &error);
+      chunk_filter_free(&probe);
+    }
+    if (rc == 0) {
+      if (job->request.payload) {
+        job->payload.data = job->request.payload;
+        job->payload.length = job->request.payload_length;
+        job->request.payload = NULL;
+        normalize_payload_text(&job_config, logger, &job->payload, "submitted payload", NULL);
+      } else if (gather_payload_root(&job_config, logger, &job->payload) != 0) {
+        error = strdup("payload capture failed (see daemon log)");
+        rc = -1;
+      }
+    }
+    if (rc == 0 && job->payload.length == 0) {
+      error = strdup("payload is empty");
+      rc = -1;
+    }
+    if (rc != 0) {
+      job_server_finish(&job->request, false, error);
+      job_request_clean(&job->request);
+      free(job->payload.data);
+      free(error);
+      if (config_built) {
+        config_free(&job_config);
+      }
+      continue;
+    }
+    size_t chunk_size = job_config.chunk_size > 0 ? job_config.chunk_size : job->payload.length;
+    job->chunks = (job->payload.length + chunk_size - 1) / chunk_size;
+    if (job_config.target_tasks_set && job_config.target_tasks > job->chunks) {
+      job->chunks = job_config.target_tasks;
+    }
+    config_free(&job_config);
+    count++;
+  }
+  return count;
+}
+
+static int compare_jobs_by_length(const void *lhs, const void *rhs) {
+  const DaemonJob *a = lhs;
+  const DaemonJob *b = rhs;
+  return (a->payload.length > b->payload.length) - (a->payload.length < b->payload.length);
+}
+
+/* Shortest payload first so rank 0 finishes its own group early and can relay the other groups'
+ * results as they complete. Every job gets one rank; the rest go one at a time to the job with the
+ * most bytes per rank, never beyond its chunk count. Unneeded ranks sit the batch out. */
+static void daemon_size_groups(DaemonJob *jobs, size_t count, int world_size) {
+  qsort(jobs, count, sizeof *jobs, compare_jobs_by_length);
+  for (size_t i = 0; i < count; ++i) {
+    jobs[i].ranks = 1;
+  }
+  for (int spare = world_size - (int) count; spare > 0; --spare) {
+    size_t best = count;
+    double best_load = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+      if ((size_t) jobs[i].ranks >= jobs[i].chunks) {
+        continue;
+      }
+      double load = (double) jobs[i].payload.length / (double) jobs[i].ranks;
+      if (best == count || load > best_load) {
+        best = i;
+        best_load = load;
+      }
+    }
+    if (best == count) {
+      break;
+    }
+    jobs[best].ranks++;
+  }
+  int next = 0;
+  for (size_t i = 0; i < count; ++i) {
+    jobs[i].first_rank = next;
+    next += jobs[i].ranks;
+  }
+}
+
+/* Rank 0 ends one finished job: its records have all been written, so only the status line is left. */
+static void daemon_reply(DaemonJob *job, int rc, Logger *logger) {
+  job_server_finish(&job->request, rc == 0, rc == 0 ? NULL : "job failed (see daemon log)");
+  logger_log(logger, LOG_LEVEL_INFO, "Daemon job on ranks %d-%d finished (%s)", job->first_rank,
+             job->first_rank + job->ranks - 1, rc == 0 ? "ok" : "error");
+  job_request_clean(&job->request);
+}
+
+typedef struct {
+  DaemonJob *jobs;
+  int count;
+  int open;
+  Logger *logger;
+  const ProgramConfig *config;
+  const char *options;
+  unsigned long long first_id;
+  StringBuffer *arrow_started;
+} DaemonRelay;
+
+/* --daemon --results-arrow: groups run side by side, so each leader merges its job into a stream of its
+ * own (this path) instead of PATH. World rank 0 then appends every job to PATH as it finishes; it is the
+ * only rank that writes there, and it remembers which paths it has started, so later jobs append. */
+static char *daemon_results_path(const char *path, unsigned long long job_id) {
+  StringBuffer stream;
+  sb_init(&stream);
+  sb_append_printf(&stream, "%s.job-%llu-%ld", path, job_id, (long) getpid());
+  return sb_detach(&stream);
+}
+
+/* Group leaders other than world rank 0: hand the job's stream to world rank 0 and remove it. */
+static void daemon_ship_results(const char *stream, Logger *logger, int rank) {
+  FILE *in = fopen(stream, "rb");
+  char *error = NULL;
+  if (forward_results_part(in, NULL, true, MPI_COMM_WORLD, &error) != 0) {
+    logger_log(logger, LOG_LEVEL_WARN, "Rank %d job results in %s are unreadable: %s", rank, stream,
+               error ? error : "unknown error");
+  }
+  unsigned long long done = 0;
+  MPI_Send(&done, 1, MPI_UNSIGNED_LONG_LONG, 0, TAG_RESULTS_LENGTH, MPI_COMM_WORLD);
+  free(error);
+  if (in) {
+    fclose(in);
+  }
+  unlink(stream);
+}
+
+static bool daemon_results_started(const StringBuffer *started, const char *path) {
+  for (size_t at = 0; at < started->length; at += strlen(started->data + at) + 1) {
+    if (strcmp(started->data + at, path) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/* Rank 0: appends job j's results to its --results-arrow (a job may name its own) before the client hears
+ * the job is done. The job's own options decide, exactly as they did on its leader. */
+static void daemon_merge_results(DaemonRelay *relay, int j) {
+  const char *job_options = relay->options;
+  for (int k = 0; k < j; ++k) {
+    job_options += strlen(job_options) + 1;
+  }
+  ProgramConfig job;
+  if (build_job_config(relay->config, job_options, 0, 1, &job, NULL) != 0) {
+    return;
+  }
+  if (!job.results_arrow) {
+    config_free(&job);
+    return;
+  }
+  char *stream = daemon_results_path(job.results_arrow, relay->first_id + (unsigned long long) j);
+  bool append = daemon_results_started(relay->arrow_started, job.results_arrow);
+  char *error = NULL;
+  FILE *out = result_arrow_begin(job.results_arrow, append, &error);
+  if (!out) {
+    logger_log(relay->logger, LOG_LEVEL_ERROR, "Cannot export results: %s", error ? error : "unknown error");
+    free(error);
+    error = NULL;
+  }
+  bool ok = out != NULL;
+  if (relay->jobs[j].first_rank == 0) {
+    FILE *in = stream ? fopen(stream, "rb") : NULL;
+    if (forward_results_part(in, out, false, MPI_COMM_WORLD, out ? &error : NULL) != 0) {
+      ok = false;
+    }
+    if (in) {
+      fclose(in);
+    }
+    if (stream) {
+      unlink(stream);
+    }
+  } else if (!receive_results_part(out, relay->jobs[j].first_rank, MPI_COMM_WORLD)) {
+    ok = false;
+  }
+  if (out && result_arrow_end(out, ok ? &error : NULL) != 0) {
+    ok = false;
+  }
+  if (out && !ok) {
+    logger_log(relay->logger, LOG_LEVEL_ERROR, "Results export to %s is incomplete: %s", job.results_arrow,
+               error ? error : strerror(errno));
+  } else if (out) {
+    logger_log(relay->logger, LOG_LEVEL_INFO, "Chunk results of daemon job %llu %s %s",
+               relay->first_id + (unsigned long long) j, append ? "appended to" : "written to", job.results_arrow);
+    if (!append) {
+      sb_append_str(relay->arrow_started, job.results_arrow);
+      sb_append_char(relay->arrow_started, '\0');
+    }
+  }
+  free(error);
+  free(stream);
+  config_free(&job);
+}
+
+static DaemonJob *daemon_job_for_rank(DaemonRelay *relay, int rank) {
+  for (int j = 0; j < relay->count; ++j) {
+    if (rank >= relay->jobs[j].first_rank && rank < relay->jobs[j].first_rank + relay->jobs[j].ranks) {
+      return &relay->jobs[j];
+    }
+  }
+  return NULL;
+}
+
+/* Rank 0: copies every record that has arrived to its job's client, takes in leader reports, and ends
+ * each job whose records are all through. Returns whether anything arrived. */
+static bool daemon_relay_pending(DaemonRelay *relay) {
+  bool progress = false;
+  for (;;) {
+    int ready = 0;
+    MPI_Status probe;
+    MPI_Iprobe(MPI_ANY_SOURCE, TAG_JOB_RECORD, MPI_COMM_WORLD, &ready, &probe);
+    if (!ready) {
+      break;
+    }
+    int length = 0;
+    MPI_Get_count(&probe, MPI_CHAR, &length);
+    char *record = malloc((size_t) length + 1);
+    if (!record) {
+      MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    MPI_Recv(record, length, MPI_CHAR, probe.MPI_SOURCE, TAG_JOB_RECORD, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    DaemonJob *job = daemon_job_for_rank(relay, probe.MPI_SOURCE);
+    if (job) {
+      if (job->request.client_fd >= 0 && job_server_write(job->request.client_fd, record, (size_t) length) != 0) {
+        logger_log(relay->logger, LOG_LEVEL_WARN, "Daemon client of ranks %d-%d stopped reading results: %s",
+                   job->first_rank, job->first_rank + job->ranks - 1, strerror(errno));
+        close(job->request.client_fd);
+        job->request.client_fd = -1;
+      }
+      job->relayed++;
+    }
+    free(record);
+    progress = true;
+  }
+  for (;;) {
+    int ready = 0;
+    MPI_Status probe;
+    MPI_Iprobe(MPI_ANY_SOURCE, TAG_JOB_RESULT, MPI_COMM_WORLD, &ready, &probe);
+    if (!ready) {
+      break;
+    }
+    unsigned long long result[2];
+    MPI_Recv(result, 2, MPI_UNSIGNED_LONG_LONG, probe.MPI_SOURCE, TAG_JOB_RESULT, MPI_COMM_WORLD,
+             MPI_STATUS_IGNORE);
+    DaemonJob *job = daemon_job_for_rank(relay, probe.MPI_SOURCE);
+    if (job) {
+      job->reported = true;
+      job->rc = result[0] == 0 ? 0 : -1;
+      job->records = result[1];
+    }
+    progress = true;
+  }
+  for (int j = 0; j < relay->count; ++j) {
+    DaemonJob *job = &relay->jobs[j];
+    if (job->reported && job->relayed == job->records) {
+      daemon_merge_results(relay, j);
+      daemon_reply(job, job->rc, relay->logger);
+      job->reported = false;
+      relay->open--;
+    }
+  }
+  return progress;
+}
+
+/* Installed as the record hook while rank 0 runs its own group, so other groups keep streaming. */
+static void daemon_relay_hook(void *data) {
+  while (daemon_relay_pending(data)) {
+  }
+}
+
+/* Rank 0 accepts jobs on a Unix socket. Jobs queued at the same time form a batch: MPI_Comm_split
+ * carves the world into one group per job, each group runs the usual pipeline on its own
+ * communicator, and groups are re-formed for the next batch. Ranks keep their warm API clients.
+ * Results stream back chunk by chunk through rank 0 (see JobStream). */
+static int run_daemon_session(ProgramConfig *config, Logger *logger) {
+  int rank = config->rank;
+  int world_size = config->world_size;
+  int listen_fd = -1;
+  int command = DAEMON_RUN_BATCH;
+  if (rank == 0) {
+    char *error = NULL;
+    listen_fd = job_server_listen(config->daemon_socket, &error);
+    if (listen_fd < 0) {
+      logger_log(logger, LOG_LEVEL_ERROR, "Daemon cannot listen: %s", error ? error : "unknown error");
+      command = DAEMON_STOP;
+    } else {
+      logger_log(logger, LOG_LEVEL_INFO, "Daemon listening on %s with %d warm ranks", config->daemon_socket,
+                 world_size);
+    }
+    free(error);
+  }
+  MPI_Bcast(&command, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  int status = command == DAEMON_STOP ? -1 : 0;
+
+  size_t limit = config->job_groups > 0 && config->job_groups < world_size ? (size_t) config->job_groups
+                                                                            : (size_t) world_size;
+  DaemonJob *jobs = rank == 0 ? calloc(limit, sizeof *jobs) : NULL;
+  int *layout = malloc(2 * limit * sizeof(int));
+  if ((rank == 0 && !jobs) || !layout) {
+    logger_log(logger, LOG_LEVEL_ERROR, "Rank %d cannot allocate daemon job table", rank);
+    MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+  }
+  bool shutdown = false;
+  /* Jobs finished before this batch; every rank counts them, so job ids need no extra broadcast. */
+  unsigned long long jobs_done = 0;
+  StringBuffer arrow_started;
+  sb_init(&arrow_started);
+
+  while (command != DAEMON_STOP) {
+    int count = 0;
+    StringBuffer options;
+    sb_init(&options);
+    if (rank == 0) {
+      count = (int) daemon_collect_batch(listen_fd, config, logger, jobs, limit, &shutdown);
+      daemon_size_groups(jobs, (size_t) count, world_size);
+      for (int j = 0; j < count; ++j) {
+        layout[2 * j] = jobs[j].first_rank;
+        layout[2 * j + 1] = jobs[j].ranks;
+        sb_append_str(&options, jobs[j].request.options ? jobs[j].request.options : "");
+        sb_append_char(&options, '\0');
+      }
+      command = count > 0 ? DAEMON_RUN_BATCH : (shutdown ? DAEMON_STOP : DAEMON_SKIP);
+      if (count > 1) {
+        logger_log(logger, LOG_LEVEL_INFO, "Daemon batch of %d jobs across %d ranks", count, world_size);
+      }
+    }
+    broadcast_int_idle(&command);
+    if (command != DAEMON_RUN_BATCH) {
+      sb_clean(&options);
+      continue;
+    }
+
+    MPI_Bcast(&count, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(layout, 2 * count, MPI_INT, 0, MPI_COMM_WORLD);
+    unsigned long long options_len = (unsigned long long) options.length;
+    MPI_Bcast(&options_len, 1, MPI_UNSIGNED_LONG_LONG, 0, MPI_COMM_WORLD);
+    if (rank != 0 && options_len > 0 && sb_reserve(&options, (size_t) options_len) != 0) {
+      logger_log(logger, LOG_LEVEL_ERROR, "Rank %d cannot allocate job options; stopping daemon", rank);
+      MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    broadcast_payload(options.data, (size_t) options_len, MPI_COMM_WORLD);
+
+    int my_job = -1;
+    const char *my_options = options.data;
+    for (int j = 0; j < count; ++j) {
+      if (rank >= layout[2 * j] && rank < layout[2 * j] + layout[2 * j + 1]) {
+        my_job = j;
+        break;
+      }
+      my_options += strlen(my_options) + 1;
+    }
+    MPI_Comm group = MPI_COMM_NULL;
+    MPI_Comm_split(MPI_COMM_WORLD, my_job >= 0 ? my_job : MPI_UNDEFINED, rank, &group);
+    DaemonRelay relay = {jobs, count, count, logger, config, options.data, jobs_done + 1, &arrow_started};
+
+    if (rank == 0) {
+      for (int j = 1; j < count; ++j) {
+        unsigned long long len64 = (unsigned long long) jobs[j].payload.length;
+        MPI_Send(&len64, 1, MPI_UNSIGNED_LONG_LONG, jobs[j].first_rank, TAG_JOB_PAYLOAD, MPI_COMM_WORLD);
+        send_blob(jobs[j].payload.data, jobs[j].payload.length, jobs[j].first_rank, TAG_JOB_PAYLOAD,
+                  MPI_COMM_WORLD);
+        free(jobs[j].payload.data);
+        jobs[j].payload.data = NULL;
+      }
+    }
+
+    if (my_job >= 0) {
+      int group_rank = 0;
+      int group_size = 1;
+      MPI_Comm_rank(group, &group_rank);
+      MPI_Comm_size(group, &group_size);
+      bool leader = group_rank == 0;
+      Payload payload = {0};
+      if (rank == 0) {
+        payload = jobs[0].payload;
+        jobs[0].payload.data = NULL;
+      } else if (leader) {
+        unsigned long long len64 = 0;
+        MPI_Recv(&len64, 1, MPI_UNSIGNED_LONG_LONG, 0, TAG_JOB_PAYLOAD, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        payload.length = (size_t) len64;
+        payload.data = recv_blob(payload.length, 0, TAG_JOB_PAYLOAD, MPI_COMM_WORLD);
+      }
+
+      ProgramConfig job;
+      char *job_error = NULL;
+      int rc = build_job_config(config, my_options, group_rank, group_size, &job, &job_error);
+      bool job_built = rc == 0;
+      unsigned long long job_id = jobs_done + (unsigned long long) my_job + 1;
+      char *results_stream = NULL;
+      if (rc == 0 && job.results_arrow) {
+        results_stream = daemon_results_path(job.results_arrow, job_id);
+        config_replace_string(&job.results_arrow, results_stream);
+        job.results_arrow_started = false;
+      }
+      /* Groups run side by side with chunk indices and group ranks of their own, so each job needs a
+       * response directory of its own or their chunk files would overwrite each other. */
+      if (rc == 0 && job.response_dir) {
+        StringBuffer dir;
+        sb_init(&dir);
+        size_t dir_len = strlen(job.response_dir);
+        sb_append_printf(&dir, "%s%sjob-%06llu", job.response_dir,
+                         dir_len > 0 && job.response_dir[dir_len - 1] == '/' ? "" : "/", job_id);
+        config_replace_string(&job.response_dir, dir.data);
+        sb_clean(&dir);
+      }
+      if (rc == 0) {
+        rc = prepare_chunk_policies(&job, logger, &job_error);
+        if (leader) {
+          adjust_chunking_for_payload(&job, &payload, logger);
+        }
+      }
+      if (rc != 0) {
+        logger_log(logger, LOG_LEVEL_ERROR, "Daemon job %d failed on rank %d: %s", my_job, rank,
+                   job_error ? job_error : "unknown error");
+        free(payload.data);
+        payload.data = NULL;
+        payload.length = 0;
+      }
+      g_job_stream.active = true;
+      g_job_stream.posted = 0;
+      g_job_stream.client_fd = rank == 0 ? jobs[0].request.client_fd : -1;
+      g_job_stream.relay = rank == 0 ? daemon_relay_hook : NULL;
+      g_job_stream.relay_data = rank == 0 ? &relay : NULL;
+      /* Ranks of a group have run different jobs before this one; numbering payloads by job keeps the
+       * payload column of --results-arrow (and the memory profile) the same across the group. */
+      g_payload_sequence = job_id - 1;
+      if (rc == 0) {
+        rc = execute_payload(&job, logger, &payload, NULL, group);
+      }
+      g_job_stream.active = false;
+      if (job_built) {
+        config_free(&job);
+      }
+      free(job_error);
+
+      /* Every record is posted by now; the leader tells rank 0 how many to expect before closing the job. */
+      unsigned long long records = 0;
+      MPI_Reduce(&g_job_stream.posted, &records, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, 0, group);
+      if (rank == 0) {
+        jobs[0].reported = true;
+        jobs[0].rc = rc;
+        jobs[0].records = records;
+      } else if (leader) {
+        unsigned long long result[2] = {(unsigned long long) (rc == 0 ? 0 : 1), records};
+        MPI_Send(result, 2, MPI_UNSIGNED_LONG_LONG, 0, TAG_JOB_RESULT, MPI_COMM_WORLD);
+        if (results_stream) {
+          daemon_ship_results(results_stream, logger, rank);
+        }
+      }
+      free(results_stream);
+      MPI_Comm_free(&group);
+    }
+
+    /* Keep relaying until every group has finished; the senders wait for their records to be taken. */
+    if (rank == 0) {
+      while (relay.open > 0) {
+        if (!daemon_relay_pending(&relay)) {
+          struct timespec pause = {0, 1000000L};
+          nanosleep(&pause, NULL);
+        }
+      }
+      if (shutdown) {
+        command = DAEMON_STOP;
+      }
+    } else {
+      job_stream_reap(true);
+    }
+    jobs_done += (unsigned long long) count;
+    sb_clean(&options);
+    broadcast_int_idle(&command);
+  }
+
+  if (rank == 0 && listen_fd >= 0) {
+    job_server_close(listen_fd, config->daemon_socket);
   }
-  return *tui_log_active;
+  free(jobs);
+  free(layout);
+  sb_clean(&arrow_started);
+  if (g_warm_client_ready) {
+    api_client_cleanup(&g_warm_client);
+    g_warm_client_ready = false;
+  }
+  prepare_chunk_policies(config, logger, NULL);
+  return status;
 }
 
-static int run_repl_session(ProgramConfig *config, Logger *logger, bool *tui_log_active) {
-  if (!config || !logger) {
+/* --plan: rank 0 captures, normalises, chunks, filters and dedups the payload exactly like a run would,
+ * then prices it with the token estimator and replays the schedule against the latency model
+ * (latency_overhead_ms + completion tokens / output_tokens_per_second per request). Nothing is
+ * broadcast and no request is sent. */
+static int run_plan_session(ProgramConfig *config, Logger *logger) {
+  if (config->rank != 0) {
+    return 0;
+  }
+  Payload payload = {0};
+  if (gather_payload_root(config, logger, &payload) != 0) {
     return -1;
   }
-  StringBuffer history;
-  sb_init(&history);
-  ReplTurnLedger turn_ledger;
-  repl_turn_ledger_init(&turn_ledger);
-  size_t turn = 1;
-  int running = 1;
-  while (running) {
-    Payload prompt = {0};
-    int ready = 0;
-    if (config->rank == 0) {
-      if (gather_payload_root(config, logger, &prompt) == 0) {
-        ready = 1;
-        if (repl_should_exit(prompt.data, prompt.length)) {
-          running = 0;
-        }
-      } else {
-        ready = 0;
+  int ranks = config->plan_ranks > 0 ? config->plan_ranks : config->world_size;
+  bool coordinated = (config->coordinator_mode || config->resilient_mode) && ranks > 1;
+  int workers = coordinated ? ranks - 1 : ranks;
+  adjust_chunking_for_payload(config, &payload, logger);
+  AutotuneChoice tuned;
+  char key[1024];
+  autotune_cache_key(config, workers, key, sizeof key);
+  bool cached = config->autotune && config->autotune_cache &&
+                autotune_cache_load(config->autotune_cache, key, &tuned) == 0;
+  if (cached) {
+    config->chunk_size = tuned.chunk_size;
+    config->max_inflight = tuned.window;
+  }
+  int inflight = config->max_inflight > 0 && config->max_inflight < workers ? config->max_inflight : workers;
+
+  ChunkPlan plan;
+  chunk_plan_init(&plan);
+  if (chunk_plan_build(&plan, config->chunk_size, payload.length, 0, 1) != 0) {
+    logger_log(logger, LOG_LEVEL_ERROR, "Cannot allocate the chunk plan");
+    chunk_plan_free(&plan);
+    free(payload.data);
+    return -1;
+  }
+  size_t filtered = 0;
+  for (size_t i = 0; g_chunk_filter.active && i < plan.count; ++i) {
+    ChunkTask *task = &plan.tasks[i];
+    if (!chunk_filter_matches(&g_chunk_filter, payload.data + task->start, task->end - task->start)) {
+      task->skip = true;
+      filtered++;
+    }
+  }
+  size_t deduplicated = 0;
+  size_t clustered = 0;
+  if (config->dedup_chunks) {
+    chunk_dedup_exchange(&plan, payload.data, MPI_COMM_SELF, &deduplicated, NULL);
+  }
+  if (config->near_dedup) {
+    chunk_dedup_near_exchange(&plan, payload.data, config->near_dedup_threshold, MPI_COMM_SELF, &clustered, NULL);
+  }
+
+  size_t count = plan.count;
+  double *latency = calloc(count + 1, sizeof *latency);
+  double *costs = calloc(count + 1, sizeof *costs);
+  size_t *order = malloc((count + 1) * sizeof *order);
+  int *owners = malloc((count + 1) * sizeof *owners);
+  double *loads = calloc((size_t) inflight, sizeof *loads);
+  if (!latency || !costs || !order || !owners || !loads) {
+    MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+  }
+  const char *system_prompt = config->system_prompt ? config->system_prompt : "";
+  double system_tokens = chunk_cost_estimate_tokens(system_prompt, strlen(system_prompt));
+  double input_tokens = 0.0;
+  double output_tokens = 0.0;
+  double max_input = 0.0;
+  size_t requests = 0;
+  double overhead = (double) config->latency_overhead_ms / 1000.0;
+  bool verbose = config->verbosity >= 2;
+  if (verbose) {
+    printf("%8s %10s %8s %8s %9s\n", "chunk", "bytes", "in_tok", "out_tok", "seconds");
+  }
+  for (size_t i = 0; i < count; ++i) {
+    const ChunkTask *task = &plan.tasks[i];
+    const char *chunk = payload.data + task->start;
+    size_t len = task->end - task->start;
+    costs[i] = chunk_cost_predict(&g_cost_model, i, chunk, len);
+    if (task->skip) {
+      continue;
+    }
+    double prompt = chunk_cost_estimate_tokens(chunk, len);
+    double completion = chunk_cost_expected_completion(prompt, config->max_output_tokens);
+    double in = system_tokens + prompt;
+    latency[i] = overhead + completion / (double) config->output_tokens_per_second;
+    input_tokens += in;
+    output_tokens += completion;
+    max_input = in > max_input ? in : max_input;
+    requests++;
+    if (verbose) {
+      printf("%8zu %10zu %8.0f %8.0f %9.2f\n", task->index, len, in, completion, latency[i]);
+    }
+  }
+
+  /* Replays the scheduler: static runs deal chunks round-robin (or by predicted cost with --cost-model)
+   * and each rank works through its share; --resilient hands the next chunk to whichever worker is free. */
+  bool cost_ordered = chunk_cost_active(&g_cost_model);
+  if (cost_ordered) {
+    chunk_order_by_cost(costs, count, order);
+  } else {
+    for (size_t i = 0; i < count; ++i) {
+      order[i] = i;
+    }
+  }
+  if (config->resilient_mode && ranks > 1) {
+    chunk_assign_least_loaded(order, count, latency, inflight, owners, loads);
+  } else {
+    if (cost_ordered) {
+      chunk_assign_least_loaded(order, count, costs, inflight, owners, NULL);
+    }
+    for (size_t i = 0; i < count; ++i) {
+      loads[cost_ordered ? owners[i] : (int) (i % (size_t) inflight)] += latency[i];
+    }
+  }
+  double makespan = 0.0;
+  for (int r = 0; r < inflight; ++r) {
+    makespan = loads[r] > makespan ? loads[r] : makespan;
+  }
+  double throttled = config->autotune_rpm > 0 ? (double) requests * 60.0 / (double) config->autotune_rpm : 0.0;
+  double wall = throttled > makespan ? throttled : makespan;
+  double input_cost = input_tokens * config->price_input / 1e6;
+  double output_cost = output_tokens * config->price_output / 1e6;
+
+  printf("Plan for a %zu-byte payload (chunk size %zu%s) on %d rank(s), %d in flight\n", payload.length,
+         config->chunk_size, cached ? ", from the autotune cache" : "", ranks, inflight);
+  printf("  chunks:        %zu total, %zu filtered, %zu deduplicated -> %zu requests\n", count, filtered,
+         deduplicated + clustered, requests);
+  printf("  input tokens:  %.0f (%.0f per request on average, %.0f at most)\n", input_tokens,
+         requests ? input_tokens / (double) requests : 0.0, max_input);
+  printf("  output tokens: %.0f (capped at %d per request)\n", output_tokens,
+         config->max_output_tokens > 0 ? config->max_output_tokens : AI_DEFAULT_MAX_OUTPUT_TOKENS);
+  printf("  cost:          $%.4f (input $%.4f at $%g/M, output $%.4f at $%g/M)\n", input_cost + output_cost,
+         input_cost, config->price_input, output_cost, config->price_output);
+  printf("  wall time:     %.1f s (%ld ms + %d tokens/s per request", wall, config->latency_overhead_ms,
+         config->output_tokens_per_second);
+  if (throttled > makespan) {
+    printf("; held back by the %d requests/minute limit", config->autotune_rpm);
+  }
+  printf(")\n");
+  logger_log(logger, LOG_LEVEL_INFO, "Plan: %zu requests, %.0f input + %.0f output tokens, $%.4f, %.1f s on %d ranks",
+             requests, input_tokens, output_tokens, input_cost + output_cost, wall, ranks);
+
+  free(latency);
+  free(costs);
+  free(order);
+  free(owners);
+  free(loads);
+  chunk_plan_free(&plan);
+  free(payload.data);
+  return 0;
+}
+
+static const char *stream_cut_label(StreamCutReason reason) {
+  switch (reason) {
+  case STREAM_CUT_SIZE:
+    return "size";
+  case STREAM_CUT_WINDOW:
+    return "window";
+  default:
+    return "end of stream";
+  }
+}
+
+/* Rank 0 cuts stdin (or a FIFO named by --input-file) into micro-batches; each batch runs through the
+ * normal pipeline on every rank and its responses are printed as soon as it completes. */
+static int run_stream_session(ProgramConfig *config, Logger *logger) {
+  int rank = config->rank;
+  StreamBatcher batcher;
+  int fd = -1;
+  int command = 1;
+  if (rank == 0) {
+    const char *path = config->input_file && strcmp(config->input_file, "-") != 0 ? config->input_file : NULL;
+    fd = path ? open(path, O_RDONLY) : STDIN_FILENO;
+    if (fd < 0 || stream_batcher_init(&batcher, fd, config->stream_batch_bytes, config->stream_window_ms) != 0) {
+      logger_log(logger, LOG_LEVEL_ERROR, "Cannot stream from %s: %s", path ? path : "stdin",
+                 fd < 0 ? strerror(errno) : "unable to allocate batch buffer");
+      command = 0;
+    } else {
+      logger_log(logger, LOG_LEVEL_INFO, "Streaming from %s in batches of up to %zu bytes or %d ms",
+                 path ? path : "stdin", config->stream_batch_bytes, config->stream_window_ms);
+      /* Keep reading while batches run; without the thread each batch is read only after the last one. */
+      char *error = NULL;
+      if (stream_batcher_start(&batcher, STREAM_BATCHER_QUEUE_DEPTH, &error) != 0) {
+        logger_log(logger, LOG_LEVEL_WARN, "Stream reader thread unavailable (%s); reading between batches",
+                   error ? error : "unknown error");
       }
+      free(error);
     }
+  }
+  MPI_Bcast(&command, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  int status = command ? 0 : -1;
 
-    MPI_Bcast(&running, 1, MPI_INT, 0, MPI_COMM_WORLD);
-    if (!running) {
-      if (prompt.data) {
-        free(prompt.data);
+  size_t batch_id = 0;
+  while (command) {
+    Payload payload = {0};
+    if (rank == 0) {
+      StreamCutReason reason = STREAM_CUT_EOF;
+      char *error = NULL;
+      int rc = stream_batcher_next(&batcher, &payload.data, &payload.length, &reason, &error);
+      if (rc < 0) {
+        logger_log(logger, LOG_LEVEL_ERROR, "Stream read failed: %s", error ? error : "unknown error");
+        status = -1;
+      } else if (rc > 0) {
+        logger_log(logger, LOG_LEVEL_INFO, "Stream batch %zu: %zu bytes (closed by %s)", batch_id + 1,
+                   payload.length, stream_cut_label(reason));
       }
+      free(error);
+      command = rc > 0;
+    }
+    broadcast_int_idle(&command);
+    if (!command) {
       break;
     }
+    batch_id++;
 
-    int ready_flag = ready;
-    MPI_Bcast(&ready_flag, 1, MPI_INT, 0, MPI_COMM_WORLD);
-    if (!ready_flag) {
-      if (prompt.data) {
-        free(prompt.data);
+    /* Per-batch response directory so chunk files from successive batches do not overwrite each other. */
+    ProgramConfig batch;
+    if (config_clone(config, &batch) != 0) {
+      logger_log(logger, LOG_LEVEL_ERROR, "Rank %d cannot allocate batch config; stopping stream", rank);
+      MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    if (batch.response_dir) {
+      StringBuffer dir;
+      sb_init(&dir);
+      size_t dir_len = strlen(batch.response_dir);
+      sb_append_printf(&dir, "%s%sbatch-%06zu", batch.response_dir,
+                       dir_len > 0 && batch.response_dir[dir_len - 1] == '/' ? "" : "/", batch_id);
+      config_replace_string(&batch.response_dir, dir.data);
+      sb_clean(&dir);
+    }
+    if (rank == 0) {
+      normalize_payload_text(&batch, logger, &payload, "stream batch", NULL);
+      adjust_chunking_for_payload(&batch, &payload, logger);
+    }
+    execute_payload(&batch, logger, &payload, NULL, MPI_COMM_WORLD);
+    config->results_arrow_started = batch.results_arrow_started;
+    config_free(&batch);
+  }
+
+  if (rank == 0 && fd >= 0) {
+    stream_batcher_free(&batcher);
+    if (fd != STDIN_FILENO) {
+      close(fd);
+    }
+  }
+  if (rank == 0) {
+    logger_log(logger, LOG_LEVEL_INFO, "Stream closed after %zu batches", batch_id);
+  }
+  return status;
+}
+
+static volatile sig_atomic_t g_watch_stop = 0;
+
+static void watch_stop_handler(int signo) {
+  (void) signo;
+  g_watch_stop = 1;
+}
+
+static char *join_path(const char *dir, const char *name) {
+  StringBuffer path;
+  sb_init(&path);
+  size_t dir_len = strlen(dir);
+  sb_append_printf(&path, "%s%s%s", dir, dir_len > 0 && dir[dir_len - 1] == '/' ? "" : "/", name);
+  return sb_detach(&path);
+}
+
+/* Moves a finished spool file aside so it is neither reprocessed nor mistaken for new input. */
+static void retire_watched_file(const char *path, const char *target_dir, Logger *logger) {
+  const char *slash = strrchr(path, '/');
+  char *target = join_path(target_dir, slash ? slash + 1 : path);
+  if (!target || ensure_directory(target_dir) != 0 || rename(path, target) != 0) {
+    logger_log(logger, LOG_LEVEL_WARN, "Cannot move %s to %s: %s", path, target_dir, strerror(errno));
+  } else {
+    logger_log(logger, LOG_LEVEL_INFO, "Moved %s to %s", path, target);
+  }
+  free(target);
+}
+
+/* Rank 0 watches a spool directory; each new file runs through the normal pipeline on the ranks that
+ * are already up, with its responses under RESPONSE_DIR/<file name>/. SIGINT/SIGTERM stop the loop
+ * between files. */
+static int run_watch_session(ProgramConfig *config, Logger *logger) {
+  int rank = config->rank;
+  signal(SIGINT, watch_stop_handler);
+  signal(SIGTERM, watch_stop_handler);
+
+  DirWatcher watcher;
+  bool watching = false;
+  char *done_dir = NULL;
+  char *failed_dir = NULL;
+  int command = 1;
+  if (rank == 0) {
+    char *error = NULL;
+    if (dir_watcher_open(&watcher, config->watch_dir, &error) != 0) {
+      logger_log(logger, LOG_LEVEL_ERROR, "Cannot watch directory: %s", error ? error : "unknown error");
+      command = 0;
+    } else {
+      watching = true;
+      done_dir = config->watch_done_dir ? strdup(config->watch_done_dir) : join_path(config->watch_dir, "done");
+      failed_dir = join_path(config->watch_dir, "failed");
+      logger_log(logger, LOG_LEVEL_INFO, "Watching %s (%zu files already waiting)", config->watch_dir,
+                 watcher.count);
+    }
+    free(error);
+  }
+  MPI_Bcast(&command, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  int status = command ? 0 : -1;
+
+  size_t files = 0;
+  while (command) {
+    char *path = NULL;
+    if (rank == 0) {
+      command = 0;
+      while (!g_watch_stop) {
+        char *error = NULL;
+        int rc = dir_watcher_next(&watcher, 500, &path, &error);
+        if (rc < 0) {
+          logger_log(logger, LOG_LEVEL_ERROR, "Directory watch failed: %s", error ? error : "unknown error");
+          free(error);
+          status = -1;
+          break;
+        }
+        if (rc > 0) {
+          command = 1;
+          break;
+        }
       }
-      continue;
+    }
+    broadcast_int_idle(&command);
+    if (!command) {
+      break;
     }
 
-    Payload composite = {0};
-    if (config->rank == 0) {
-      build_repl_payload(&history, &prompt, turn, &composite);
-      adjust_chunking_for_payload(config, &composite, logger);
+    const char *slash = path ? strrchr(path, '/') : NULL;
+    unsigned long long name_len = rank == 0 ? (unsigned long long) strlen(slash ? slash + 1 : path) : 0ULL;
+    MPI_Bcast(&name_len, 1, MPI_UNSIGNED_LONG_LONG, 0, MPI_COMM_WORLD);
+    char *name = malloc((size_t) name_len + 1);
+    ProgramConfig job;
+    if (!name || config_clone(config, &job) != 0) {
+      logger_log(logger, LOG_LEVEL_ERROR, "Rank %d cannot allocate watch job; stopping", rank);
+      MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    if (rank == 0) {
+      memcpy(name, slash ? slash + 1 : path, (size_t) name_len);
+    }
+    MPI_Bcast(name, (int) name_len, MPI_CHAR, 0, MPI_COMM_WORLD);
+    name[name_len] = '\0';
+    if (job.response_dir) {
+      char *dir = join_path(job.response_dir, name);
+      config_replace_string(&job.response_dir, dir);
+      free(dir);
     }
 
-    StringBuffer repl_response;
-    if (config->rank == 0) {
-      sb_init(&repl_response);
+    Payload payload = {0};
+    if (rank == 0) {
+      config_replace_string(&job.input_file, path);
+      if (gather_payload_root(&job, logger, &payload) == 0) {
+        adjust_chunking_for_payload(&job, &payload, logger);
+      }
     }
-    if (config->rank == 0) {
-      start_tui_log_view_if_needed(config, logger, tui_log_active);
+    int rc = execute_payload(&job, logger, &payload, NULL, MPI_COMM_WORLD);
+    config->results_arrow_started = job.results_arrow_started;
+    files++;
+    if (rank == 0) {
+      retire_watched_file(path, rc == 0 ? done_dir : failed_dir, logger);
     }
-    int exec_rc = execute_payload(config, logger, &composite, config->rank == 0 ? &repl_response : NULL);
+    config_free(&job);
+    free(name);
+    free(path);
+  }
 
-    if (config->rank == 0) {
-      size_t turn_start = history.length;
-      sb_append_printf(&history, "User #%zu:\n%.*s\n", turn,
-                       (int) (prompt.length), prompt.data ? prompt.data : "");
-      if (exec_rc == 0 && repl_response.length > 0 && repl_response.data) {
-        sb_append_printf(&history, "Assistant #%zu:\n%.*s\n\n", turn,
-                         (int) repl_response.length, repl_response.data);
-        tui_repl_append_assistant(turn, repl_response.data, repl_response.length);
-      } else {
-        const char *fallback = "(no response available)";
-        sb_append_printf(&history, "Assistant #%zu:\n%s\n\n", turn, fallback);
-        tui_repl_append_assistant(turn, fallback, strlen(fallback));
+  if (rank == 0) {
+    if (watching) {
+      dir_watcher_close(&watcher);
+    }
+    logger_log(logger, LOG_LEVEL_INFO, "Stopped watching after %zu files", files);
+  }
+  free(done_dir);
+  free(failed_dir);
+  signal(SIGINT, SIG_DFL);
+  signal(SIGTERM, SIG_DFL);
+  return status;
+}
+
+/* Autoscale (threads) target: auto_scale_factor times the current ranks, capped by
+ * auto_scale_max_ranks or, when that is unset, by the MPI universe size. Returns ranks to add. */
+static int autoscale_spawn_count(const ProgramConfig *config, const Payload *payload, Logger *logger) {
+  if (config->auto_scale_mode != AUTOSCALE_MODE_THREADS || !payload->data || config->auto_scale_factor <= 1 ||
+      config->auto_scale_threshold_bytes == 0 || payload->length < config->auto_scale_threshold_bytes) {
+    return 0;
+  }
+  long target = (long) config->world_size * config->auto_scale_factor;
+  long limit = config->auto_scale_max_ranks;
+  if (limit <= 0) {
+    int *universe = NULL;
+    int flag = 0;
+    MPI_Comm_get_attr(MPI_COMM_WORLD, MPI_UNIVERSE_SIZE, &universe, &flag);
+    if (flag && universe && *universe > 0) {
+      limit = *universe;
+    }
+  }
+  if (limit > 0 && target > limit) {
+    target = limit;
+  }
+  int extra = (int) (target - config->world_size);
+  if (extra <= 0) {
+    logger_log(logger, LOG_LEVEL_INFO,
+               "Autoscale (threads) triggered for %zu-byte payload but no free slots (limit %ld ranks)",
+               payload->length, limit);
+    return 0;
+  }
+  logger_log(logger, LOG_LEVEL_INFO,
+             "Autoscale (threads) triggered: payload %zu bytes >= %zu bytes -> spawning %d worker ranks (%ld total)",
+             payload->length, config->auto_scale_threshold_bytes, extra, target);
+  return extra;
+}
+
+/* Collective over MPI_COMM_WORLD. Spawns extra copies of this binary with the same arguments and
+ * returns the merged communicator the payload should run on (MPI_COMM_WORLD when nothing was
+ * spawned). The parents keep ranks 0..N-1 in the merged communicator. */
+static MPI_Comm spawn_autoscale_workers(ProgramConfig *config, Logger *logger, const Payload *payload, char **argv,
+                                        MPI_Comm *intercomm_out) {
+  *intercomm_out = MPI_COMM_NULL;
+  int extra = config->rank == 0 ? autoscale_spawn_count(config, payload, logger) : 0;
+  MPI_Bcast(&extra, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  if (extra <= 0) {
+    return MPI_COMM_WORLD;
+  }
+  char command[PATH_MAX];
+  ssize_t len = readlink("/proc/self/exe", command, sizeof command - 1);
+  if (len > 0) {
+    command[len] = '\0';
+  } else {
+    snprintf(command, sizeof command, "%s", argv[0]);
+  }
+
+  MPI_Comm intercomm = MPI_COMM_NULL;
+  MPI_Comm_set_errhandler(MPI_COMM_WORLD, MPI_ERRORS_RETURN);
+  int rc = MPI_Comm_spawn(command, argv + 1, extra, MPI_INFO_NULL, 0, MPI_COMM_WORLD, &intercomm,
+                          MPI_ERRCODES_IGNORE);
+  MPI_Comm_set_errhandler(MPI_COMM_WORLD, MPI_ERRORS_ARE_FATAL);
+  if (rc != MPI_SUCCESS || intercomm == MPI_COMM_NULL) {
+    char reason[MPI_MAX_ERROR_STRING];
+    int reason_len = 0;
+    MPI_Error_string(rc, reason, &reason_len);
+    logger_log(logger, LOG_LEVEL_WARN, "Autoscale spawn of %d ranks failed (%s); continuing with %d ranks", extra,
+               reason, config->world_size);
+    return MPI_COMM_WORLD;
+  }
+  MPI_Comm merged = MPI_COMM_NULL;
+  MPI_Intercomm_merge(intercomm, 0, &merged);
+  int merged_size = config->world_size;
+  MPI_Comm_size(merged, &merged_size);
+  config->world_size = merged_size;
+  *intercomm_out = intercomm;
+  return merged;
+}
+
+static void release_autoscale_workers(ProgramConfig *config, MPI_Comm *work_comm, MPI_Comm *intercomm) {
+  if (*intercomm == MPI_COMM_NULL) {
+    return;
+  }
+  MPI_Comm_free(work_comm);
+  MPI_Comm_disconnect(intercomm);
+  MPI_Comm_size(MPI_COMM_WORLD, &config->world_size);
+  *work_comm = MPI_COMM_WORLD;
+}
+
+#define NUMA_MAP_ENTRY 256
+
+/* Collective over comm. With --numa-bind, the ranks sharing a host are spread evenly over the NUMA
+ * domains they may run on, before they allocate the payload or any curl state; a rank the launcher
+ * already confined to one domain keeps that binding. Rank 0 then logs where every rank runs. */
+static void place_ranks_on_numa(const ProgramConfig *config, Logger *logger, MPI_Comm comm) {
+  int rank = 0;
+  int size = 1;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &size);
+  NumaTopology topology;
+  char *error = NULL;
+  bool loaded = numa_topology_load(&topology, &error) == 0;
+  if (!loaded) {
+    logger_log(logger, LOG_LEVEL_WARN, "NUMA topology unavailable: %s", error ? error : "unknown error");
+    free(error);
+    error = NULL;
+  }
+  if (config->numa_bind) {
+    MPI_Comm host_comm = MPI_COMM_NULL;
+    MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &host_comm);
+    int local_rank = 0;
+    int local_size = 1;
+    MPI_Comm_rank(host_comm, &local_rank);
+    MPI_Comm_size(host_comm, &local_size);
+    int *nodes = loaded ? malloc((size_t) topology.node_count * sizeof *nodes) : NULL;
+    int allowed = nodes ? numa_topology_allowed_nodes(&topology, nodes) : 0;
+    if (allowed > 1 && numa_topology_current_node(&topology) < 0) {
+      int node = nodes[(long long) local_rank * allowed / local_size];
+      if (numa_topology_bind_node(&topology, node, &error) != 0) {
+        logger_log(logger, LOG_LEVEL_WARN, "Rank %d keeps its CPU binding: %s", rank,
+                   error ? error : "unknown error");
+        free(error);
       }
-      size_t turn_chunk = history.length - turn_start;
-      repl_turn_ledger_append(&turn_ledger, turn_chunk);
-      repl_turn_ledger_trim(&turn_ledger, config->repl_history_limit, &history);
-      sb_clean(&repl_response);
     }
+    free(nodes);
+    MPI_Comm_free(&host_comm);
+  }
 
-    if (prompt.data) {
-      free(prompt.data);
+  char entry[NUMA_MAP_ENTRY];
+  char host[MPI_MAX_PROCESSOR_NAME];
+  int host_len = 0;
+  MPI_Get_processor_name(host, &host_len);
+  int prefix = snprintf(entry, sizeof entry, "rank %d on %.*s: ", rank, host_len > 64 ? 64 : host_len, host);
+  if (loaded) {
+    numa_topology_describe(&topology, entry + prefix, sizeof entry - (size_t) prefix);
+  } else {
+    snprintf(entry + prefix, sizeof entry - (size_t) prefix, "unknown");
+  }
+  char *entries = rank == 0 ? malloc((size_t) size * NUMA_MAP_ENTRY) : NULL;
+  if (rank == 0 && !entries) {
+    MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+  }
+  MPI_Gather(entry, NUMA_MAP_ENTRY, MPI_CHAR, entries, NUMA_MAP_ENTRY, MPI_CHAR, 0, comm);
+  if (rank == 0) {
+    StringBuffer map;
+    sb_init(&map);
+    sb_append_printf(&map, "Binding map (%d NUMA domain(s) on %.*s%s):", loaded ? topology.node_count : 1, host_len,
+                     host, config->numa_bind ? ", --numa-bind" : "");
+    for (int r = 0; r < size; ++r) {
+      sb_append_printf(&map, "\n  %s", entries + (size_t) r * NUMA_MAP_ENTRY);
     }
-    turn++;
+    logger_log(logger, LOG_LEVEL_INFO, "%s", map.data);
+    sb_clean(&map);
+    free(entries);
   }
-  sb_clean(&history);
-  repl_turn_ledger_free(&turn_ledger);
-  if (config->rank == 0 && config->use_tui && config->repl_mode) {
-    tui_repl_shutdown();
+  if (loaded) {
+    numa_topology_free(&topology);
   }
-  return 0;
+}
+
+/* Starts the per-rank disk writer that response files and input reads go through. */
+static void start_disk_io(const ProgramConfig *config, Logger *logger) {
+  AsyncIoBackend backend = async_io_start(config->io_backend, config->response_fsync);
+  if (config->io_backend != ASYNC_IO_AUTO && backend != config->io_backend) {
+    logger_log(logger, LOG_LEVEL_WARN, "Rank %d: %s disk I/O is unavailable here; using %s", config->rank,
+               async_io_backend_name(config->io_backend), async_io_backend_name(backend));
+  } else {
+    logger_log(logger, LOG_LEVEL_DEBUG, "Rank %d disk I/O backend: %s", config->rank,
+               async_io_backend_name(backend));
+  }
+}
+
+/* Entry point of a rank started by spawn_autoscale_workers: it parses the parent's arguments, joins
+ * the merged communicator as a plain worker for one payload, and exits. */
+static int run_spawned_worker(int argc, char **argv, MPI_Comm parent) {
+  MPI_Comm merged = MPI_COMM_NULL;
+  MPI_Intercomm_merge(parent, 1, &merged);
+  int rank = 0;
+  int size = 1;
+  MPI_Comm_rank(merged, &rank);
+  MPI_Comm_size(merged, &size);
+
+  ProgramConfig config = config_defaults();
+  config_record_rank(&config, rank, size);
+  cli_parse_args(argc, argv, &config);
+  config.use_tui = false;
+  config.use_readline_prompt = false;
+
+  Logger logger;
+  if (logger_init(&logger, config.log_file, rank, config.verbosity) != 0) {
+    logger.process_rank = rank;
+    logger.verbosity = config.verbosity;
+    logger.mirror_stdout = true;
+    logger.handle = NULL;
+  }
+  logger_log(&logger, LOG_LEVEL_INFO, "Autoscale worker joined as rank %d/%d", rank, size);
+  /* The spawned ranks place themselves among each other; the parents are already waiting on the payload. */
+  place_ranks_on_numa(&config, &logger, MPI_COMM_WORLD);
+  start_disk_io(&config, &logger);
+  prepare_chunk_policies(&config, &logger, NULL);
+  Payload payload = {0};
+  execute_payload(&config, &logger, &payload, NULL, merged);
+
+  MPI_Comm_free(&merged);
+  MPI_Comm_disconnect(&parent);
+  async_io_stop();
+  chunk_filter_free(&g_chunk_filter);
+  chunk_cost_free(&g_cost_model);
+  logger_log(&logger, LOG_LEVEL_INFO, "Autoscale worker rank %d released", rank);
+  logger_close(&logger);
+  config_free(&config);
+  MPI_Finalize();
+  return EXIT_SUCCESS;
 }
 
 int main(int argc, char **argv) {
   MPI_Init(&argc, &argv);
+  MPI_Comm parent = MPI_COMM_NULL;
+  MPI_Comm_get_parent(&parent);
+  if (parent != MPI_COMM_NULL) {
+    return run_spawned_worker(argc, argv, parent);
+  }
 
   int rank = 0;
   int world_size = 1;
@@ -1194,25 +4384,46 @@ int main(int argc, char **argv) {
 
   bool tui_log_active = false;
 
-  if (config.repl_mode) {
+  char *filter_error = NULL;
+  if (prepare_chunk_policies(&config, &logger, &filter_error) != 0) {
+    logger_log(&logger, LOG_LEVEL_ERROR, "Invalid chunk filter: %s", filter_error ? filter_error : "unknown error");
+    free(filter_error);
+    logger_close(&logger);
+    config_free(&config);
+    MPI_Finalize();
+    return EXIT_FAILURE;
+  }
+
+  if (!config.plan_mode) {
+    place_ranks_on_numa(&config, &logger, MPI_COMM_WORLD);
+  }
+  start_disk_io(&config, &logger);
+  if (config.plan_mode) {
+    run_plan_session(&config, &logger);
+  } else if (config.daemon_mode) {
+    run_daemon_session(&config, &logger);
+  } else if (config.stream_mode) {
+    run_stream_session(&config, &logger);
+  } else if (config.watch_dir) {
+    run_watch_session(&config, &logger);
+  } else if (config.repl_mode) {
     run_repl_session(&config, &logger, &tui_log_active);
   } else {
     Payload payload = {0};
-    int ready = 0;
     if (rank == 0) {
-      ready = (gather_payload_root(&config, &logger, &payload) == 0) ? 1 : 0;
+      if (gather_payload_root(&config, &logger, &payload) == 0) {
+        start_tui_log_view_if_needed(&config, &logger, &tui_log_active);
+      }
     }
-    if (ready) {
-      start_tui_log_view_if_needed(&config, &logger, &tui_log_active);
-      execute_payload(&config, &logger, &payload, NULL);
-    } else {
+    MPI_Comm intercomm = MPI_COMM_NULL;
+    MPI_Comm work_comm = spawn_autoscale_workers(&config, &logger, &payload, argv, &intercomm);
+    if (rank == 0) {
+      adjust_chunking_for_payload(&config, &payload, &logger);
+    }
+    if (execute_payload(&config, &logger, &payload, NULL, work_comm) != 0) {
       logger_log(&logger, LOG_LEVEL_ERROR, "Aborting because root rank failed to prepare payload");
-      if (payload.data) {
-        free(payload.data);
-        payload.data = NULL;
-        payload.length = 0;
-      }
     }
+    release_autoscale_workers(&config, &work_comm, &intercomm);
   }
 
   if (tui_log_active) {
@@ -1224,7 +4435,21 @@ int main(int argc, char **argv) {
     g_tui_log_from_repl = false;
   }
 
+  async_io_stop();
+  chunk_filter_free(&g_chunk_filter);
+  chunk_cost_free(&g_cost_model);
   logger_log(&logger, LOG_LEVEL_INFO, "Rank %d complete", rank);
+#ifndef DEEPSEEK_HAVE_ULFM
+  if (g_lost_ranks > 0) {
+    /* Timed-out ranks that reported back were released by the dispatcher. Without ULFM one that never did
+     * keeps MPI_Finalize waiting forever, so the job ends here, with a failure status since a rank is hung. */
+    logger_log(&logger, LOG_LEVEL_ERROR, "%zu rank(s) never reported back; ending the job with MPI_Abort",
+               g_lost_ranks);
+    logger_close(&logger);
+    config_free(&config);
+    MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+  }
+#endif
   logger_close(&logger);
   config_free(&config);
   MPI_Finalize();
@@ -0,0 +1,66 @@
+#include "memory_budget.h"
+
+static size_t budget_limit = 0;
+static size_t budget_used = 0;
+static size_t budget_peak = 0;
+static size_t interval_peak = 0;
+static size_t interval_allocations = 0;
+static size_t interval_bytes = 0;
+
+void memory_budget_set_limit(size_t bytes) {
+  budget_limit = bytes;
+}
+
+size_t memory_budget_limit(void) {
+  return budget_limit;
+}
+
+void memory_budget_charge(size_t bytes) {
+  budget_used += bytes;
+  if (budget_used > budget_peak) {
+    budget_peak = budget_used;
+  }
+  if (budget_used > interval_peak) {
+    interval_peak = budget_used;
+  }
+  interval_allocations++;
+  interval_bytes += bytes;
+}
+
+void memory_budget_release(size_t bytes) {
+  /* Buffers assembled by hand (not through sb_init) can be released without ever being charged. */
+  budget_used = bytes > budget_used ? 0 : budget_used - bytes;
+}
+
+void memory_budget_note(size_t bytes) {
+  memory_budget_charge(bytes);
+  memory_budget_release(bytes);
+}
+
+size_t memory_budget_used(void) {
+  return budget_used;
+}
+
+size_t memory_budget_peak(void) {
+  return budget_peak;
+}
+
+bool memory_budget_fits(size_t bytes) {
+  return budget_limit == 0 || (budget_used <= budget_limit && bytes <= budget_limit - budget_used);
+}
+
+void memory_budget_stats(MemoryBudgetStats *out) {
+  if (!out) {
+    return;
+  }
+  out->used = budget_used;
+  out->peak = interval_peak;
+  out->allocations = interval_allocations;
+  out->allocated_bytes = interval_bytes;
+}
+
+void memory_budget_reset_interval(void) {
+  interval_peak = budget_used;
+  interval_allocations = 0;
+  interval_bytes = 0;
+}
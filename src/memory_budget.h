@@ -0,0 +1,38 @@
+#ifndef MEMORY_BUDGET_H
+#define MEMORY_BUDGET_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Per-rank memory budget (--max-memory). Long-lived buffers (every StringBuffer, the shared payload)
+ * charge what they hold against one process-wide counter. Charging never fails an allocation; code that
+ * can move data out of memory or turn work away asks memory_budget_fits first. A limit of 0 means
+ * unlimited, but usage and its peak are still counted.
+ */
+void memory_budget_set_limit(size_t bytes);
+size_t memory_budget_limit(void);
+void memory_budget_charge(size_t bytes);
+void memory_budget_release(size_t bytes);
+/* Counts a one-off buffer whose lifetime is not tracked: it shows up in the allocation counters and
+ * the peak, but not in the running usage. */
+void memory_budget_note(size_t bytes);
+size_t memory_budget_used(void);
+size_t memory_budget_peak(void);
+/* True when bytes more would still be within the limit (always true without one). */
+bool memory_budget_fits(size_t bytes);
+
+/* Allocation counters for the memory profile: charges (buffer growths) and bytes charged since the last
+ * reset, and the highest usage seen since then. */
+typedef struct {
+  size_t used;
+  size_t peak;
+  size_t allocations;
+  size_t allocated_bytes;
+} MemoryBudgetStats;
+
+void memory_budget_stats(MemoryBudgetStats *out);
+/* Starts a new measuring interval: counters go to zero and the peak to current usage. */
+void memory_budget_reset_interval(void);
+
+#endif /* MEMORY_BUDGET_H */
@@ -0,0 +1,118 @@
+#define _GNU_SOURCE
+#include "memory_profile.h"
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "memory_budget.h"
+
+static void assign_error(char **error_out, const char *fmt, ...) {
+  if (!error_out) {
+    return;
+  }
+  va_list args;
+  va_start(args, fmt);
+  va_list copy;
+  va_copy(copy, args);
+  int needed = vsnprintf(NULL, 0, fmt, copy);
+  va_end(copy);
+  if (needed < 0) {
+    va_end(args);
+    return;
+  }
+  size_t size = (size_t) needed + 1;
+  char *msg = malloc(size);
+  if (!msg) {
+    va_end(args);
+    return;
+  }
+  vsnprintf(msg, size, fmt, args);
+  va_end(args);
+  *error_out = msg;
+}
+
+/* Resident pages from /proc/self/statm; 0 where procfs is not available. */
+static unsigned long long current_rss_kb(void) {
+  FILE *fp = fopen("/proc/self/statm", "r");
+  if (!fp) {
+    return 0;
+  }
+  unsigned long long size = 0;
+  unsigned long long resident = 0;
+  int matched = fscanf(fp, "%llu %llu", &size, &resident);
+  fclose(fp);
+  long page = sysconf(_SC_PAGESIZE);
+  return matched == 2 && page > 0 ? resident * (unsigned long long) page / 1024ULL : 0;
+}
+
+static unsigned long long peak_rss_kb(void) {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+  /* Linux reports ru_maxrss in kilobytes. */
+  return (unsigned long long) usage.ru_maxrss;
+}
+
+void memory_profile_mark(MemoryProfile *profile, MemoryPhase phase) {
+  if (!profile || phase >= MEMORY_PHASE_COUNT) {
+    return;
+  }
+  MemoryBudgetStats stats;
+  memory_budget_stats(&stats);
+  unsigned long long *row = profile->values[phase];
+  row[MEMORY_FIELD_RSS_KB] = current_rss_kb();
+  row[MEMORY_FIELD_PEAK_RSS_KB] = peak_rss_kb();
+  row[MEMORY_FIELD_TRACKED_PEAK] = stats.peak;
+  row[MEMORY_FIELD_ALLOCATIONS] = stats.allocations;
+  row[MEMORY_FIELD_ALLOCATED_BYTES] = stats.allocated_bytes;
+  memory_budget_reset_interval();
+}
+
+const char *memory_profile_phase_name(MemoryPhase phase) {
+  switch (phase) {
+  case MEMORY_PHASE_CAPTURE:
+    return "capture";
+  case MEMORY_PHASE_BROADCAST:
+    return "broadcast";
+  case MEMORY_PHASE_CHUNKS:
+    return "chunks";
+  case MEMORY_PHASE_GATHER:
+    return "gather";
+  default:
+    return "unknown";
+  }
+}
+
+int memory_profile_write_csv(const char *path, unsigned long long payload, const MemoryProfile *profiles,
+                             int count, char **error_out) {
+  if (!path || !profiles) {
+    return -1;
+  }
+  FILE *fp = fopen(path, "a");
+  if (!fp) {
+    assign_error(error_out, "cannot open %s: %s", path, strerror(errno));
+    return -1;
+  }
+  if (fseek(fp, 0, SEEK_END) == 0 && ftell(fp) == 0) {
+    fputs("payload,rank,phase,rss_kb,peak_rss_kb,tracked_peak_bytes,allocations,allocated_bytes\n", fp);
+  }
+  for (int r = 0; r < count; ++r) {
+    for (int p = 0; p < MEMORY_PHASE_COUNT; ++p) {
+      const unsigned long long *row = profiles[r].values[p];
+      fprintf(fp, "%llu,%d,%s,%llu,%llu,%llu,%llu,%llu\n", payload, r, memory_profile_phase_name((MemoryPhase) p),
+              row[MEMORY_FIELD_RSS_KB], row[MEMORY_FIELD_PEAK_RSS_KB], row[MEMORY_FIELD_TRACKED_PEAK],
+              row[MEMORY_FIELD_ALLOCATIONS], row[MEMORY_FIELD_ALLOCATED_BYTES]);
+    }
+  }
+  if (fclose(fp) != 0) {
+    assign_error(error_out, "cannot write %s: %s", path, strerror(errno));
+    return -1;
+  }
+  return 0;
+}
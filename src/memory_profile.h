@@ -0,0 +1,39 @@
+#ifndef MEMORY_PROFILE_H
+#define MEMORY_PROFILE_H
+
+#include <stddef.h>
+
+/**
+ * Per-phase memory samples for one payload. Each mark records the resident set size at the phase
+ * boundary, the process's peak RSS so far, and the budget counters (tracked peak, buffer growths and
+ * bytes) accumulated since the previous mark, so a phase's numbers cover only that phase.
+ */
+typedef enum {
+  MEMORY_PHASE_CAPTURE = 0, /* reading and extracting the input, up to execute_payload */
+  MEMORY_PHASE_BROADCAST,
+  MEMORY_PHASE_CHUNKS,      /* API requests, retries and result collection */
+  MEMORY_PHASE_GATHER,      /* printing and shipping responses to rank 0 */
+  MEMORY_PHASE_COUNT
+} MemoryPhase;
+
+typedef enum {
+  MEMORY_FIELD_RSS_KB = 0,
+  MEMORY_FIELD_PEAK_RSS_KB,
+  MEMORY_FIELD_TRACKED_PEAK,
+  MEMORY_FIELD_ALLOCATIONS,
+  MEMORY_FIELD_ALLOCATED_BYTES,
+  MEMORY_FIELD_COUNT
+} MemoryField;
+
+/* Flat so a rank's profile travels as one MPI_UNSIGNED_LONG_LONG array. */
+typedef struct {
+  unsigned long long values[MEMORY_PHASE_COUNT][MEMORY_FIELD_COUNT];
+} MemoryProfile;
+
+void memory_profile_mark(MemoryProfile *profile, MemoryPhase phase);
+const char *memory_profile_phase_name(MemoryPhase phase);
+/* Appends one CSV row per rank and phase to path, writing the header when the file is new. */
+int memory_profile_write_csv(const char *path, unsigned long long payload, const MemoryProfile *profiles,
+                             int count, char **error_out);
+
+#endif /* MEMORY_PROFILE_H */
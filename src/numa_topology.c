@@ -0,0 +1,240 @@
+#define _GNU_SOURCE
+#include "numa_topology.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <sched.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define NUMA_SYSFS_NODES "/sys/devices/system/node"
+
+static void assign_error(char **error_out, const char *fmt, ...) {
+  if (!error_out) {
+    return;
+  }
+  va_list args;
+  va_start(args, fmt);
+  va_list copy;
+  va_copy(copy, args);
+  int needed = vsnprintf(NULL, 0, fmt, copy);
+  va_end(copy);
+  if (needed < 0) {
+    va_end(args);
+    return;
+  }
+  size_t size = (size_t) needed + 1;
+  char *msg = malloc(size);
+  if (!msg) {
+    va_end(args);
+    return;
+  }
+  vsnprintf(msg, size, fmt, args);
+  va_end(args);
+  *error_out = msg;
+}
+
+/* Parses a kernel CPU list such as "0-3,8,10-11" and assigns every listed CPU below limit to node. */
+static void parse_cpu_list(const char *text, int limit, int node, int *node_of_cpu) {
+  const char *p = text;
+  while (*p) {
+    char *end = NULL;
+    long first = strtol(p, &end, 10);
+    if (end == p) {
+      break;
+    }
+    long last = first;
+    p = end;
+    if (*p == '-') {
+      last = strtol(p + 1, &end, 10);
+      p = end;
+    }
+    for (long cpu = first; cpu <= last && cpu < limit; ++cpu) {
+      if (cpu >= 0) {
+        node_of_cpu[cpu] = node;
+      }
+    }
+    if (*p != ',') {
+      break;
+    }
+    p++;
+  }
+}
+
+int numa_topology_load(NumaTopology *topology, char **error_out) {
+  if (!topology) {
+    return -1;
+  }
+  memset(topology, 0, sizeof *topology);
+  long configured = sysconf(_SC_NPROCESSORS_CONF);
+  topology->cpu_count = configured > CPU_SETSIZE ? CPU_SETSIZE : (configured > 0 ? (int) configured : 1);
+  topology->node_of_cpu = malloc((size_t) topology->cpu_count * sizeof *topology->node_of_cpu);
+  if (!topology->node_of_cpu) {
+    assign_error(error_out, "unable to allocate NUMA topology");
+    return -1;
+  }
+  for (int cpu = 0; cpu < topology->cpu_count; ++cpu) {
+    topology->node_of_cpu[cpu] = -1;
+  }
+  DIR *dir = opendir(NUMA_SYSFS_NODES);
+  if (dir) {
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+      int node = -1;
+      char tail = '\0';
+      if (sscanf(entry->d_name, "node%d%c", &node, &tail) != 1 || node < 0) {
+        continue;
+      }
+      char path[512];
+      snprintf(path, sizeof path, NUMA_SYSFS_NODES "/%s/cpulist", entry->d_name);
+      FILE *fp = fopen(path, "r");
+      if (!fp) {
+        continue;
+      }
+      char list[4096];
+      if (fgets(list, sizeof list, fp)) {
+        parse_cpu_list(list, topology->cpu_count, node, topology->node_of_cpu);
+        if (node + 1 > topology->node_count) {
+          topology->node_count = node + 1;
+        }
+      }
+      fclose(fp);
+    }
+    closedir(dir);
+  }
+  if (topology->node_count == 0) {
+    topology->node_count = 1;
+    for (int cpu = 0; cpu < topology->cpu_count; ++cpu) {
+      topology->node_of_cpu[cpu] = 0;
+    }
+  }
+  return 0;
+}
+
+void numa_topology_free(NumaTopology *topology) {
+  if (!topology) {
+    return;
+  }
+  free(topology->node_of_cpu);
+  memset(topology, 0, sizeof *topology);
+}
+
+static bool current_affinity(cpu_set_t *set) {
+  CPU_ZERO(set);
+  return sched_getaffinity(0, sizeof *set, set) == 0;
+}
+
+int numa_topology_current_node(const NumaTopology *topology) {
+  cpu_set_t set;
+  if (!topology || !current_affinity(&set)) {
+    return -1;
+  }
+  int node = -1;
+  for (int cpu = 0; cpu < topology->cpu_count; ++cpu) {
+    if (!CPU_ISSET(cpu, &set)) {
+      continue;
+    }
+    int owner = topology->node_of_cpu[cpu];
+    if (node >= 0 && owner != node) {
+      return -1;
+    }
+    node = owner;
+  }
+  return node;
+}
+
+int numa_topology_allowed_nodes(const NumaTopology *topology, int *nodes_out) {
+  cpu_set_t set;
+  if (!topology || !nodes_out || !current_affinity(&set)) {
+    return 0;
+  }
+  int count = 0;
+  for (int node = 0; node < topology->node_count; ++node) {
+    for (int cpu = 0; cpu < topology->cpu_count; ++cpu) {
+      if (topology->node_of_cpu[cpu] == node && CPU_ISSET(cpu, &set)) {
+        nodes_out[count++] = node;
+        break;
+      }
+    }
+  }
+  return count;
+}
+
+int numa_topology_bind_node(const NumaTopology *topology, int node, char **error_out) {
+  cpu_set_t allowed;
+  if (!topology || !current_affinity(&allowed)) {
+    assign_error(error_out, "cannot read CPU affinity: %s", strerror(errno));
+    return -1;
+  }
+  cpu_set_t target;
+  CPU_ZERO(&target);
+  for (int cpu = 0; cpu < topology->cpu_count; ++cpu) {
+    if (topology->node_of_cpu[cpu] == node && CPU_ISSET(cpu, &allowed)) {
+      CPU_SET(cpu, &target);
+    }
+  }
+  if (CPU_COUNT(&target) == 0) {
+    assign_error(error_out, "no usable CPUs on NUMA node %d", node);
+    return -1;
+  }
+  if (sched_setaffinity(0, sizeof target, &target) != 0) {
+    assign_error(error_out, "cannot bind to NUMA node %d: %s", node, strerror(errno));
+    return -1;
+  }
+  return 0;
+}
+
+static void append_text(char *out, size_t size, size_t *used, const char *fmt, ...) {
+  if (*used >= size) {
+    return;
+  }
+  va_list args;
+  va_start(args, fmt);
+  int written = vsnprintf(out + *used, size - *used, fmt, args);
+  va_end(args);
+  if (written > 0) {
+    *used += (size_t) written;
+  }
+}
+
+void numa_topology_describe(const NumaTopology *topology, char *out, size_t size) {
+  if (!out || size == 0) {
+    return;
+  }
+  out[0] = '\0';
+  cpu_set_t set;
+  if (!topology || !current_affinity(&set)) {
+    snprintf(out, size, "cpus unknown");
+    return;
+  }
+  size_t used = 0;
+  append_text(out, size, &used, "cpus ");
+  bool first = true;
+  for (int cpu = 0; cpu < topology->cpu_count; ++cpu) {
+    if (!CPU_ISSET(cpu, &set)) {
+      continue;
+    }
+    int last = cpu;
+    while (last + 1 < topology->cpu_count && CPU_ISSET(last + 1, &set)) {
+      last++;
+    }
+    if (last > cpu) {
+      append_text(out, size, &used, "%s%d-%d", first ? "" : ",", cpu, last);
+    } else {
+      append_text(out, size, &used, "%s%d", first ? "" : ",", cpu);
+    }
+    first = false;
+    cpu = last;
+  }
+  int *nodes = malloc((size_t) topology->node_count * sizeof *nodes);
+  int count = nodes ? numa_topology_allowed_nodes(topology, nodes) : 0;
+  append_text(out, size, &used, " numa ");
+  for (int i = 0; i < count; ++i) {
+    append_text(out, size, &used, "%s%d", i == 0 ? "" : ",", nodes[i]);
+  }
+  free(nodes);
+}
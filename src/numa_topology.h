@@ -0,0 +1,31 @@
+#ifndef NUMA_TOPOLOGY_H
+#define NUMA_TOPOLOGY_H
+
+#include <stddef.h>
+
+/**
+ * NUMA layout of this host as Linux reports it under /sys/devices/system/node. Hosts without that
+ * directory (or non-Linux systems) load as a single domain holding every CPU. Placement relies on the
+ * kernel's first-touch policy: once a rank runs on one domain's CPUs, the pages it writes first (the
+ * payload it receives, curl's buffers, response buffers) are allocated on that domain.
+ */
+typedef struct {
+  int cpu_count;
+  int node_count;
+  int *node_of_cpu; /* -1 for CPUs no domain lists */
+} NumaTopology;
+
+int numa_topology_load(NumaTopology *topology, char **error_out);
+void numa_topology_free(NumaTopology *topology);
+
+/* The domain every CPU the calling thread may run on belongs to, or -1 when they span several. */
+int numa_topology_current_node(const NumaTopology *topology);
+/* Number of domains holding at least one CPU the calling thread may run on; their ids go to nodes_out
+ * (room for topology->node_count entries). */
+int numa_topology_allowed_nodes(const NumaTopology *topology, int *nodes_out);
+/* Restricts the calling thread to the CPUs of one domain that it may already run on. */
+int numa_topology_bind_node(const NumaTopology *topology, int node, char **error_out);
+/* Writes the calling thread's binding, e.g. "cpus 0-7,16-23 numa 0". */
+void numa_topology_describe(const NumaTopology *topology, char *out, size_t size);
+
+#endif /* NUMA_TOPOLOGY_H */
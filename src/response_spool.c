@@ -0,0 +1,163 @@
+#define _GNU_SOURCE
+#include "response_spool.h"
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "memory_budget.h"
+
+static void assign_error(char **error_out, const char *fmt, ...) {
+  if (!error_out) {
+    return;
+  }
+  va_list args;
+  va_start(args, fmt);
+  va_list copy;
+  va_copy(copy, args);
+  int needed = vsnprintf(NULL, 0, fmt, copy);
+  va_end(copy);
+  if (needed < 0) {
+    va_end(args);
+    return;
+  }
+  size_t size = (size_t) needed + 1;
+  char *msg = malloc(size);
+  if (!msg) {
+    va_end(args);
+    return;
+  }
+  vsnprintf(msg, size, fmt, args);
+  va_end(args);
+  *error_out = msg;
+}
+
+void response_spool_init(ResponseSpool *spool) {
+  if (!spool) {
+    return;
+  }
+  memset(spool, 0, sizeof *spool);
+  sb_init(&spool->memory);
+}
+
+/* Moves the in-memory records to a temporary file that is unlinked at once, so it vanishes with the
+ * process however the run ends. */
+static int spool_spill(ResponseSpool *spool, char **error_out) {
+  const char *dir = getenv("TMPDIR");
+  if (!dir || !*dir) {
+    dir = "/tmp";
+  }
+  char path[4096];
+  snprintf(path, sizeof path, "%s/deepseek_mpi_spool_XXXXXX", dir);
+  int fd = mkstemp(path);
+  if (fd < 0) {
+    assign_error(error_out, "cannot create spool file in %s: %s", dir, strerror(errno));
+    return -1;
+  }
+  unlink(path);
+  FILE *fp = fdopen(fd, "w+b");
+  if (!fp) {
+    assign_error(error_out, "cannot open spool file: %s", strerror(errno));
+    close(fd);
+    return -1;
+  }
+  if (spool->memory.length > 0 && fwrite(spool->memory.data, 1, spool->memory.length, fp) != spool->memory.length) {
+    assign_error(error_out, "cannot write spool file: %s", strerror(errno));
+    fclose(fp);
+    return -1;
+  }
+  sb_clean(&spool->memory);
+  spool->spill = fp;
+  return 0;
+}
+
+int response_spool_add(ResponseSpool *spool, const char *data, size_t len, char **error_out) {
+  if (!spool || (!data && len > 0)) {
+    return -1;
+  }
+  if (spool->record_count == spool->record_capacity) {
+    size_t new_cap = spool->record_capacity ? spool->record_capacity * 2 : 64;
+    size_t *grown = realloc(spool->record_ends, new_cap * sizeof *grown);
+    if (!grown) {
+      assign_error(error_out, "unable to allocate spool index");
+      return -1;
+    }
+    spool->record_ends = grown;
+    spool->record_capacity = new_cap;
+  }
+  /* Once spilled the spool stays on disk. A failed spill is reported once and the records stay in memory. */
+  int rc = 0;
+  if (!spool->spill && !spool->spill_failed && !memory_budget_fits(len) && spool_spill(spool, error_out) != 0) {
+    spool->spill_failed = true;
+    rc = -1;
+  }
+  if (spool->spill) {
+    if (fseeko(spool->spill, 0, SEEK_END) != 0 || fwrite(data, 1, len, spool->spill) != len) {
+      assign_error(error_out, "cannot write spool file: %s", strerror(errno));
+      return -1;
+    }
+  } else if (sb_append(&spool->memory, data, len) != 0) {
+    assign_error(error_out, "unable to grow response buffer");
+    return -1;
+  }
+  spool->length += len;
+  spool->record_ends[spool->record_count++] = spool->length;
+  return rc;
+}
+
+bool response_spool_spilled(const ResponseSpool *spool) {
+  return spool && spool->spill;
+}
+
+size_t response_spool_length(const ResponseSpool *spool) {
+  return spool ? spool->length : 0;
+}
+
+int response_spool_read(ResponseSpool *spool, size_t *cursor, size_t max_bytes, StringBuffer *out,
+                        char **error_out) {
+  if (!spool || !cursor || !out) {
+    return -1;
+  }
+  size_t first = *cursor;
+  if (first >= spool->record_count) {
+    return 0;
+  }
+  size_t start = first > 0 ? spool->record_ends[first - 1] : 0;
+  size_t last = first + 1;
+  while (last < spool->record_count && spool->record_ends[last] - start <= max_bytes) {
+    last++;
+  }
+  size_t bytes = spool->record_ends[last - 1] - start;
+  if (sb_reserve(out, bytes) != 0) {
+    assign_error(error_out, "unable to allocate %zu bytes for spooled responses", bytes);
+    return -1;
+  }
+  if (spool->spill) {
+    if (fseeko(spool->spill, (off_t) start, SEEK_SET) != 0 ||
+        fread(out->data + out->length, 1, bytes, spool->spill) != bytes) {
+      assign_error(error_out, "cannot read spool file: %s", strerror(errno));
+      return -1;
+    }
+  } else {
+    memcpy(out->data + out->length, spool->memory.data + start, bytes);
+  }
+  out->length += bytes;
+  out->data[out->length] = '\0';
+  *cursor = last;
+  return 1;
+}
+
+void response_spool_free(ResponseSpool *spool) {
+  if (!spool) {
+    return;
+  }
+  sb_clean(&spool->memory);
+  if (spool->spill) {
+    fclose(spool->spill);
+  }
+  free(spool->record_ends);
+  memset(spool, 0, sizeof *spool);
+}
@@ -0,0 +1,40 @@
+#ifndef RESPONSE_SPOOL_H
+#define RESPONSE_SPOOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "string_buffer.h"
+
+/**
+ * Accumulates the per-chunk records a rank prints once its payload is done. Records stay in memory until
+ * one would push the rank past its memory budget; then everything moves to an unlinked temporary file
+ * (under $TMPDIR, else /tmp) and later records are appended there. Reads hand records back in batches so
+ * a consumer never holds more than one batch at a time.
+ */
+typedef struct {
+  StringBuffer memory;
+  FILE *spill;
+  bool spill_failed;
+  size_t length;
+  size_t *record_ends;
+  size_t record_count;
+  size_t record_capacity;
+} ResponseSpool;
+
+void response_spool_init(ResponseSpool *spool);
+/* Returns -1 when the record could not be stored, or when spilling failed and it was kept in memory. */
+int response_spool_add(ResponseSpool *spool, const char *data, size_t len, char **error_out);
+bool response_spool_spilled(const ResponseSpool *spool);
+size_t response_spool_length(const ResponseSpool *spool);
+/**
+ * Appends whole records, starting at record *cursor, to out until the next one would take the batch past
+ * max_bytes (a single larger record is still returned on its own). Returns 1 when records were read, 0
+ * once the spool is exhausted and -1 on a read error.
+ */
+int response_spool_read(ResponseSpool *spool, size_t *cursor, size_t max_bytes, StringBuffer *out,
+                        char **error_out);
+void response_spool_free(ResponseSpool *spool);
+
+#endif /* RESPONSE_SPOOL_H */
@@ -0,0 +1,639 @@
+#define _GNU_SOURCE
+#include "result_arrow.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* A record batch is written once either limit is reached. */
+#define RESULT_ARROW_BATCH_ROWS 4096U
+#define RESULT_ARROW_BATCH_BYTES (8U * 1024U * 1024U)
+
+/* Values from the Arrow format definitions (Schema.fbs and Message.fbs). */
+#define ARROW_METADATA_V5 4
+#define ARROW_HEADER_SCHEMA 1
+#define ARROW_HEADER_RECORD_BATCH 3
+#define ARROW_TYPE_INT 2
+#define ARROW_TYPE_FLOATING_POINT 3
+#define ARROW_TYPE_UTF8 5
+#define ARROW_PRECISION_DOUBLE 2
+#define ARROW_CONTINUATION 0xFFFFFFFFU
+
+typedef enum { COLUMN_INT, COLUMN_DOUBLE, COLUMN_UTF8 } ColumnKind;
+
+typedef struct {
+  const char *name;
+  ColumnKind kind;
+  int bit_width;
+  bool is_signed;
+  bool nullable;
+} ColumnSpec;
+
+enum {
+  COL_PAYLOAD,
+  COL_CHUNK_INDEX,
+  COL_RANK,
+  COL_SOURCE,
+  COL_OFFSET,
+  COL_LENGTH,
+  COL_STATUS,
+  COL_LATENCY,
+  COL_PROMPT_TOKENS,
+  COL_COMPLETION_TOKENS,
+  COL_DUPLICATE_OF,
+  COL_TEXT,
+  COLUMN_COUNT
+};
+
+static const ColumnSpec result_columns[COLUMN_COUNT] = {
+    {"payload", COLUMN_INT, 64, false, false},         {"chunk_index", COLUMN_INT, 64, false, false},
+    {"rank", COLUMN_INT, 32, true, false},             {"source", COLUMN_UTF8, 0, false, true},
+    {"offset", COLUMN_INT, 64, false, false},          {"length", COLUMN_INT, 64, false, false},
+    {"status", COLUMN_UTF8, 0, false, false},          {"latency_s", COLUMN_DOUBLE, 64, true, true},
+    {"prompt_tokens", COLUMN_INT, 64, true, true},     {"completion_tokens", COLUMN_INT, 64, true, true},
+    {"duplicate_of", COLUMN_INT, 64, false, true},     {"text", COLUMN_UTF8, 0, false, true}};
+
+static void assign_error(char **error_out, const char *fmt, ...) {
+  if (!error_out) {
+    return;
+  }
+  va_list args;
+  va_start(args, fmt);
+  va_list copy;
+  va_copy(copy, args);
+  int needed = vsnprintf(NULL, 0, fmt, copy);
+  va_end(copy);
+  if (needed < 0) {
+    va_end(args);
+    return;
+  }
+  size_t size = (size_t) needed + 1;
+  char *msg = malloc(size);
+  if (!msg) {
+    va_end(args);
+    return;
+  }
+  vsnprintf(msg, size, fmt, args);
+  va_end(args);
+  *error_out = msg;
+}
+
+/* ---- Flatbuffer encoding -------------------------------------------------------------------------
+ * Arrow metadata is a flatbuffer. It is built front to back here: a table is written with placeholder
+ * offsets for its strings, vectors and sub-tables, which are written after it and linked back, since
+ * flatbuffer offsets always point forward. Each vtable sits right before its table. */
+
+typedef struct {
+  unsigned id;
+  unsigned size;
+  uint64_t value;
+  size_t *slot;
+} FlatField;
+
+static int fb_put(StringBuffer *fb, uint64_t value, unsigned size) {
+  char bytes[8];
+  for (unsigned i = 0; i < size; ++i) {
+    bytes[i] = (char) ((value >> (8 * i)) & 0xFFU);
+  }
+  return sb_append(fb, bytes, size);
+}
+
+static void fb_set(StringBuffer *fb, size_t pos, uint64_t value, unsigned size) {
+  for (unsigned i = 0; i < size; ++i) {
+    fb->data[pos + i] = (char) ((value >> (8 * i)) & 0xFFU);
+  }
+}
+
+static int fb_pad_to(StringBuffer *fb, size_t length) {
+  while (fb->length < length) {
+    if (sb_append_char(fb, '\0') != 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+static int fb_align(StringBuffer *fb, size_t align) {
+  return fb_pad_to(fb, (fb->length + align - 1) / align * align);
+}
+
+/* Points the offset at slot to target, which must come after it. */
+static void fb_link(StringBuffer *fb, size_t slot, size_t target) {
+  fb_set(fb, slot, (uint64_t) (target - slot), 4);
+}
+
+/* Writes a vtable and its table. Fields are laid out in the given order, each aligned to its size;
+ * offset fields (slot set) are left zero and their positions reported for fb_link. */
+static size_t fb_table(StringBuffer *fb, const FlatField *fields, size_t count) {
+  unsigned slots = 0;
+  size_t layout[8];
+  size_t inline_size = 4;
+  for (size_t i = 0; i < count && i < 8; ++i) {
+    slots = fields[i].id + 1 > slots ? fields[i].id + 1 : slots;
+    inline_size = (inline_size + fields[i].size - 1) / fields[i].size * fields[i].size;
+    layout[i] = inline_size;
+    inline_size += fields[i].size;
+  }
+  fb_align(fb, 2);
+  size_t vtable = fb->length;
+  fb_put(fb, 4 + 2 * (uint64_t) slots, 2);
+  fb_put(fb, inline_size, 2);
+  for (unsigned id = 0; id < slots; ++id) {
+    size_t offset = 0;
+    for (size_t i = 0; i < count; ++i) {
+      if (fields[i].id == id) {
+        offset = layout[i];
+      }
+    }
+    fb_put(fb, offset, 2);
+  }
+  fb_align(fb, 8);
+  size_t table = fb->length;
+  fb_put(fb, table - vtable, 4);
+  for (size_t i = 0; i < count; ++i) {
+    fb_pad_to(fb, table + layout[i]);
+    if (fields[i].slot) {
+      *fields[i].slot = fb->length;
+    }
+    fb_put(fb, fields[i].slot ? 0 : fields[i].value, fields[i].size);
+  }
+  return table;
+}
+
+static size_t fb_string(StringBuffer *fb, const char *text) {
+  fb_align(fb, 4);
+  size_t pos = fb->length;
+  size_t len = strlen(text);
+  fb_put(fb, len, 4);
+  sb_append(fb, text, len);
+  sb_append_char(fb, '\0');
+  return pos;
+}
+
+/* A vector of count offsets, all zero; element i sits at the returned position + 4 + 4 * i. */
+static size_t fb_offset_vector(StringBuffer *fb, size_t count) {
+  fb_align(fb, 4);
+  size_t pos = fb->length;
+  fb_put(fb, count, 4);
+  for (size_t i = 0; i < count; ++i) {
+    fb_put(fb, 0, 4);
+  }
+  return pos;
+}
+
+/* A vector of (int64, int64) structs (FieldNode and Buffer), which need 8-byte aligned elements. */
+static size_t fb_pair_vector(StringBuffer *fb, const uint64_t *pairs, size_t count) {
+  fb_align(fb, 4);
+  if (fb->length % 8 == 0) {
+    fb_put(fb, 0, 4);
+  }
+  size_t pos = fb->length;
+  fb_put(fb, count, 4);
+  for (size_t i = 0; i < 2 * count; ++i) {
+    fb_put(fb, pairs[i], 8);
+  }
+  return pos;
+}
+
+/* Starts a Message flatbuffer; header_slot receives where the header table offset goes. */
+static void fb_message(StringBuffer *fb, unsigned header_type, uint64_t body_length, size_t *header_slot) {
+  fb_put(fb, 0, 4);
+  FlatField fields[] = {{0, 2, ARROW_METADATA_V5, NULL},
+                        {1, 1, header_type, NULL},
+                        {2, 4, 0, header_slot},
+                        {3, 8, body_length, NULL}};
+  size_t message = fb_table(fb, fields, sizeof fields / sizeof fields[0]);
+  fb_link(fb, 0, message);
+}
+
+static void build_schema(StringBuffer *fb) {
+  size_t header_slot = 0;
+  fb_message(fb, ARROW_HEADER_SCHEMA, 0, &header_slot);
+  size_t fields_slot = 0;
+  FlatField schema_fields[] = {{1, 4, 0, &fields_slot}};
+  fb_link(fb, header_slot, fb_table(fb, schema_fields, 1));
+  size_t vector = fb_offset_vector(fb, COLUMN_COUNT);
+  fb_link(fb, fields_slot, vector);
+  for (size_t c = 0; c < COLUMN_COUNT; ++c) {
+    const ColumnSpec *spec = &result_columns[c];
+    unsigned type = spec->kind == COLUMN_INT ? ARROW_TYPE_INT
+                    : spec->kind == COLUMN_DOUBLE ? ARROW_TYPE_FLOATING_POINT
+                                                  : ARROW_TYPE_UTF8;
+    size_t name_slot = 0;
+    size_t type_slot = 0;
+    size_t children_slot = 0;
+    FlatField field[] = {{0, 4, 0, &name_slot},
+                         {1, 1, spec->nullable ? 1 : 0, NULL},
+                         {2, 1, type, NULL},
+                         {3, 4, 0, &type_slot},
+                         {5, 4, 0, &children_slot}};
+    fb_link(fb, vector + 4 + 4 * c, fb_table(fb, field, sizeof field / sizeof field[0]));
+    fb_link(fb, name_slot, fb_string(fb, spec->name));
+    if (spec->kind == COLUMN_INT) {
+      FlatField int_type[] = {{0, 4, (uint64_t) spec->bit_width, NULL}, {1, 1, spec->is_signed ? 1 : 0, NULL}};
+      fb_link(fb, type_slot, fb_table(fb, int_type, 2));
+    } else if (spec->kind == COLUMN_DOUBLE) {
+      FlatField float_type[] = {{0, 2, ARROW_PRECISION_DOUBLE, NULL}};
+      fb_link(fb, type_slot, fb_table(fb, float_type, 1));
+    } else {
+      fb_link(fb, type_slot, fb_table(fb, NULL, 0));
+    }
+    fb_link(fb, children_slot, fb_offset_vector(fb, 0));
+  }
+}
+
+/* ---- Stream framing ------------------------------------------------------------------------------ */
+
+static const char zero_padding[8];
+
+/* Writes one encapsulated message: continuation marker, metadata length, metadata padded to 8 bytes. The
+ * body follows separately. */
+static int write_metadata(FILE *fp, StringBuffer *fb) {
+  if (fb_align(fb, 8) != 0) {
+    return -1;
+  }
+  char prefix[8];
+  uint32_t marker = ARROW_CONTINUATION;
+  uint32_t length = (uint32_t) fb->length;
+  for (unsigned i = 0; i < 4; ++i) {
+    prefix[i] = (char) ((marker >> (8 * i)) & 0xFFU);
+    prefix[4 + i] = (char) ((length >> (8 * i)) & 0xFFU);
+  }
+  if (fwrite(prefix, 1, sizeof prefix, fp) != sizeof prefix || fwrite(fb->data, 1, fb->length, fp) != fb->length) {
+    return -1;
+  }
+  return 0;
+}
+
+static int write_schema(FILE *fp) {
+  StringBuffer fb;
+  sb_init(&fb);
+  build_schema(&fb);
+  int rc = fb.data ? write_metadata(fp, &fb) : -1;
+  sb_clean(&fb);
+  return rc;
+}
+
+static int write_end_of_stream(FILE *fp) {
+  static const unsigned char eos[8] = {0xFF, 0xFF, 0xFF, 0xFF, 0, 0, 0, 0};
+  return fwrite(eos, 1, sizeof eos, fp) == sizeof eos ? 0 : -1;
+}
+
+/* ---- Writer -------------------------------------------------------------------------------------- */
+
+static size_t padded(size_t length) {
+  return (length + 7) / 8 * 8;
+}
+
+static void column_reset(ResultArrowColumn *column, ColumnKind kind) {
+  sb_reset(&column->validity);
+  sb_reset(&column->offsets);
+  sb_reset(&column->values);
+  column->null_count = 0;
+  if (kind == COLUMN_UTF8) {
+    fb_put(&column->offsets, 0, 4);
+  }
+}
+
+/* The buffers of one column in body order: validity (empty without nulls), offsets for strings, values. */
+static size_t column_buffers(const ResultArrowColumn *column, ColumnKind kind, const StringBuffer **out) {
+  static const StringBuffer empty = {NULL, 0, 0};
+  size_t count = 0;
+  out[count++] = column->null_count > 0 ? &column->validity : &empty;
+  if (kind == COLUMN_UTF8) {
+    out[count++] = &column->offsets;
+  }
+  out[count++] = &column->values;
+  return count;
+}
+
+static int flush_batch(ResultArrowWriter *writer, char **error_out) {
+  if (writer->rows == 0) {
+    return 0;
+  }
+  uint64_t nodes[2 * COLUMN_COUNT];
+  uint64_t buffers[2 * 3 * COLUMN_COUNT];
+  size_t buffer_count = 0;
+  uint64_t body_length = 0;
+  for (size_t c = 0; c < COLUMN_COUNT; ++c) {
+    const StringBuffer *parts[3];
+    size_t count = column_buffers(&writer->columns[c], result_columns[c].kind, parts);
+    nodes[2 * c] = writer->rows;
+    nodes[2 * c + 1] = writer->columns[c].null_count;
+    for (size_t b = 0; b < count; ++b) {
+      buffers[2 * buffer_count] = body_length;
+      buffers[2 * buffer_count + 1] = parts[b]->length;
+      buffer_count++;
+      body_length += padded(parts[b]->length);
+    }
+  }
+  StringBuffer fb;
+  sb_init(&fb);
+  size_t header_slot = 0;
+  fb_message(&fb, ARROW_HEADER_RECORD_BATCH, body_length, &header_slot);
+  size_t nodes_slot = 0;
+  size_t buffers_slot = 0;
+  FlatField batch[] = {{0, 8, writer->rows, NULL}, {1, 4, 0, &nodes_slot}, {2, 4, 0, &buffers_slot}};
+  fb_link(&fb, header_slot, fb_table(&fb, batch, sizeof batch / sizeof batch[0]));
+  fb_link(&fb, nodes_slot, fb_pair_vector(&fb, nodes, COLUMN_COUNT));
+  fb_link(&fb, buffers_slot, fb_pair_vector(&fb, buffers, buffer_count));
+  int rc = fb.data ? write_metadata(writer->fp, &fb) : -1;
+  sb_clean(&fb);
+  for (size_t c = 0; rc == 0 && c < COLUMN_COUNT; ++c) {
+    const StringBuffer *parts[3];
+    size_t count = column_buffers(&writer->columns[c], result_columns[c].kind, parts);
+    for (size_t b = 0; rc == 0 && b < count; ++b) {
+      size_t len = parts[b]->length;
+      size_t pad = padded(len) - len;
+      if ((len > 0 && fwrite(parts[b]->data, 1, len, writer->fp) != len) ||
+          (pad > 0 && fwrite(zero_padding, 1, pad, writer->fp) != pad)) {
+        rc = -1;
+      }
+    }
+  }
+  if (rc != 0) {
+    assign_error(error_out, "cannot write record batch: %s", strerror(errno));
+    return -1;
+  }
+  for (size_t c = 0; c < COLUMN_COUNT; ++c) {
+    column_reset(&writer->columns[c], result_columns[c].kind);
+  }
+  writer->rows = 0;
+  return 0;
+}
+
+int result_arrow_open(ResultArrowWriter *writer, const char *path, unsigned long long payload, const char *source,
+                      size_t chunk_size, size_t payload_length, char **error_out) {
+  if (!writer || !path) {
+    assign_error(error_out, "invalid arguments");
+    return -1;
+  }
+  memset(writer, 0, sizeof *writer);
+  writer->payload = payload;
+  writer->chunk_size = chunk_size;
+  writer->payload_length = payload_length;
+  writer->columns = calloc(COLUMN_COUNT, sizeof *writer->columns);
+  writer->source = source ? strdup(source) : NULL;
+  if (!writer->columns || (source && !writer->source)) {
+    assign_error(error_out, "out of memory");
+    free(writer->columns);
+    free(writer->source);
+    return -1;
+  }
+  for (size_t c = 0; c < COLUMN_COUNT; ++c) {
+    sb_init(&writer->columns[c].validity);
+    sb_init(&writer->columns[c].offsets);
+    sb_init(&writer->columns[c].values);
+    column_reset(&writer->columns[c], result_columns[c].kind);
+  }
+  writer->fp = fopen(path, "wb");
+  if (!writer->fp || write_schema(writer->fp) != 0) {
+    assign_error(error_out, "cannot write %s: %s", path, strerror(errno));
+    result_arrow_close(writer, NULL);
+    return -1;
+  }
+  return 0;
+}
+
+static int append_value(ResultArrowWriter *writer, size_t c, bool valid, uint64_t bits) {
+  ResultArrowColumn *column = &writer->columns[c];
+  if (writer->rows % 8 == 0 && sb_append_char(&column->validity, '\0') != 0) {
+    return -1;
+  }
+  if (valid) {
+    column->validity.data[writer->rows / 8] |= (char) (1U << (writer->rows % 8));
+  } else {
+    column->null_count++;
+  }
+  return fb_put(&column->values, valid ? bits : 0, (unsigned) result_columns[c].bit_width / 8);
+}
+
+static int append_text(ResultArrowWriter *writer, size_t c, const char *text, size_t len) {
+  ResultArrowColumn *column = &writer->columns[c];
+  if (writer->rows % 8 == 0 && sb_append_char(&column->validity, '\0') != 0) {
+    return -1;
+  }
+  if (text) {
+    column->validity.data[writer->rows / 8] |= (char) (1U << (writer->rows % 8));
+    if (len > 0 && sb_append(&column->values, text, len) != 0) {
+      return -1;
+    }
+  } else {
+    column->null_count++;
+  }
+  return fb_put(&column->offsets, column->values.length, 4);
+}
+
+int result_arrow_add(ResultArrowWriter *writer, const ResultArrowRow *row, char **error_out) {
+  if (!writer || !writer->fp || !row || !row->status) {
+    assign_error(error_out, "invalid arguments");
+    return -1;
+  }
+  /* String offsets are 32-bit, so a batch holds at most 2 GiB of text per column. */
+  size_t text_len = row->text ? row->text_len : 0;
+  if (text_len > (size_t) INT32_MAX / 2) {
+    assign_error(error_out, "chunk %zu response is too large to export", row->chunk_index);
+    return -1;
+  }
+  if (writer->columns[COL_TEXT].values.length + text_len > (size_t) INT32_MAX && flush_batch(writer, error_out) != 0) {
+    return -1;
+  }
+  size_t offset = row->chunk_index * writer->chunk_size;
+  size_t length = writer->chunk_size;
+  if (offset >= writer->payload_length) {
+    length = 0;
+  } else if (writer->payload_length - offset < length) {
+    length = writer->payload_length - offset;
+  }
+  double latency = row->latency;
+  uint64_t latency_bits = 0;
+  memcpy(&latency_bits, &latency, sizeof latency_bits);
+  int rc = 0;
+  rc |= append_value(writer, COL_PAYLOAD, true, writer->payload);
+  rc |= append_value(writer, COL_CHUNK_INDEX, true, row->chunk_index);
+  rc |= append_value(writer, COL_RANK, true, (uint64_t) (uint32_t) row->rank);
+  rc |= append_text(writer, COL_SOURCE, writer->source, writer->source ? strlen(writer->source) : 0);
+  rc |= append_value(writer, COL_OFFSET, true, offset);
+  rc |= append_value(writer, COL_LENGTH, true, length);
+  rc |= append_text(writer, COL_STATUS, row->status, strlen(row->status));
+  rc |= append_value(writer, COL_LATENCY, row->latency >= 0.0, latency_bits);
+  rc |= append_value(writer, COL_PROMPT_TOKENS, row->prompt_tokens >= 0, (uint64_t) row->prompt_tokens);
+  rc |= append_value(writer, COL_COMPLETION_TOKENS, row->completion_tokens >= 0, (uint64_t) row->completion_tokens);
+  rc |= append_value(writer, COL_DUPLICATE_OF, row->duplicate, row->duplicate_of);
+  rc |= append_text(writer, COL_TEXT, row->text, text_len);
+  if (rc != 0) {
+    assign_error(error_out, "out of memory");
+    return -1;
+  }
+  writer->rows++;
+  if (writer->rows >= RESULT_ARROW_BATCH_ROWS || writer->columns[COL_TEXT].values.length >= RESULT_ARROW_BATCH_BYTES) {
+    return flush_batch(writer, error_out);
+  }
+  return 0;
+}
+
+int result_arrow_close(ResultArrowWriter *writer, char **error_out) {
+  if (!writer) {
+    return -1;
+  }
+  int rc = 0;
+  if (writer->fp) {
+    rc = flush_batch(writer, error_out);
+    if (rc == 0 && write_end_of_stream(writer->fp) != 0) {
+      assign_error(error_out, "cannot write end of stream: %s", strerror(errno));
+      rc = -1;
+    }
+    if (fclose(writer->fp) != 0 && rc == 0) {
+      assign_error(error_out, "cannot close stream: %s", strerror(errno));
+      rc = -1;
+    }
+  }
+  for (size_t c = 0; writer->columns && c < COLUMN_COUNT; ++c) {
+    sb_clean(&writer->columns[c].validity);
+    sb_clean(&writer->columns[c].offsets);
+    sb_clean(&writer->columns[c].values);
+  }
+  free(writer->columns);
+  free(writer->source);
+  memset(writer, 0, sizeof *writer);
+  return rc;
+}
+
+/* ---- Merging ------------------------------------------------------------------------------------- */
+
+FILE *result_arrow_begin(const char *path, bool append, char **error_out) {
+  if (!path) {
+    assign_error(error_out, "invalid arguments");
+    return NULL;
+  }
+  FILE *fp = append ? fopen(path, "r+b") : NULL;
+  if (fp) {
+    unsigned char tail[8];
+    if (fseek(fp, 0, SEEK_END) == 0 && ftell(fp) == 0) {
+      if (write_schema(fp) != 0) {
+        assign_error(error_out, "cannot write %s: %s", path, strerror(errno));
+        fclose(fp);
+        return NULL;
+      }
+      return fp;
+    }
+    if (fseek(fp, -8, SEEK_END) != 0 || fread(tail, 1, sizeof tail, fp) != sizeof tail ||
+        memcmp(tail, "\xFF\xFF\xFF\xFF\0\0\0\0", sizeof tail) != 0 || fseek(fp, -8, SEEK_END) != 0) {
+      assign_error(error_out, "%s does not end with a complete Arrow stream", path);
+      fclose(fp);
+      return NULL;
+    }
+    return fp;
+  }
+  fp = fopen(path, "wb");
+  if (!fp || write_schema(fp) != 0) {
+    assign_error(error_out, "cannot write %s: %s", path, strerror(errno));
+    if (fp) {
+      fclose(fp);
+    }
+    return NULL;
+  }
+  return fp;
+}
+
+int result_arrow_end(FILE *fp, char **error_out) {
+  if (!fp) {
+    return -1;
+  }
+  int rc = write_end_of_stream(fp);
+  if (fclose(fp) != 0) {
+    rc = -1;
+  }
+  if (rc != 0) {
+    assign_error(error_out, "cannot finish stream: %s", strerror(errno));
+  }
+  return rc;
+}
+
+static uint64_t read_le(const unsigned char *bytes, unsigned size) {
+  uint64_t value = 0;
+  for (unsigned i = 0; i < size; ++i) {
+    value |= (uint64_t) bytes[i] << (8 * i);
+  }
+  return value;
+}
+
+/* Position of field id in the table at table, or 0 when the field is absent or the buffer is malformed. */
+static size_t flat_field(const unsigned char *fb, size_t length, size_t table, unsigned id) {
+  if (table + 4 > length) {
+    return 0;
+  }
+  int32_t soffset = (int32_t) (uint32_t) read_le(fb + table, 4);
+  size_t vtable = (size_t) ((int64_t) table - soffset);
+  if (vtable + 4 > length) {
+    return 0;
+  }
+  size_t vtable_size = (size_t) read_le(fb + vtable, 2);
+  if (4 + 2 * (size_t) id + 2 > vtable_size || vtable + vtable_size > length) {
+    return 0;
+  }
+  size_t offset = (size_t) read_le(fb + vtable + 4 + 2 * id, 2);
+  return offset == 0 ? 0 : table + offset;
+}
+
+int result_arrow_read_message(FILE *fp, StringBuffer *out, bool *schema, char **error_out) {
+  if (!fp || !out) {
+    assign_error(error_out, "invalid arguments");
+    return -1;
+  }
+  sb_reset(out);
+  unsigned char prefix[8];
+  size_t got = fread(prefix, 1, sizeof prefix, fp);
+  if (got == 0 && feof(fp)) {
+    return 0;
+  }
+  if (got != sizeof prefix || read_le(prefix, 4) != ARROW_CONTINUATION) {
+    assign_error(error_out, "truncated or unsupported Arrow stream");
+    return -1;
+  }
+  size_t meta_len = (size_t) read_le(prefix + 4, 4);
+  if (meta_len == 0) {
+    return 0;
+  }
+  if (sb_reserve(out, sizeof prefix + meta_len) != 0) {
+    assign_error(error_out, "out of memory");
+    return -1;
+  }
+  sb_append(out, (const char *) prefix, sizeof prefix);
+  if (fread(out->data + out->length, 1, meta_len, fp) != meta_len) {
+    assign_error(error_out, "truncated Arrow message");
+    return -1;
+  }
+  out->length += meta_len;
+  const unsigned char *fb = (const unsigned char *) out->data + sizeof prefix;
+  size_t message = meta_len >= 4 ? (size_t) read_le(fb, 4) : 0;
+  size_t type_at = flat_field(fb, meta_len, message, 1);
+  size_t body_at = flat_field(fb, meta_len, message, 3);
+  unsigned header_type = type_at && type_at < meta_len ? fb[type_at] : 0;
+  uint64_t body_length = body_at && body_at + 8 <= meta_len ? read_le(fb + body_at, 8) : 0;
+  if (header_type == 0) {
+    assign_error(error_out, "malformed Arrow message");
+    return -1;
+  }
+  if (schema) {
+    *schema = header_type == ARROW_HEADER_SCHEMA;
+  }
+  if (body_length > 0) {
+    if (sb_reserve(out, (size_t) body_length) != 0) {
+      assign_error(error_out, "out of memory");
+      return -1;
+    }
+    if (fread(out->data + out->length, 1, (size_t) body_length, fp) != (size_t) body_length) {
+      assign_error(error_out, "truncated Arrow message body");
+      return -1;
+    }
+    out->length += (size_t) body_length;
+  }
+  return 1;
+}
@@ -0,0 +1,69 @@
+#ifndef RESULT_ARROW_H
+#define RESULT_ARROW_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "string_buffer.h"
+
+/**
+ * Writes chunk results as an Arrow IPC stream (the format pyarrow.ipc.open_stream, polars and duckdb
+ * read directly). One row per chunk with the columns payload, chunk_index, rank, source, offset, length,
+ * status, latency_s, prompt_tokens, completion_tokens, duplicate_of and text; unknown values are nulls.
+ * Rows are buffered column by column and written as a record batch every few thousand rows or few MiB of
+ * text.
+ * The encoding is written by hand, so no Arrow library is needed to produce it.
+ */
+typedef struct {
+  StringBuffer validity;
+  StringBuffer offsets;
+  StringBuffer values;
+  size_t null_count;
+} ResultArrowColumn;
+
+typedef struct {
+  FILE *fp;
+  char *source;
+  unsigned long long payload;
+  size_t chunk_size;
+  size_t payload_length;
+  size_t rows;
+  ResultArrowColumn *columns;
+} ResultArrowWriter;
+
+/* One row. Negative latency and token counts, and a NULL text, are written as nulls. */
+typedef struct {
+  size_t chunk_index;
+  int rank;
+  const char *status;
+  double latency;
+  long long prompt_tokens;
+  long long completion_tokens;
+  bool duplicate;
+  size_t duplicate_of;
+  const char *text;
+  size_t text_len;
+} ResultArrowRow;
+
+/* Creates path and writes the schema. payload and source (may be NULL) fill the columns of the same
+ * name; offset and length are derived from the chunk index, chunk_size and payload_length. */
+int result_arrow_open(ResultArrowWriter *writer, const char *path, unsigned long long payload, const char *source,
+                      size_t chunk_size, size_t payload_length, char **error_out);
+int result_arrow_add(ResultArrowWriter *writer, const ResultArrowRow *row, char **error_out);
+/* Writes the rows still buffered and the end-of-stream marker. The writer is released either way. */
+int result_arrow_close(ResultArrowWriter *writer, char **error_out);
+
+/* Opens path for a merged stream: a new file starts with the schema, while append continues an existing
+ * stream (dropping its end-of-stream marker) or starts one when the file is missing or empty. */
+FILE *result_arrow_begin(const char *path, bool append, char **error_out);
+/* Ends a stream started by result_arrow_begin and closes it. */
+int result_arrow_end(FILE *fp, char **error_out);
+/**
+ * Reads the next encapsulated message of a stream into out (replacing its contents) exactly as it is on
+ * disk, so it can be appended to another stream with the same schema. Returns 1 for a message, 0 at the
+ * end of the stream and -1 on a read or format error. schema tells whether the message is a schema.
+ */
+int result_arrow_read_message(FILE *fp, StringBuffer *out, bool *schema, char **error_out);
+
+#endif /* RESULT_ARROW_H */
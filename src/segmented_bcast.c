@@ -0,0 +1,191 @@
+#include "segmented_bcast.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "memory_budget.h"
+
+/* Segments posted ahead of the oldest incomplete one. */
+#define SEGMENTED_BCAST_WINDOW 8U
+/* Compressed segments are staged whole, so they are kept well below INT_MAX. */
+#define SEGMENTED_BCAST_MAX_FRAMED (256U * 1024U * 1024U)
+
+static bool framed(const SegmentedBcast *bcast) {
+  return bcast->codec != TRANSFER_CODEC_OFF;
+}
+
+static size_t segment_length(const SegmentedBcast *bcast, size_t segment) {
+  size_t offset = segment * bcast->segment_size;
+  return bcast->length - offset < bcast->segment_size ? bcast->length - offset : bcast->segment_size;
+}
+
+static char *stage_slot(const SegmentedBcast *bcast, size_t segment) {
+  return bcast->stage + (segment % SEGMENTED_BCAST_WINDOW) * bcast->stage_slot;
+}
+
+/* Posts data for as many segments as the window allows. Receivers of a framed broadcast stop at the
+ * first segment whose frame has not arrived yet. */
+static void post_segments(SegmentedBcast *bcast) {
+  while (bcast->posted < bcast->segment_count && bcast->posted - bcast->completed < SEGMENTED_BCAST_WINDOW) {
+    size_t segment = bcast->posted;
+    char *data = bcast->buffer + segment * bcast->segment_size;
+    size_t len = segment_length(bcast, segment);
+    MPI_Request *frame = &bcast->requests[2 * segment];
+    if (framed(bcast) && bcast->root) {
+      size_t wire_len = 0;
+      if (transfer_codec_compress(bcast->codec, data, len, stage_slot(bcast, segment), bcast->stage_slot,
+                                  &wire_len) != 0 ||
+          wire_len >= len) {
+        wire_len = 0;
+      }
+      bcast->frames[segment] = wire_len;
+      MPI_Ibcast(&bcast->frames[segment], 1, MPI_UNSIGNED_LONG_LONG, 0, bcast->comm, frame);
+    } else if (framed(bcast)) {
+      if (bcast->announced == segment) {
+        MPI_Ibcast(&bcast->frames[segment], 1, MPI_UNSIGNED_LONG_LONG, 0, bcast->comm, frame);
+        bcast->announced++;
+      }
+      int arrived = 0;
+      MPI_Test(frame, &arrived, MPI_STATUS_IGNORE);
+      if (!arrived) {
+        return;
+      }
+    }
+    if (framed(bcast) && bcast->frames[segment] > 0) {
+      data = stage_slot(bcast, segment);
+      len = (size_t) bcast->frames[segment];
+    }
+    MPI_Ibcast(data, (int) len, MPI_CHAR, 0, bcast->comm, &bcast->requests[2 * segment + 1]);
+    bcast->posted++;
+  }
+}
+
+/* Makes sure the data of segment has been posted, waiting for its frame if need be. */
+static void wait_posted(SegmentedBcast *bcast, size_t segment) {
+  post_segments(bcast);
+  while (bcast->posted <= segment) {
+    MPI_Wait(&bcast->requests[2 * bcast->posted], MPI_STATUS_IGNORE);
+    post_segments(bcast);
+  }
+}
+
+/* Runs once both requests of the oldest incomplete segment are done. */
+static void complete_segment(SegmentedBcast *bcast) {
+  size_t segment = bcast->completed;
+  size_t len = segment_length(bcast, segment);
+  size_t wire_len = framed(bcast) && bcast->frames[segment] > 0 ? (size_t) bcast->frames[segment] : len;
+  if (!bcast->root && wire_len != len &&
+      transfer_codec_decompress(bcast->codec, stage_slot(bcast, segment), wire_len,
+                                bcast->buffer + segment * bcast->segment_size, len) != 0) {
+    fprintf(stderr, "Corrupt %s segment %zu in payload broadcast\n", transfer_codec_name(bcast->codec), segment);
+    MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+  }
+  bcast->wire_bytes += wire_len;
+  bcast->completed++;
+}
+
+int segmented_bcast_start(SegmentedBcast *bcast, char *buffer, size_t length, size_t segment_size,
+                          TransferCodec codec, MPI_Comm comm) {
+  if (!bcast || (!buffer && length > 0)) {
+    return -1;
+  }
+  memset(bcast, 0, sizeof *bcast);
+  bcast->codec = codec == TRANSFER_CODEC_AUTO ? TRANSFER_CODEC_OFF : codec;
+  size_t max_segment = framed(bcast) ? (size_t) SEGMENTED_BCAST_MAX_FRAMED : (size_t) INT_MAX;
+  if (segment_size == 0 || segment_size > max_segment) {
+    segment_size = max_segment;
+  }
+  bcast->buffer = buffer;
+  bcast->length = length;
+  bcast->segment_size = segment_size;
+  bcast->segment_count = (length + segment_size - 1) / segment_size;
+  bcast->requests = malloc((2 * bcast->segment_count + 1) * sizeof *bcast->requests);
+  if (!bcast->requests) {
+    MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+  }
+  for (size_t i = 0; i < 2 * bcast->segment_count; ++i) {
+    bcast->requests[i] = MPI_REQUEST_NULL;
+  }
+  if (framed(bcast)) {
+    size_t first = segment_size < length ? segment_size : length;
+    bcast->stage_slot = transfer_codec_bound(bcast->codec, first);
+    bcast->frames = calloc(bcast->segment_count + 1, sizeof *bcast->frames);
+    bcast->stage = malloc(SEGMENTED_BCAST_WINDOW * (bcast->stage_slot ? bcast->stage_slot : 1));
+    if (!bcast->frames || !bcast->stage || bcast->stage_slot == 0) {
+      MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    memory_budget_charge(SEGMENTED_BCAST_WINDOW * bcast->stage_slot);
+  }
+  int rank = 0;
+  MPI_Comm_rank(comm, &rank);
+  bcast->root = rank == 0;
+  MPI_Comm_dup(comm, &bcast->comm);
+  bcast->started_at = MPI_Wtime();
+  post_segments(bcast);
+  return 0;
+}
+
+void segmented_bcast_progress(SegmentedBcast *bcast) {
+  if (!bcast || !bcast->requests) {
+    return;
+  }
+  post_segments(bcast);
+  while (bcast->completed < bcast->posted) {
+    int done = 0;
+    MPI_Testall(2, &bcast->requests[2 * bcast->completed], &done, MPI_STATUSES_IGNORE);
+    if (!done) {
+      break;
+    }
+    complete_segment(bcast);
+    post_segments(bcast);
+  }
+}
+
+void segmented_bcast_wait(SegmentedBcast *bcast, size_t end) {
+  if (!bcast || !bcast->requests) {
+    return;
+  }
+  if (bcast->root) {
+    segmented_bcast_progress(bcast);
+    return;
+  }
+  size_t needed = end >= bcast->length ? bcast->segment_count : (end + bcast->segment_size - 1) / bcast->segment_size;
+  while (bcast->completed < needed) {
+    wait_posted(bcast, bcast->completed);
+    MPI_Waitall(2, &bcast->requests[2 * bcast->completed], MPI_STATUSES_IGNORE);
+    complete_segment(bcast);
+    post_segments(bcast);
+  }
+  segmented_bcast_progress(bcast);
+}
+
+size_t segmented_bcast_arrived(const SegmentedBcast *bcast) {
+  if (!bcast || !bcast->requests || bcast->root) {
+    return bcast ? bcast->length : 0;
+  }
+  size_t arrived = bcast->completed * bcast->segment_size;
+  return arrived < bcast->length ? arrived : bcast->length;
+}
+
+void segmented_bcast_finish(SegmentedBcast *bcast) {
+  if (!bcast || !bcast->requests) {
+    return;
+  }
+  while (bcast->completed < bcast->segment_count) {
+    wait_posted(bcast, bcast->completed);
+    MPI_Waitall(2, &bcast->requests[2 * bcast->completed], MPI_STATUSES_IGNORE);
+    complete_segment(bcast);
+  }
+  free(bcast->requests);
+  bcast->requests = NULL;
+  if (bcast->stage) {
+    memory_budget_release(SEGMENTED_BCAST_WINDOW * bcast->stage_slot);
+  }
+  free(bcast->stage);
+  free(bcast->frames);
+  bcast->stage = NULL;
+  bcast->frames = NULL;
+  MPI_Comm_free(&bcast->comm);
+}
@@ -0,0 +1,56 @@
+#ifndef SEGMENTED_BCAST_H
+#define SEGMENTED_BCAST_H
+
+#include <mpi.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "transfer_codec.h"
+
+/**
+ * Pipelined broadcast of one buffer from rank 0: the buffer is cut into segments, each sent with its own
+ * MPI_Ibcast, so receivers can use the front of the payload while the rest is still in flight. A window
+ * of segments is kept posted and later ones are posted as earlier ones complete; since ranks post at
+ * different moments, the segments travel on a private duplicate of the communicator, where the only
+ * collectives are these broadcasts and their order is the same everywhere. Nonblocking collectives only
+ * advance inside MPI calls, so a rank busy with other work should call segmented_bcast_progress now and
+ * then (rank 0 included: it posts the later segments).
+ *
+ * With a codec, rank 0 compresses each segment as it posts it and sends a one-word frame (the wire
+ * length, 0 for a segment sent raw) ahead of the data; receivers post a segment's data once its frame
+ * is in and expand it into place when it completes.
+ */
+typedef struct {
+  char *buffer;
+  size_t length;
+  size_t segment_size;
+  size_t segment_count;
+  TransferCodec codec;
+  /* Two requests per segment: the frame (MPI_REQUEST_NULL without a codec) and the data. */
+  MPI_Request *requests;
+  unsigned long long *frames;
+  char *stage;
+  size_t stage_slot;
+  size_t announced;
+  size_t wire_bytes;
+  size_t posted;
+  size_t completed;
+  bool root;
+  MPI_Comm comm;
+  double started_at;
+} SegmentedBcast;
+
+/* Collective over comm; posts the first window of segments. codec must be the same on every rank and is
+ * either off or a codec this build links. */
+int segmented_bcast_start(SegmentedBcast *bcast, char *buffer, size_t length, size_t segment_size,
+                          TransferCodec codec, MPI_Comm comm);
+/* Completes whatever has arrived and posts more without blocking. */
+void segmented_bcast_progress(SegmentedBcast *bcast);
+/* Blocks until bytes [0, end) are in place (immediately on rank 0). */
+void segmented_bcast_wait(SegmentedBcast *bcast, size_t end);
+/* Bytes known to be in place, counted from the start of the buffer. */
+size_t segmented_bcast_arrived(const SegmentedBcast *bcast);
+/* Waits for every segment and releases the requests and the duplicate communicator. Safe to repeat. */
+void segmented_bcast_finish(SegmentedBcast *bcast);
+
+#endif /* SEGMENTED_BCAST_H */
@@ -0,0 +1,287 @@
+#define _GNU_SOURCE
+#include "stream_batcher.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static void assign_error(char **error_out, const char *fmt, ...) {
+  if (!error_out) {
+    return;
+  }
+  va_list args;
+  va_start(args, fmt);
+  va_list copy;
+  va_copy(copy, args);
+  int needed = vsnprintf(NULL, 0, fmt, copy);
+  va_end(copy);
+  if (needed < 0) {
+    va_end(args);
+    return;
+  }
+  size_t size = (size_t) needed + 1;
+  char *msg = malloc(size);
+  if (!msg) {
+    va_end(args);
+    return;
+  }
+  vsnprintf(msg, size, fmt, args);
+  va_end(args);
+  *error_out = msg;
+}
+
+static long long now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long) ts.tv_sec * 1000LL + ts.tv_nsec / 1000000L;
+}
+
+int stream_batcher_init(StreamBatcher *batcher, int fd, size_t max_bytes, int window_ms) {
+  if (!batcher || fd < 0 || max_bytes == 0) {
+    return -1;
+  }
+  memset(batcher, 0, sizeof *batcher);
+  batcher->fd = fd;
+  batcher->max_bytes = max_bytes;
+  batcher->window_ms = window_ms > 0 ? window_ms : 0;
+  batcher->wake[0] = -1;
+  batcher->wake[1] = -1;
+  sb_init(&batcher->pending);
+  if (sb_reserve(&batcher->pending, max_bytes) != 0) {
+    return -1;
+  }
+  return 0;
+}
+
+/* Detaches the first `length` pending bytes and keeps the remainder for the next batch. */
+static int cut_batch(StreamBatcher *batcher, size_t length, char **batch_out, size_t *length_out) {
+  char *batch = malloc(length + 1);
+  if (!batch) {
+    return -1;
+  }
+  memcpy(batch, batcher->pending.data, length);
+  batch[length] = '\0';
+  size_t rest = batcher->pending.length - length;
+  memmove(batcher->pending.data, batcher->pending.data + length, rest);
+  batcher->pending.length = rest;
+  batcher->pending.data[rest] = '\0';
+  batcher->deadline_ms = rest > 0 ? now_ms() + batcher->window_ms : 0;
+  *batch_out = batch;
+  *length_out = length;
+  return 0;
+}
+
+static size_t record_boundary(const StreamBatcher *batcher, size_t limit) {
+  for (size_t i = limit; i > 0; --i) {
+    if (batcher->pending.data[i - 1] == '\n') {
+      return i;
+    }
+  }
+  return 0;
+}
+
+/* Reads until the next batch can be cut. With a reader thread, a byte on the wake pipe ends the stream. */
+static int read_batch(StreamBatcher *batcher, char **batch_out, size_t *length_out, StreamCutReason *reason_out,
+                      char **error_out) {
+  for (;;) {
+    size_t pending = batcher->pending.length;
+    if (pending >= batcher->max_bytes) {
+      size_t cut = record_boundary(batcher, batcher->max_bytes);
+      if (reason_out) {
+        *reason_out = STREAM_CUT_SIZE;
+      }
+      return cut_batch(batcher, cut > 0 ? cut : batcher->max_bytes, batch_out, length_out) == 0 ? 1 : -1;
+    }
+    if (batcher->eof) {
+      if (pending == 0) {
+        return 0;
+      }
+      if (reason_out) {
+        *reason_out = STREAM_CUT_EOF;
+      }
+      return cut_batch(batcher, pending, batch_out, length_out) == 0 ? 1 : -1;
+    }
+    int timeout = -1;
+    if (pending > 0) {
+      long long remaining = batcher->deadline_ms - now_ms();
+      if (remaining <= 0) {
+        /* A trailing partial record waits for its newline unless it is all we have. */
+        size_t cut = record_boundary(batcher, pending);
+        if (reason_out) {
+          *reason_out = STREAM_CUT_WINDOW;
+        }
+        return cut_batch(batcher, cut > 0 ? cut : pending, batch_out, length_out) == 0 ? 1 : -1;
+      }
+      timeout = remaining > 60000 ? 60000 : (int) remaining;
+    }
+    struct pollfd entries[2] = {{.fd = batcher->fd, .events = POLLIN, .revents = 0},
+                                {.fd = batcher->wake[0], .events = POLLIN, .revents = 0}};
+    int ready = poll(entries, batcher->wake[0] >= 0 ? 2 : 1, timeout);
+    if (ready < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      assign_error(error_out, "poll: %s", strerror(errno));
+      return -1;
+    }
+    if (ready > 0 && batcher->wake[0] >= 0 && entries[1].revents) {
+      return 0;
+    }
+    if (ready == 0) {
+      continue;
+    }
+    ssize_t n = read(batcher->fd, batcher->pending.data + pending, batcher->max_bytes - pending);
+    if (n < 0) {
+      if (errno == EINTR || errno == EAGAIN) {
+        continue;
+      }
+      assign_error(error_out, "read: %s", strerror(errno));
+      return -1;
+    }
+    if (n == 0) {
+      batcher->eof = true;
+      continue;
+    }
+    if (pending == 0) {
+      batcher->deadline_ms = now_ms() + batcher->window_ms;
+    }
+    batcher->pending.length += (size_t) n;
+    batcher->pending.data[batcher->pending.length] = '\0';
+  }
+}
+
+static void *reader_main(void *data) {
+  StreamBatcher *batcher = data;
+  for (;;) {
+    StreamBatch batch = {NULL, 0, STREAM_CUT_EOF};
+    char *error = NULL;
+    int rc = read_batch(batcher, &batch.data, &batch.length, &batch.reason, &error);
+    pthread_mutex_lock(&batcher->lock);
+    if (rc <= 0) {
+      batcher->finished = true;
+      batcher->status = rc;
+      batcher->error = error;
+      pthread_cond_broadcast(&batcher->changed);
+      pthread_mutex_unlock(&batcher->lock);
+      return NULL;
+    }
+    /* A full queue stops the reads, so the pipe pushes back on the producer. */
+    while (batcher->queue_count == batcher->queue_depth && !batcher->stopping) {
+      pthread_cond_wait(&batcher->changed, &batcher->lock);
+    }
+    if (batcher->stopping) {
+      batcher->finished = true;
+      pthread_mutex_unlock(&batcher->lock);
+      free(batch.data);
+      return NULL;
+    }
+    batcher->queue[(batcher->queue_head + batcher->queue_count) % batcher->queue_depth] = batch;
+    batcher->queue_count++;
+    pthread_cond_broadcast(&batcher->changed);
+    pthread_mutex_unlock(&batcher->lock);
+  }
+}
+
+int stream_batcher_start(StreamBatcher *batcher, size_t queue_depth, char **error_out) {
+  if (!batcher || batcher->threaded || queue_depth == 0) {
+    return -1;
+  }
+  batcher->queue = calloc(queue_depth, sizeof *batcher->queue);
+  if (!batcher->queue) {
+    assign_error(error_out, "unable to allocate batch queue");
+    return -1;
+  }
+  if (pipe(batcher->wake) != 0) {
+    assign_error(error_out, "pipe: %s", strerror(errno));
+    batcher->wake[0] = -1;
+    batcher->wake[1] = -1;
+    free(batcher->queue);
+    batcher->queue = NULL;
+    return -1;
+  }
+  batcher->queue_depth = queue_depth;
+  pthread_mutex_init(&batcher->lock, NULL);
+  pthread_cond_init(&batcher->changed, NULL);
+  int rc = pthread_create(&batcher->thread, NULL, reader_main, batcher);
+  if (rc != 0) {
+    assign_error(error_out, "pthread_create: %s", strerror(rc));
+    pthread_mutex_destroy(&batcher->lock);
+    pthread_cond_destroy(&batcher->changed);
+    close(batcher->wake[0]);
+    close(batcher->wake[1]);
+    batcher->wake[0] = -1;
+    batcher->wake[1] = -1;
+    free(batcher->queue);
+    batcher->queue = NULL;
+    return -1;
+  }
+  batcher->threaded = true;
+  return 0;
+}
+
+int stream_batcher_next(StreamBatcher *batcher, char **batch_out, size_t *length_out, StreamCutReason *reason_out,
+                        char **error_out) {
+  if (!batcher || !batch_out || !length_out) {
+    return -1;
+  }
+  if (!batcher->threaded) {
+    return read_batch(batcher, batch_out, length_out, reason_out, error_out);
+  }
+  pthread_mutex_lock(&batcher->lock);
+  while (batcher->queue_count == 0 && !batcher->finished) {
+    pthread_cond_wait(&batcher->changed, &batcher->lock);
+  }
+  int rc = batcher->status;
+  if (batcher->queue_count > 0) {
+    StreamBatch *batch = &batcher->queue[batcher->queue_head];
+    *batch_out = batch->data;
+    *length_out = batch->length;
+    if (reason_out) {
+      *reason_out = batch->reason;
+    }
+    batcher->queue_head = (batcher->queue_head + 1) % batcher->queue_depth;
+    batcher->queue_count--;
+    pthread_cond_broadcast(&batcher->changed);
+    rc = 1;
+  } else if (rc < 0) {
+    if (error_out) {
+      *error_out = batcher->error;
+      batcher->error = NULL;
+    }
+  }
+  pthread_mutex_unlock(&batcher->lock);
+  return rc;
+}
+
+void stream_batcher_free(StreamBatcher *batcher) {
+  if (!batcher) {
+    return;
+  }
+  if (batcher->threaded) {
+    pthread_mutex_lock(&batcher->lock);
+    batcher->stopping = true;
+    pthread_cond_broadcast(&batcher->changed);
+    pthread_mutex_unlock(&batcher->lock);
+    ssize_t ignored = write(batcher->wake[1], "", 1);
+    (void) ignored;
+    pthread_join(batcher->thread, NULL);
+    for (size_t i = 0; i < batcher->queue_count; ++i) {
+      free(batcher->queue[(batcher->queue_head + i) % batcher->queue_depth].data);
+    }
+    pthread_mutex_destroy(&batcher->lock);
+    pthread_cond_destroy(&batcher->changed);
+    close(batcher->wake[0]);
+    close(batcher->wake[1]);
+    free(batcher->queue);
+    free(batcher->error);
+  }
+  sb_clean(&batcher->pending);
+  memset(batcher, 0, sizeof *batcher);
+  batcher->fd = -1;
+}
@@ -0,0 +1,69 @@
+#ifndef STREAM_BATCHER_H
+#define STREAM_BATCHER_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "string_buffer.h"
+
+typedef enum {
+  STREAM_CUT_SIZE = 0,
+  STREAM_CUT_WINDOW,
+  STREAM_CUT_EOF
+} StreamCutReason;
+
+/* Finished batches a reader thread may hold before it stops reading (see stream_batcher_start). */
+#define STREAM_BATCHER_QUEUE_DEPTH 4
+
+typedef struct {
+  char *data;
+  size_t length;
+  StreamCutReason reason;
+} StreamBatch;
+
+/**
+ * Cuts an endless byte stream (a pipe, FIFO or tail -f) into micro-batches. A batch closes when it
+ * reaches max_bytes, when window_ms have passed since its first byte arrived, or at end of stream.
+ * Batches end on a record (newline) boundary whenever one exists, and at most max_bytes are ever
+ * buffered: once the buffer is full the batcher stops reading and the pipe applies backpressure.
+ * With a reader thread, reading and cutting go on while the caller processes earlier batches, and up
+ * to queue_depth finished batches wait in a bounded queue before the thread stops reading.
+ */
+typedef struct {
+  int fd;
+  size_t max_bytes;
+  int window_ms;
+  StringBuffer pending;
+  long long deadline_ms;
+  bool eof;
+
+  bool threaded;
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+  StreamBatch *queue;
+  size_t queue_depth;
+  size_t queue_head;
+  size_t queue_count;
+  bool finished;
+  bool stopping;
+  int status;
+  char *error;
+  int wake[2];
+} StreamBatcher;
+
+int stream_batcher_init(StreamBatcher *batcher, int fd, size_t max_bytes, int window_ms);
+/* Moves reading onto a thread of its own feeding a queue of queue_depth batches. */
+int stream_batcher_start(StreamBatcher *batcher, size_t queue_depth, char **error_out);
+
+/**
+ * Blocks until the next batch is ready. Returns 1 with a malloc'd batch in batch_out, 0 once the
+ * stream is exhausted, or -1 on a read error (reported after any batches cut before it).
+ */
+int stream_batcher_next(StreamBatcher *batcher, char **batch_out, size_t *length_out, StreamCutReason *reason_out,
+                        char **error_out);
+/* Stops the reader thread, if any, and drops batches still queued. */
+void stream_batcher_free(StreamBatcher *batcher);
+
+#endif /* STREAM_BATCHER_H */
@@ -5,6 +5,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "large_buffer.h"
+#include "memory_budget.h"
+
 void sb_init(StringBuffer *buffer) {
   if (!buffer) {
     return;
@@ -15,6 +18,7 @@ void sb_init(StringBuffer *buffer) {
   }
   buffer->length = 0;
   buffer->capacity = buffer->data ? 1 : 0;
+  memory_budget_charge(buffer->capacity);
 }
 
 static int sb_grow(StringBuffer *buffer, size_t needed) {
@@ -33,6 +37,8 @@ static int sb_grow(StringBuffer *buffer, size_t needed) {
   if (!next) {
     return -1;
   }
+  memory_budget_charge(new_cap - buffer->capacity);
+  large_buffer_advise(next, new_cap);
   buffer->data = next;
   buffer->capacity = new_cap;
   return 0;
@@ -106,6 +112,8 @@ char *sb_detach(StringBuffer *buffer) {
     return NULL;
   }
   char *result = buffer->data;
+  /* Detached memory belongs to the caller and leaves the budget. */
+  memory_budget_release(buffer->capacity);
   buffer->data = NULL;
   buffer->length = 0;
   buffer->capacity = 0;
@@ -116,6 +124,7 @@ void sb_clean(StringBuffer *buffer) {
   if (!buffer) {
     return;
   }
+  memory_budget_release(buffer->capacity);
   free(buffer->data);
   buffer->data = NULL;
   buffer->length = 0;
@@ -0,0 +1,136 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "deepseek.h"
+#include "job_server.h"
+#include "string_buffer.h"
+
+/* Thin client for a deepseek_mpi --daemon instance: forwards config keys and an optional payload,
+ * copies the daemon's reply to stdout and exits non-zero unless the job finished with status=ok. */
+
+static void print_usage(const char *prog) {
+  printf("Usage: %s [options] [key=value ...]\n", prog);
+  printf("\nOptions:\n");
+  printf("  --socket PATH       Daemon socket (default %s)\n", DEEPSEEK_DEFAULT_DAEMON_SOCKET);
+  printf("  --input-file PATH   Process PATH on the daemon; '-' streams stdin as the payload\n");
+  printf("  --shutdown          Ask the daemon to exit after in-flight work\n");
+  printf("  --help              Show this message\n");
+  printf("\nkey=value arguments use the configuration file keys, e.g. chunk_size=4096.\n");
+}
+
+static int read_stream(FILE *stream, StringBuffer *out) {
+  char block[8192];
+  size_t n;
+  while ((n = fread(block, 1, sizeof block, stream)) > 0) {
+    if (sb_append(out, block, n) != 0) {
+      return -1;
+    }
+  }
+  return ferror(stream) ? -1 : 0;
+}
+
+int main(int argc, char **argv) {
+  const char *socket_path = DEEPSEEK_DEFAULT_DAEMON_SOCKET;
+  const char *input_path = NULL;
+  int shutdown_daemon = 0;
+  StringBuffer header;
+  StringBuffer payload;
+  sb_init(&header);
+  sb_init(&payload);
+
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+      socket_path = argv[++i];
+    } else if (strcmp(argv[i], "--input-file") == 0 && i + 1 < argc) {
+      input_path = argv[++i];
+    } else if (strcmp(argv[i], "--shutdown") == 0) {
+      shutdown_daemon = 1;
+    } else if (strcmp(argv[i], "--help") == 0) {
+      print_usage(argv[0]);
+      return EXIT_SUCCESS;
+    } else if (strchr(argv[i], '=') && !strchr(argv[i], '\n')) {
+      sb_append_printf(&header, "%s\n", argv[i]);
+    } else {
+      fprintf(stderr, "Unrecognised argument: %s\n", argv[i]);
+      print_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (shutdown_daemon) {
+    sb_reset(&header);
+    sb_append_str(&header, JOB_COMMAND_KEY "=shutdown\n");
+  } else if (input_path && strcmp(input_path, "-") == 0) {
+    if (read_stream(stdin, &payload) != 0) {
+      fprintf(stderr, "Failed to read stdin: %s\n", strerror(errno));
+      return EXIT_FAILURE;
+    }
+    sb_append_printf(&header, JOB_PAYLOAD_BYTES_KEY "=%zu\n", payload.length);
+  } else if (input_path) {
+    /* The daemon resolves paths from its own working directory. */
+    char resolved[PATH_MAX];
+    if (!realpath(input_path, resolved)) {
+      fprintf(stderr, "Cannot resolve %s: %s\n", input_path, strerror(errno));
+      return EXIT_FAILURE;
+    }
+    sb_append_printf(&header, "input_file=%s\n", resolved);
+  }
+  sb_append_char(&header, '\n');
+
+  char *error = NULL;
+  int fd = job_server_connect(socket_path, &error);
+  if (fd < 0) {
+    fprintf(stderr, "Cannot reach daemon: %s\n", error ? error : "unknown error");
+    free(error);
+    return EXIT_FAILURE;
+  }
+  if (job_server_write(fd, header.data, header.length) != 0 ||
+      (payload.length > 0 && job_server_write(fd, payload.data, payload.length) != 0)) {
+    /* A daemon that refuses the job (say, over the memory budget) closes early but still says why. */
+    if (errno != EPIPE && errno != ECONNRESET) {
+      fprintf(stderr, "Failed to send job: %s\n", strerror(errno));
+      close(fd);
+      return EXIT_FAILURE;
+    }
+  }
+  sb_clean(&header);
+  sb_clean(&payload);
+
+  /* Stream the reply through and keep only its tail to find the status line. */
+  char tail[512];
+  size_t tail_len = 0;
+  char block[8192];
+  ssize_t n;
+  while ((n = read(fd, block, sizeof block)) != 0) {
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    fwrite(block, 1, (size_t) n, stdout);
+    if ((size_t) n >= sizeof tail - 1) {
+      memcpy(tail, block + n - (sizeof tail - 1), sizeof tail - 1);
+      tail_len = sizeof tail - 1;
+    } else {
+      size_t keep = tail_len + (size_t) n > sizeof tail - 1 ? sizeof tail - 1 - (size_t) n : tail_len;
+      memmove(tail, tail + tail_len - keep, keep);
+      memcpy(tail + keep, block, (size_t) n);
+      tail_len = keep + (size_t) n;
+    }
+  }
+  close(fd);
+  fflush(stdout);
+  tail[tail_len] = '\0';
+
+  const char *status = NULL;
+  for (const char *cursor = tail; (cursor = strstr(cursor, "\n" JOB_STATUS_PREFIX)) != NULL; ++cursor) {
+    status = cursor + 1 + strlen(JOB_STATUS_PREFIX);
+  }
+  return status && strncmp(status, "ok", 2) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,273 @@
+#include "text_classifier.h"
+
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define TEXT_CLASSIFIER_HAVE_SSE2 1
+#endif
+#if defined(__x86_64__) && (defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#include <immintrin.h>
+#define TEXT_CLASSIFIER_HAVE_AVX2 1
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define TEXT_CLASSIFIER_HAVE_NEON 1
+#endif
+
+/* Bytes per step of the exact scan; the decision is re-checked after each block. */
+#define CLASSIFY_BLOCK_BYTES   (64U * 1024U)
+/* Sampling parameters: one SAMPLE_BLOCK_BYTES probe per stratum, strata visited in bit-reversed order. */
+#define SAMPLE_BLOCK_BYTES     4096U
+#define SAMPLE_STRATA_BITS     10U
+#define SAMPLE_STRATA          (1U << SAMPLE_STRATA_BITS)
+#define SAMPLE_MIN_BLOCKS      32U
+/* Two-sided z for ~99.9% confidence; squared so the hot loop avoids sqrt(). */
+#define SAMPLE_Z_SQUARED       10.8241
+#define BINARY_FRACTION        0.2
+
+typedef size_t (*CountControlFn)(const unsigned char *data, size_t len);
+
+static inline size_t is_control_byte(unsigned char ch) {
+  return (ch < 0x09 || (ch > 0x0D && ch < 0x20) || ch == 0x7F) ? 1U : 0U;
+}
+
+static size_t count_control_scalar(const unsigned char *data, size_t len) {
+  size_t count = 0;
+  for (size_t i = 0; i < len; ++i) {
+    count += is_control_byte(data[i]);
+  }
+  return count;
+}
+
+#ifdef TEXT_CLASSIFIER_HAVE_SSE2
+static size_t count_control_sse2(const unsigned char *data, size_t len) {
+  const __m128i below_tab = _mm_set1_epi8(0x08);
+  const __m128i shift_base = _mm_set1_epi8(0x0E);
+  const __m128i shifted_span = _mm_set1_epi8(0x11);
+  const __m128i del = _mm_set1_epi8(0x7F);
+  const __m128i zero = _mm_setzero_si128();
+  size_t total = 0;
+  size_t i = 0;
+  while (len - i >= 16) {
+    /* Byte lanes count up to 255 matches before they have to be folded into total. */
+    size_t rounds = (len - i) / 16;
+    if (rounds > 255) {
+      rounds = 255;
+    }
+    __m128i acc = zero;
+    for (size_t r = 0; r < rounds; ++r, i += 16) {
+      __m128i v = _mm_loadu_si128((const __m128i *) (const void *) (data + i));
+      __m128i low = _mm_cmpeq_epi8(_mm_min_epu8(v, below_tab), v);
+      __m128i t = _mm_sub_epi8(v, shift_base);
+      __m128i mid = _mm_cmpeq_epi8(_mm_min_epu8(t, shifted_span), t);
+      __m128i hit = _mm_or_si128(_mm_or_si128(low, mid), _mm_cmpeq_epi8(v, del));
+      acc = _mm_sub_epi8(acc, hit);
+    }
+    __m128i sums = _mm_sad_epu8(acc, zero);
+    total += (size_t) _mm_cvtsi128_si32(sums) + (size_t) _mm_extract_epi16(sums, 4);
+  }
+  return total + count_control_scalar(data + i, len - i);
+}
+#endif
+
+#ifdef TEXT_CLASSIFIER_HAVE_AVX2
+__attribute__((target("avx2"))) static size_t count_control_avx2(const unsigned char *data, size_t len) {
+  const __m256i below_tab = _mm256_set1_epi8(0x08);
+  const __m256i shift_base = _mm256_set1_epi8(0x0E);
+  const __m256i shifted_span = _mm256_set1_epi8(0x11);
+  const __m256i del = _mm256_set1_epi8(0x7F);
+  const __m256i zero = _mm256_setzero_si256();
+  size_t total = 0;
+  size_t i = 0;
+  while (len - i >= 32) {
+    size_t rounds = (len - i) / 32;
+    if (rounds > 255) {
+      rounds = 255;
+    }
+    __m256i acc = zero;
+    for (size_t r = 0; r < rounds; ++r, i += 32) {
+      __m256i v = _mm256_loadu_si256((const __m256i *) (const void *) (data + i));
+      __m256i low = _mm256_cmpeq_epi8(_mm256_min_epu8(v, below_tab), v);
+      __m256i t = _mm256_sub_epi8(v, shift_base);
+      __m256i mid = _mm256_cmpeq_epi8(_mm256_min_epu8(t, shifted_span), t);
+      __m256i hit = _mm256_or_si256(_mm256_or_si256(low, mid), _mm256_cmpeq_epi8(v, del));
+      acc = _mm256_sub_epi8(acc, hit);
+    }
+    __m256i sums = _mm256_sad_epu8(acc, zero);
+    total += (size_t) _mm256_extract_epi64(sums, 0) + (size_t) _mm256_extract_epi64(sums, 1) +
+             (size_t) _mm256_extract_epi64(sums, 2) + (size_t) _mm256_extract_epi64(sums, 3);
+  }
+  return total + count_control_scalar(data + i, len - i);
+}
+#endif
+
+#ifdef TEXT_CLASSIFIER_HAVE_NEON
+static size_t count_control_neon(const unsigned char *data, size_t len) {
+  const uint8x16_t below_tab = vdupq_n_u8(0x08);
+  const uint8x16_t shift_base = vdupq_n_u8(0x0E);
+  const uint8x16_t shifted_span = vdupq_n_u8(0x11);
+  const uint8x16_t del = vdupq_n_u8(0x7F);
+  size_t total = 0;
+  size_t i = 0;
+  while (len - i >= 16) {
+    size_t rounds = (len - i) / 16;
+    if (rounds > 255) {
+      rounds = 255;
+    }
+    uint8x16_t acc = vdupq_n_u8(0);
+    for (size_t r = 0; r < rounds; ++r, i += 16) {
+      uint8x16_t v = vld1q_u8(data + i);
+      uint8x16_t low = vcleq_u8(v, below_tab);
+      uint8x16_t mid = vcleq_u8(vsubq_u8(v, shift_base), shifted_span);
+      uint8x16_t hit = vorrq_u8(vorrq_u8(low, mid), vceqq_u8(v, del));
+      acc = vsubq_u8(acc, hit);
+    }
+    uint64x2_t sums = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(acc)));
+    total += (size_t) vgetq_lane_u64(sums, 0) + (size_t) vgetq_lane_u64(sums, 1);
+  }
+  return total + count_control_scalar(data + i, len - i);
+}
+#endif
+
+static CountControlFn g_count_control = NULL;
+static const char *g_backend_name = "scalar";
+
+static CountControlFn resolve_count_control(void) {
+  if (g_count_control) {
+    return g_count_control;
+  }
+  CountControlFn fn = count_control_scalar;
+  const char *name = "scalar";
+#if defined(TEXT_CLASSIFIER_HAVE_SSE2)
+  fn = count_control_sse2;
+  name = "sse2";
+#elif defined(TEXT_CLASSIFIER_HAVE_NEON)
+  fn = count_control_neon;
+  name = "neon";
+#endif
+#ifdef TEXT_CLASSIFIER_HAVE_AVX2
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    fn = count_control_avx2;
+    name = "avx2";
+  }
+#endif
+  g_backend_name = name;
+  g_count_control = fn;
+  return fn;
+}
+
+size_t text_classifier_count_control(const unsigned char *data, size_t len) {
+  if (!data || len == 0) {
+    return 0;
+  }
+  return resolve_count_control()(data, len);
+}
+
+const char *text_classifier_backend(void) {
+  resolve_count_control();
+  return g_backend_name;
+}
+
+bool text_classifier_is_binary_exact(const unsigned char *data, size_t len) {
+  if (!data || len == 0) {
+    return false;
+  }
+  CountControlFn count_fn = resolve_count_control();
+  /* Binary when control * 5 > len, i.e. control > len / 5; stop once either side is certain. */
+  size_t limit = len / 5;
+  size_t control = 0;
+  size_t offset = 0;
+  while (offset < len) {
+    size_t span = len - offset > CLASSIFY_BLOCK_BYTES ? CLASSIFY_BLOCK_BYTES : len - offset;
+    control += count_fn(data + offset, span);
+    offset += span;
+    if (control > limit) {
+      return true;
+    }
+    if (control + (len - offset) <= limit) {
+      return false;
+    }
+  }
+  return false;
+}
+
+static size_t bit_reverse(size_t value, unsigned bits) {
+  size_t out = 0;
+  for (unsigned i = 0; i < bits; ++i) {
+    out = (out << 1) | (value & 1U);
+    value >>= 1;
+  }
+  return out;
+}
+
+static uint64_t mix64(uint64_t x) {
+  x += 0x9E3779B97F4A7C15ULL;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+bool text_classifier_is_binary_sampled(const unsigned char *data, size_t len, size_t *sampled_bytes) {
+  if (sampled_bytes) {
+    *sampled_bytes = 0;
+  }
+  if (!data || len == 0) {
+    return false;
+  }
+  size_t stratum_len = len / SAMPLE_STRATA;
+  if (stratum_len < SAMPLE_BLOCK_BYTES * 2) {
+    if (sampled_bytes) {
+      *sampled_bytes = len;
+    }
+    return text_classifier_is_binary_exact(data, len);
+  }
+  CountControlFn count_fn = resolve_count_control();
+  size_t slack = stratum_len - SAMPLE_BLOCK_BYTES;
+  double sum = 0.0;
+  double sum_sq = 0.0;
+  size_t scanned = 0;
+  for (size_t n = 1; n <= SAMPLE_STRATA; ++n) {
+    size_t stratum = bit_reverse(n - 1, SAMPLE_STRATA_BITS);
+    size_t offset = stratum * stratum_len + (size_t) (mix64((uint64_t) stratum) % (uint64_t) slack);
+    double fraction = (double) count_fn(data + offset, SAMPLE_BLOCK_BYTES) / (double) SAMPLE_BLOCK_BYTES;
+    scanned += SAMPLE_BLOCK_BYTES;
+    sum += fraction;
+    sum_sq += fraction * fraction;
+    if (n < SAMPLE_MIN_BLOCKS) {
+      continue;
+    }
+    double mean = sum / (double) n;
+    double variance = (sum_sq - sum * mean) / (double) (n - 1);
+    if (variance < 0.0) {
+      variance = 0.0;
+    }
+    /* Standard error with finite-population correction, floored so uniform samples still need evidence. */
+    double se_sq = variance / (double) n * (1.0 - (double) n / (double) SAMPLE_STRATA);
+    double floor_sq = 1.0 / ((double) n * (double) n);
+    if (se_sq < floor_sq) {
+      se_sq = floor_sq;
+    }
+    double gap = mean - BINARY_FRACTION;
+    if (gap * gap > SAMPLE_Z_SQUARED * se_sq) {
+      if (sampled_bytes) {
+        *sampled_bytes = scanned;
+      }
+      return gap > 0.0;
+    }
+  }
+  /* Too close to the threshold to call from samples; settle it exactly. */
+  if (sampled_bytes) {
+    *sampled_bytes = scanned + len;
+  }
+  return text_classifier_is_binary_exact(data, len);
+}
+
+bool text_classifier_is_binary(const unsigned char *data, size_t len) {
+  if (len >= TEXT_CLASSIFIER_SAMPLE_MIN_BYTES) {
+    return text_classifier_is_binary_sampled(data, len, NULL);
+  }
+  return text_classifier_is_binary_exact(data, len);
+}
@@ -0,0 +1,18 @@
+#ifndef TEXT_CLASSIFIER_H
+#define TEXT_CLASSIFIER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Buffers at least this large are classified from stratified samples instead of a full scan.
+ */
+#define TEXT_CLASSIFIER_SAMPLE_MIN_BYTES (64ULL * 1024ULL * 1024ULL)
+
+size_t text_classifier_count_control(const unsigned char *data, size_t len);
+bool text_classifier_is_binary_exact(const unsigned char *data, size_t len);
+bool text_classifier_is_binary_sampled(const unsigned char *data, size_t len, size_t *sampled_bytes);
+bool text_classifier_is_binary(const unsigned char *data, size_t len);
+const char *text_classifier_backend(void);
+
+#endif /* TEXT_CLASSIFIER_H */
@@ -0,0 +1,817 @@
+#include "text_normalizer.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#define NORMALIZE_BASE64_MIN_RUN 200U
+#define NORMALIZE_BASE64_MIN_WIDTH 16U
+#define NORMALIZE_EDGE_LINES     2U
+#define NORMALIZE_MAX_EDGE_LEN   160U
+#define NORMALIZE_MIN_PAGES      3U
+#define NORMALIZE_MAX_INDENT     16U
+
+enum {
+  LINE_BLANK = 1U << 0,
+  LINE_DROP = 1U << 1,
+  LINE_NEWLINE = 1U << 2,
+  LINE_CSV_ROW = 1U << 3,
+  LINE_PAGE_NUMBER = 1U << 4
+};
+
+typedef struct {
+  size_t offset;
+  size_t length;
+  uint32_t page;
+  uint32_t table;
+  unsigned flags;
+} NormLine;
+
+typedef struct {
+  size_t header_line;
+  size_t width;
+  size_t capacity;
+  unsigned char *used;
+  bool irregular;
+  char delimiter;
+} NormTable;
+
+typedef struct {
+  NormLine *lines;
+  size_t count;
+  size_t capacity;
+  NormTable *tables;
+  size_t table_count;
+  size_t table_capacity;
+  bool tracking;
+  bool csv_layout;
+  bool in_quotes;
+  bool last_blank;
+  bool in_fence;
+  bool needs_compaction;
+  uint32_t page;
+  uint32_t edge_threshold;
+  TextNormalizeStats *stats;
+} NormState;
+
+typedef struct {
+  uint64_t key;
+  uint32_t last_page;
+  uint32_t pages;
+  bool used;
+  bool kept_first;
+} EdgeEntry;
+
+static bool is_inline_space(unsigned char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\v';
+}
+
+static bool is_base64_char(unsigned char c) {
+  return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '+' || c == '/' ||
+         c == '=';
+}
+
+static bool looks_like_base64(const char *token, size_t len) {
+  if (len < NORMALIZE_BASE64_MIN_RUN) {
+    return false;
+  }
+  bool upper = false;
+  bool lower = false;
+  bool digit = false;
+  for (size_t i = 0; i < len && !(upper && lower && digit); ++i) {
+    unsigned char c = (unsigned char) token[i];
+    upper = upper || (c >= 'A' && c <= 'Z');
+    lower = lower || (c >= 'a' && c <= 'z');
+    digit = digit || (c >= '0' && c <= '9');
+  }
+  return upper && lower && digit;
+}
+
+/* Wrapped base64 (MIME bodies, PEM) starting with a line-filling token of width bytes at r: the lines after
+ * it that hold exactly width base64 bytes, plus one shorter closing line (each may end in "\r"). Returns the
+ * span up to the end of the last token; chars_out gets the encoded bytes and lines_out the line count. */
+static size_t wrapped_base64_span(const char *data, size_t len, size_t r, size_t width, size_t *chars_out,
+                                  size_t *lines_out) {
+  size_t pos = r + width;
+  size_t chars = width;
+  size_t lines = 1;
+  for (;;) {
+    size_t eol = pos < len && data[pos] == '\r' ? pos + 1 : pos;
+    if (eol >= len || data[eol] != '\n') {
+      break;
+    }
+    size_t next = eol + 1;
+    size_t end = next;
+    while (end < len && is_base64_char((unsigned char) data[end])) {
+      end++;
+    }
+    size_t after = end < len && data[end] == '\r' ? end + 1 : end;
+    size_t n = end - next;
+    if (n == 0 || n > width || (after < len && data[after] != '\n')) {
+      break;
+    }
+    chars += n;
+    lines++;
+    pos = end;
+    if (n < width) {
+      break;
+    }
+  }
+  *chars_out = chars;
+  *lines_out = lines;
+  return pos - r;
+}
+
+/* Leading spaces and tabs kept as a line's indentation; tabular layouts keep none. */
+static size_t indent_length(const NormState *st, const char *s, size_t len) {
+  size_t i = 0;
+  while (!st->csv_layout && i < len && (s[i] == ' ' || s[i] == '\t')) {
+    i++;
+  }
+  return i;
+}
+
+static bool is_page_marker(const char *s, size_t len) {
+  return len > 16 && strncmp(s, "----- Page ", 11) == 0 && strncmp(s + len - 6, " -----", 6) == 0;
+}
+
+/* A run of 4+ identical rule characters. "~~~~" is left alone: in Markdown it opens a code fence. */
+static bool is_separator_line(const char *s, size_t len) {
+  if (len < 4 || !strchr("-=_*", s[0])) {
+    return false;
+  }
+  for (size_t i = 1; i < len; ++i) {
+    if (s[i] != s[0]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* Markdown code fence: 3+ backticks or tildes, optionally followed by an info string. */
+static bool is_fence_line(const char *s, size_t len) {
+  if (len < 3 || (s[0] != '`' && s[0] != '~')) {
+    return false;
+  }
+  return s[1] == s[0] && s[2] == s[0];
+}
+
+static size_t skip_digits(const char *s, size_t len, size_t i) {
+  while (i < len && s[i] >= '0' && s[i] <= '9') {
+    i++;
+  }
+  return i;
+}
+
+/* Matches bare page numbers such as "12", "Page 3", "page 3 of 10", "3/10" and "- 7 -". */
+static bool is_page_number_line(const char *s, size_t len) {
+  size_t i = 0;
+  bool dashed = false;
+  if (len >= 2 && s[0] == '-' && s[1] == ' ') {
+    dashed = true;
+    i = 2;
+  }
+  if (len - i >= 4 && strncasecmp(s + i, "page", 4) == 0) {
+    i += 4;
+    if (i < len && s[i] == ' ') {
+      i++;
+    }
+  }
+  size_t end = skip_digits(s, len, i);
+  if (end == i) {
+    return false;
+  }
+  i = end;
+  size_t j = i;
+  if (j < len && s[j] == ' ') {
+    j++;
+  }
+  bool has_total = false;
+  if (len - j >= 2 && strncasecmp(s + j, "of", 2) == 0) {
+    j += 2;
+    has_total = true;
+  } else if (j < len && s[j] == '/') {
+    j++;
+    has_total = true;
+  }
+  if (has_total) {
+    if (j < len && s[j] == ' ') {
+      j++;
+    }
+    end = skip_digits(s, len, j);
+    if (end == j) {
+      return false;
+    }
+    i = end;
+  }
+  if (dashed) {
+    if (len - i != 2 || s[i] != ' ' || s[i + 1] != '-') {
+      return false;
+    }
+    i += 2;
+  }
+  return i == len;
+}
+
+static bool is_table_marker(const char *s, size_t len) {
+  return (len >= 9 && strncmp(s, "# Sheet: ", 9) == 0) || (len >= 9 && strncmp(s, "# Table: ", 9) == 0);
+}
+
+/* FNV-1a over the line with digit runs folded to '#', so "Page 3 of 9" and "Page 4 of 9" collide. */
+static uint64_t edge_key(const char *s, size_t len) {
+  uint64_t hash = 1469598103934665603ULL;
+  bool in_digits = false;
+  for (size_t i = 0; i < len; ++i) {
+    unsigned char c = (unsigned char) s[i];
+    if (c >= '0' && c <= '9') {
+      if (in_digits) {
+        continue;
+      }
+      in_digits = true;
+      c = '#';
+    } else {
+      in_digits = false;
+    }
+    hash ^= c;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+static NormTable *current_table(NormState *st) {
+  if (st->table_count == 0) {
+    if (st->table_capacity == 0) {
+      NormTable *tables = calloc(4, sizeof *tables);
+      if (!tables) {
+        return NULL;
+      }
+      st->tables = tables;
+      st->table_capacity = 4;
+    }
+    memset(&st->tables[0], 0, sizeof st->tables[0]);
+    st->tables[0].header_line = SIZE_MAX;
+    st->table_count = 1;
+  }
+  return &st->tables[st->table_count - 1];
+}
+
+static int begin_table(NormState *st) {
+  if (st->table_count == st->table_capacity) {
+    size_t next_cap = st->table_capacity ? st->table_capacity * 2 : 4;
+    NormTable *next = realloc(st->tables, next_cap * sizeof *next);
+    if (!next) {
+      return -1;
+    }
+    st->tables = next;
+    st->table_capacity = next_cap;
+  }
+  NormTable *table = &st->tables[st->table_count++];
+  memset(table, 0, sizeof *table);
+  table->header_line = SIZE_MAX;
+  st->in_quotes = false;
+  return 0;
+}
+
+static int table_mark_column(NormTable *table, size_t column, bool has_content) {
+  if (column >= table->capacity) {
+    size_t next_cap = table->capacity ? table->capacity : 16;
+    while (next_cap <= column) {
+      next_cap *= 2;
+    }
+    unsigned char *next = realloc(table->used, next_cap);
+    if (!next) {
+      return -1;
+    }
+    memset(next + table->capacity, 0, next_cap - table->capacity);
+    table->used = next;
+    table->capacity = next_cap;
+  }
+  if (column >= table->width) {
+    table->width = column + 1;
+  }
+  if (has_content) {
+    table->used[column] = 1;
+  }
+  return 0;
+}
+
+/* A table is tab-separated when its header row has at least as many tabs as commas outside quotes. */
+static char detect_delimiter(const char *s, size_t len) {
+  size_t tabs = 0;
+  size_t commas = 0;
+  bool in_quotes = false;
+  for (size_t i = 0; i < len; ++i) {
+    if (s[i] == '"') {
+      in_quotes = !in_quotes;
+    } else if (!in_quotes) {
+      tabs += s[i] == '\t';
+      commas += s[i] == ',';
+    }
+  }
+  return tabs > 0 && tabs >= commas ? '\t' : ',';
+}
+
+static int scan_csv_row(NormState *st, NormTable *table, const char *s, size_t len) {
+  if (st->in_quotes) {
+    table->irregular = true;
+  }
+  size_t column = 0;
+  size_t field_len = 0;
+  for (size_t i = 0; i < len; ++i) {
+    char c = s[i];
+    if (c == '"') {
+      st->in_quotes = !st->in_quotes;
+      field_len++;
+    } else if (c == table->delimiter && !st->in_quotes) {
+      if (table_mark_column(table, column, field_len > 0 && !(field_len == 2 && s[i - 1] == '"')) != 0) {
+        return -1;
+      }
+      column++;
+      field_len = 0;
+    } else {
+      field_len++;
+    }
+  }
+  bool quoted_empty = field_len == 2 && len >= 2 && s[len - 1] == '"' && s[len - 2] == '"';
+  if (table_mark_column(table, column, field_len > 0 && !quoted_empty) != 0) {
+    return -1;
+  }
+  if (st->in_quotes) {
+    table->irregular = true;
+  }
+  return 0;
+}
+
+static int record_line(NormState *st, size_t offset, size_t length, unsigned flags) {
+  if (!st->tracking) {
+    return 0;
+  }
+  if (st->count == st->capacity) {
+    size_t next_cap = st->capacity ? st->capacity * 2 : 1024;
+    NormLine *next = realloc(st->lines, next_cap * sizeof *next);
+    if (!next) {
+      st->tracking = false;
+      return -1;
+    }
+    st->lines = next;
+    st->capacity = next_cap;
+  }
+  NormLine *line = &st->lines[st->count++];
+  line->offset = offset;
+  line->length = length;
+  line->page = st->page;
+  line->table = st->table_count > 0 ? (uint32_t) (st->table_count - 1) : 0;
+  line->flags = flags;
+  return 0;
+}
+
+static void drop_now(NormState *st, size_t start, size_t *w, bool newline) {
+  st->stats->boilerplate_bytes += (*w - start) + (newline ? 1U : 0U);
+  st->stats->boilerplate_lines++;
+  *w = start;
+}
+
+static void finish_line(NormState *st, char *data, size_t start, size_t *w, bool newline, bool page_break) {
+  size_t len = *w - start;
+  const char *s = data + start;
+  size_t indent = indent_length(st, s, len);
+  /* Markers, rules and page numbers are recognised whatever their indentation. */
+  const char *text = s + indent;
+  size_t text_len = len - indent;
+  if (len == 0) {
+    if (!st->last_blank && newline && !page_break) {
+      record_line(st, start, 0, LINE_BLANK | LINE_NEWLINE);
+      data[(*w)++] = '\n';
+      st->last_blank = true;
+    }
+    if (page_break) {
+      st->page++;
+    }
+    return;
+  }
+  if (is_page_marker(text, text_len)) {
+    drop_now(st, start, w, newline);
+    st->page++;
+    return;
+  }
+  if (!st->csv_layout && is_fence_line(text, text_len)) {
+    st->in_fence = !st->in_fence;
+  } else if (!st->in_fence && st->last_blank && is_separator_line(text, text_len)) {
+    /* Only a free-standing rule goes: directly under a line of text it underlines a (setext) heading. */
+    drop_now(st, start, w, newline);
+    if (page_break) {
+      st->page++;
+    }
+    return;
+  }
+  unsigned flags = newline ? LINE_NEWLINE : 0U;
+  /* Only a candidate for now: it goes if it turns out to sit next to a page break (drop_page_numbers). */
+  if (!st->csv_layout && is_page_number_line(text, text_len)) {
+    flags |= LINE_PAGE_NUMBER;
+  }
+  if (st->csv_layout && st->tracking) {
+    if (is_table_marker(text, text_len)) {
+      if (begin_table(st) != 0) {
+        st->tracking = false;
+      }
+    } else {
+      NormTable *table = current_table(st);
+      if (!table) {
+        st->tracking = false;
+      } else if (table->header_line == SIZE_MAX) {
+        table->header_line = st->count;
+        table->delimiter = detect_delimiter(s, len);
+        flags |= LINE_CSV_ROW;
+        if (scan_csv_row(st, table, s, len) != 0) {
+          st->tracking = false;
+        }
+      } else {
+        const NormLine *header = &st->lines[table->header_line];
+        if (header->length == len && memcmp(data + header->offset, s, len) == 0) {
+          /* A repeated header row (typically re-emitted per page of an export). */
+          drop_now(st, start, w, newline);
+          return;
+        }
+        flags |= LINE_CSV_ROW;
+        if (scan_csv_row(st, table, s, len) != 0) {
+          st->tracking = false;
+        }
+      }
+    }
+  }
+  record_line(st, start, len, flags);
+  if (newline) {
+    data[(*w)++] = '\n';
+  }
+  st->last_blank = false;
+  if (page_break) {
+    st->page++;
+  }
+}
+
+static size_t next_pow2(size_t value) {
+  size_t out = 16;
+  while (out < value) {
+    out <<= 1;
+  }
+  return out;
+}
+
+static EdgeEntry *edge_lookup(EdgeEntry *entries, size_t capacity, uint64_t key) {
+  size_t slot = (size_t) key & (capacity - 1);
+  while (entries[slot].used && entries[slot].key != key) {
+    slot = (slot + 1) & (capacity - 1);
+  }
+  if (!entries[slot].used) {
+    entries[slot].used = true;
+    entries[slot].key = key;
+    entries[slot].last_page = UINT32_MAX;
+  }
+  return &entries[slot];
+}
+
+/* Calls visit() for the first and last NORMALIZE_EDGE_LINES non-blank lines of each page. */
+static void for_each_edge_line(NormState *st, const char *data, EdgeEntry *entries, size_t capacity,
+                               void (*visit)(NormState *, NormLine *, EdgeEntry *)) {
+  size_t begin = 0;
+  while (begin < st->count) {
+    uint32_t page = st->lines[begin].page;
+    size_t end = begin;
+    while (end < st->count && st->lines[end].page == page) {
+      end++;
+    }
+    size_t seen = 0;
+    size_t first_tail = end;
+    size_t tail_seen = 0;
+    while (first_tail > begin && tail_seen < NORMALIZE_EDGE_LINES) {
+      first_tail--;
+      if (!(st->lines[first_tail].flags & (LINE_BLANK | LINE_DROP))) {
+        tail_seen++;
+      }
+    }
+    for (size_t i = begin; i < end; ++i) {
+      NormLine *line = &st->lines[i];
+      if (line->flags & (LINE_BLANK | LINE_DROP)) {
+        continue;
+      }
+      bool head = seen < NORMALIZE_EDGE_LINES;
+      seen++;
+      if ((head || i >= first_tail) && line->length <= NORMALIZE_MAX_EDGE_LEN) {
+        size_t indent = indent_length(st, data + line->offset, line->length);
+        visit(st, line,
+              edge_lookup(entries, capacity, edge_key(data + line->offset + indent, line->length - indent)));
+      }
+    }
+    begin = end;
+  }
+}
+
+static void count_edge(NormState *st, NormLine *line, EdgeEntry *entry) {
+  (void) st;
+  if (entry->last_page != line->page) {
+    entry->last_page = line->page;
+    entry->pages++;
+  }
+}
+
+static void mark_edge(NormState *st, NormLine *line, EdgeEntry *entry) {
+  if (entry->pages < st->edge_threshold) {
+    return;
+  }
+  if (!entry->kept_first) {
+    entry->kept_first = true;
+    return;
+  }
+  line->flags |= LINE_DROP;
+  st->needs_compaction = true;
+}
+
+/* Drops page-number lines that open or close a page of a paged document (one with form feeds or page
+ * markers). Without page breaks nothing is dropped, so a bare number in running text or a list survives. */
+static void drop_page_numbers(NormState *st) {
+  if (st->page == 0) {
+    return;
+  }
+  size_t begin = 0;
+  while (begin < st->count) {
+    uint32_t page = st->lines[begin].page;
+    size_t end = begin;
+    while (end < st->count && st->lines[end].page == page) {
+      end++;
+    }
+    size_t first = begin;
+    while (first < end && (st->lines[first].flags & LINE_BLANK)) {
+      first++;
+    }
+    size_t last = end;
+    while (last > first && (st->lines[last - 1].flags & LINE_BLANK)) {
+      last--;
+    }
+    if (first < end && (st->lines[first].flags & LINE_PAGE_NUMBER)) {
+      st->lines[first].flags |= LINE_DROP;
+      st->needs_compaction = true;
+    }
+    if (last > first && (st->lines[last - 1].flags & LINE_PAGE_NUMBER)) {
+      st->lines[last - 1].flags |= LINE_DROP;
+      st->needs_compaction = true;
+    }
+    begin = end;
+  }
+}
+
+static void detect_page_boilerplate(NormState *st, const char *data) {
+  uint32_t pages = 0;
+  uint32_t last_page = UINT32_MAX;
+  for (size_t i = 0; i < st->count; ++i) {
+    if (!(st->lines[i].flags & LINE_BLANK) && st->lines[i].page != last_page) {
+      last_page = st->lines[i].page;
+      pages++;
+    }
+  }
+  if (pages < NORMALIZE_MIN_PAGES) {
+    return;
+  }
+  size_t capacity = next_pow2((size_t) pages * NORMALIZE_EDGE_LINES * 4U);
+  EdgeEntry *entries = calloc(capacity, sizeof *entries);
+  if (!entries) {
+    return;
+  }
+  for_each_edge_line(st, data, entries, capacity, count_edge);
+  st->edge_threshold = pages / 2 > NORMALIZE_MIN_PAGES ? (pages + 1) / 2 : NORMALIZE_MIN_PAGES;
+  for_each_edge_line(st, data, entries, capacity, mark_edge);
+  free(entries);
+}
+
+static size_t rewrite_csv_row(char *data, size_t w, const NormLine *line, const NormTable *table) {
+  const char *s = data + line->offset;
+  size_t len = line->length;
+  size_t out = w;
+  size_t column = 0;
+  size_t field_start = 0;
+  bool in_quotes = false;
+  bool wrote_any = false;
+  for (size_t i = 0; i <= len; ++i) {
+    bool boundary = (i == len);
+    if (!boundary) {
+      if (s[i] == '"') {
+        in_quotes = !in_quotes;
+      } else if (s[i] == table->delimiter && !in_quotes) {
+        boundary = true;
+      }
+    }
+    if (!boundary) {
+      continue;
+    }
+    if (column >= table->width || table->used[column]) {
+      if (wrote_any) {
+        data[out++] = table->delimiter;
+      }
+      memmove(data + out, s + field_start, i - field_start);
+      out += i - field_start;
+      wrote_any = true;
+    }
+    column++;
+    field_start = i + 1;
+  }
+  return out;
+}
+
+static void compact_lines(NormState *st, char *data, size_t *w) {
+  for (size_t t = 0; t < st->table_count; ++t) {
+    NormTable *table = &st->tables[t];
+    if (table->irregular) {
+      continue;
+    }
+    for (size_t c = 0; c < table->width; ++c) {
+      if (!table->used[c]) {
+        st->stats->csv_columns_dropped++;
+        st->needs_compaction = true;
+      }
+    }
+  }
+  if (!st->needs_compaction) {
+    return;
+  }
+  size_t out = 0;
+  bool last_blank = true;
+  for (size_t i = 0; i < st->count; ++i) {
+    NormLine *line = &st->lines[i];
+    size_t newline = (line->flags & LINE_NEWLINE) ? 1U : 0U;
+    if (line->flags & LINE_DROP) {
+      st->stats->boilerplate_bytes += line->length + newline;
+      st->stats->boilerplate_lines++;
+      continue;
+    }
+    if (line->flags & LINE_BLANK) {
+      if (!last_blank) {
+        data[out++] = '\n';
+        last_blank = true;
+      }
+      continue;
+    }
+    size_t before = out;
+    const NormTable *table = (line->flags & LINE_CSV_ROW) ? &st->tables[line->table] : NULL;
+    if (table && !table->irregular && table->width > 0) {
+      out = rewrite_csv_row(data, out, line, table);
+      st->stats->csv_column_bytes += line->length - (out - before);
+    } else {
+      memmove(data + out, data + line->offset, line->length);
+      out += line->length;
+    }
+    if (newline) {
+      data[out++] = '\n';
+    }
+    last_blank = false;
+  }
+  *w = out;
+}
+
+static void state_free(NormState *st) {
+  for (size_t t = 0; t < st->table_count; ++t) {
+    free(st->tables[t].used);
+  }
+  free(st->tables);
+  free(st->lines);
+}
+
+bool text_normalize_mime_is_tabular(const char *mime) {
+  if (!mime) {
+    return false;
+  }
+  return strstr(mime, "csv") || strstr(mime, "spreadsheet") || strstr(mime, "tab-separated");
+}
+
+/*
+ * Compacts data in place. The input bytes are scanned once: whitespace runs collapse (tabs survive in a
+ * tabular layout, where they separate fields, and indentation elsewhere is kept up to a bounded width),
+ * page markers and separators are dropped and long base64 runs are replaced while a line table is built.
+ * Page numbers next to page breaks, repeated page headers/footers and empty CSV/TSV columns are then
+ * removed by compacting the retained lines, which only touches bytes that survive.
+ */
+int text_normalize(char *data, size_t *length, bool csv_layout, TextNormalizeStats *stats) {
+  TextNormalizeStats local;
+  TextNormalizeStats *out_stats = stats ? stats : &local;
+  memset(out_stats, 0, sizeof *out_stats);
+  if (!data || !length) {
+    return -1;
+  }
+  size_t len = *length;
+  out_stats->input_bytes = len;
+
+  NormState st;
+  memset(&st, 0, sizeof st);
+  st.tracking = true;
+  st.csv_layout = csv_layout;
+  st.last_blank = true;
+  st.stats = out_stats;
+
+  size_t r = 0;
+  size_t w = 0;
+  size_t line_start = 0;
+  bool pending_space = false;
+  bool at_line_start = true;
+  while (r < len) {
+    unsigned char c = (unsigned char) data[r];
+    if (c == '\n' || c == '\f') {
+      if (at_line_start) {
+        w = line_start;
+      }
+      finish_line(&st, data, line_start, &w, true, c == '\f');
+      line_start = w;
+      pending_space = false;
+      at_line_start = true;
+      r++;
+      continue;
+    }
+    /* Outside tabular layouts indentation is kept as written, up to NORMALIZE_MAX_INDENT bytes; a line
+     * holding nothing else is blank. Copying at most what was read keeps the write cursor behind. */
+    if (at_line_start && !csv_layout && (c == ' ' || c == '\t')) {
+      if (w - line_start < NORMALIZE_MAX_INDENT) {
+        data[w++] = (char) c;
+      }
+      r++;
+      continue;
+    }
+    if (is_inline_space(c) && !(c == '\t' && csv_layout)) {
+      pending_space = !at_line_start && !(csv_layout && data[w - 1] == '\t');
+      r++;
+      continue;
+    }
+    bool line_token = at_line_start;
+    at_line_start = false;
+    if (c == '\t') {
+      data[w++] = '\t';
+      pending_space = false;
+      r++;
+      continue;
+    }
+    if (pending_space) {
+      data[w++] = ' ';
+      pending_space = false;
+    }
+    if (is_base64_char(c)) {
+      size_t end = r;
+      while (end < len && is_base64_char((unsigned char) data[end])) {
+        end++;
+      }
+      size_t token = end - r;
+      size_t eol = end < len && data[end] == '\r' ? end + 1 : end;
+      size_t chars = 0;
+      size_t lines = 0;
+      size_t span = line_token && token >= NORMALIZE_BASE64_MIN_WIDTH && (eol == len || data[eol] == '\n')
+                        ? wrapped_base64_span(data, len, r, token, &chars, &lines)
+                        : 0;
+      /* Line-wrapped base64 counts as one run; only the bytes up to the last line's end are replaced. */
+      if (lines > 1 && chars >= NORMALIZE_BASE64_MIN_RUN && looks_like_base64(data + r, span)) {
+        char marker[48];
+        int n = snprintf(marker, sizeof marker, "[base64 omitted: %zu bytes]", chars);
+        memcpy(data + w, marker, (size_t) n);
+        w += (size_t) n;
+        out_stats->base64_bytes += span - (size_t) n;
+        out_stats->base64_runs++;
+        r += span;
+        continue;
+      }
+      if (looks_like_base64(data + r, token)) {
+        char marker[48];
+        int n = snprintf(marker, sizeof marker, "[base64 omitted: %zu bytes]", token);
+        memcpy(data + w, marker, (size_t) n);
+        w += (size_t) n;
+        out_stats->base64_bytes += token - (size_t) n;
+        out_stats->base64_runs++;
+      } else {
+        memmove(data + w, data + r, token);
+        w += token;
+      }
+      r = end;
+      continue;
+    }
+    data[w++] = (char) c;
+    r++;
+  }
+  if (at_line_start) {
+    w = line_start;
+  }
+  if (w > line_start) {
+    finish_line(&st, data, line_start, &w, false, false);
+  }
+
+  if (st.tracking) {
+    if (!csv_layout) {
+      drop_page_numbers(&st);
+      detect_page_boilerplate(&st, data);
+    }
+    compact_lines(&st, data, &w);
+  }
+  state_free(&st);
+
+  data[w] = '\0';
+  *length = w;
+  out_stats->output_bytes = w;
+  size_t saved = len - w;
+  size_t attributed = out_stats->boilerplate_bytes + out_stats->csv_column_bytes + out_stats->base64_bytes;
+  out_stats->whitespace_bytes = saved > attributed ? saved - attributed : 0;
+  return 0;
+}
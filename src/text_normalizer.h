@@ -0,0 +1,26 @@
+#ifndef TEXT_NORMALIZER_H
+#define TEXT_NORMALIZER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Byte accounting for one text_normalize() call; the category counters add up to
+ * input_bytes - output_bytes.
+ */
+typedef struct {
+  size_t input_bytes;
+  size_t output_bytes;
+  size_t whitespace_bytes;
+  size_t boilerplate_bytes;
+  size_t boilerplate_lines;
+  size_t csv_column_bytes;
+  size_t csv_columns_dropped;
+  size_t base64_bytes;
+  size_t base64_runs;
+} TextNormalizeStats;
+
+int text_normalize(char *data, size_t *length, bool csv_layout, TextNormalizeStats *stats);
+bool text_normalize_mime_is_tabular(const char *mime);
+
+#endif /* TEXT_NORMALIZER_H */
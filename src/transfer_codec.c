@@ -0,0 +1,264 @@
+#include "transfer_codec.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+/* auto only compresses when the estimate beats raw bytes by this factor, so noise in the link and codec
+ * timings does not flip a near tie towards spending CPU for nothing. */
+#define TRANSFER_CODEC_MARGIN 0.9
+
+int transfer_codec_parse(const char *text, TransferCodec *out) {
+  if (!text || !out) {
+    return -1;
+  }
+  if (strcasecmp(text, "auto") == 0) {
+    *out = TRANSFER_CODEC_AUTO;
+  } else if (strcasecmp(text, "off") == 0 || strcasecmp(text, "none") == 0) {
+    *out = TRANSFER_CODEC_OFF;
+  } else if (strcasecmp(text, "lz4") == 0) {
+    *out = TRANSFER_CODEC_LZ4;
+  } else if (strcasecmp(text, "zstd") == 0) {
+    *out = TRANSFER_CODEC_ZSTD;
+  } else if (strcasecmp(text, "zlib") == 0) {
+    *out = TRANSFER_CODEC_ZLIB;
+  } else {
+    return -1;
+  }
+  return 0;
+}
+
+const char *transfer_codec_name(TransferCodec codec) {
+  switch (codec) {
+  case TRANSFER_CODEC_OFF:
+    return "off";
+  case TRANSFER_CODEC_LZ4:
+    return "lz4";
+  case TRANSFER_CODEC_ZSTD:
+    return "zstd";
+  case TRANSFER_CODEC_ZLIB:
+    return "zlib";
+  case TRANSFER_CODEC_AUTO:
+  default:
+    return "auto";
+  }
+}
+
+bool transfer_codec_available(TransferCodec codec) {
+  switch (codec) {
+  case TRANSFER_CODEC_AUTO:
+  case TRANSFER_CODEC_OFF:
+    return true;
+#ifdef HAVE_LZ4
+  case TRANSFER_CODEC_LZ4:
+    return true;
+#endif
+#ifdef HAVE_ZSTD
+  case TRANSFER_CODEC_ZSTD:
+    return true;
+#endif
+#ifdef HAVE_ZLIB
+  case TRANSFER_CODEC_ZLIB:
+    return true;
+#endif
+  default:
+    return false;
+  }
+}
+
+size_t transfer_codec_bound(TransferCodec codec, size_t len) {
+  switch (codec) {
+#ifdef HAVE_LZ4
+  case TRANSFER_CODEC_LZ4:
+    return len <= (size_t) LZ4_MAX_INPUT_SIZE ? (size_t) LZ4_compressBound((int) len) : 0;
+#endif
+#ifdef HAVE_ZSTD
+  case TRANSFER_CODEC_ZSTD:
+    return ZSTD_compressBound(len);
+#endif
+#ifdef HAVE_ZLIB
+  case TRANSFER_CODEC_ZLIB:
+    return (size_t) compressBound((uLong) len);
+#endif
+  default:
+    return 0;
+  }
+}
+
+int transfer_codec_compress(TransferCodec codec, const char *src, size_t len, char *dst, size_t capacity,
+                            size_t *wire_len) {
+  if (!src || !dst || !wire_len) {
+    return -1;
+  }
+  switch (codec) {
+#ifdef HAVE_LZ4
+  case TRANSFER_CODEC_LZ4: {
+    if (len > (size_t) LZ4_MAX_INPUT_SIZE) {
+      return -1;
+    }
+    int written = LZ4_compress_default(src, dst, (int) len, capacity > INT_MAX ? INT_MAX : (int) capacity);
+    if (written <= 0) {
+      return -1;
+    }
+    *wire_len = (size_t) written;
+    return 0;
+  }
+#endif
+#ifdef HAVE_ZSTD
+  case TRANSFER_CODEC_ZSTD: {
+    size_t written = ZSTD_compress(dst, capacity, src, len, 1);
+    if (ZSTD_isError(written)) {
+      return -1;
+    }
+    *wire_len = written;
+    return 0;
+  }
+#endif
+#ifdef HAVE_ZLIB
+  case TRANSFER_CODEC_ZLIB: {
+    uLongf written = (uLongf) capacity;
+    if (compress2((Bytef *) dst, &written, (const Bytef *) src, (uLong) len, 1) != Z_OK) {
+      return -1;
+    }
+    *wire_len = (size_t) written;
+    return 0;
+  }
+#endif
+  default:
+    (void) len;
+    (void) capacity;
+    return -1;
+  }
+}
+
+int transfer_codec_decompress(TransferCodec codec, const char *src, size_t wire_len, char *dst, size_t dst_len) {
+  if (!src || !dst) {
+    return -1;
+  }
+  switch (codec) {
+#ifdef HAVE_LZ4
+  case TRANSFER_CODEC_LZ4:
+    if (wire_len > INT_MAX || dst_len > INT_MAX) {
+      return -1;
+    }
+    return LZ4_decompress_safe(src, dst, (int) wire_len, (int) dst_len) == (int) dst_len ? 0 : -1;
+#endif
+#ifdef HAVE_ZSTD
+  case TRANSFER_CODEC_ZSTD: {
+    size_t produced = ZSTD_decompress(dst, dst_len, src, wire_len);
+    return !ZSTD_isError(produced) && produced == dst_len ? 0 : -1;
+  }
+#endif
+#ifdef HAVE_ZLIB
+  case TRANSFER_CODEC_ZLIB: {
+    uLongf produced = (uLongf) dst_len;
+    int rc = uncompress((Bytef *) dst, &produced, (const Bytef *) src, (uLong) wire_len);
+    return rc == Z_OK && produced == (uLongf) dst_len ? 0 : -1;
+  }
+#endif
+  default:
+    (void) wire_len;
+    (void) dst_len;
+    return -1;
+  }
+}
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+int transfer_codec_profile(TransferCodec codec, const char *sample, size_t len, TransferCodecProfile *out) {
+  size_t capacity = transfer_codec_bound(codec, len);
+  if (!sample || len == 0 || !out || capacity == 0) {
+    return -1;
+  }
+  char *wire = malloc(capacity);
+  char *restored = malloc(len);
+  if (!wire || !restored) {
+    free(wire);
+    free(restored);
+    return -1;
+  }
+  size_t wire_len = 0;
+  double started = now_seconds();
+  int rc = transfer_codec_compress(codec, sample, len, wire, capacity, &wire_len);
+  double compressed = now_seconds();
+  if (rc == 0) {
+    rc = transfer_codec_decompress(codec, wire, wire_len, restored, len);
+  }
+  double restored_at = now_seconds();
+  if (rc == 0) {
+    /* A clock tick floor keeps tiny samples from reporting infinite rates. */
+    out->codec = codec;
+    out->ratio = (double) len / (double) (wire_len ? wire_len : 1);
+    out->compress_rate = (double) len / (compressed - started > 1e-6 ? compressed - started : 1e-6);
+    out->decompress_rate = (double) len / (restored_at - compressed > 1e-6 ? restored_at - compressed : 1e-6);
+  }
+  free(wire);
+  free(restored);
+  return rc;
+}
+
+/* Seconds per input byte. Transfers go in segments, so compressing one segment, sending the previous
+ * one and expanding the one before overlap, and the slowest of the three stages sets the pace. */
+static double profile_cost(const TransferCodecProfile *profile, double link_rate) {
+  double cost = 1.0 / profile->compress_rate;
+  double send = 1.0 / (profile->ratio * link_rate);
+  double expand = 1.0 / profile->decompress_rate;
+  cost = send > cost ? send : cost;
+  return expand > cost ? expand : cost;
+}
+
+TransferCodec transfer_codec_choose(TransferCodec requested, const char *sample, size_t len, double link_rate,
+                                    TransferCodecProfile *chosen) {
+  if (chosen) {
+    memset(chosen, 0, sizeof *chosen);
+    chosen->codec = TRANSFER_CODEC_OFF;
+  }
+  if (requested != TRANSFER_CODEC_AUTO) {
+    if (chosen && requested != TRANSFER_CODEC_OFF) {
+      transfer_codec_profile(requested, sample, len, chosen);
+      chosen->codec = requested;
+    }
+    return requested;
+  }
+  if (link_rate <= 0.0) {
+    return TRANSFER_CODEC_OFF;
+  }
+  static const TransferCodec candidates[] = {TRANSFER_CODEC_LZ4, TRANSFER_CODEC_ZSTD, TRANSFER_CODEC_ZLIB};
+  TransferCodec best = TRANSFER_CODEC_OFF;
+  double best_cost = TRANSFER_CODEC_MARGIN / link_rate;
+  for (size_t i = 0; i < sizeof candidates / sizeof candidates[0]; ++i) {
+    TransferCodecProfile profile;
+    if (!transfer_codec_available(candidates[i]) || transfer_codec_profile(candidates[i], sample, len, &profile) != 0) {
+      continue;
+    }
+    double cost = profile_cost(&profile, link_rate);
+    if (cost < best_cost) {
+      best = candidates[i];
+      best_cost = cost;
+      if (chosen) {
+        *chosen = profile;
+      }
+    }
+  }
+  return best;
+}
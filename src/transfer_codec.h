@@ -0,0 +1,55 @@
+#ifndef TRANSFER_CODEC_H
+#define TRANSFER_CODEC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Fast compression for bulk MPI transfers (the payload broadcast and the response stream to rank 0).
+ * Codecs are the optional libraries configure found: lz4, zstd (level 1) and zlib (level 1). auto
+ * profiles each built codec on a sample of the data and keeps the one whose slowest stage (compress,
+ * send the smaller data, decompress) beats sending raw bytes over the measured link; off always sends
+ * raw bytes.
+ * Every compressed unit is framed with its codec and wire length, so a unit that does not shrink is
+ * simply sent raw.
+ */
+typedef enum {
+  TRANSFER_CODEC_AUTO = 0,
+  TRANSFER_CODEC_OFF,
+  TRANSFER_CODEC_LZ4,
+  TRANSFER_CODEC_ZSTD,
+  TRANSFER_CODEC_ZLIB
+} TransferCodec;
+
+/* What one codec achieved on a sample: input bytes per wire byte, and input bytes per second in each
+ * direction. */
+typedef struct {
+  TransferCodec codec;
+  double ratio;
+  double compress_rate;
+  double decompress_rate;
+} TransferCodecProfile;
+
+int transfer_codec_parse(const char *text, TransferCodec *out);
+const char *transfer_codec_name(TransferCodec codec);
+/* True for auto and off, and for codecs this build links. */
+bool transfer_codec_available(TransferCodec codec);
+
+/* Largest output transfer_codec_compress may produce for len input bytes (0 for auto and off). */
+size_t transfer_codec_bound(TransferCodec codec, size_t len);
+/* Compresses src into dst. Returns -1 when the codec cannot take the input or dst is too small; the
+ * caller then sends src raw. */
+int transfer_codec_compress(TransferCodec codec, const char *src, size_t len, char *dst, size_t capacity,
+                            size_t *wire_len);
+/* Returns 0 only when src expands to exactly dst_len bytes. */
+int transfer_codec_decompress(TransferCodec codec, const char *src, size_t wire_len, char *dst, size_t dst_len);
+
+/* Times codec over sample (which should be at least a few hundred KiB to mean anything). */
+int transfer_codec_profile(TransferCodec codec, const char *sample, size_t len, TransferCodecProfile *out);
+/* Picks the codec for data like sample on a link moving link_rate bytes per second. A specific codec
+ * is kept as requested; auto profiles every built codec and returns the fastest end to end, or off
+ * when none beats raw bytes. chosen (optional) receives the winner's profile. */
+TransferCodec transfer_codec_choose(TransferCodec requested, const char *sample, size_t len, double link_rate,
+                                    TransferCodecProfile *chosen);
+
+#endif /* TRANSFER_CODEC_H */
@@ -0,0 +1,121 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "text_normalizer.h"
+
+static int failures = 0;
+
+/* Normalizes a copy of input and compares the result with expected byte for byte. */
+static void check(const char *name, const char *input, bool csv_layout, const char *expected) {
+  size_t length = strlen(input);
+  char *data = malloc(length + 1);
+  if (!data) {
+    fprintf(stderr, "%s: out of memory\n", name);
+    failures++;
+    return;
+  }
+  memcpy(data, input, length + 1);
+  TextNormalizeStats stats;
+  if (text_normalize(data, &length, csv_layout, &stats) != 0) {
+    fprintf(stderr, "FAIL %s: text_normalize returned an error\n", name);
+    failures++;
+  } else if (length != strlen(expected) || memcmp(data, expected, length) != 0) {
+    fprintf(stderr, "FAIL %s:\n--- expected\n%s\n--- got\n%.*s\n", name, expected, (int) length, data);
+    failures++;
+  } else if (stats.input_bytes - stats.output_bytes != stats.whitespace_bytes + stats.boilerplate_bytes +
+                                                           stats.csv_column_bytes + stats.base64_bytes) {
+    fprintf(stderr, "FAIL %s: byte categories do not add up\n", name);
+    failures++;
+  }
+  free(data);
+}
+
+/* count lines of width base64 characters mixing upper case, lower case and digits, then a closing line of
+ * tail characters; every line ends in eol. */
+static char *wrapped_base64(size_t width, size_t count, size_t tail, const char *eol) {
+  static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  size_t eol_len = strlen(eol);
+  char *out = malloc((width + eol_len) * (count + 1) + 1);
+  if (!out) {
+    return NULL;
+  }
+  size_t w = 0;
+  size_t k = 0;
+  for (size_t line = 0; line <= count; ++line) {
+    size_t n = line < count ? width : tail;
+    for (size_t i = 0; i < n; ++i) {
+      out[w++] = alphabet[(k++ * 7) % 64];
+    }
+    memcpy(out + w, eol, eol_len);
+    w += eol_len;
+  }
+  out[w] = '\0';
+  return out;
+}
+
+static void check_base64(void) {
+  char *body = wrapped_base64(76, 20, 40, "\r\n");
+  char *pem = wrapped_base64(64, 10, 64, "\n");
+  char *narrow = wrapped_base64(12, 30, 4, "\n");
+  char *token = wrapped_base64(256, 1, 0, "");
+  if (!body || !pem || !narrow || !token) {
+    fprintf(stderr, "base64: out of memory\n");
+    failures++;
+    free(body);
+    free(pem);
+    free(narrow);
+    free(token);
+    return;
+  }
+  char input[4096];
+  snprintf(input, sizeof input, "Content-Transfer-Encoding: base64\r\n\r\n%s\r\n--boundary--\r\n", body);
+  check("wrapped MIME body", input, false,
+        "Content-Transfer-Encoding: base64\n\n[base64 omitted: 1560 bytes]\n\n--boundary--\n");
+  snprintf(input, sizeof input, "-----BEGIN CERTIFICATE-----\n%s-----END CERTIFICATE-----\n", pem);
+  check("PEM block", input, false,
+        "-----BEGIN CERTIFICATE-----\n[base64 omitted: 704 bytes]\n-----END CERTIFICATE-----\n");
+  /* Lines narrower than the minimum width are left alone, however many there are. */
+  check("narrow lines", narrow, false, narrow);
+  snprintf(input, sizeof input, "key: %s end\n", token);
+  check("unbroken run", input, false, "key: [base64 omitted: 256 bytes] end\n");
+  check("short lines", "ABCDEFGHabcdefgh12345678\nABCDEFGHabcdefgh12345678\nplain words\n", false,
+        "ABCDEFGHabcdefgh12345678\nABCDEFGHabcdefgh12345678\nplain words\n");
+  free(body);
+  free(pem);
+  free(narrow);
+  free(token);
+}
+
+int main(void) {
+  check("whitespace", "one   two\t three\n\n\n\nfour  \n", false, "one two three\n\nfour\n");
+
+  check("CSV empty column", "a,,c\n1,,3\n4,,6\n", true, "a,c\n1,3\n4,6\n");
+  check("TSV empty column", "a\t\tc\n1\t\t3\n4\t\t6\n", true, "a\tc\n1\t3\n4\t6\n");
+  check("TSV keeps tabs", "name\tcity\nAda Lovelace\tLondon\n", true, "name\tcity\nAda Lovelace\tLondon\n");
+  check("CSV repeated header", "a,b\n1,2\na,b\n3,4\n", true, "a,b\n1,2\n3,4\n");
+  check("CSV quoted commas", "a,\"b,c\",d\n1,\"2,3\",\n", true, "a,\"b,c\",d\n1,\"2,3\",\n");
+
+  check("page numbers at page edges", "Intro\nbody one\n3\n\fbody two\n4\n", false, "Intro\nbody one\nbody two\n");
+  check("numbers in unpaged text", "Steps:\n1\n2\n", false, "Steps:\n1\n2\n");
+  check("page marker", "first\n----- Page 2 -----\nsecond\n", false, "first\nsecond\n");
+
+  check("indentation", "def f():\n    return 1\n\t\tx\n", false, "def f():\n    return 1\n\t\tx\n");
+  check("indentation cap", "                        deep\n", false, "                deep\n");
+  check("whitespace-only line", "a\n    \nb\n", false, "a\n\nb\n");
+
+  check("setext headings", "Title\n=====\n\nSection\n-------\ntext\n", false,
+        "Title\n=====\n\nSection\n-------\ntext\n");
+  check("free-standing rule", "a\n\n-----\n\nb\n", false, "a\n\nb\n");
+  check("tilde fence", "~~~~\ncode\n~~~~\n", false, "~~~~\ncode\n~~~~\n");
+  check("rule inside fence", "```\n\n====\n```\n", false, "```\n\n====\n```\n");
+
+  check_base64();
+
+  if (failures > 0) {
+    fprintf(stderr, "%d text_normalize check(s) failed\n", failures);
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}